@@ -0,0 +1,63 @@
+﻿#include "benchmarks.h"
+#include "bench_common.h"
+#include "physics.h"
+#include <algorithm>
+
+// Accuracy of the tree code against the exact direct sum for several opening angles
+void Benchmarks::barnesHutAccuracy() {
+    const size_t n = 4000;
+    Simulation reference = makeDiskSimulation(n);
+    double directTime = measureSeconds([&] { Physics::computeAccelerations(reference); });
+
+    std::cout << "Barnes-Hut accuracy, N = " << n << " (direct sum: " << directTime << " s)\n";
+    std::cout << std::setw(8) << "theta" << std::setw(16) << "mean rel err"
+        << std::setw(16) << "max rel err" << std::setw(12) << "time (s)" << "\n";
+
+    for (LD theta : { 0.0L, 0.25L, 0.5L, 0.75L, 1.0L }) {
+        Simulation sim = makeDiskSimulation(n);
+        sim.solver = ForceSolver::BarnesHut;
+        sim.tree.theta = theta;
+        double t = measureSeconds([&] { sim.computeAccelerations(); });
+
+        LD sumErr = 0, maxErr = 0;
+        for (size_t i = 0; i < n; ++i) {
+            LD exact = reference.bodies[i].acceleration.norm();
+            if (exact < MIN_NUMBER) continue;
+            LD err = (sim.bodies[i].acceleration - reference.bodies[i].acceleration).norm() / exact;
+            sumErr += err;
+            maxErr = std::max(maxErr, err);
+        }
+        std::cout << std::setw(8) << static_cast<double>(theta)
+            << std::setw(16) << static_cast<double>(sumErr / n)
+            << std::setw(16) << static_cast<double>(maxErr)
+            << std::setw(12) << t << "\n";
+    }
+}
+
+// Time per force evaluation as N grows; the direct sum is skipped where it takes too long
+void Benchmarks::barnesHutScaling() {
+    const size_t maxDirectN = 20000;
+
+    std::cout << "Force evaluation time vs N (theta = 0.5)\n";
+    std::cout << std::setw(10) << "N" << std::setw(14) << "direct (s)"
+        << std::setw(14) << "tree (s)" << std::setw(10) << "speedup" << "\n";
+
+    for (size_t n : { 1000, 2000, 5000, 10000, 20000, 50000 }) {
+        Simulation tree = makeDiskSimulation(n);
+        tree.solver = ForceSolver::BarnesHut;
+        tree.tree.theta = 0.5;
+        tree.computeAccelerations(); // warm-up: fills the node arena
+        double treeTime = measureSeconds([&] { tree.computeAccelerations(); });
+
+        std::cout << std::setw(10) << n;
+        if (n <= maxDirectN) {
+            Simulation direct = makeDiskSimulation(n);
+            double directTime = measureSeconds([&] { Physics::computeAccelerations(direct); });
+            std::cout << std::setw(14) << directTime << std::setw(14) << treeTime
+                << std::setw(10) << directTime / treeTime << "\n";
+        }
+        else {
+            std::cout << std::setw(14) << "-" << std::setw(14) << treeTime << std::setw(10) << "-" << "\n";
+        }
+    }
+}
\ No newline at end of file
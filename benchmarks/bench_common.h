@@ -0,0 +1,49 @@
+#pragma once
+#include "helpers.h"
+#include "simulation.h"
+#include "physics.h"
+#include <chrono>
+#include <random>
+
+// Rotating exponential-ish disk around a heavy central mass,
+// the kind of galaxy-disk setup the tree codes are meant for.
+inline Simulation makeDiskSimulation(size_t n, unsigned seed = 42) {
+    Simulation sim;
+    std::mt19937_64 rng(seed);
+    std::exponential_distribution<double> radius(1.0 / 3e19);
+    std::uniform_real_distribution<double> angle(0.0, 2 * M_PI);
+
+    const LD centralMass = 1e41;
+    sim.addBody(Body(centralMass, 1e10, { 0, 0 }, { 0, 0 }));
+    for (size_t i = 1; i < n; ++i) {
+        LD r = radius(rng) + 1e18;
+        LD a = angle(rng);
+        LD v = std::sqrt(6.67430e-11 * centralMass / r);
+        sim.addBody(Body(1e30, 1e9, { r * std::cos(a), r * std::sin(a) }, { -v * std::sin(a), v * std::cos(a) }));
+    }
+    return sim;
+}
+
+// Circular Earth-satellite orbit (the default setup), integrated over exactly one period
+inline Simulation makeCircularOrbit(IntegratorType type, int stepsPerOrbit, LD& period) {
+    const LD M = 5.97e24, m = 1000, r = 7.37e6;
+    const LD mu = Physics::G * (M + m);
+    const LD v = std::sqrt(mu / r);
+    period = 2 * M_PI * std::sqrt(r * r * r / mu);
+
+    Simulation sim;
+    sim.dt = period / stepsPerOrbit;
+    sim.setIntegrator(type);
+    // Center of mass at rest
+    sim.addBody(Body(M, 6.37e6, { -r * m / (M + m), 0 }, { 0, -v * m / (M + m) }));
+    sim.addBody(Body(m, 1, { r * M / (M + m), 0 }, { 0, v * M / (M + m) }));
+    return sim;
+}
+
+template <typename F>
+double measureSeconds(F&& f) {
+    auto start = std::chrono::steady_clock::now();
+    f();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(end - start).count();
+}
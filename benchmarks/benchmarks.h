@@ -0,0 +1,23 @@
+#pragma once
+#include "suite.h"
+
+class Benchmarks {
+public:
+    static void barnesHutAccuracy();
+    static void barnesHutScaling();
+    static void directKernels();
+    static void mixedPrecision();
+    static void softening();
+    static void strongScaling();
+    static void integrators();
+    static void blockTimesteps();
+    static void collisions();
+    static void fmmAccuracy();
+    static void fmmScaling();
+    static void dimensions();
+    static void diagnostics();
+    static void ensemble();
+
+    // Regression-tracking cases with JSON output (see suite.h)
+    static void suite(Suite& suite);
+};
@@ -0,0 +1,67 @@
+﻿#include "benchmarks.h"
+#include "bench_common.h"
+#include "physics.h"
+
+// Disk plus one tight binary: the binary's period is ~1000x shorter than the disk's
+static Simulation makeHierarchicalSystem(size_t n) {
+    Simulation sim = makeDiskSimulation(n);
+    const LD m = 1e30, a = 1e14, r = 3e19;
+    const LD vOrbit = std::sqrt(Physics::G * 1e41 / r);
+    const LD vBinary = std::sqrt(Physics::G * m / (2 * a));
+    sim.addBody(Body(m, 1e9, { r + a / 2, 0 }, { 0, vOrbit + vBinary }));
+    sim.addBody(Body(m, 1e9, { r - a / 2, 0 }, { 0, vOrbit - vBinary }));
+    return sim;
+}
+
+static LD totalEnergy(const Simulation& sim) {
+    LD e = 0;
+    const auto& b = sim.bodies;
+    for (size_t i = 0; i < b.size(); ++i) {
+        e += b[i].mass * (b[i].velocity.x * b[i].velocity.x + b[i].velocity.y * b[i].velocity.y) / 2;
+        for (size_t j = i + 1; j < b.size(); ++j) {
+            e -= Physics::G * b[i].mass * b[j].mass / Physics::calculateDistance(b[i], b[j]);
+        }
+    }
+    return e;
+}
+
+static LD binarySeparation(const Simulation& sim) {
+    size_t n = sim.bodies.size();
+    return Physics::calculateDistance(sim.bodies[n - 1], sim.bodies[n - 2]);
+}
+
+// Same simulated span: global leapfrog at the binary's time step vs block time steps
+void Benchmarks::blockTimesteps() {
+    const size_t n = 2000;
+    const LD span = 1e12;        // ~2 binary periods
+    const int globalSteps = 400; // ~200 steps per binary period
+    const int blocks = 4;
+
+    Simulation global = makeHierarchicalSystem(n);
+    global.setIntegrator(IntegratorType::LeapfrogKDK);
+    global.dt = span / globalSteps;
+    LD e0 = totalEnergy(global);
+    double globalTime = measureSeconds([&] { for (int k = 0; k < globalSteps; ++k) global.step(); });
+
+    Simulation block = makeHierarchicalSystem(n);
+    block.setIntegrator(IntegratorType::BlockTimestep);
+    block.dt = span / blocks;
+    double blockTime = measureSeconds([&] { for (int k = 0; k < blocks; ++k) block.step(); });
+    auto* integrator = static_cast<BlockTimestepIntegrator*>(block.integrator.get());
+
+    int maxLevel = 0;
+    for (int level : integrator->level) maxLevel = std::max(maxLevel, level);
+
+    std::cout << "Disk + close binary, N = " << n + 2 << ", simulated " << static_cast<double>(span) << " s\n";
+    std::cout << std::setw(20) << "" << std::setw(14) << "time (s)" << std::setw(18) << "body forces"
+        << std::setw(14) << "energy drift" << std::setw(16) << "binary sep (m)" << "\n";
+    std::cout << std::setw(20) << "global leapfrog" << std::setw(14) << globalTime
+        << std::setw(18) << global.forceEvaluations * static_cast<long long>(n + 2)
+        << std::setw(14) << static_cast<double>(std::fabs((totalEnergy(global) - e0) / e0))
+        << std::setw(16) << static_cast<double>(binarySeparation(global)) << "\n";
+    std::cout << std::setw(20) << "block time steps" << std::setw(14) << blockTime
+        << std::setw(18) << integrator->activeForceEvaluations
+        << std::setw(14) << static_cast<double>(std::fabs((totalEnergy(block) - e0) / e0))
+        << std::setw(16) << static_cast<double>(binarySeparation(block)) << "\n";
+    std::cout << "speedup: " << globalTime / blockTime << "x, deepest level: " << maxLevel << "\n";
+}
\ No newline at end of file
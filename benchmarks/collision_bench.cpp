@@ -0,0 +1,84 @@
+﻿#include "benchmarks.h"
+#include "bench_common.h"
+#include "collision.h"
+
+// Uniform cloud in a square whose side keeps the mean number of contacts per body fixed
+static std::vector<Body> makeCloud(size_t n, unsigned seed = 7) {
+    std::mt19937_64 rng(seed);
+    const LD radius = 1.0;
+    const LD side = std::sqrt(static_cast<LD>(n) * 4 * M_PI * radius * radius / 0.05); // ~5% contacts per body
+    std::uniform_real_distribution<double> pos(0.0, static_cast<double>(side));
+    std::vector<Body> bodies;
+    for (size_t i = 0; i < n; ++i) {
+        bodies.push_back(Body(1.0, radius, { pos(rng), pos(rng) }, { 0, 0 }));
+    }
+    return bodies;
+}
+
+static void bruteForceOverlaps(const std::vector<Body>& b, std::vector<std::pair<int, int>>& pairs) {
+    pairs.clear();
+    for (size_t i = 0; i < b.size(); ++i) {
+        for (size_t j = i + 1; j < b.size(); ++j) {
+            LD dx = b[i].position.x - b[j].position.x, dy = b[i].position.y - b[j].position.y;
+            LD r = b[i].radius + b[j].radius;
+            if (dx * dx + dy * dy < r * r) pairs.emplace_back(static_cast<int>(i), static_cast<int>(j));
+        }
+    }
+}
+
+// Broad phase vs the O(N^2) sweep, plus momentum/mass conservation of merging
+void Benchmarks::collisions() {
+    std::cout << std::setw(8) << "N" << std::setw(10) << "contacts" << std::setw(14) << "sweep [ms]"
+        << std::setw(14) << "hash [ms]" << std::setw(16) << "rehash [ms]" << std::setw(10) << "same" << "\n";
+
+    for (size_t n : { 1000, 4000, 16000, 64000, 256000 }) {
+        std::vector<Body> bodies = makeCloud(n);
+        std::vector<std::pair<int, int>> expected, found;
+
+        SpatialHash grid;
+        double hashTime = measureSeconds([&] { grid.findOverlaps(bodies, found); });
+        // Second call with nobody crossing a cell: the bucket order is reused
+        double reuseTime = measureSeconds([&] { grid.findOverlaps(bodies, found); });
+
+        std::cout << std::setw(8) << n << std::setw(10) << found.size();
+        if (n <= 16000) {
+            double sweepTime = measureSeconds([&] { bruteForceOverlaps(bodies, expected); });
+            std::cout << std::setw(14) << sweepTime * 1e3;
+        }
+        else {
+            std::cout << std::setw(14) << "-";
+        }
+        std::cout << std::setw(14) << hashTime * 1e3 << std::setw(16) << reuseTime * 1e3
+            << std::setw(10) << (n <= 16000 ? (found == expected ? "yes" : "NO") : "-") << "\n";
+    }
+
+    // Accretion: a cold collapsing cloud with merging, conservation of mass and momentum
+    Simulation sim;
+    for (const Body& b : makeCloud(2000, 11)) {
+        sim.addBody(Body(1e12, 50, b.position * 20, { 0, 0 }));
+    }
+    sim.bodies[0].velocity = { 1, 0 }; // some net momentum to conserve
+    sim.setIntegrator(IntegratorType::LeapfrogKDK);
+    sim.collisionPolicy = CollisionPolicy::Merge;
+    sim.dt = 10;
+
+    auto totals = [&](LD& m, Vec2& p) {
+        m = 0;
+        p = { 0, 0 };
+        for (const auto& b : sim.bodies) {
+            m += b.mass;
+            p = p + b.velocity * b.mass;
+        }
+    };
+    LD m0, m1;
+    Vec2 p0, p1;
+    totals(m0, p0);
+    double t = measureSeconds([&] { for (int k = 0; k < 200; ++k) sim.step(); });
+    totals(m1, p1);
+
+    std::cout << "\naccretion, 2000 bodies, 200 steps: " << sim.collisions.total << " contacts merged, "
+        << sim.bodies.size() << " bodies left, " << t << " s\n"
+        << "  mass drift " << static_cast<double>((m1 - m0) / m0)
+        << ", momentum drift " << static_cast<double>((p1 - p0).norm() / p0.norm()) << " (relative)\n"
+        << "  grid rebuilds " << sim.collisions.grid.rebuilds << ", reuses " << sim.collisions.grid.reuses << "\n";
+}
\ No newline at end of file
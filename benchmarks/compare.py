@@ -0,0 +1,87 @@
+#!/usr/bin/env python3
+"""Compares two benchmark JSON files (benchmarks --json, or Google Benchmark output).
+
+    compare.py baseline.json contender.json [--threshold 0.10] [--metric real_time]
+
+Prints the per-case time change and exits with status 1 if any case common to
+both files got slower by more than the threshold (a fraction: 0.10 = 10%).
+Cases present in only one of the files are listed but never fail the check.
+"""
+import argparse
+import json
+import sys
+
+
+def load(path):
+    with open(path, encoding="utf-8") as f:
+        data = json.load(f)
+    results = {}
+    for b in data.get("benchmarks", []):
+        # Aggregates (mean/median/stddev rows) of repeated Google Benchmark runs are skipped
+        if b.get("run_type", "iteration") != "iteration":
+            continue
+        results[b["name"]] = b
+    return data.get("context", {}), results
+
+
+def format_time(ns):
+    for unit, scale in (("s", 1e9), ("ms", 1e6), ("us", 1e3)):
+        if ns >= scale:
+            return "%.3g %s" % (ns / scale, unit)
+    return "%.3g ns" % ns
+
+
+UNIT_NS = {"ns": 1.0, "us": 1e3, "ms": 1e6, "s": 1e9}
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Flag benchmark regressions between two runs.")
+    parser.add_argument("baseline")
+    parser.add_argument("contender")
+    parser.add_argument("--threshold", type=float, default=0.10,
+                        help="allowed slowdown as a fraction (default 0.10)")
+    parser.add_argument("--metric", default="real_time", choices=("real_time", "cpu_time"))
+    args = parser.parse_args()
+
+    base_context, base = load(args.baseline)
+    new_context, new = load(args.contender)
+    for key in ("num_cpus", "isa", "library_build_type"):
+        if key in base_context and key in new_context and base_context[key] != new_context[key]:
+            print("warning: %s differs (%s vs %s), timings may not be comparable"
+                  % (key, base_context[key], new_context[key]))
+
+    width = max([len(n) for n in list(base) + list(new)] + [4])
+    print("%-*s %12s %12s %9s" % (width, "case", "baseline", "contender", "change"))
+
+    regressions = []
+    for name in base:
+        if name not in new:
+            continue
+        b = base[name][args.metric] * UNIT_NS[base[name].get("time_unit", "ns")]
+        c = new[name][args.metric] * UNIT_NS[new[name].get("time_unit", "ns")]
+        change = c / b - 1 if b > 0 else 0.0
+        flag = ""
+        if change > args.threshold:
+            flag = "  REGRESSION"
+            regressions.append(name)
+        elif change < -args.threshold:
+            flag = "  faster"
+        print("%-*s %12s %12s %+8.1f%%%s" % (width, name, format_time(b), format_time(c), 100 * change, flag))
+
+    for name in base:
+        if name not in new:
+            print("%-*s only in %s" % (width, name, args.baseline))
+    for name in new:
+        if name not in base:
+            print("%-*s only in %s" % (width, name, args.contender))
+
+    if regressions:
+        print("\n%d case(s) slower by more than %.0f%%: %s"
+              % (len(regressions), 100 * args.threshold, ", ".join(regressions)))
+        return 1
+    print("\nno regressions above %.0f%%" % (100 * args.threshold))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,51 @@
+﻿#include "benchmarks.h"
+#include "bench_common.h"
+
+struct DiagnosticsCase {
+    const char* name;
+    ForceSolver solver;
+    Precision precision;
+    size_t n;
+};
+
+static Simulation makeCase(const DiagnosticsCase& c, long long every) {
+    Simulation sim = makeDiskSimulation(c.n);
+    sim.dt = 1e9;
+    sim.setIntegrator(IntegratorType::VelocityVerlet);
+    sim.solver = c.solver;
+    sim.precision = c.precision;
+    sim.fmm.errorSamples = 0;
+    sim.diagnostics.every = every;
+    sim.step(); // warm-up, also takes the reference sample
+    return sim;
+}
+
+// Cost of the conserved-quantity samples, per step: the potential is summed
+// in the force loop of the sampled step, the rest is O(N)
+void Benchmarks::diagnostics() {
+    const DiagnosticsCase cases[] = {
+        { "direct long double", ForceSolver::Direct, Precision::LongDouble, 2048 },
+        { "direct double", ForceSolver::Direct, Precision::Double, 8192 },
+        { "direct float", ForceSolver::Direct, Precision::Float, 8192 },
+        { "barnes-hut", ForceSolver::BarnesHut, Precision::LongDouble, 32768 },
+        { "fmm", ForceSolver::Fmm, Precision::LongDouble, 32768 },
+    };
+    const int rounds = 10;
+
+    std::cout << "Diagnostics overhead, Velocity Verlet\n";
+    std::cout << std::setw(20) << "solver" << std::setw(8) << "N" << std::setw(14) << "off (ms)"
+        << std::setw(16) << "every 100 (%)" << std::setw(14) << "every 1 (%)" << "\n";
+    for (const auto& c : cases) {
+        // Interleaved rounds, best of each: the three runs see the same machine state
+        Simulation runs[3] = { makeCase(c, 0), makeCase(c, 100), makeCase(c, 1) };
+        double best[3] = { 1e300, 1e300, 1e300 };
+        for (int round = 0; round < rounds; ++round) {
+            for (int k = 0; k < 3; ++k) {
+                best[k] = std::min(best[k], measureSeconds([&] { runs[k].step(); }));
+            }
+        }
+        const double off = best[0], sparse = best[1], dense = best[2];
+        std::cout << std::setw(20) << c.name << std::setw(8) << c.n << std::setw(14) << off * 1e3
+            << std::setw(16) << 100 * (sparse / off - 1) << std::setw(14) << 100 * (dense / off - 1) << "\n";
+    }
+}
\ No newline at end of file
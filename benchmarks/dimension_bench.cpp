@@ -0,0 +1,43 @@
+﻿#include "benchmarks.h"
+#include "bench_common.h"
+#include "basicsimulation.h"
+
+// Same bodies (a unit cube, flattened to z = 0 for 2D) in every instantiation
+template <int D, typename T>
+static std::vector<BodyT<D, T>> makeCube(size_t n) {
+    std::mt19937_64 rng(42);
+    std::uniform_real_distribution<double> coord(-1.0, 1.0);
+    std::vector<BodyT<D, T>> bodies(n);
+    for (auto& b : bodies) {
+        b.mass = 1;
+        b.position.x = static_cast<T>(coord(rng));
+        b.position.y = static_cast<T>(coord(rng));
+        double z = coord(rng);
+        if constexpr (D == 3) b.position.z = static_cast<T>(z);
+    }
+    return bodies;
+}
+
+template <int D, typename T>
+static void reportDirectSum(const char* name, size_t n) {
+    auto bodies = makeCube<D, T>(n);
+    Physics::directSum(bodies); // warm-up
+    double t = measureSeconds([&] { Physics::directSum(bodies); });
+    std::cout << std::setw(18) << name << std::setw(8) << sizeof(Vec<D, T>) << std::setw(12) << t
+        << std::setw(14) << t * 1e9 / (static_cast<double>(n) * (n - 1)) << "\n";
+}
+
+// Cost of the templated direct sum per dimension and precision
+// (a 3D vector does four lanes of work, the fourth one padding)
+void Benchmarks::dimensions() {
+    const size_t n = 4000;
+    std::cout << "Physics::directSum, N = " << n << "\n";
+    std::cout << std::setw(18) << "instantiation" << std::setw(8) << "bytes" << std::setw(12) << "time (s)"
+        << std::setw(14) << "ns/pair" << "\n";
+    reportDirectSum<2, LD>("<2, long double>", n);
+    reportDirectSum<2, double>("<2, double>", n);
+    reportDirectSum<2, float>("<2, float>", n);
+    reportDirectSum<3, LD>("<3, long double>", n);
+    reportDirectSum<3, double>("<3, double>", n);
+    reportDirectSum<3, float>("<3, float>", n);
+}
\ No newline at end of file
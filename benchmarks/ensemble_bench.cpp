@@ -0,0 +1,94 @@
+﻿#include "benchmarks.h"
+#include "bench_common.h"
+#include "basicsimulation.h"
+#include "ensemble.h"
+
+// A central mass with k - 1 light satellites on circular orbits, satellite speeds varied per run
+static SweepSpec makeSweep(int k, long long runs, long long steps) {
+    SweepSpec spec;
+    spec.runs = runs;
+    spec.base.dt = 1;
+    spec.base.steps = steps;
+    spec.base.integrator = IntegratorType::LeapfrogKDK;
+    const LD M = 5.97e24;
+    spec.base.bodies.push_back(Body(M, 6.37e6, { 0, 0 }, { 0, 0 }));
+    for (int i = 1; i < k; ++i) {
+        LD r = 7.37e6 + 1e6 * i;
+        LD v = std::sqrt(Physics::G * M / r);
+        spec.base.bodies.push_back(Body(1000, 1, { r, 0 }, { 0, v }));
+        SweepParameter p;
+        p.field = SweepParameter::Field::Vy;
+        p.body = i;
+        p.distribution = SweepParameter::Distribution::Uniform;
+        p.a = static_cast<double>(v * 0.98L);
+        p.b = static_cast<double>(v * 1.02L);
+        spec.parameters.push_back(p);
+    }
+    return spec;
+}
+
+// Setup of one run, as the ensemble builds it
+static std::vector<Body> runBodies(const SweepSpec& spec, long long run) {
+    std::vector<Body> bodies = spec.base.bodies;
+    for (size_t p = 0; p < spec.parameters.size(); ++p) {
+        bodies[spec.parameters[p].body].velocity.y = spec.parameters[p].value(spec.seed, run, spec.runs, static_cast<int>(p));
+    }
+    return bodies;
+}
+
+// The same runs one at a time: the reference Simulation and the double-precision BasicSimulation
+static double oneByOneReference(const SweepSpec& spec, long long runs) {
+    return measureSeconds([&] {
+        for (long long run = 0; run < runs; ++run) {
+            Simulation sim;
+            sim.dt = spec.base.dt;
+            sim.setIntegrator(spec.base.integrator);
+            for (const Body& b : runBodies(spec, run)) sim.addBody(b);
+            for (long long s = 0; s < spec.base.steps; ++s) sim.step();
+        }
+    });
+}
+
+static double oneByOneDouble(const SweepSpec& spec, long long runs) {
+    return measureSeconds([&] {
+        for (long long run = 0; run < runs; ++run) {
+            BasicSimulation<2, double> sim;
+            sim.dt = static_cast<double>(spec.base.dt);
+            sim.setIntegrator(spec.base.integrator);
+            for (const Body& b : runBodies(spec, run)) {
+                sim.addBody(BodyT<2, double>(static_cast<double>(b.mass), static_cast<double>(b.radius),
+                    { static_cast<double>(b.position.x), static_cast<double>(b.position.y) },
+                    { static_cast<double>(b.velocity.x), static_cast<double>(b.velocity.y) }));
+            }
+            for (long long s = 0; s < spec.base.steps; ++s) sim.step();
+        }
+    });
+}
+
+static double batched(const SweepSpec& spec, int threads) {
+    Ensemble engine;
+    engine.threads = threads;
+    std::string error;
+    return measureSeconds([&] { engine.run(spec, [](const EnsembleRun&) {}, error); });
+}
+
+// System steps per second: one run at a time vs. the batched ensemble
+void Benchmarks::ensemble() {
+    const long long runs = 4096, steps = 1000;
+    const int threads = ThreadPool::hardwareThreads();
+    std::cout << "Leapfrog, " << runs << " runs x " << steps << " steps, system steps/s (ensemble: "
+        << ForceKernel::isaName(ForceKernel::detectIsa()) << ", " << Ensemble::LANES << " systems per batch)\n";
+    std::cout << std::setw(8) << "bodies" << std::setw(16) << "Simulation" << std::setw(16) << "Basic<double>"
+        << std::setw(16) << "ensemble x1" << std::setw(16) << "ensemble x" + std::to_string(threads) << "\n";
+    for (int k : { 2, 3, 5, 10 }) {
+        SweepSpec spec = makeSweep(k, runs, steps);
+        // The one-by-one loops get a slice of the runs, they are much slower
+        const long long slice = runs / 16;
+        const double total = static_cast<double>(runs * steps);
+        std::cout << std::setw(8) << k
+            << std::setw(16) << slice * steps / oneByOneReference(spec, slice)
+            << std::setw(16) << slice * steps / oneByOneDouble(spec, slice)
+            << std::setw(16) << total / batched(spec, 1)
+            << std::setw(16) << total / batched(spec, threads) << "\n";
+    }
+}
\ No newline at end of file
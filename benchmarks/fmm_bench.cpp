@@ -0,0 +1,82 @@
+﻿#include "benchmarks.h"
+#include "bench_common.h"
+#include "physics.h"
+#include <algorithm>
+#include <cmath>
+
+// Accuracy and cost of the multipole solver for several expansion orders and separation criteria
+void Benchmarks::fmmAccuracy() {
+    const size_t n = 4000;
+    Simulation reference = makeDiskSimulation(n);
+    double directTime = measureSeconds([&] { Physics::computeAccelerations(reference); });
+
+    std::cout << "FMM accuracy, N = " << n << " (direct sum: " << directTime << " s)\n";
+    std::cout << std::setw(6) << "order" << std::setw(8) << "theta" << std::setw(14) << "rms rel err"
+        << std::setw(14) << "max rel err" << std::setw(14) << "sampled rms" << std::setw(14) << "sampled max"
+        << std::setw(12) << "bound"
+        << std::setw(12) << "time (s)" << "\n";
+
+    for (int order : { 2, 4, 8, 12, 16 }) {
+        for (LD theta : { 0.3L, 0.5L, 0.7L }) {
+            Simulation sim = makeDiskSimulation(n);
+            sim.solver = ForceSolver::Fmm;
+            sim.fmm.order = order;
+            sim.fmm.theta = theta;
+            sim.fmm.errorSamples = 0; // timed without the self-check
+            double t = measureSeconds([&] { sim.computeAccelerations(); });
+
+            LD sumErr2 = 0, maxErr = 0;
+            for (size_t i = 0; i < n; ++i) {
+                LD exact = reference.bodies[i].acceleration.norm();
+                if (exact < MIN_NUMBER) continue;
+                LD err = (sim.bodies[i].acceleration - reference.bodies[i].acceleration).norm() / exact;
+                sumErr2 += err * err;
+                maxErr = std::max(maxErr, err);
+            }
+            sim.fmm.errorSamples = 32;
+            sim.computeAccelerations();
+            std::cout << std::setw(6) << order << std::setw(8) << static_cast<double>(theta)
+                << std::setw(14) << static_cast<double>(std::sqrt(sumErr2 / n))
+                << std::setw(14) << static_cast<double>(maxErr)
+                << std::setw(14) << sim.fmm.stats().sampledRmsError
+                << std::setw(14) << sim.fmm.stats().sampledMaxError
+                << std::setw(12) << sim.fmm.stats().errorBound
+                << std::setw(12) << t << "\n";
+        }
+    }
+}
+
+// Time per force evaluation as N grows, against Barnes-Hut at the same theta
+void Benchmarks::fmmScaling() {
+    const size_t maxDirectN = 20000;
+
+    std::cout << "Force evaluation time vs N (theta = 0.5, FMM order 8)\n";
+    std::cout << std::setw(10) << "N" << std::setw(14) << "direct (s)" << std::setw(14) << "tree (s)"
+        << std::setw(14) << "fmm (s)" << std::setw(14) << "fmm ns/body" << "\n";
+
+    for (size_t n : { 1000, 5000, 20000, 100000, 200000 }) {
+        Simulation tree = makeDiskSimulation(n);
+        tree.solver = ForceSolver::BarnesHut;
+        tree.tree.theta = 0.5;
+        tree.computeAccelerations();
+        double treeTime = measureSeconds([&] { tree.computeAccelerations(); });
+
+        Simulation fmm = makeDiskSimulation(n);
+        fmm.solver = ForceSolver::Fmm;
+        fmm.fmm.theta = 0.5;
+        fmm.fmm.errorSamples = 0;
+        fmm.computeAccelerations();
+        double fmmTime = measureSeconds([&] { fmm.computeAccelerations(); });
+
+        std::cout << std::setw(10) << n;
+        if (n <= maxDirectN) {
+            Simulation direct = makeDiskSimulation(n);
+            std::cout << std::setw(14) << measureSeconds([&] { Physics::computeAccelerations(direct); });
+        }
+        else {
+            std::cout << std::setw(14) << "-";
+        }
+        std::cout << std::setw(14) << treeTime << std::setw(14) << fmmTime
+            << std::setw(14) << fmmTime * 1e9 / n << "\n";
+    }
+}
\ No newline at end of file
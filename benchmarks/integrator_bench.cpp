@@ -0,0 +1,47 @@
+﻿#include "benchmarks.h"
+#include "bench_common.h"
+#include "physics.h"
+
+static LD totalEnergy(const Simulation& sim) {
+    const Body& a = sim.bodies[0];
+    const Body& b = sim.bodies[1];
+    LD kinetic = (a.mass * a.velocity.norm() * a.velocity.norm() + b.mass * b.velocity.norm() * b.velocity.norm()) / 2;
+    return kinetic - Physics::G * a.mass * b.mass / Physics::calculateDistance(a, b);
+}
+
+// Accuracy after one orbit vs force evaluations and wall-clock time.
+// The cheapest row of each integrator below the target is what matters for long runs.
+void Benchmarks::integrators() {
+    const LD target = 1e-6;
+
+    std::cout << "One circular orbit (Earth-satellite), error = |r(T) - r(0)| / r\n";
+    std::cout << std::setw(22) << "integrator" << std::setw(8) << "steps" << std::setw(10) << "forces"
+        << std::setw(14) << "pos err" << std::setw(14) << "energy drift" << std::setw(12) << "time (s)" << "\n";
+
+    for (IntegratorType type : { IntegratorType::Euler, IntegratorType::VelocityVerlet, IntegratorType::LeapfrogKDK,
+        IntegratorType::Yoshida4, IntegratorType::DormandPrince45 }) {
+        long long cheapest = -1;
+        for (int steps : { 16, 64, 256, 1024, 4096, 16384 }) {
+            LD period;
+            Simulation sim = makeCircularOrbit(type, steps, period);
+            Vec2 start = sim.bodies[1].position - sim.bodies[0].position;
+            LD e0 = totalEnergy(sim);
+
+            double t = measureSeconds([&] {
+                for (int k = 0; k < steps; ++k) sim.step();
+            });
+
+            Vec2 end = sim.bodies[1].position - sim.bodies[0].position;
+            LD posErr = (end - start).norm() / start.norm();
+            LD drift = std::fabs((totalEnergy(sim) - e0) / e0);
+            if (posErr < target && cheapest < 0) cheapest = sim.forceEvaluations;
+
+            std::cout << std::setw(22) << Integrator::name(type) << std::setw(8) << steps
+                << std::setw(10) << sim.forceEvaluations
+                << std::setw(14) << static_cast<double>(posErr) << std::setw(14) << static_cast<double>(drift)
+                << std::setw(12) << t << "\n";
+        }
+        std::cout << std::setw(22) << Integrator::name(type) << "  force evaluations for error < "
+            << static_cast<double>(target) << ": " << (cheapest < 0 ? std::string("not reached") : std::to_string(cheapest)) << "\n";
+    }
+}
\ No newline at end of file
@@ -0,0 +1,49 @@
+﻿#include "benchmarks.h"
+#include "bench_common.h"
+#include "physics.h"
+#include <algorithm>
+
+// Maximum relative acceleration error of 'sim' against 'reference'
+static LD maxRelativeError(const Simulation& sim, const Simulation& reference) {
+    LD maxErr = 0;
+    for (size_t i = 0; i < sim.bodies.size(); ++i) {
+        LD exact = reference.bodies[i].acceleration.norm();
+        if (exact < MIN_NUMBER) continue;
+        maxErr = std::max(maxErr, (sim.bodies[i].acceleration - reference.bodies[i].acceleration).norm() / exact);
+    }
+    return maxErr;
+}
+
+// Direct sum: long double AoS reference vs SoA kernels for every available instruction set,
+// as a run uses them (symmetric tiles) and as the full N^2 kernel without the pair symmetry
+void Benchmarks::directKernels() {
+    const ForceKernel::Isa best = ForceKernel::detectIsa();
+    std::cout << "Best vector unit: " << ForceKernel::isaName(best) << "\n";
+    std::cout << std::setw(8) << "N" << std::setw(14) << "precision" << std::setw(10) << "isa"
+        << std::setw(12) << "time (s)" << std::setw(10) << "speedup" << std::setw(14) << "max rel err" << std::setw(12) << "full (s)" << "\n";
+
+    for (size_t n : { 1000, 4000, 16000 }) {
+        Simulation reference = makeDiskSimulation(n);
+        double refTime = measureSeconds([&] { Physics::computeAccelerations(reference); });
+        std::cout << std::setw(8) << n << std::setw(14) << "long double" << std::setw(10) << "-"
+            << std::setw(12) << refTime << std::setw(10) << 1.0 << std::setw(14) << 0.0 << "\n";
+
+        for (Precision precision : { Precision::Double, Precision::Float }) {
+            for (ForceKernel::Isa isa : { ForceKernel::Isa::Scalar, ForceKernel::Isa::Avx2, ForceKernel::Isa::Avx512 }) {
+                if (static_cast<int>(isa) > static_cast<int>(best)) continue;
+
+                Simulation sim = makeDiskSimulation(n);
+                sim.precision = precision;
+                sim.isa = isa;
+                double t = measureSeconds([&] { sim.computeAccelerations(); });
+                const LD error = maxRelativeError(sim, reference);
+                double full = measureSeconds([&] { Physics::computeAccelerationsSoA(sim); });
+                std::cout << std::setw(8) << n
+                    << std::setw(14) << (precision == Precision::Double ? "double" : "float")
+                    << std::setw(10) << ForceKernel::isaName(isa)
+                    << std::setw(12) << t << std::setw(10) << refTime / t
+                    << std::setw(14) << static_cast<double>(error) << std::setw(12) << full << "\n";
+            }
+        }
+    }
+}
\ No newline at end of file
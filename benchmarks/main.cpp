@@ -0,0 +1,69 @@
+// benchmarks [filter] [--json FILE] [--cases SUBSTRING] [--min-time SECONDS] [--max-n N]
+//
+// Runs the benchmarks whose name contains 'filter' (all by default).
+// The options apply to the 'suite' entry: --json writes its results for
+// benchmarks/compare.py, --cases selects cases by name, --min-time is the
+// time spent per case and --max-n caps the body counts.
+#include "benchmarks.h"
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+
+static void usage() {
+    std::cerr << "usage: benchmarks [filter] [--json FILE] [--cases SUBSTRING] [--min-time SECONDS] [--max-n N]\n";
+}
+
+int main(int argc, char* argv[]) {
+    const char* filter = "";
+    Suite suite;
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (std::strcmp(arg, "--json") == 0 && hasValue) suite.jsonPath = argv[++i];
+        else if (std::strcmp(arg, "--cases") == 0 && hasValue) suite.caseFilter = argv[++i];
+        else if (std::strcmp(arg, "--min-time") == 0 && hasValue) suite.minSeconds = std::atof(argv[++i]);
+        else if (std::strcmp(arg, "--max-n") == 0 && hasValue) suite.maxN = static_cast<size_t>(std::atoll(argv[++i]));
+        else if (arg[0] != '-') filter = arg;
+        else {
+            usage();
+            return 2;
+        }
+    }
+
+    struct Entry { const char* name; std::function<void()> run; };
+    const Entry all[] = {
+        { "barnes-hut-accuracy", &Benchmarks::barnesHutAccuracy },
+        { "barnes-hut-scaling", &Benchmarks::barnesHutScaling },
+        { "direct-kernels", &Benchmarks::directKernels },
+        { "mixed-precision", &Benchmarks::mixedPrecision },
+        { "strong-scaling", &Benchmarks::strongScaling },
+        { "integrators", &Benchmarks::integrators },
+        { "block-timesteps", &Benchmarks::blockTimesteps },
+        { "collisions", &Benchmarks::collisions },
+        { "softening", &Benchmarks::softening },
+        { "fmm-accuracy", &Benchmarks::fmmAccuracy },
+        { "fmm-scaling", &Benchmarks::fmmScaling },
+        { "dimensions", &Benchmarks::dimensions },
+        { "diagnostics", &Benchmarks::diagnostics },
+        { "ensemble", &Benchmarks::ensemble },
+        { "suite", [&] { Benchmarks::suite(suite); } },
+    };
+
+    for (const auto& e : all) {
+        if (std::strstr(e.name, filter) == nullptr) continue;
+        std::cout << "=== " << e.name << " ===\n";
+        e.run();
+        std::cout << "\n";
+    }
+
+    if (!suite.jsonPath.empty()) {
+        std::string error;
+        if (!suite.writeJson(error)) {
+            std::cerr << error << "\n";
+            return 1;
+        }
+        std::cout << suite.all().size() << " results written to " << suite.jsonPath << "\n";
+    }
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,96 @@
+﻿#include "benchmarks.h"
+#include "bench_common.h"
+#include <algorithm>
+
+// The disk with every 'every'-th star turned into a tight binary: companions
+// 1e11..1e13 m apart at ~3e19 m from the center, below the resolution of a float
+// position and close to that of a double one
+static Simulation makeBinaryDisk(size_t n, size_t every) {
+    Simulation sim = makeDiskSimulation(n);
+    std::mt19937_64 rng(7);
+    std::uniform_real_distribution<double> logSeparation(11.0, 13.0);
+    std::uniform_real_distribution<double> angle(0.0, 2 * M_PI);
+    const size_t stars = sim.bodies.size();
+    for (size_t i = 1; i < stars; i += every) {
+        const Body& star = sim.bodies[i];
+        LD d = std::pow(10.0, logSeparation(rng));
+        LD a = angle(rng);
+        LD v = std::sqrt(Physics::G * 2 * star.mass / d);
+        Vec2 offset = { d * std::cos(a), d * std::sin(a) };
+        Vec2 orbit = { -v * std::sin(a), v * std::cos(a) };
+        sim.addBody(Body(star.mass, 1e9, star.position + offset, star.velocity + orbit));
+    }
+    return sim;
+}
+
+struct AccuracyStats {
+    LD maxErr = 0, rmsErr = 0;
+};
+
+static AccuracyStats accelerationErrors(const Simulation& sim, const Simulation& reference) {
+    AccuracyStats stats;
+    size_t counted = 0;
+    for (size_t i = 0; i < sim.bodies.size(); ++i) {
+        LD exact = reference.bodies[i].acceleration.norm();
+        if (exact < MIN_NUMBER) continue;
+        LD err = (sim.bodies[i].acceleration - reference.bodies[i].acceleration).norm() / exact;
+        stats.maxErr = std::max(stats.maxErr, err);
+        stats.rmsErr += err * err;
+        ++counted;
+    }
+    if (counted > 0) stats.rmsErr = std::sqrt(stats.rmsErr / counted);
+    return stats;
+}
+
+// Mixed-precision direct sum: far field in the SIMD kernels, pairs closer than
+// the near radius from the long double positions. Accuracy against the all-long-double sum.
+void Benchmarks::mixedPrecision() {
+    struct MixedCase { const char* name; Precision precision; LD nearRadius; Precision nearPrecision; };
+    const LD radius = 1e15; // covers the binaries, not the disk neighbours (~1e17 m apart)
+    const MixedCase cases[] = {
+        { "double", Precision::Double, 0, Precision::LongDouble },
+        { "double + near ld", Precision::Double, radius, Precision::LongDouble },
+        { "double + near double", Precision::Double, radius, Precision::Double },
+        { "float", Precision::Float, 0, Precision::LongDouble },
+        { "float + near ld", Precision::Float, radius, Precision::LongDouble },
+        { "float + near double", Precision::Float, radius, Precision::Double },
+    };
+    const int rounds = 3;
+
+    std::cout << "Direct sum on a disk with tight binaries (vector unit: "
+        << ForceKernel::isaName(ForceKernel::detectIsa()) << "), near radius " << static_cast<double>(radius) << " m\n";
+    std::cout << std::setw(8) << "N" << std::setw(22) << "path" << std::setw(12) << "time (ms)" << std::setw(10) << "speedup"
+        << std::setw(12) << "near pairs" << std::setw(14) << "max rel err" << std::setw(14) << "rms rel err"
+        << std::setw(14) << "energy err" << "\n";
+
+    for (size_t n : { 2000, 8000 }) {
+        Simulation reference = makeBinaryDisk(n, 4);
+        reference.computePotential = true;
+        double refTime = 1e300;
+        for (int round = 0; round < rounds; ++round) {
+            refTime = std::min(refTime, measureSeconds([&] { reference.computeAccelerations(); }));
+        }
+        std::cout << std::setw(8) << reference.bodies.size() << std::setw(22) << "long double"
+            << std::setw(12) << refTime * 1e3 << std::setw(10) << 1.0 << std::setw(12) << "-"
+            << std::setw(14) << 0.0 << std::setw(14) << 0.0 << std::setw(14) << 0.0 << "\n";
+
+        for (const auto& c : cases) {
+            Simulation sim = makeBinaryDisk(n, 4);
+            sim.precision = c.precision;
+            sim.nearRadius = c.nearRadius;
+            sim.nearPrecision = c.nearPrecision;
+            sim.computePotential = true;
+            double t = 1e300;
+            for (int round = 0; round < rounds; ++round) {
+                t = std::min(t, measureSeconds([&] { sim.computeAccelerations(); }));
+            }
+            AccuracyStats stats = accelerationErrors(sim, reference);
+            LD energyErr = std::fabs(sim.potentialEnergy / reference.potentialEnergy - 1);
+            std::cout << std::setw(8) << sim.bodies.size() << std::setw(22) << c.name
+                << std::setw(12) << t * 1e3 << std::setw(10) << refTime / t
+                << std::setw(12) << sim.nearPairs.pairs.size()
+                << std::setw(14) << static_cast<double>(stats.maxErr) << std::setw(14) << static_cast<double>(stats.rmsErr)
+                << std::setw(14) << static_cast<double>(energyErr) << "\n";
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,100 @@
+﻿#include "benchmarks.h"
+#include "bench_common.h"
+#include "physics.h"
+
+// Positions and velocities compared with ==, so "equal" means bit for bit
+static bool sameState(const std::vector<Body>& a, const std::vector<Body>& b) {
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (a[i].position.x != b[i].position.x || a[i].position.y != b[i].position.y
+            || a[i].velocity.x != b[i].velocity.x || a[i].velocity.y != b[i].velocity.y) return false;
+    }
+    return true;
+}
+
+// Ten leapfrog steps of a small disk in every precision, plain, Plummer-softened and with the
+// spline's near-field split, on 1 to 7 threads (more than the machine has is fine):
+// the bodies and the sampled energy must match the one-thread run bit for bit.
+static void checkThreadIndependence() {
+    static const char* const precisionNames[] = { "long double", "double", "float" };
+    const char* const variants[] = { "plain", "plummer", "split" };
+    int failures = 0;
+    for (Precision precision : { Precision::LongDouble, Precision::Double, Precision::Float }) {
+        for (int variant = 0; variant < 3; ++variant) {
+            std::vector<Body> first;
+            LD firstEnergy = 0;
+            for (int threads : { 1, 2, 3, 4, 7 }) {
+                Simulation sim = makeDiskSimulation(3001);
+                sim.precision = precision;
+                sim.threads = threads;
+                sim.dt = 1e7;
+                sim.setIntegrator(IntegratorType::LeapfrogKDK);
+                sim.diagnostics.every = 5;
+                if (variant == 1) {
+                    sim.softening.type = SofteningType::Plummer;
+                    sim.softening.length = 1e16;
+                }
+                if (variant == 2) {
+                    sim.softening.type = SofteningType::Spline;
+                    sim.softening.length = 1e16;
+                    sim.nearRadius = 3e17;
+                }
+                for (int k = 0; k < 10; ++k) sim.step();
+
+                const LD energy = sim.diagnostics.recent().back().energy();
+                if (first.empty()) {
+                    first = sim.bodies;
+                    firstEnergy = energy;
+                }
+                else if (!sameState(first, sim.bodies) || energy != firstEnergy) {
+                    std::cout << "  " << precisionNames[static_cast<int>(precision)] << ", " << variants[variant] << ": "
+                        << threads << " threads differ from 1\n";
+                    ++failures;
+                }
+            }
+        }
+    }
+    std::cout << "Thread-count independence (1..7 threads, every precision): " << (failures ? "FAILED" : "bit-identical") << "\n";
+}
+
+// Fixed problem size, 1..hardware threads, through Simulation::computeAccelerations like a run.
+// Also checks that the result does not depend on the thread count (bitwise).
+void Benchmarks::strongScaling() {
+    checkThreadIndependence();
+
+    const size_t n = 20000;
+    const int maxThreads = ThreadPool::hardwareThreads();
+
+    std::cout << "Strong scaling, direct sum (double, symmetric tiles), N = " << n << "\n";
+    std::cout << std::setw(8) << "threads" << std::setw(12) << "time (s)" << std::setw(10) << "speedup"
+        << std::setw(12) << "efficiency" << std::setw(15) << "bit-identical" << "\n";
+
+    std::vector<int> counts;
+    for (int threads = 1; threads < maxThreads; threads = threads < 4 ? threads + 1 : threads * 2) {
+        counts.push_back(threads);
+    }
+    counts.push_back(maxThreads);
+
+    std::vector<Vec2> first;
+    double baseTime = 0;
+    for (int threads : counts) {
+        Simulation sim = makeDiskSimulation(n);
+        sim.precision = Precision::Double;
+        sim.threads = threads;
+        sim.computeAccelerations(); // warm-up: starts the pool, sizes the tile buffers
+        double t = measureSeconds([&] { sim.computeAccelerations(); });
+
+        bool identical = true;
+        if (first.empty()) {
+            baseTime = t;
+            for (const auto& b : sim.bodies) first.push_back(b.acceleration);
+        }
+        else {
+            for (size_t i = 0; i < n && identical; ++i) {
+                identical = first[i].x == sim.bodies[i].acceleration.x && first[i].y == sim.bodies[i].acceleration.y;
+            }
+        }
+
+        std::cout << std::setw(8) << threads << std::setw(12) << t << std::setw(10) << baseTime / t
+            << std::setw(12) << baseTime / t / threads << std::setw(15) << (identical ? "yes" : "NO") << "\n";
+    }
+}
\ No newline at end of file
@@ -0,0 +1,80 @@
+﻿#include "suite.h"
+#include "forcekernel.h"
+#include "threadpool.h"
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+void Suite::print(const SuiteResult& r) const {
+    std::cout << std::left << std::setw(44) << r.name << std::right
+        << std::setw(14) << r.realSeconds * 1e9 << " ns" << std::setw(10) << r.iterations;
+    for (const auto& c : r.counters) {
+        std::cout << "  " << c.first << "=" << c.second;
+    }
+    std::cout << std::endl;
+}
+
+static std::string jsonString(const std::string& s) {
+    std::string out = "\"";
+    for (char c : s) {
+        if (c == '"' || c == '\\') out += '\\';
+        out += c;
+    }
+    return out + "\"";
+}
+
+static std::string jsonNumber(double v) {
+    if (!std::isfinite(v)) return "null";
+    std::ostringstream os;
+    os << std::setprecision(17) << v;
+    return os.str();
+}
+
+bool Suite::writeJson(std::string& error) const {
+    std::ofstream out(jsonPath);
+    if (!out) {
+        error = "cannot create " + jsonPath;
+        return false;
+    }
+
+    char date[32] = "";
+    std::time_t now = std::time(nullptr);
+    std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+
+    out << "{\n  \"context\": {\n"
+        << "    \"date\": " << jsonString(date) << ",\n"
+        << "    \"num_cpus\": " << ThreadPool::hardwareThreads() << ",\n"
+        << "    \"isa\": " << jsonString(ForceKernel::isaName(ForceKernel::detectIsa())) << ",\n"
+#ifdef NDEBUG
+        << "    \"library_build_type\": \"release\",\n"
+#else
+        << "    \"library_build_type\": \"debug\",\n"
+#endif
+        << "    \"min_time\": " << jsonNumber(minSeconds) << "\n"
+        << "  },\n  \"benchmarks\": [";
+
+    for (size_t i = 0; i < results.size(); ++i) {
+        const SuiteResult& r = results[i];
+        out << (i ? "," : "") << "\n    {\n"
+            << "      \"name\": " << jsonString(r.name) << ",\n"
+            << "      \"run_type\": \"iteration\",\n"
+            << "      \"iterations\": " << r.iterations << ",\n"
+            << "      \"real_time\": " << jsonNumber(r.realSeconds * 1e9) << ",\n"
+            << "      \"cpu_time\": " << jsonNumber(r.cpuSeconds * 1e9) << ",\n"
+            << "      \"time_unit\": \"ns\"";
+        for (const auto& c : r.counters) {
+            out << ",\n      " << jsonString(c.first) << ": " << jsonNumber(c.second);
+        }
+        out << "\n    }";
+    }
+    out << "\n  ]\n}\n";
+
+    if (!out) {
+        error = "cannot write " + jsonPath;
+        return false;
+    }
+    return true;
+}
\ No newline at end of file
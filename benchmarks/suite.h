@@ -0,0 +1,77 @@
+#pragma once
+#include <chrono>
+#include <ctime>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct SuiteResult {
+    std::string name;
+    long long iterations = 0;
+    double realSeconds = 0; // per iteration
+    double cpuSeconds = 0;  // per iteration, all threads of the process
+    std::vector<std::pair<std::string, double>> counters;
+
+    void counter(const std::string& key, double value) { counters.emplace_back(key, value); }
+};
+
+// Named, repeatable timings with machine-readable output, laid out like
+// Google Benchmark's (so benchmarks/compare.py reads either).
+// A case body runs one iteration; it is repeated until minSeconds have passed.
+// The first iteration is a warm-up (arenas, thread pools, caches) and is only
+// counted when it alone took longer than minSeconds.
+class Suite {
+public:
+    double minSeconds = 0.5;
+    size_t maxN = 1 << 20;  // largest body count the cases may use
+    std::string caseFilter; // run only cases whose name contains this
+    std::string jsonPath;   // empty = console output only
+
+    bool wants(const std::string& name) const {
+        return caseFilter.empty() || name.find(caseFilter) != std::string::npos;
+    }
+
+    // Returns the new result (to attach counters) or nullptr if the case is filtered out
+    template <typename F>
+    SuiteResult* run(const std::string& name, F&& body) {
+        if (!wants(name)) return nullptr;
+        using Clock = std::chrono::steady_clock;
+
+        SuiteResult r;
+        r.name = name;
+        auto start = Clock::now();
+        std::clock_t cpuStart = std::clock();
+        body();
+        double first = std::chrono::duration<double>(Clock::now() - start).count();
+        double firstCpu = static_cast<double>(std::clock() - cpuStart) / CLOCKS_PER_SEC;
+
+        if (first >= minSeconds) {
+            r.iterations = 1;
+            r.realSeconds = first;
+            r.cpuSeconds = firstCpu;
+        }
+        else {
+            start = Clock::now();
+            cpuStart = std::clock();
+            double elapsed = 0;
+            do {
+                body();
+                ++r.iterations;
+                elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+            } while (elapsed < minSeconds);
+            r.realSeconds = elapsed / r.iterations;
+            r.cpuSeconds = static_cast<double>(std::clock() - cpuStart) / CLOCKS_PER_SEC / r.iterations;
+        }
+        results.push_back(std::move(r));
+        return &results.back();
+    }
+
+    // Console line for the last result, once its counters are attached
+    void print(const SuiteResult& r) const;
+
+    const std::vector<SuiteResult>& all() const { return results; }
+    bool writeJson(std::string& error) const;
+
+private:
+    std::vector<SuiteResult> results;
+};
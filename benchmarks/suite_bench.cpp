@@ -0,0 +1,408 @@
+﻿#include "benchmarks.h"
+#include "bench_common.h"
+#include "bodylist.h"
+#include "domain.h"
+#include "generators.h"
+#include "logpipeline.h"
+#include "orbitrenderer.h"
+#include "replay.h"
+#include "snapshot.h"
+#include "triplebuffer.h"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+static const size_t SUITE_SIZES[] = { 2, 16, 128, 1024, 8192, 65536, 262144, 1048576 };
+
+static void accelerationCases(Suite& suite) {
+    struct SolverCase { const char* name; ForceSolver solver; Precision precision; size_t maxN; };
+    const SolverCase solvers[] = {
+        { "direct-long-double", ForceSolver::Direct, Precision::LongDouble, 8192 },
+        { "direct-double", ForceSolver::Direct, Precision::Double, 65536 },
+        { "barnes-hut", ForceSolver::BarnesHut, Precision::LongDouble, 1 << 20 },
+        { "fmm", ForceSolver::Fmm, Precision::LongDouble, 1 << 20 },
+    };
+
+    for (const auto& s : solvers) {
+        for (size_t n : SUITE_SIZES) {
+            const std::string name = std::string("accelerations/") + s.name + "/" + std::to_string(n);
+            if (n > s.maxN || n > suite.maxN || !suite.wants(name)) continue;
+
+            Simulation sim = makeDiskSimulation(n);
+            sim.solver = s.solver;
+            sim.precision = s.precision;
+            sim.fmm.errorSamples = 0;
+            SuiteResult* r = suite.run(name, [&] { sim.computeAccelerations(); });
+            // Pairwise interactions the direct sum would do, so all solvers are comparable
+            r->counter("interactions_per_second", static_cast<double>(n) * (n - 1) / r->realSeconds);
+            r->counter("ns_per_body", r->realSeconds * 1e9 / n);
+            suite.print(*r);
+        }
+    }
+}
+
+static void stepCases(Suite& suite) {
+    struct StepCase { IntegratorType integrator; ForceSolver solver; Precision precision; size_t n; const char* solverName; };
+    const StepCase cases[] = {
+        { IntegratorType::Euler, ForceSolver::Direct, Precision::Double, 1024, "direct-double" },
+        { IntegratorType::VelocityVerlet, ForceSolver::Direct, Precision::Double, 1024, "direct-double" },
+        { IntegratorType::LeapfrogKDK, ForceSolver::Direct, Precision::Double, 1024, "direct-double" },
+        { IntegratorType::Yoshida4, ForceSolver::Direct, Precision::Double, 1024, "direct-double" },
+        { IntegratorType::DormandPrince45, ForceSolver::Direct, Precision::Double, 1024, "direct-double" },
+        { IntegratorType::BlockTimestep, ForceSolver::Direct, Precision::LongDouble, 1024, "direct-long-double" },
+        { IntegratorType::LeapfrogKDK, ForceSolver::BarnesHut, Precision::LongDouble, 65536, "barnes-hut" },
+        { IntegratorType::LeapfrogKDK, ForceSolver::Fmm, Precision::LongDouble, 65536, "fmm" },
+    };
+    static const char* const integratorNames[] = { "euler", "verlet", "leapfrog", "yoshida4", "dopri45", "block" };
+
+    for (const auto& c : cases) {
+        const std::string name = std::string("step/") + integratorNames[static_cast<int>(c.integrator)] + "/"
+            + c.solverName + "/" + std::to_string(c.n);
+        if (c.n > suite.maxN || !suite.wants(name)) continue;
+
+        Simulation sim = makeDiskSimulation(c.n);
+        sim.setIntegrator(c.integrator);
+        sim.solver = c.solver;
+        sim.precision = c.precision;
+        sim.fmm.errorSamples = 0;
+        SuiteResult* r = suite.run(name, [&] { sim.step(); });
+        r->counter("ns_per_step", r->realSeconds * 1e9);
+        // Block time steps count n body forces as one evaluation
+        if (sim.forceEvaluations > 0) {
+            r->counter("force_evaluations_per_step", static_cast<double>(sim.forceEvaluations) / sim.stepCount);
+        }
+        suite.print(*r);
+    }
+}
+
+// Cheapest run of one orbit that gets below the target position error, timed.
+// ns_per_digit is the cost of each correct decimal digit of the final position.
+static void integratorAccuracyCases(Suite& suite) {
+    const LD target = 1e-6;
+    static const char* const integratorNames[] = { "euler", "verlet", "leapfrog", "yoshida4", "dopri45" };
+
+    for (IntegratorType type : { IntegratorType::Euler, IntegratorType::VelocityVerlet, IntegratorType::LeapfrogKDK,
+        IntegratorType::Yoshida4, IntegratorType::DormandPrince45 }) {
+        const std::string name = std::string("integrator-accuracy/") + integratorNames[static_cast<int>(type)];
+        if (!suite.wants(name)) continue;
+
+        // One orbit, relative position error after it
+        auto orbit = [type](int steps, long long& evaluations) {
+            LD period;
+            Simulation sim = makeCircularOrbit(type, steps, period);
+            Vec2 start = sim.bodies[1].position - sim.bodies[0].position;
+            for (int k = 0; k < steps; ++k) sim.step();
+            Vec2 end = sim.bodies[1].position - sim.bodies[0].position;
+            evaluations = sim.forceEvaluations;
+            return static_cast<double>((end - start).norm() / start.norm());
+        };
+
+        int steps = 16;
+        long long evaluations = 0;
+        double error = orbit(steps, evaluations);
+        while (error >= target && steps < (1 << 22)) {
+            steps *= 2;
+            error = orbit(steps, evaluations);
+        }
+
+        SuiteResult* r = suite.run(name, [&] { long long unused; orbit(steps, unused); });
+        r->counter("steps_per_orbit", steps);
+        r->counter("force_evaluations", static_cast<double>(evaluations));
+        r->counter("position_error", error);
+        r->counter("reached_target", error < target ? 1 : 0);
+        r->counter("ns_per_digit", r->realSeconds * 1e9 / std::max(1e-3, -std::log10(error)));
+        suite.print(*r);
+    }
+}
+
+// The stepping thread's share of a GUI refresh: copying the bodies into a
+// snapshot and handing it over (SimulationWorker::publish) plus the UI picking it up.
+// Formatting the visible table rows happens in Qt and is not part of this binary.
+static void guiRefreshCases(Suite& suite) {
+    for (size_t n : { 1024, 65536, 1048576 }) {
+        const std::string name = "gui-refresh/snapshot/" + std::to_string(n);
+        if (n > suite.maxN || !suite.wants(name)) continue;
+
+        Simulation sim = makeDiskSimulation(n);
+        TripleBuffer<SimulationSnapshot> snapshots;
+        SuiteResult* r = suite.run(name, [&] {
+            SimulationSnapshot& s = snapshots.writeSlot();
+            s.bodies = sim.bodies;
+            s.time = sim.time;
+            s.stepCount = sim.stepCount;
+            s.collisions = sim.collisions.recent();
+            snapshots.publish();
+            snapshots.update();
+        });
+        r->counter("bytes_per_second", static_cast<double>(n * sizeof(Body)) / r->realSeconds);
+        suite.print(*r);
+    }
+
+    // The orbit view's frame at 1280x720 with full trails: recording the snapshot in the
+    // trail ring plus culling and splatting. Small N only builds the sprite lists here,
+    // the QPainter pass over them needs Qt
+    for (size_t n : { 1024, 65536, 1048576 }) {
+        const std::string name = "gui-refresh/render/" + std::to_string(n);
+        if (n > suite.maxN || !suite.wants(name)) continue;
+
+        Simulation sim = makeDiskSimulation(n);
+        OrbitRenderer renderer;
+        renderer.setSize(1280, 720);
+        for (int f = 0; f <= renderer.trailLength; ++f) renderer.push(sim.bodies);
+        bool splatted = false;
+        SuiteResult* r = suite.run(name, [&] {
+            renderer.push(sim.bodies);
+            splatted = renderer.render();
+        });
+        r->counter("frames_per_second", 1.0 / r->realSeconds);
+        r->counter("splatted", splatted ? 1 : 0);
+        r->counter("trail_frames", renderer.trailFrames());
+        suite.print(*r);
+    }
+
+    // A body listing in the log: the records pushed on the stepping thread, formatted
+    // on the pipeline's thread and taken by the UI. Listings longer than the ring drop lines
+    for (size_t n : { 1024, 65536 }) {
+        const std::string name = "gui-refresh/log/" + std::to_string(n);
+        if (n > suite.maxN || !suite.wants(name)) continue;
+
+        Simulation sim = makeDiskSimulation(n);
+        LogPipeline log;
+        std::vector<std::string> lines;
+        double pushSeconds = 0;
+        long long listings = 0; // the warm-up included
+        SuiteResult* r = suite.run(name, [&] {
+            ++listings;
+            pushSeconds += measureSeconds([&] {
+                LogRecord record;
+                record.kind = LogRecord::Kind::Body;
+                for (size_t i = 0; i < sim.bodies.size(); ++i) {
+                    const Body& b = sim.bodies[i];
+                    record.a = static_cast<int>(i);
+                    record.v[0] = static_cast<double>(b.position.x);
+                    record.v[1] = static_cast<double>(b.position.y);
+                    record.v[2] = static_cast<double>(b.velocity.x);
+                    record.v[3] = static_cast<double>(b.velocity.y);
+                    log.push(record);
+                }
+            });
+            log.flush();
+            lines.clear();
+            log.take(lines, n);
+        });
+        r->counter("lines_per_second", static_cast<double>(n) / r->realSeconds);
+        r->counter("push_ns_per_line", pushSeconds / static_cast<double>(listings) / n * 1e9);
+        r->counter("dropped_per_listing", static_cast<double>(log.dropped()) / static_cast<double>(listings));
+        suite.print(*r);
+    }
+}
+
+// Building a large setup: parsing a body list already in memory (CSV with 17 digits,
+// and the binary form) and running each generator, on every hardware thread
+static void setupCases(Suite& suite) {
+    for (size_t n : { 65536, 1048576 }) {
+        const std::string csvName = "setup/csv/" + std::to_string(n);
+        const std::string binaryName = "setup/binary/" + std::to_string(n);
+        if (n > suite.maxN || (!suite.wants(csvName) && !suite.wants(binaryName))) continue;
+
+        Simulation sim = makeDiskSimulation(n);
+        std::string csv = "mass,radius,x,y,vx,vy\n";
+        char line[256];
+        for (const Body& b : sim.bodies) {
+            std::snprintf(line, sizeof(line), "%.17g,%.17g,%.17g,%.17g,%.17g,%.17g\n",
+                static_cast<double>(b.mass), static_cast<double>(b.radius),
+                static_cast<double>(b.position.x), static_cast<double>(b.position.y),
+                static_cast<double>(b.velocity.x), static_cast<double>(b.velocity.y));
+            csv += line;
+        }
+        std::string binary(BODY_LIST_MAGIC, sizeof(BODY_LIST_MAGIC));
+        const uint64_t count = n;
+        binary.append(reinterpret_cast<const char*>(&count), sizeof(count));
+        for (const Body& b : sim.bodies) {
+            const double v[6] = { static_cast<double>(b.mass), static_cast<double>(b.radius),
+                static_cast<double>(b.position.x), static_cast<double>(b.position.y),
+                static_cast<double>(b.velocity.x), static_cast<double>(b.velocity.y) };
+            binary.append(reinterpret_cast<const char*>(v), sizeof(v));
+        }
+
+        std::vector<Body> bodies;
+        std::string error;
+        if (suite.wants(csvName)) {
+            SuiteResult* r = suite.run(csvName, [&] {
+                bodies.clear();
+                parseBodyCsv(csv.data(), csv.size(), bodies, error);
+            });
+            r->counter("bodies_per_second", static_cast<double>(n) / r->realSeconds);
+            r->counter("megabytes_per_second", csv.size() / 1e6 / r->realSeconds);
+            r->counter("parsed", static_cast<double>(bodies.size()));
+            suite.print(*r);
+        }
+        if (suite.wants(binaryName)) {
+            SuiteResult* r = suite.run(binaryName, [&] {
+                bodies.clear();
+                parseBodyBinary(binary.data(), binary.size(), bodies, error);
+            });
+            r->counter("bodies_per_second", static_cast<double>(n) / r->realSeconds);
+            r->counter("parsed", static_cast<double>(bodies.size()));
+            suite.print(*r);
+        }
+    }
+
+    for (GeneratorType type : { GeneratorType::Plummer, GeneratorType::ExponentialDisk,
+        GeneratorType::UniformBox, GeneratorType::KeplerRing }) {
+        for (size_t n : { 65536, 1048576 }) {
+            const std::string name = std::string("setup/generate/") + generatorName(type) + "/" + std::to_string(n);
+            if (n > suite.maxN || !suite.wants(name)) continue;
+
+            GeneratorSpec spec = defaultGenerator(type);
+            spec.count = n;
+            std::vector<Body> bodies;
+            SuiteResult* r = suite.run(name, [&] {
+                bodies.clear();
+                generateBodies(spec, bodies);
+            });
+            r->counter("bodies_per_second", static_cast<double>(n) / r->realSeconds);
+            suite.print(*r);
+        }
+    }
+}
+
+// Scrubbing the timeline: a Barnes-Hut run of 128 steps with a keyframe every 32, then
+// seeks that each load a keyframe and re-run half the spacing (the average case).
+// record_ns_per_step is what keeping the keyframes adds to the live run
+static void replayCases(Suite& suite) {
+    for (size_t n : { 1024, 16384 }) {
+        const std::string name = "replay/seek/" + std::to_string(n);
+        if (n > suite.maxN || !suite.wants(name)) continue;
+
+        Simulation sim = makeDiskSimulation(n);
+        sim.solver = ForceSolver::BarnesHut;
+        sim.setIntegrator(IntegratorType::LeapfrogKDK);
+        ReplayCache cache;
+        cache.reset(size_t(1) << 30, std::string(), 32);
+        cache.record(sim);
+        const long long steps = 128;
+        double stepSeconds = 0, recordSeconds = 0;
+        for (long long k = 0; k < steps; ++k) {
+            stepSeconds += measureSeconds([&] { sim.step(); });
+            recordSeconds += measureSeconds([&] { cache.record(sim); });
+        }
+
+        // Alternating between two keyframes, so no seek can go on from the previous one
+        long long seeks = 0;
+        std::string error;
+        SuiteResult* r = suite.run(name, [&] {
+            cache.seek((seeks++ % 2 ? 32 : 64) + 16, error);
+        });
+        r->counter("seeks_per_second", 1.0 / r->realSeconds);
+        r->counter("steps_per_seek", 16);
+        r->counter("record_ns_per_step", recordSeconds / steps * 1e9);
+        r->counter("record_share", recordSeconds / stepSeconds);
+        r->counter("keyframe_bytes", static_cast<double>(cache.memoryBytes()) / cache.keyframeCount());
+        suite.print(*r);
+    }
+}
+
+// A Plummer cluster split over 1, 2 and 4 ranks on either transport. On a machine with
+// fewer cores than ranks the ranks take turns, so steps/s shows the overhead of the
+// decomposition rather than its speed-up; the exchange counters are exact either way.
+static void domainCases(Suite& suite, TransportType transport) {
+    const size_t n = 16384;
+    if (n > suite.maxN) return;
+    Scenario scenario;
+    GeneratorSpec spec;
+    std::string error;
+    parseGenerator("plummer n=16384 mass=3.3e34 scale=3e16 seed=1", spec, error);
+    generateBodies(spec, scenario.bodies);
+    scenario.dt = 5e9;
+    scenario.steps = 8;
+    scenario.integrator = IntegratorType::LeapfrogKDK;
+    scenario.solver = ForceSolver::BarnesHut;
+    scenario.theta = 0.6;
+    scenario.softening.type = SofteningType::Plummer;
+    scenario.softening.length = 3e14;
+
+    for (int ranks : { 1, 2, 4 }) {
+        const std::string name = std::string("domain/") + (transport == TransportType::Socket ? "socket/" : "local/")
+            + std::to_string(ranks) + "/" + std::to_string(n);
+        if (!suite.wants(name)) continue;
+
+        DomainRunSettings settings;
+        settings.ranks = ranks;
+        settings.transport = transport;
+        settings.rebalanceEvery = 4;
+        DomainStats stats;
+        bool ok = true;
+        SuiteResult* r = suite.run(name, [&] {
+            ok = runDecomposed(scenario, settings, [](const Simulation&) {}, stats, error) && ok;
+        });
+        const double evaluations = std::max<double>(1, static_cast<double>(stats.evaluations));
+        r->counter("steps_per_second", scenario.steps / r->realSeconds);
+        r->counter("imported_per_rank", static_cast<double>(stats.importedItems) / evaluations / ranks);
+        r->counter("kilobytes_per_step", stats.bytesSent / 1e3 / scenario.steps);
+        r->counter("messages_per_step", static_cast<double>(stats.messagesSent) / scenario.steps);
+        r->counter("imbalance", stats.imbalance);
+        r->counter("wait_share", stats.waitSeconds / r->realSeconds);
+        suite.print(*r);
+        if (!ok) std::cerr << name << " failed: " << error << "\n";
+    }
+}
+
+// Leapfrog steps on the disk, whose bodies were added in random order: as added, and
+// Morton-sorted (see BodyOrder). The forces are the same either way, the difference is
+// memory locality in the tree builds and walks and the collision grid. disorder is the
+// share of neighbouring slots out of curve order; sort_ns is one full re-sort.
+static void orderCases(Suite& suite) {
+    struct OrderCase { const char* name; ForceSolver solver; CollisionPolicy collisions; };
+    const OrderCase cases[] = {
+        { "barnes-hut", ForceSolver::BarnesHut, CollisionPolicy::None },
+        { "fmm", ForceSolver::Fmm, CollisionPolicy::None },
+        { "barnes-hut-collisions", ForceSolver::BarnesHut, CollisionPolicy::Log },
+    };
+
+    for (const auto& c : cases) {
+        for (size_t n : { size_t(65536), size_t(262144) }) {
+            for (bool sorted : { false, true }) {
+                const std::string name = std::string("order/") + (sorted ? "sorted/" : "unsorted/") + c.name + "/" + std::to_string(n);
+                if (n > suite.maxN || !suite.wants(name)) continue;
+
+                Simulation sim = makeDiskSimulation(n);
+                sim.setIntegrator(IntegratorType::LeapfrogKDK);
+                sim.solver = c.solver;
+                sim.collisionPolicy = c.collisions;
+                sim.fmm.errorSamples = 0;
+                double sortSeconds = 0;
+                if (sorted) {
+                    sim.order.every = 16;
+                    sortSeconds = measureSeconds([&] { sim.order.sort(sim); });
+                }
+                SuiteResult* r = suite.run(name, [&] { sim.step(); });
+                r->counter("ns_per_step", r->realSeconds * 1e9);
+                r->counter("ns_per_body", r->realSeconds * 1e9 / n);
+                BodyOrder probe; // measures only: nothing is ever over a threshold of 1
+                probe.threshold = 1;
+                probe.update(sim);
+                r->counter("disorder", probe.disorder);
+                if (sorted) r->counter("sort_ns", sortSeconds * 1e9);
+                suite.print(*r);
+            }
+        }
+    }
+}
+
+void Benchmarks::suite(Suite& suite) {
+    std::cout << std::left << std::setw(44) << "case" << std::right << std::setw(17) << "time/iteration"
+        << std::setw(10) << "iters" << "  counters\n";
+    // Socket ranks are forked, which runRanks allows only while this process runs no other
+    // threads: these cases go first, before any case has started a pool or a worker
+    domainCases(suite, TransportType::Socket);
+    accelerationCases(suite);
+    stepCases(suite);
+    integratorAccuracyCases(suite);
+    guiRefreshCases(suite);
+    setupCases(suite);
+    replayCases(suite);
+    domainCases(suite, TransportType::Local);
+    orderCases(suite);
+}
\ No newline at end of file
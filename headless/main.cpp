@@ -0,0 +1,512 @@
+// Headless batch runner: no Qt, only the simulation core.
+//
+//   headless <scenario file> [--steps N] [--output-every N] [--threads N] [--trajectory FILE]
+//            [--checkpoint FILE] [--checkpoint-every N] [--restart FILE] [--profile FILE]
+//            [--diagnostics-every N] [--diagnostics FILE] [--ranks N] [--transport local|socket]
+//            [--rebalance-every N] [--sort-every N] [--quiet]
+//   headless --inspect <trajectory file> [frame]
+//   headless --ensemble <sweep file> [--threads N] [--output FILE]
+//
+// Runs the scenario at full speed, prints a snapshot every 'output-every' steps
+// (and after the last one) plus timing statistics at the end.
+// 'steps' is the total step count: --restart continues from a checkpoint up to it.
+// --inspect prints the frame list of a recorded trajectory, or one frame in full.
+// --profile writes a Chrome trace of the run and prints the phase breakdown
+// (only in builds with GRAVITY_PROFILING, see profiler.h).
+// --diagnostics-every samples energy, momentum and angular momentum (see diagnostics.h),
+// printed with their drift and, with --diagnostics, written as CSV (at output-every without a cadence).
+// 3D scenarios ('dimensions 3') run on BasicSimulation in the scenario's precision.
+// --ranks splits the run over that many ranks (threads, or processes with --transport socket),
+// each owning one region of the bodies (see domain.h); snapshots are gathered on rank 0.
+// --sort-every checks the body order every N steps and re-sorts it for locality when it has
+// drifted (see bodyorder.h); output keeps listing the bodies in their original order.
+// --ensemble runs every member of a parameter sweep (see ensemble.h) and streams one
+// CSV line per run, to FILE or to the standard output.
+#include "bodylist.h"
+#include "domain.h"
+#include "ensemble.h"
+#include "profiler.h"
+#include "scenario.h"
+#include "simulation.h"
+#include "trajectory.h"
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+static void printSnapshot(const Simulation& sim) {
+    PROFILE_SCOPE(ProfilePhase::Output);
+    std::cout << "t = " << std::fixed << std::setprecision(3) << static_cast<double>(sim.time)
+        << " s, step " << sim.stepCount << "\n";
+    std::cout.unsetf(std::ios::floatfield);
+    for (size_t i = 0; i < sim.bodies.size(); ++i) {
+        const Body& b = sim.bodies[sim.order.slotOf(i)];
+        std::cout << "  [" << i << "] pos=" << b.position << ", vel=" << b.velocity << ", acc=" << b.acceleration << "\n";
+    }
+}
+
+template <typename T>
+static void printSnapshot(const BasicSimulation<3, T>& sim) {
+    std::cout << "t = " << std::fixed << std::setprecision(3) << static_cast<double>(sim.time)
+        << " s, step " << sim.stepCount << "\n";
+    std::cout.unsetf(std::ios::floatfield);
+    for (size_t i = 0; i < sim.bodies.size(); ++i) {
+        const auto& b = sim.bodies[i];
+        std::cout << "  [" << i << "] pos=" << b.position << ", vel=" << b.velocity << ", acc=" << b.acceleration << "\n";
+    }
+}
+
+// Same loop and statistics as the 2D run below, without collisions and files
+template <typename T>
+static int run3d(const Scenario& scenario, const std::string& title, bool quiet) {
+    BasicSimulation<3, T> sim;
+    scenario.apply(sim);
+    std::cout << title << ": " << sim.bodies.size() << " bodies (3D), " << scenario.steps << " steps, dt = "
+        << static_cast<double>(sim.dt) << " s, " << Integrator::name(sim.integratorType()) << "\n";
+
+    using Clock = std::chrono::steady_clock;
+    auto start = Clock::now();
+    double outputSeconds = 0;
+    while (sim.stepCount < scenario.steps) {
+        sim.step();
+        const long long step = sim.stepCount;
+        bool periodic = scenario.outputEvery > 0 && step % scenario.outputEvery == 0;
+        if (!quiet && (periodic || step == scenario.steps)) {
+            auto outStart = Clock::now();
+            printSnapshot(sim);
+            outputSeconds += std::chrono::duration<double>(Clock::now() - outStart).count();
+        }
+    }
+    double total = std::chrono::duration<double>(Clock::now() - start).count();
+    double stepping = total - outputSeconds;
+    std::cout << "--- " << sim.stepCount << " steps in " << total << " s ("
+        << stepping << " s stepping, " << outputSeconds << " s output)\n";
+    if (sim.stepCount > 0 && stepping > 0) {
+        std::cout << "    " << sim.stepCount / stepping << " steps/s, "
+            << stepping * 1e9 / sim.stepCount << " ns/step, "
+            << sim.forceEvaluations << " force evaluations\n";
+    }
+    return 0;
+}
+
+// Domain-decomposed 2D run: the same loop on every rank, output from rank 0
+static int decomposed(const Scenario& scenario, const std::string& title, bool quiet) {
+    std::cout << title << ": " << scenario.bodies.size() << " bodies, " << scenario.steps << " steps, dt = "
+        << static_cast<double>(scenario.dt) << " s, " << Integrator::name(scenario.integrator) << ", "
+        << scenario.ranks << " ranks over " << transportName(scenario.transport) << "\n";
+    std::cout << "    " << summarizeBodies(scenario.bodies).describe() << "\n";
+
+    DomainRunSettings settings;
+    settings.ranks = scenario.ranks;
+    settings.transport = scenario.transport;
+    settings.rebalanceEvery = scenario.rebalanceEvery;
+
+    using Clock = std::chrono::steady_clock;
+    auto start = Clock::now();
+    double outputSeconds = 0;
+    long long steps = 0, evaluations = 0;
+    auto output = [&](const Simulation& whole) {
+        steps = whole.stepCount;
+        evaluations = whole.forceEvaluations;
+        if (quiet) return;
+        auto outStart = Clock::now();
+        printSnapshot(whole);
+        outputSeconds += std::chrono::duration<double>(Clock::now() - outStart).count();
+    };
+    DomainStats stats;
+    std::string error;
+    if (!runDecomposed(scenario, settings, output, stats, error)) {
+        std::cerr << error << "\n";
+        return 1;
+    }
+
+    double total = std::chrono::duration<double>(Clock::now() - start).count();
+    double stepping = total - outputSeconds;
+    std::cout << "--- " << steps << " steps in " << total << " s ("
+        << stepping << " s stepping, " << outputSeconds << " s output)\n";
+    if (steps > 0 && stepping > 0) {
+        std::cout << "    " << steps / stepping << " steps/s, "
+            << stepping * 1e9 / steps << " ns/step, "
+            << evaluations << " force evaluations per rank\n";
+    }
+    if (stats.evaluations > 0) {
+        std::cout << std::setprecision(4) << "    domains: " << stats.rebalances << " rebalances, " << stats.migrated << " bodies migrated, "
+            << static_cast<double>(stats.importedItems) / stats.evaluations / scenario.ranks << " imported cells and bodies per rank and evaluation, "
+            << stats.bytesSent / 1e6 << " MB in " << stats.messagesSent << " messages, imbalance " << stats.imbalance
+            << ", waited " << stats.waitSeconds << " s for imports\n" << std::setprecision(6);
+    }
+    return 0;
+}
+
+static void usage() {
+    std::cerr << "usage: headless <scenario file> [--steps N] [--output-every N] [--threads N] [--trajectory FILE]\n"
+        << "                [--checkpoint FILE] [--checkpoint-every N] [--restart FILE] [--profile FILE]\n"
+        << "                [--diagnostics-every N] [--diagnostics FILE] [--ranks N] [--transport local|socket]\n"
+        << "                [--rebalance-every N] [--sort-every N] [--quiet]\n"
+        << "       headless --inspect <trajectory file> [frame]\n"
+        << "       headless --ensemble <sweep file> [--threads N] [--output FILE]\n";
+}
+
+static void printDiagnostics(const Diagnostics& d, const DiagnosticsSample& s) {
+    std::cout << std::setprecision(6) << "  E = " << static_cast<double>(s.energy()) << " J (dE/E0 " << static_cast<double>(d.energyDrift(s))
+        << "), P = " << s.momentum << ", L = " << static_cast<double>(s.angularMomentum) << " (step " << s.step << ")\n";
+}
+
+static void writeDiagnostics(std::ostream& out, const Diagnostics& d, const DiagnosticsSample& s) {
+    out << s.step << "," << static_cast<double>(s.time) << "," << static_cast<double>(s.kinetic) << ","
+        << static_cast<double>(s.potential) << "," << static_cast<double>(s.energy()) << ","
+        << static_cast<double>(d.energyDrift(s)) << "," << static_cast<double>(s.momentum.x) << ","
+        << static_cast<double>(s.momentum.y) << "," << static_cast<double>(s.angularMomentum) << "\n";
+}
+
+// Exclusive time per phase as a share of the run, plus the counter rates
+static void printProfile(const ProfileTotals& t, double seconds) {
+    int64_t sum = 0;
+    for (int p = 0; p < PROFILE_PHASES; ++p) sum += t.ns[p];
+    std::cout << "    profile:";
+    for (int p = 0; p < PROFILE_PHASES; ++p) {
+        if (t.calls[p] == 0) continue;
+        std::cout << " " << Profiler::phaseName(static_cast<ProfilePhase>(p)) << " "
+            << std::fixed << std::setprecision(1) << 100.0 * t.ns[p] / std::max<int64_t>(sum, 1) << "%";
+    }
+    std::cout.unsetf(std::ios::floatfield);
+    std::cout << std::setprecision(6) << "\n    " << t.counters[static_cast<int>(ProfileCounter::Steps)] / seconds << " steps/s, "
+        << t.counters[static_cast<int>(ProfileCounter::Interactions)] / seconds << " interactions/s\n";
+}
+
+static int inspect(const char* path, const char* frameArg) {
+    TrajectoryReader reader;
+    std::string error;
+    if (!reader.open(path, error)) {
+        std::cerr << error << "\n";
+        return 1;
+    }
+
+    std::cout << path << ": " << reader.frameCount() << " frames, "
+        << (reader.isFloat32() ? "float32" : "float64") << "\n";
+
+    if (!frameArg) {
+        for (size_t k = 0; k < reader.frameCount(); ++k) {
+            TrajectoryFrameHeader fh = reader.frameHeader(k);
+            std::cout << "  #" << k << " step " << fh.step << ", t = " << fh.time << " s, " << fh.bodyCount << " bodies\n";
+        }
+        return 0;
+    }
+
+    size_t k = static_cast<size_t>(std::atoll(frameArg));
+    if (k >= reader.frameCount()) {
+        std::cerr << "no frame " << k << "\n";
+        return 1;
+    }
+    std::vector<Body> bodies;
+    reader.readFrame(k, bodies);
+    TrajectoryFrameHeader fh = reader.frameHeader(k);
+    std::cout << "frame " << k << ": step " << fh.step << ", t = " << fh.time << " s\n";
+    for (size_t i = 0; i < bodies.size(); ++i) {
+        std::cout << "  [" << i << "] m=" << static_cast<double>(bodies[i].mass)
+            << ", pos=" << bodies[i].position << ", vel=" << bodies[i].velocity << "\n";
+    }
+    return 0;
+}
+
+static int ensemble(int argc, char* argv[]) {
+    SweepSpec spec;
+    std::string error;
+    if (!loadSweepFile(argv[2], spec, error)) {
+        std::cerr << argv[2] << ": " << error << "\n";
+        return 1;
+    }
+
+    Ensemble engine;
+    engine.threads = spec.base.threads;
+    std::string outputPath;
+    for (int i = 3; i < argc; ++i) {
+        bool hasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "--threads") == 0 && hasValue) engine.threads = std::max(1, std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--output") == 0 && hasValue) outputPath = argv[++i];
+        else {
+            usage();
+            return 2;
+        }
+    }
+
+    std::ofstream file;
+    if (!outputPath.empty()) {
+        file.open(outputPath);
+        if (!file) {
+            std::cerr << "cannot create " << outputPath << "\n";
+            return 1;
+        }
+    }
+    std::ostream& out = file.is_open() ? file : std::cout;
+    std::ostream& log = file.is_open() ? std::cout : std::cerr; // keeps a piped CSV clean
+
+    const std::string title = spec.base.name.empty() ? std::string(argv[2]) : spec.base.name;
+    log << title << ": " << spec.runs << " runs of " << spec.base.bodies.size() << " bodies, " << spec.base.steps
+        << " steps, " << Integrator::name(spec.base.integrator) << ", " << engine.threads << " threads, "
+        << ForceKernel::isaName(engine.isa) << "\n";
+
+    out << "run";
+    for (const auto& p : spec.parameters) out << "," << p.name();
+    out << ",contact_step,min_distance,energy_drift";
+    for (size_t i = 0; i < spec.base.bodies.size(); ++i) {
+        out << ",x" << i << ",y" << i << ",vx" << i << ",vy" << i;
+    }
+    out << "\n" << std::setprecision(17);
+
+    long long contacts = 0;
+    double worstDrift = 0;
+    auto sink = [&](const EnsembleRun& r) {
+        out << r.index;
+        for (double v : r.parameters) out << "," << v;
+        out << "," << r.contactStep << "," << r.minDistance << "," << r.energyDrift;
+        for (const Body& b : r.bodies) {
+            out << "," << static_cast<double>(b.position.x) << "," << static_cast<double>(b.position.y)
+                << "," << static_cast<double>(b.velocity.x) << "," << static_cast<double>(b.velocity.y);
+        }
+        out << "\n";
+        contacts += r.contactStep >= 0;
+        worstDrift = std::max(worstDrift, r.energyDrift);
+    };
+
+    using Clock = std::chrono::steady_clock;
+    auto start = Clock::now();
+    if (!engine.run(spec, sink, error)) {
+        std::cerr << error << "\n";
+        return 1;
+    }
+    double total = std::chrono::duration<double>(Clock::now() - start).count();
+    log << "--- " << spec.runs << " runs in " << total << " s (" << spec.runs / total << " runs/s, "
+        << engine.systemSteps / total << " system steps/s)\n"
+        << "    " << contacts << " runs with contact, max energy drift " << worstDrift << "\n";
+    if (file.is_open()) log << "    results: " << outputPath << "\n";
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        usage();
+        return 2;
+    }
+    if (std::strcmp(argv[1], "--inspect") == 0) {
+        if (argc < 3) {
+            usage();
+            return 2;
+        }
+        return inspect(argv[2], argc > 3 ? argv[3] : nullptr);
+    }
+    if (std::strcmp(argv[1], "--ensemble") == 0) {
+        if (argc < 3) {
+            usage();
+            return 2;
+        }
+        return ensemble(argc, argv);
+    }
+
+    Scenario scenario;
+    std::string error;
+    if (!loadScenarioFile(argv[1], scenario, error)) {
+        std::cerr << argv[1] << ": " << error << "\n";
+        return 1;
+    }
+
+    bool quiet = false;
+    std::string restart, profile, diagnosticsPath;
+    long long sortEvery = -1; // -1 = the scenario's, or the checkpoint's on a restart
+    for (int i = 2; i < argc; ++i) {
+        const char* arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (std::strcmp(arg, "--steps") == 0 && hasValue) scenario.steps = std::atoll(argv[++i]);
+        else if (std::strcmp(arg, "--output-every") == 0 && hasValue) scenario.outputEvery = std::atoll(argv[++i]);
+        else if (std::strcmp(arg, "--threads") == 0 && hasValue) scenario.threads = std::max(1, std::atoi(argv[++i]));
+        else if (std::strcmp(arg, "--trajectory") == 0 && hasValue) scenario.trajectory = argv[++i];
+        else if (std::strcmp(arg, "--checkpoint") == 0 && hasValue) scenario.checkpoint = argv[++i];
+        else if (std::strcmp(arg, "--checkpoint-every") == 0 && hasValue) scenario.checkpointEvery = std::atoll(argv[++i]);
+        else if (std::strcmp(arg, "--restart") == 0 && hasValue) restart = argv[++i];
+        else if (std::strcmp(arg, "--profile") == 0 && hasValue) profile = argv[++i];
+        else if (std::strcmp(arg, "--diagnostics-every") == 0 && hasValue) scenario.diagnosticsEvery = std::max(0LL, std::atoll(argv[++i]));
+        else if (std::strcmp(arg, "--diagnostics") == 0 && hasValue) diagnosticsPath = argv[++i];
+        else if (std::strcmp(arg, "--ranks") == 0 && hasValue) scenario.ranks = std::max(1, std::atoi(argv[++i]));
+        else if (std::strcmp(arg, "--transport") == 0 && hasValue) {
+            if (!parseTransport(argv[++i], scenario.transport)) {
+                usage();
+                return 2;
+            }
+        }
+        else if (std::strcmp(arg, "--rebalance-every") == 0 && hasValue) scenario.rebalanceEvery = std::max(0LL, std::atoll(argv[++i]));
+        else if (std::strcmp(arg, "--sort-every") == 0 && hasValue) sortEvery = std::max(0LL, std::atoll(argv[++i]));
+        else if (std::strcmp(arg, "--quiet") == 0) quiet = true;
+        else {
+            usage();
+            return 2;
+        }
+    }
+
+    const std::string title = scenario.name.empty() ? std::string(argv[1]) : scenario.name;
+    if (scenario.ranks > 1) {
+        if (!restart.empty() || !diagnosticsPath.empty()) {
+            std::cerr << "restarts and diagnostics are not supported with more than one rank\n";
+            return 1;
+        }
+        return decomposed(scenario, title, quiet);
+    }
+
+    if (scenario.dimensions == 3) {
+        if (!restart.empty() || !scenario.trajectory.empty() || !scenario.checkpoint.empty()
+            || scenario.diagnosticsEvery > 0 || !diagnosticsPath.empty()) {
+            std::cerr << "trajectories, checkpoints and diagnostics are not supported in 3D\n";
+            return 1;
+        }
+        switch (scenario.precision) {
+        case Precision::Double: return run3d<double>(scenario, title, quiet);
+        case Precision::Float: return run3d<float>(scenario, title, quiet);
+        case Precision::LongDouble:
+        default: return run3d<LD>(scenario, title, quiet);
+        }
+    }
+
+    Simulation sim;
+    if (restart.empty()) {
+        scenario.apply(sim);
+    }
+    else if (!loadCheckpoint(restart, sim, error)) {
+        std::cerr << error << "\n";
+        return 1;
+    }
+    else {
+        std::cout << "restarting from " << restart << " at step " << sim.stepCount << "\n";
+        sim.diagnostics.every = scenario.diagnosticsEvery; // not part of the checkpoint
+    }
+    if (sortEvery >= 0) sim.order.every = sortEvery;
+
+    if (!scenario.checkpoint.empty()) {
+        sim.checkpointer.reset(new BackgroundCheckpointer(scenario.checkpoint));
+        if (scenario.checkpointEvery > 0) sim.checkpointEvery = scenario.checkpointEvery;
+    }
+
+    if (!scenario.trajectory.empty()) {
+        sim.trajectory.reset(new TrajectoryWriter());
+        if (!sim.trajectory->open(scenario.trajectory, scenario.trajectoryFloat32, error)) {
+            std::cerr << error << "\n";
+            return 1;
+        }
+        sim.trajectory->record(sim); // initial state is the first frame
+    }
+
+    std::ofstream diagnosticsFile;
+    if (!diagnosticsPath.empty()) {
+        if (sim.diagnostics.every == 0) sim.diagnostics.every = std::max(1LL, scenario.outputEvery);
+        diagnosticsFile.open(diagnosticsPath);
+        if (!diagnosticsFile) {
+            std::cerr << "cannot create " << diagnosticsPath << "\n";
+            return 1;
+        }
+        diagnosticsFile << std::setprecision(17) << "step,time,kinetic,potential,energy,energy_drift,px,py,angular_momentum\n";
+    }
+
+    std::cout << title << ": "
+        << sim.bodies.size() << " bodies, " << scenario.steps << " steps, dt = " << static_cast<double>(sim.dt)
+        << " s, " << Integrator::name(sim.integrator->type()) << "\n";
+    std::cout << "    " << summarizeBodies(sim.bodies).describe() << "\n";
+
+    using Clock = std::chrono::steady_clock;
+    auto start = Clock::now();
+    double outputSeconds = 0;
+    const long long firstStep = sim.stepCount;
+    long long reportedCollisions = sim.collisions.total;
+    long long reportedSamples = sim.diagnostics.total;
+
+    while (sim.stepCount < scenario.steps && !sim.isFinished) {
+        sim.step();
+
+        if (sim.collisions.total != reportedCollisions) {
+            if (!quiet) {
+                for (const auto& e : sim.collisions.recent()) {
+                    if (e.seq <= reportedCollisions) continue;
+                    std::cout << "Collision of bodies " << e.a << " and " << e.b << " at t = "
+                        << static_cast<double>(e.time) << " s (step " << e.step << ")\n";
+                }
+            }
+            reportedCollisions = sim.collisions.total;
+        }
+
+        if (sim.diagnostics.total != reportedSamples) {
+            auto outStart = Clock::now();
+            for (const auto& s : sim.diagnostics.recent()) {
+                if (s.seq <= reportedSamples) continue;
+                if (!quiet) printDiagnostics(sim.diagnostics, s);
+                if (diagnosticsFile.is_open()) writeDiagnostics(diagnosticsFile, sim.diagnostics, s);
+            }
+            reportedSamples = sim.diagnostics.total;
+            outputSeconds += std::chrono::duration<double>(Clock::now() - outStart).count();
+        }
+
+        const long long step = sim.stepCount;
+        bool periodic = scenario.outputEvery > 0 && step % scenario.outputEvery == 0;
+        if (!quiet && (periodic || step == scenario.steps || sim.isFinished)) {
+            auto outStart = Clock::now();
+            printSnapshot(sim);
+            outputSeconds += std::chrono::duration<double>(Clock::now() - outStart).count();
+        }
+    }
+
+    if (sim.trajectory) {
+        sim.trajectory->close(); // the index is part of the measured time
+        std::string trajectoryError = sim.trajectory->lastError();
+        if (!trajectoryError.empty()) {
+            std::cerr << trajectoryError << "\n";
+            return 1;
+        }
+    }
+    double total = std::chrono::duration<double>(Clock::now() - start).count();
+    if (sim.checkpointer) {
+        sim.checkpointer->request(sim); // final state
+        sim.checkpointer.reset();       // waits for the write
+        std::cout << "checkpoint: " << scenario.checkpoint << " (step " << sim.stepCount << ")\n";
+    }
+    const long long steps = sim.stepCount - firstStep;
+    double stepping = total - outputSeconds;
+    std::cout << "--- " << steps << " steps in " << total << " s ("
+        << stepping << " s stepping, " << outputSeconds << " s output)\n";
+    if (steps > 0 && stepping > 0) {
+        std::cout << "    " << steps / stepping << " steps/s, "
+            << stepping * 1e9 / steps << " ns/step, "
+            << sim.forceEvaluations << " force evaluations\n";
+    }
+    if (sim.diagnostics.total > 0) {
+        const DiagnosticsSample& first = sim.diagnostics.reference();
+        const DiagnosticsSample& last = sim.diagnostics.recent().back();
+        std::cout << std::setprecision(6) << "    " << sim.diagnostics.total << " diagnostics samples: dE/E0 " << static_cast<double>(sim.diagnostics.energyDrift(last))
+            << " (max " << static_cast<double>(sim.diagnostics.maxEnergyDrift) << "), dP " << (last.momentum - first.momentum)
+            << ", dL " << static_cast<double>(last.angularMomentum - first.angularMomentum) << "\n";
+        if (diagnosticsFile.is_open()) std::cout << "    diagnostics: " << diagnosticsPath << "\n";
+    }
+    if (sim.collisionPolicy != CollisionPolicy::None) {
+        std::cout << "    " << sim.collisions.total << " collisions, " << sim.bodies.size() << " bodies left"
+            << (sim.isFinished ? " (stopped at the first one)" : "") << "\n";
+    }
+    if (sim.order.checks > 0) {
+        std::cout << std::setprecision(3) << "    body order: " << sim.order.sorts << " re-sorts in " << sim.order.checks
+            << " checks, " << sim.order.disorder * 100 << "% out of order at the last one\n";
+    }
+    if (!profile.empty()) {
+        if (!Profiler::enabled) {
+            std::cout << "    profile: not recorded, this build has no GRAVITY_PROFILING\n";
+        }
+        else if (!Profiler::instance().writeChromeTrace(profile, error)) {
+            std::cerr << error << "\n";
+        }
+        else {
+            printProfile(Profiler::instance().totals(), stepping);
+            std::cout << "    trace: " << profile << "\n";
+        }
+    }
+    if (sim.solver == ForceSolver::Fmm && steps > 0) {
+        const FmmStats& fs = sim.fmm.stats();
+        std::cout << "    fmm order " << sim.fmm.order << ", theta " << static_cast<double>(sim.fmm.theta) << ": "
+            << fs.nodes << " cells, " << fs.m2l << " M2L, " << fs.p2p << " P2P, sampled error rms "
+            << fs.sampledRmsError << " / max " << fs.sampledMaxError << "\n";
+    }
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,266 @@
+﻿#include "barneshut.h"
+#include "physics.h"
+#include <algorithm>
+
+static int quadrantOf(const QuadNode& node, const Vec2& p) {
+    return (p.x >= node.centerX ? 1 : 0) | (p.y >= node.centerY ? 2 : 0);
+}
+
+int BarnesHut::allocChildren(int parent) {
+    // Copy the parent geometry first: push_back() may move the arena
+    const LD cx = nodes[parent].centerX;
+    const LD cy = nodes[parent].centerY;
+    const LD h = nodes[parent].halfSize / 2;
+
+    int first = static_cast<int>(nodes.size());
+    for (int q = 0; q < 4; ++q) {
+        QuadNode child;
+        child.centerX = cx + ((q & 1) ? h : -h);
+        child.centerY = cy + ((q & 2) ? h : -h);
+        child.halfSize = h;
+        nodes.push_back(child);
+    }
+    return first;
+}
+
+void BarnesHut::build(const std::vector<Body>& bodies) {
+    // clear() keeps the capacity, so the arena is reused between steps
+    nodes.clear();
+    nextBody.assign(bodies.size(), -1);
+    if (bodies.empty()) return;
+
+    LD minX = bodies[0].position.x, maxX = minX;
+    LD minY = bodies[0].position.y, maxY = minY;
+    for (const auto& b : bodies) {
+        minX = std::min(minX, b.position.x); maxX = std::max(maxX, b.position.x);
+        minY = std::min(minY, b.position.y); maxY = std::max(maxY, b.position.y);
+    }
+
+    QuadNode root;
+    root.centerX = (minX + maxX) / 2;
+    root.centerY = (minY + maxY) / 2;
+    // A little padding so that bodies on the max edge still fall inside
+    root.halfSize = std::max(maxX - minX, maxY - minY) / 2 * 1.0001L + MIN_NUMBER;
+    nodes.push_back(root);
+
+    for (size_t i = 0; i < bodies.size(); ++i) {
+        insert(bodies, static_cast<int>(i));
+    }
+    computeMass(bodies);
+}
+
+void BarnesHut::insert(const std::vector<Body>& bodies, int bodyIndex) {
+    const Vec2& p = bodies[bodyIndex].position;
+    int node = 0;
+    int depth = 0;
+
+    while (true) {
+        // Note: no references into 'nodes' are kept across allocChildren()
+        if (nodes[node].firstChild >= 0) {
+            node = nodes[node].firstChild + quadrantOf(nodes[node], p);
+            ++depth;
+            continue;
+        }
+        if (nodes[node].firstBody < 0) {
+            nodes[node].firstBody = bodyIndex;
+            nextBody[bodyIndex] = -1;
+            return;
+        }
+        if (depth >= MAX_DEPTH) {
+            // Bodies (almost) at the same point: keep them together in one bucket
+            nextBody[bodyIndex] = nodes[node].firstBody;
+            nodes[node].firstBody = bodyIndex;
+            return;
+        }
+
+        // Occupied leaf: split it and push the old body one level down
+        int existing = nodes[node].firstBody;
+        int first = allocChildren(node);
+        nodes[node].firstBody = -1;
+        nodes[node].firstChild = first;
+        int q = quadrantOf(nodes[node], bodies[existing].position);
+        nodes[first + q].firstBody = existing;
+        nextBody[existing] = -1;
+    }
+}
+
+void BarnesHut::computeMass(const std::vector<Body>& bodies) {
+    // Children are always allocated after their parent,
+    // so a reverse sweep is a post-order traversal
+    for (size_t k = nodes.size(); k-- > 0; ) {
+        QuadNode& n = nodes[k];
+        LD m = 0, mx = 0, my = 0;
+        if (n.firstChild < 0) {
+            for (int b = n.firstBody; b >= 0; b = nextBody[b]) {
+                m += bodies[b].mass;
+                mx += bodies[b].mass * bodies[b].position.x;
+                my += bodies[b].mass * bodies[b].position.y;
+            }
+        }
+        else {
+            for (int q = 0; q < 4; ++q) {
+                const QuadNode& c = nodes[n.firstChild + q];
+                m += c.mass;
+                mx += c.mass * c.comX;
+                my += c.mass * c.comY;
+            }
+        }
+        n.mass = m;
+        n.comX = m > 0 ? mx / m : n.centerX;
+        n.comY = m > 0 ? my / m : n.centerY;
+    }
+}
+
+// With phi, also sums mass / distance over the same bodies and cells; with count, counts them
+Vec2 BarnesHut::accelerationAt(const std::vector<Body>& bodies, const Vec2& p, int self, const SofteningLaw<LD>& law, LD* phi, uint32_t* count) const {
+    const bool softened = softening.enabled();
+    Vec2 acc = { 0, 0 };
+    LD sum = 0;
+    uint32_t visited = 0;
+
+    int stack[3 * MAX_DEPTH + 8];
+    int top = 0;
+    stack[top++] = 0;
+
+    while (top > 0) {
+        const QuadNode& n = nodes[stack[--top]];
+        if (n.mass == 0) continue;
+
+        if (n.firstChild < 0) {
+            // Leaf: exact interaction with every body in it
+            for (int b = n.firstBody; b >= 0; b = nextBody[b]) {
+                if (b == self) continue;
+                Vec2 r_vec = bodies[b].position - p;
+                LD r = r_vec.norm();
+                if (r < MIN_NUMBER || r < nearRadius) continue;
+                ++visited;
+                if (softened) {
+                    acc = acc + r_vec * (Physics::G * bodies[b].mass * law.inverseCube(r));
+                    if (phi) sum += bodies[b].mass * law.inverse(r);
+                    continue;
+                }
+                acc = acc + r_vec * (Physics::G * bodies[b].mass / (r * r * r));
+                if (phi) sum += bodies[b].mass / r;
+            }
+            continue;
+        }
+
+        Vec2 r_vec = { n.comX - p.x, n.comY - p.y };
+        LD r = r_vec.norm();
+
+        // Every body of the cell is within its diagonal (2 sqrt(2) halfSize) of the center of mass
+        const bool mayHoldNear = nearRadius > 0 && r <= nearRadius + 2.83L * n.halfSize;
+
+        // Opening criterion: cell size / distance < theta
+        if (2 * n.halfSize < theta * r && !mayHoldNear) {
+            ++visited;
+            acc = acc + r_vec * (Physics::G * n.mass * (softened ? law.inverseCube(r) : 1 / (r * r * r)));
+            if (phi) sum += n.mass * (softened ? law.inverse(r) : 1 / r);
+            continue;
+        }
+        for (int q = 0; q < 4; ++q) {
+            stack[top++] = n.firstChild + q;
+        }
+    }
+    if (phi) *phi = sum;
+    if (count) *count = visited;
+    return acc;
+}
+
+void BarnesHut::essentialFor(const std::vector<Body>& bodies, LD minX, LD minY, LD maxX, LD maxY, std::vector<PointMass>& out) const {
+    if (nodes.empty()) return;
+    int stack[3 * MAX_DEPTH + 8];
+    int top = 0;
+    stack[top++] = 0;
+
+    while (top > 0) {
+        const QuadNode& n = nodes[stack[--top]];
+        if (n.mass == 0) continue;
+
+        if (n.firstChild < 0) {
+            for (int b = n.firstBody; b >= 0; b = nextBody[b]) {
+                out.push_back({ bodies[b].position.x, bodies[b].position.y, bodies[b].mass });
+            }
+            continue;
+        }
+
+        // Closest point of the rectangle to the center of mass: no body there is any nearer
+        const LD dx = std::max({ minX - n.comX, n.comX - maxX, 0.0L });
+        const LD dy = std::max({ minY - n.comY, n.comY - maxY, 0.0L });
+        if (2 * n.halfSize < theta * std::sqrt(dx * dx + dy * dy)) {
+            out.push_back({ n.comX, n.comY, n.mass });
+            continue;
+        }
+        for (int q = 0; q < 4; ++q) {
+            stack[top++] = n.firstChild + q;
+        }
+    }
+}
+
+void BarnesHut::computeAccelerations(std::vector<Body>& bodies, LD* potential) const {
+    if (nodes.empty()) return;
+    const SofteningLaw<LD> law(softening);
+    if (interactions) interactions->resize(bodies.size());
+    LD energy = 0;
+    for (size_t i = 0; i < bodies.size(); ++i) {
+        LD phi = 0;
+        bodies[i].acceleration = accelerationAt(bodies, bodies[i].position, static_cast<int>(i), law, potential ? &phi : nullptr,
+            interactions ? &(*interactions)[i] : nullptr);
+        energy += bodies[i].mass * phi;
+    }
+    if (potential) *potential = -Physics::G * energy / 2;
+}
+
+void BarnesHut::computeAccelerations(std::vector<Body>& bodies, ThreadPool& pool, LD* potential) const {
+    if (nodes.empty()) return;
+    // Tree walks are independent, so plain per-body tiles are enough
+    const size_t n = bodies.size();
+    const size_t tile = 256;
+    const size_t tiles = (n + tile - 1) / tile;
+    const SofteningLaw<LD> law(softening);
+    std::vector<LD> tileEnergy(potential ? tiles : 0, 0);
+    if (interactions) interactions->resize(n);
+    pool.run(tiles, [&](size_t t, int) {
+        size_t end = std::min(n, (t + 1) * tile);
+        for (size_t i = t * tile; i < end; ++i) {
+            LD phi = 0;
+            bodies[i].acceleration = accelerationAt(bodies, bodies[i].position, static_cast<int>(i), law, potential ? &phi : nullptr,
+                interactions ? &(*interactions)[i] : nullptr);
+            if (potential) tileEnergy[t] += bodies[i].mass * phi;
+        }
+    });
+    if (potential) {
+        // Summed in tile order, so the result does not depend on the thread count
+        LD energy = 0;
+        for (LD e : tileEnergy) energy += e;
+        *potential = -Physics::G * energy / 2;
+    }
+}
+
+void BarnesHut::addAccelerations(const std::vector<Body>& sources, std::vector<Body>& targets, ThreadPool* pool,
+    LD* pairs, std::vector<uint32_t>* counts) const {
+    if (nodes.empty()) return;
+    const size_t n = targets.size();
+    const size_t tile = 256;
+    const size_t tiles = (n + tile - 1) / tile;
+    const SofteningLaw<LD> law(softening);
+    std::vector<LD> tilePairs(pairs ? tiles : 0, 0);
+    if (counts) counts->resize(n, 0);
+    auto task = [&](size_t t, int) {
+        size_t end = std::min(n, (t + 1) * tile);
+        for (size_t i = t * tile; i < end; ++i) {
+            LD phi = 0;
+            uint32_t visited = 0;
+            targets[i].acceleration += accelerationAt(sources, targets[i].position, -1, law, pairs ? &phi : nullptr, counts ? &visited : nullptr);
+            if (counts) (*counts)[i] += visited;
+            if (pairs) tilePairs[t] += targets[i].mass * phi;
+        }
+    };
+    if (pool && tiles > 1) pool->run(tiles, task);
+    else for (size_t t = 0; t < tiles; ++t) task(t, 0);
+    if (pairs) {
+        LD sum = 0;
+        for (LD e : tilePairs) sum += e;
+        *pairs = sum;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,70 @@
+#pragma once
+#include "helpers.h"
+#include "body.h"
+#include "softening.h"
+#include "threadpool.h"
+#include <cstdint>
+
+// One square cell of the quadtree.
+// Children are allocated as 4 contiguous nodes, so a single index is enough.
+struct QuadNode {
+    LD centerX = 0, centerY = 0;
+    LD halfSize = 0;
+
+    LD mass = 0;
+    LD comX = 0, comY = 0; // center of mass
+
+    int firstChild = -1; // -1 for leaves
+    int firstBody = -1;  // leaves only: head of the body chain (see BarnesHut::nextBody)
+};
+
+// A cell or body handed to another rank as a single source (see BarnesHut::essentialFor)
+struct PointMass {
+    LD x = 0, y = 0;
+    LD mass = 0;
+};
+
+// Barnes-Hut tree code: O(N log N) approximation of the direct sum.
+// Nodes live in an arena that is cleared (not freed) on every build,
+// so after the first step no allocations happen.
+class BarnesHut {
+public:
+    LD theta = 0.5; // opening angle; 0 = exact (every leaf is opened)
+    Softening softening; // applied to bodies and cells alike
+    // Pairs closer than this (m) are left out for the caller to sum (see Simulation::nearRadius):
+    // such bodies are skipped, and cells that may hold one are always opened. 0 = none
+    LD nearRadius = 0;
+    // When set, computeAccelerations() also stores how many bodies and cells each body
+    // interacted with: its share of the cost, used to balance a domain decomposition
+    std::vector<uint32_t>* interactions = nullptr;
+
+    void build(const std::vector<Body>& bodies);
+    // With 'potential' the walk also returns the potential energy (J), with the same cell approximation
+    void computeAccelerations(std::vector<Body>& bodies, LD* potential = nullptr) const;
+    void computeAccelerations(std::vector<Body>& bodies, ThreadPool& pool, LD* potential = nullptr) const;
+
+    // Pull of the tree's bodies ('sources', as given to build()) on bodies outside of it,
+    // such as another rank's (see domain.h): adds to their accelerations and, with 'counts',
+    // to their interaction counts. With 'pairs' also returns sum m_target m_source / r.
+    void addAccelerations(const std::vector<Body>& sources, std::vector<Body>& targets, ThreadPool* pool,
+        LD* pairs = nullptr, std::vector<uint32_t>* counts = nullptr) const;
+
+    // Locally essential tree for the rectangle [minX, maxX] x [minY, maxY] (see domain.h):
+    // the cells that pass the opening test for every point of it, at their center of mass,
+    // and the bodies of the leaves that are reached. Appended to 'out'.
+    void essentialFor(const std::vector<Body>& bodies, LD minX, LD minY, LD maxX, LD maxY, std::vector<PointMass>& out) const;
+
+    size_t nodeCount() const { return nodes.size(); }
+
+    static constexpr int MAX_DEPTH = 64; // deeper cells become buckets of coincident bodies
+
+private:
+    std::vector<QuadNode> nodes;
+    std::vector<int> nextBody; // singly linked body chains for the leaves
+
+    int allocChildren(int parent);
+    void insert(const std::vector<Body>& bodies, int bodyIndex);
+    void computeMass(const std::vector<Body>& bodies);
+    // Pull on the point p of the bodies in the tree except bodies[self] (-1 = none)
+    Vec2 accelerationAt(const std::vector<Body>& bodies, const Vec2& p, int self, const SofteningLaw<LD>& law, LD* phi = nullptr, uint32_t* count = nullptr) const;
+};
\ No newline at end of file
@@ -0,0 +1,72 @@
+#pragma once
+#include "helpers.h"
+#include "body.h"
+#include "integrator.h"
+#include "physics.h"
+
+// Simulation core for any dimension and precision: direct-sum gravity with the
+// symplectic integrators. Header-only, so every loop is compiled for the
+// concrete Vec<D, T> and nothing is dispatched per body.
+//
+// The 2D GUI runs the full Simulation (tree solvers, collisions, trajectories,
+// checkpoints) on BodyT<2, long double>; this class is what 3D runs use.
+template <int D, typename T>
+class BasicSimulation {
+public:
+    using Vector = Vec<D, T>;
+    using BodyType = BodyT<D, T>;
+
+    std::vector<BodyType> bodies;
+    T time = 0; // total time (s)
+    T dt = 1;   // step (s)
+    long long stepCount = 0;
+    long long forceEvaluations = 0;
+    Softening softening; // see softening.h
+
+    // The adaptive schemes (Dormand-Prince, block time steps) are 2D only
+    static bool supports(IntegratorType type) {
+        return type == IntegratorType::Euler || type == IntegratorType::VelocityVerlet
+            || type == IntegratorType::LeapfrogKDK || type == IntegratorType::Yoshida4;
+    }
+
+    // Returns false (and keeps the current scheme) for an unsupported type
+    bool setIntegrator(IntegratorType type) {
+        if (!supports(type)) return false;
+        integrator = type;
+        return true;
+    }
+
+    IntegratorType integratorType() const { return integrator; }
+
+    void addBody(const BodyType& body) {
+        bodies.push_back(body);
+        accelerationsCurrent = false;
+    }
+
+    void computeAccelerations() {
+        Physics::directSum(bodies, static_cast<T*>(nullptr), softening);
+        ++forceEvaluations;
+        accelerationsCurrent = true;
+    }
+
+    // The same scheme code as the Integrator classes (see SymplecticSteps)
+    void step() {
+        switch (integrator) {
+        case IntegratorType::VelocityVerlet: SymplecticSteps::velocityVerlet(*this, previous); break;
+        case IntegratorType::LeapfrogKDK: SymplecticSteps::kickDriftKick(*this, dt); break;
+        case IntegratorType::Yoshida4: SymplecticSteps::yoshida4(*this); break;
+        case IntegratorType::Euler:
+        default: SymplecticSteps::euler(*this); break;
+        }
+        time += dt;
+        ++stepCount;
+    }
+
+    bool accelerationsCurrent = false; // forces belong to the current positions
+
+private:
+    IntegratorType integrator = IntegratorType::Euler;
+    std::vector<Vector> previous; // Velocity Verlet: a(t) while a(t + dt) is computed
+};
+
+using Simulation3D = BasicSimulation<3, LD>;
\ No newline at end of file
@@ -1,32 +1,31 @@
 #pragma once
 #include "helpers.h"
-#include <QString>
+#include "vec.h"
 
-struct Vec2 {
-    LD x = 0.0, y = 0.0;
-    Vec2 operator+(Vec2 o) const { return { x + o.x, y + o.y }; }
-    Vec2 operator-(Vec2 o) const { return { x - o.x, y - o.y }; }
-    Vec2 operator*(LD s) const { return { x * s, y * s }; }
-    LD norm() const { return std::sqrt(x * x + y * y); }
-    QString toString() const {
-        return QString("(%1, %2)").arg(x, 0, 'e', 6).arg(y, 0, 'e', 6);
-    }
-};
-
-class Body {
+// Point mass with a radius (for density and collisions) in D dimensions.
+// The 2D long double instantiation is the Body of the GUI and of all 2D solvers.
+template <int D, typename T>
+class BodyT {
 public:
-    LD mass;
-    LD radius;
+    using Vector = Vec<D, T>;
 
-    Vec2 position;
-    Vec2 velocity;
-    Vec2 acceleration = { 0, 0 };
+    T mass;
+    T radius;
 
-    LD density() const {
-        return mass / ((4.0 / 3.0) * M_PI * radius * radius * radius);
+    Vector position;
+    Vector velocity;
+    Vector acceleration = {};
+
+    T density() const {
+        return mass / (static_cast<T>((4.0 / 3.0) * M_PI) * radius * radius * radius);
     }
 
-    Body(LD m = 10, LD r = 10, Vec2 pos = { 0,0 }, Vec2 vel = { 0,0 })
+    BodyT(T m = 10, T r = 10, const Vector& pos = {}, const Vector& vel = {})
         : mass(m), radius(r), position(pos), velocity(vel) {
     }
-};
\ No newline at end of file
+};
+
+using Vec2 = Vec<2, LD>;
+using Vec3 = Vec<3, LD>;
+using Body = BodyT<2, LD>;
+using Body3 = BodyT<3, LD>;
\ No newline at end of file
@@ -0,0 +1,260 @@
+﻿#include "bodylist.h"
+#include "threadpool.h"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+static const size_t CSV_CHUNK_BYTES = 1 << 20;
+static const size_t BINARY_RECORD = 6 * sizeof(double);
+static const size_t BINARY_HEADER = sizeof(BODY_LIST_MAGIC) + sizeof(uint64_t);
+static const size_t BINARY_CHUNK = 1 << 16; // bodies
+
+static int resolveThreads(int threads) {
+    return threads > 0 ? threads : ThreadPool::hardwareThreads();
+}
+
+static bool isSeparator(char c) {
+    return c == ',' || c == ';' || c == ' ' || c == '\t' || c == '\r';
+}
+
+// One number at p (after optional blanks and a '+', which from_chars does not take).
+// Read as double like the binary form: the long double from_chars is several times slower
+static bool parseNumber(const char*& p, const char* end, double& value) {
+    while (p < end && (*p == ' ' || *p == '\t')) ++p;
+    if (p < end && *p == '+') ++p;
+    auto result = std::from_chars(p, end, value);
+    if (result.ec != std::errc() || !std::isfinite(value)) return false;
+    p = result.ptr;
+    return true;
+}
+
+namespace {
+    struct CsvChunk {
+        const char* begin;
+        const char* end;
+        std::vector<Body> bodies;
+        const char* errorAt = nullptr; // start of the first bad line
+    };
+}
+
+// Lines of [begin, end): bodies, blank or comment lines. Stops at the first bad line
+static void parseCsvChunk(CsvChunk& chunk) {
+    const char* p = chunk.begin;
+    while (p < chunk.end) {
+        const char* lineEnd = static_cast<const char*>(std::memchr(p, '\n', chunk.end - p));
+        if (!lineEnd) lineEnd = chunk.end;
+        const char* content = static_cast<const char*>(std::memchr(p, '#', lineEnd - p));
+        if (!content) content = lineEnd;
+
+        double v[6];
+        int fields = 0;
+        const char* q = p;
+        bool bad = false;
+        while (true) {
+            while (q < content && isSeparator(*q)) ++q;
+            if (q == content) break;
+            if (fields == 6 || !parseNumber(q, content, v[fields])) {
+                bad = true;
+                break;
+            }
+            ++fields;
+            if (q < content && !isSeparator(*q)) {
+                bad = true;
+                break;
+            }
+        }
+        if (bad || (fields != 0 && fields != 6) || (fields == 6 && (v[0] < 0 || v[1] < 0))) {
+            chunk.errorAt = p;
+            return;
+        }
+        if (fields == 6) chunk.bodies.push_back(Body(v[0], v[1], { v[2], v[3] }, { v[4], v[5] }));
+        p = lineEnd + 1;
+    }
+}
+
+bool parseBodyCsv(const char* text, size_t size, std::vector<Body>& bodies, std::string& error, int threads) {
+    const char* begin = text;
+    const char* end = text + size;
+    if (size >= 3 && std::memcmp(begin, "\xef\xbb\xbf", 3) == 0) begin += 3;
+
+    // A header is the first line with content that does not start with a number
+    for (const char* p = begin; p < end;) {
+        const char* lineEnd = static_cast<const char*>(std::memchr(p, '\n', end - p));
+        if (!lineEnd) lineEnd = end;
+        const char* q = p;
+        while (q < lineEnd && isSeparator(*q)) ++q;
+        if (q == lineEnd || *q == '#') {
+            p = lineEnd + 1;
+            continue;
+        }
+        double unused;
+        if (!parseNumber(q, lineEnd, unused)) begin = std::min(lineEnd + 1, end);
+        break;
+    }
+
+    // Chunks of about CSV_CHUNK_BYTES, each ending after a newline
+    std::vector<CsvChunk> chunks;
+    for (const char* p = begin; p < end;) {
+        const char* stop = p + std::min<size_t>(CSV_CHUNK_BYTES, end - p);
+        if (stop < end) {
+            const char* newline = static_cast<const char*>(std::memchr(stop, '\n', end - stop));
+            stop = newline ? newline + 1 : end;
+        }
+        chunks.push_back({ p, stop, {} });
+        p = stop;
+    }
+
+    if (chunks.size() > 1) {
+        ThreadPool pool(std::min(resolveThreads(threads), static_cast<int>(chunks.size())));
+        pool.run(chunks.size(), [&](size_t c, int) { parseCsvChunk(chunks[c]); });
+    }
+    else if (!chunks.empty()) {
+        parseCsvChunk(chunks[0]);
+    }
+
+    size_t total = 0;
+    for (const auto& c : chunks) {
+        if (c.errorAt) {
+            const long long line = 1 + std::count(text, c.errorAt, '\n');
+            error = "line " + std::to_string(line) + ": expected 6 numbers (mass, radius, x, y, vx, vy)";
+            return false;
+        }
+        total += c.bodies.size();
+    }
+    bodies.reserve(bodies.size() + total);
+    for (const auto& c : chunks) bodies.insert(bodies.end(), c.bodies.begin(), c.bodies.end());
+    return true;
+}
+
+bool parseBodyBinary(const char* data, size_t size, std::vector<Body>& bodies, std::string& error, int threads) {
+    uint64_t count = 0;
+    if (size < BINARY_HEADER || std::memcmp(data, BODY_LIST_MAGIC, sizeof(BODY_LIST_MAGIC)) != 0) {
+        error = "not a binary body list";
+        return false;
+    }
+    std::memcpy(&count, data + sizeof(BODY_LIST_MAGIC), sizeof(count));
+    if (count > (size - BINARY_HEADER) / BINARY_RECORD || size - BINARY_HEADER != count * BINARY_RECORD) {
+        error = "truncated or corrupt body list";
+        return false;
+    }
+
+    const size_t first = bodies.size();
+    bodies.resize(first + count);
+    const size_t tiles = (count + BINARY_CHUNK - 1) / BINARY_CHUNK;
+    std::vector<char> bad(tiles, 0);
+    auto decode = [&](size_t tile, int) {
+        const size_t stop = std::min<size_t>(count, (tile + 1) * BINARY_CHUNK);
+        for (size_t i = tile * BINARY_CHUNK; i < stop; ++i) {
+            double v[6];
+            std::memcpy(v, data + BINARY_HEADER + i * BINARY_RECORD, BINARY_RECORD);
+            for (double x : v) bad[tile] |= !std::isfinite(x);
+            bad[tile] |= v[0] < 0 || v[1] < 0;
+            bodies[first + i] = Body(v[0], v[1], { v[2], v[3] }, { v[4], v[5] });
+        }
+    };
+    if (tiles > 1) {
+        ThreadPool pool(std::min(resolveThreads(threads), static_cast<int>(tiles)));
+        pool.run(tiles, decode);
+    }
+    else if (tiles == 1) {
+        decode(0, 0);
+    }
+
+    if (std::find(bad.begin(), bad.end(), 1) != bad.end()) {
+        bodies.resize(first);
+        error = "body list has a negative mass or radius, or a value that is not finite";
+        return false;
+    }
+    return true;
+}
+
+bool loadBodyList(const std::string& path, std::vector<Body>& bodies, std::string& error, int threads) {
+    // One read of the whole file; parsing is the part worth parallelizing
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in) {
+        error = "cannot open " + path;
+        return false;
+    }
+    const std::streamsize size = in.tellg();
+    std::vector<char> data(static_cast<size_t>(std::max<std::streamsize>(size, 0)));
+    in.seekg(0);
+    if (size > 0 && !in.read(data.data(), size)) {
+        error = "cannot read " + path;
+        return false;
+    }
+
+    bool ok;
+    if (data.size() >= sizeof(BODY_LIST_MAGIC) && std::memcmp(data.data(), BODY_LIST_MAGIC, sizeof(BODY_LIST_MAGIC)) == 0) {
+        ok = parseBodyBinary(data.data(), data.size(), bodies, error, threads);
+    }
+    else {
+        ok = parseBodyCsv(data.data(), data.size(), bodies, error, threads);
+    }
+    if (!ok) error = path + ": " + error;
+    return ok;
+}
+
+bool saveBodyList(const std::string& path, const std::vector<Body>& bodies, std::string& error) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        error = "cannot create " + path;
+        return false;
+    }
+    const uint64_t count = bodies.size();
+    out.write(BODY_LIST_MAGIC, sizeof(BODY_LIST_MAGIC));
+    out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+    for (const Body& b : bodies) {
+        const double v[6] = {
+            static_cast<double>(b.mass), static_cast<double>(b.radius),
+            static_cast<double>(b.position.x), static_cast<double>(b.position.y),
+            static_cast<double>(b.velocity.x), static_cast<double>(b.velocity.y),
+        };
+        out.write(reinterpret_cast<const char*>(v), sizeof(v));
+    }
+    if (!out.flush()) {
+        error = "cannot write " + path;
+        return false;
+    }
+    return true;
+}
+
+BodyListSummary summarizeBodies(const std::vector<Body>& bodies) {
+    BodyListSummary s;
+    s.count = bodies.size();
+    if (bodies.empty()) return s;
+
+    s.minMass = s.maxMass = bodies[0].mass;
+    Vec2 weighted, momentum;
+    for (const Body& b : bodies) {
+        s.totalMass += b.mass;
+        s.minMass = std::min(s.minMass, b.mass);
+        s.maxMass = std::max(s.maxMass, b.mass);
+        weighted += b.position * b.mass;
+        momentum += b.velocity * b.mass;
+    }
+    Vec2 drift;
+    if (s.totalMass > 0) {
+        s.centerOfMass = weighted * (1 / s.totalMass);
+        drift = momentum * (1 / s.totalMass);
+    }
+    for (const Body& b : bodies) {
+        s.extent = std::max(s.extent, (b.position - s.centerOfMass).norm());
+        s.maxSpeed = std::max(s.maxSpeed, (b.velocity - drift).norm());
+    }
+    return s;
+}
+
+std::string BodyListSummary::describe() const {
+    std::ostringstream os;
+    os << std::setprecision(4) << count << " bodies, total mass " << static_cast<double>(totalMass) << " kg";
+    if (count > 1 && minMass != maxMass) {
+        os << " (" << static_cast<double>(minMass) << " to " << static_cast<double>(maxMass) << " each)";
+    }
+    os << ", radius " << static_cast<double>(extent) << " m around " << centerOfMass
+        << ", max speed " << static_cast<double>(maxSpeed) << " m/s";
+    return os.str();
+}
\ No newline at end of file
@@ -0,0 +1,35 @@
+#pragma once
+#include "helpers.h"
+#include "body.h"
+#include <cstdint>
+#include <string>
+
+// Bulk body lists, for setups too large to type in or to keep in a scenario file.
+//
+// CSV: one body per line, "mass, radius, x, y, vx, vy" in SI units (read as double), separated by commas,
+// semicolons or blanks; '#' starts a comment and a first line that does not start with a
+// number is a header. Parsing cuts the text into chunks at line boundaries and parses them
+// in parallel with std::from_chars, each into its own list; the lists are joined in order.
+//
+// Binary: the 8 bytes of BODY_LIST_MAGIC, the body count as a uint64, then six doubles
+// per body in the CSV order, all little-endian. Files without the magic are read as CSV.
+static constexpr char BODY_LIST_MAGIC[8] = { 'N', 'B', 'O', 'D', 'Y', '2', 'D', '1' };
+
+// 'threads' = 0 uses every hardware thread. The bodies are appended to 'bodies'
+bool loadBodyList(const std::string& path, std::vector<Body>& bodies, std::string& error, int threads = 0);
+bool parseBodyCsv(const char* text, size_t size, std::vector<Body>& bodies, std::string& error, int threads = 0);
+bool parseBodyBinary(const char* data, size_t size, std::vector<Body>& bodies, std::string& error, int threads = 0);
+bool saveBodyList(const std::string& path, const std::vector<Body>& bodies, std::string& error);
+
+// What the setup page and the runner show instead of one row per body
+struct BodyListSummary {
+    size_t count = 0;
+    LD totalMass = 0, minMass = 0, maxMass = 0;
+    Vec2 centerOfMass;
+    LD extent = 0;   // largest distance from the center of mass (m)
+    LD maxSpeed = 0; // in the center-of-mass frame (m/s)
+
+    std::string describe() const;
+};
+
+BodyListSummary summarizeBodies(const std::vector<Body>& bodies);
\ No newline at end of file
@@ -0,0 +1,167 @@
+﻿#include "bodyorder.h"
+#include "checkpoint.h"
+#include "simulation.h"
+#include <algorithm>
+#include <limits>
+#include <numeric>
+
+// Low 16 bits of v spread to the even bits
+static uint32_t spreadBits(uint32_t v) {
+    v &= 0xFFFF;
+    v = (v | (v << 8)) & 0x00FF00FF;
+    v = (v | (v << 4)) & 0x0F0F0F0F;
+    v = (v | (v << 2)) & 0x33333333;
+    v = (v | (v << 1)) & 0x55555555;
+    return v;
+}
+
+// 16 bits per axis over the bounding square of the bodies
+void BodyOrder::computeKeys(const std::vector<Body>& bodies) {
+    const size_t n = bodies.size();
+    double minX = std::numeric_limits<double>::infinity(), minY = minX;
+    double maxX = -minX, maxY = -minX;
+    for (const Body& b : bodies) {
+        const double x = static_cast<double>(b.position.x), y = static_cast<double>(b.position.y);
+        if (x < minX) minX = x;
+        if (x > maxX) maxX = x;
+        if (y < minY) minY = y;
+        if (y > maxY) maxY = y;
+    }
+    const double extent = std::max(maxX - minX, maxY - minY);
+    const double scale = extent > 0 && extent < std::numeric_limits<double>::infinity() ? 65535.0 / extent : 0;
+    auto cell = [scale](double v) {
+        const double q = v * scale;
+        return static_cast<uint32_t>(q >= 0 ? std::min(q, 65535.0) : 0); // NaN and overflow end up in a corner
+    };
+
+    keys.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+        const double x = static_cast<double>(bodies[i].position.x) - minX;
+        const double y = static_cast<double>(bodies[i].position.y) - minY;
+        keys[i] = spreadBits(cell(x)) | (spreadBits(cell(y)) << 1);
+    }
+}
+
+bool BodyOrder::update(Simulation& sim) {
+    const size_t n = sim.bodies.size();
+    ++checks;
+    disorder = 0;
+    if (n < 2) return false;
+    computeKeys(sim.bodies);
+
+    int bits = 1;
+    while (bits < 16 && (static_cast<size_t>(1) << (2 * bits)) * CELL_BODIES < n) ++bits;
+    const int shift = 2 * (16 - bits);
+    size_t descents = 0;
+    for (size_t i = 1; i < n; ++i) descents += (keys[i] >> shift) < (keys[i - 1] >> shift);
+    disorder = static_cast<double>(descents) / (n - 1);
+
+    return disorder > threshold && radixSort(sim);
+}
+
+bool BodyOrder::sort(Simulation& sim) {
+    if (sim.bodies.size() < 2) return false;
+    computeKeys(sim.bodies);
+    return radixSort(sim);
+}
+
+// LSD radix sort of (key, slot), a byte per pass. The sort is stable, so a nearly sorted
+// store stays as it is where it can, and a byte that every key shares needs no pass.
+bool BodyOrder::radixSort(Simulation& sim) {
+    const size_t n = keys.size();
+    order.resize(n);
+    std::iota(order.begin(), order.end(), 0u);
+    sortedKeys.resize(n);
+    sortedOrder.resize(n);
+    for (int shift = 0; shift < 32; shift += 8) {
+        size_t start[257] = {};
+        for (uint32_t k : keys) ++start[((k >> shift) & 0xFF) + 1];
+        if (std::find(start + 1, start + 257, n) != start + 257) continue;
+        for (int d = 1; d <= 256; ++d) start[d] += start[d - 1];
+        for (size_t i = 0; i < n; ++i) {
+            const size_t to = start[(keys[i] >> shift) & 0xFF]++;
+            sortedKeys[to] = keys[i];
+            sortedOrder[to] = order[i];
+        }
+        keys.swap(sortedKeys);
+        order.swap(sortedOrder);
+    }
+
+    size_t first = 0;
+    while (first < n && order[first] == first) ++first;
+    if (first == n) return false; // already in curve order
+
+    // Accelerations and per-body integrator history travel with the bodies, so nothing
+    // has to be recomputed. The neighbour list and collision grid see the moved slots as
+    // displacements and rebuild on their own.
+    std::vector<Body>& bodies = sim.bodies;
+    scratch.resize(n);
+    for (size_t i = 0; i < n; ++i) scratch[i] = bodies[order[i]];
+    bodies.swap(scratch);
+
+    scratchIds.resize(n);
+    for (size_t i = 0; i < n; ++i) scratchIds[i] = ids.empty() ? order[i] : ids[order[i]];
+    ids.swap(scratchIds);
+    slots.clear();
+
+    sim.integrator->permute(order);
+    ++sorts;
+    return true;
+}
+
+size_t BodyOrder::slotOf(size_t id) const {
+    if (ids.empty()) return id;
+    if (slots.size() != ids.size()) {
+        slots.resize(ids.size());
+        for (size_t i = 0; i < ids.size(); ++i) slots[ids[i]] = static_cast<uint32_t>(i);
+    }
+    return slots[id];
+}
+
+void BodyOrder::saveState(CheckpointWriter& out) const {
+    out.put(every);
+    out.put(threshold);
+    out.putVector(ids);
+}
+
+bool BodyOrder::loadState(CheckpointReader& in, size_t n) {
+    every = in.get<long long>();
+    threshold = in.get<double>();
+    in.getVector(ids);
+    slots.clear();
+    if (!in.ok || ids.empty()) return in.ok;
+    if (ids.size() != n) return false;
+    std::vector<char> seen(n, 0);
+    for (uint32_t id : ids) {
+        if (id >= n || seen[id]) return false;
+        seen[id] = 1;
+    }
+    return true;
+}
+
+void BodyOrder::toExternal(const std::vector<Body>& bodies, std::vector<Body>& out) const {
+    if (ids.empty()) {
+        out = bodies; // reuses the capacity
+        return;
+    }
+    out.resize(bodies.size());
+    for (size_t i = 0; i < bodies.size(); ++i) out[ids[i]] = bodies[i];
+}
+
+void BodyOrder::remove(const std::vector<char>& removed) {
+    if (ids.empty()) return;
+    const size_t n = ids.size();
+    // below[id] = removed ids smaller than id, i.e. how far the id moves down
+    scratchIds.assign(n + 1, 0);
+    for (size_t i = 0; i < n; ++i) {
+        if (removed[i]) scratchIds[ids[i] + 1] = 1;
+    }
+    for (size_t k = 1; k <= n; ++k) scratchIds[k] += scratchIds[k - 1];
+
+    size_t out = 0;
+    for (size_t i = 0; i < n; ++i) {
+        if (!removed[i]) ids[out++] = ids[i] - scratchIds[ids[i]];
+    }
+    ids.resize(out);
+    slots.clear();
+}
\ No newline at end of file
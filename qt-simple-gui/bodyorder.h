@@ -0,0 +1,61 @@
+#pragma once
+#include "helpers.h"
+#include "body.h"
+#include <cstdint>
+
+class Simulation;
+class CheckpointWriter;
+class CheckpointReader;
+
+// Spatial order of Simulation::bodies. Bodies keep the slot they were added in unless
+// they are re-sorted along a Morton (Z-order) curve, which puts bodies that are close in
+// space close in memory: tree builds and walks, the SoA copies, the collision grid and
+// the near-pair lists then touch neighbouring bodies through the same cache lines.
+//
+// Sorting moves the slots, not the identities: ids[slot] is the body's external index,
+// its place in the list as added, which is what the UI, the logs, collision events and
+// output files refer to. Merges drop ids and renumber the rest densely, exactly as they
+// remove indices from an unsorted list.
+class BodyOrder {
+public:
+    long long every = 0;    // steps between checks; 0 = never sorted
+    double threshold = 0.1; // re-sort once this share of neighbouring slots is out of curve order
+
+    // Measures the drift since the last sort (O(N)) and re-sorts if it is over threshold.
+    // Returns true if the bodies moved.
+    bool update(Simulation& sim);
+    bool sort(Simulation& sim); // whatever the drift
+
+    bool identity() const { return ids.empty(); }
+    int idOf(size_t slot) const { return static_cast<int>(ids.empty() ? slot : ids[slot]); }
+    size_t slotOf(size_t id) const; // inverse of idOf()
+
+    // Settings and ids, for a restart that continues in the same slot order (see checkpoint.h).
+    // loadState() fails unless the ids fit n bodies.
+    void saveState(CheckpointWriter& out) const;
+    bool loadState(CheckpointReader& in, size_t n);
+
+    // 'bodies' (the slots) in external order
+    void toExternal(const std::vector<Body>& bodies, std::vector<Body>& out) const;
+    // Drops the ids of the slots marked in 'removed', which were compacted out of the bodies
+    void remove(const std::vector<char>& removed);
+    void append() { if (!ids.empty()) ids.push_back(static_cast<uint32_t>(ids.size())); }
+
+    long long checks = 0, sorts = 0;
+    double disorder = 0; // share of out-of-order neighbours at the last check
+
+private:
+    // Drift is measured in cells of about this many bodies; finer than that,
+    // neighbours trading places cost nothing
+    static constexpr size_t CELL_BODIES = 8;
+
+    std::vector<uint32_t> ids;              // external index per slot; empty = every body in its own slot
+    std::vector<uint32_t> keys, sortedKeys; // Morton keys of the current slots
+    std::vector<uint32_t> order, sortedOrder; // new slot -> old slot
+    std::vector<uint32_t> scratchIds;
+    mutable std::vector<uint32_t> slots;    // inverse of ids, rebuilt when stale
+    std::vector<Body> scratch;
+
+    void computeKeys(const std::vector<Body>& bodies);
+    bool radixSort(Simulation& sim);
+};
\ No newline at end of file
@@ -0,0 +1,86 @@
+#pragma once
+#include "helpers.h"
+#include "body.h"
+#include <algorithm>
+#include <type_traits>
+
+// Structure-of-arrays copy of the bodies for the vectorized force kernels.
+// T is the working precision: float or double, or long double for ParallelDirectSum<LD>.
+//
+// To keep float usable at astronomical scales everything is normalized:
+// positions are in units of lengthScale and masses in units of massScale,
+// so a kernel sums m_j * dr / r^3 in these units and
+// accelerationScale() converts the result back to m/s^2.
+template <typename T>
+struct BodyStore {
+    std::vector<T> mass, x, y, vx, vy, ax, ay;
+
+    LD lengthScale = 1;
+    LD massScale = 1;
+
+    size_t size() const { return mass.size(); }
+
+    void resize(size_t n) {
+        mass.resize(n); x.resize(n); y.resize(n);
+        vx.resize(n); vy.resize(n); ax.resize(n); ay.resize(n);
+    }
+
+    void gather(const std::vector<Body>& bodies) {
+        resize(bodies.size());
+
+        LD maxPos = 0, maxMass = 0;
+        for (const auto& b : bodies) {
+            maxPos = std::max({ maxPos, std::fabs(b.position.x), std::fabs(b.position.y) });
+            maxMass = std::max(maxMass, std::fabs(b.mass));
+        }
+        // long double has the range for meters and kilograms as they are,
+        // and skipping the division keeps close pairs exact far from the origin
+        const bool normalize = !std::is_same<T, LD>::value;
+        lengthScale = normalize && maxPos > 0 ? maxPos : 1;
+        massScale = normalize && maxMass > 0 ? maxMass : 1;
+
+        for (size_t i = 0; i < bodies.size(); ++i) {
+            const Body& b = bodies[i];
+            mass[i] = static_cast<T>(b.mass / massScale);
+            x[i] = static_cast<T>(b.position.x / lengthScale);
+            y[i] = static_cast<T>(b.position.y / lengthScale);
+            vx[i] = static_cast<T>(b.velocity.x);
+            vy[i] = static_cast<T>(b.velocity.y);
+        }
+    }
+
+    // G * M / L^2: converts kernel output to m/s^2
+    LD accelerationScale(LD G) const {
+        return G * massScale / (lengthScale * lengthScale);
+    }
+
+    // -G * M^2 / L: converts a kernel's pair sum of m_i m_j / r to the potential energy in J
+    LD potentialScale(LD G) const {
+        return -G * massScale * massScale / lengthScale;
+    }
+
+    // Smallest distance that still interacts, in store units (MIN_NUMBER in meters)
+    T minDistanceSquared() const {
+        LD d = MIN_NUMBER / lengthScale;
+        return static_cast<T>(d * d);
+    }
+
+    // Softening length (m) in store units, squared
+    T softeningSquared(LD length) const {
+        LD e = length / lengthScale;
+        return static_cast<T>(e * e);
+    }
+
+    // Near-field radius (m) in store units, squared; never below minDistanceSquared()
+    T nearDistanceSquared(LD radius) const {
+        LD d = std::max<LD>(radius, MIN_NUMBER) / lengthScale;
+        return static_cast<T>(d * d);
+    }
+
+    void scatterAccelerations(std::vector<Body>& bodies, LD G) const {
+        LD k = accelerationScale(G);
+        for (size_t i = 0; i < bodies.size(); ++i) {
+            bodies[i].acceleration = { static_cast<LD>(ax[i]) * k, static_cast<LD>(ay[i]) * k };
+        }
+    }
+};
@@ -0,0 +1,71 @@
+﻿#include "bodytablemodel.h"
+#include "snapshot.h"
+#include <algorithm>
+
+BodyTableModel::BodyTableModel(QObject* parent)
+    : QAbstractTableModel(parent)
+{
+}
+
+QString BodyTableModel::formatDouble(double value) {
+    if (value == 0.0) return "0";
+    return QString::number(value, 'e', 6);
+}
+
+QString BodyTableModel::formatVec2(const Vec2& v) {
+    return QString("(%1, %2)").arg(static_cast<double>(v.x), 0, 'e', 6).arg(static_cast<double>(v.y), 0, 'e', 6);
+}
+
+void BodyTableModel::setSnapshot(const SimulationSnapshot* snap, int firstVisibleRow, int lastVisibleRow) {
+    snapshot = snap;
+    const int n = snap ? static_cast<int>(snap->bodies.size()) : 0;
+
+    // Rows are inserted/removed at the end so the view keeps its scroll position and selection
+    if (n > rows) {
+        beginInsertRows(QModelIndex(), rows, n - 1);
+        rows = n;
+        endInsertRows();
+    }
+    else if (n < rows) {
+        beginRemoveRows(QModelIndex(), n, rows - 1);
+        rows = n;
+        endRemoveRows();
+    }
+    if (rows == 0) return;
+
+    // Off-screen rows are formatted fresh from the snapshot when they scroll in
+    int first = std::min(std::max(firstVisibleRow, 0), rows - 1);
+    int last = lastVisibleRow < 0 ? rows - 1 : std::min(std::max(lastVisibleRow, first), rows - 1);
+    emit dataChanged(index(first, Mass), index(last, ColumnCount - 1), { Qt::DisplayRole });
+}
+
+int BodyTableModel::rowCount(const QModelIndex& parent) const {
+    return parent.isValid() ? 0 : rows;
+}
+
+int BodyTableModel::columnCount(const QModelIndex& parent) const {
+    return parent.isValid() ? 0 : ColumnCount;
+}
+
+QVariant BodyTableModel::data(const QModelIndex& index, int role) const {
+    if (role != Qt::DisplayRole || !snapshot || !index.isValid() || index.row() >= rows) {
+        return QVariant();
+    }
+    const Body& b = snapshot->bodies[index.row()];
+    switch (index.column()) {
+    case Id: return index.row();
+    case Mass: return formatDouble(b.mass);
+    case Position: return formatVec2(b.position);
+    case Velocity: return formatVec2(b.velocity);
+    case Acceleration: return formatVec2(b.acceleration);
+    default: return QVariant();
+    }
+}
+
+QVariant BodyTableModel::headerData(int section, Qt::Orientation orientation, int role) const {
+    if (role != Qt::DisplayRole || orientation != Qt::Horizontal) {
+        return QAbstractTableModel::headerData(section, orientation, role);
+    }
+    static const char* titles[ColumnCount] = { "ID", "Mass", "Position", "Velocity", "Acceleration" };
+    return section >= 0 && section < ColumnCount ? QString(titles[section]) : QVariant();
+}
\ No newline at end of file
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <QAbstractTableModel>
+
+#include "body.h"
+struct SimulationSnapshot;
+
+// Properties table backed directly by the latest snapshot.
+// No per-cell items: data() formats a cell when the view asks for it, so only
+// the rows on screen are ever formatted, and setSnapshot() announces changes
+// just for the visible row range.
+class BodyTableModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    enum Column { Id, Mass, Position, Velocity, Acceleration, ColumnCount };
+
+    explicit BodyTableModel(QObject* parent = nullptr);
+
+    // 'snap' must stay valid until the next call (the worker keeps its front buffer until poll());
+    // nullptr empties the table
+    void setSnapshot(const SimulationSnapshot* snap, int firstVisibleRow, int lastVisibleRow);
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+    static QString formatDouble(double value);
+    static QString formatVec2(const Vec2& v);
+
+private:
+    const SimulationSnapshot* snapshot = nullptr;
+    int rows = 0;
+};
@@ -0,0 +1,212 @@
+﻿#include "checkpoint.h"
+#include "simulation.h"
+#include <algorithm>
+#include <cstdio>
+
+static const char CHECKPOINT_MAGIC[8] = { 'N', 'B', 'O', 'D', 'Y', 'C', 'K', 'P' };
+static const uint32_t CHECKPOINT_VERSION = 6;
+
+std::vector<char> serializeCheckpoint(const Simulation& sim) {
+    CheckpointWriter out;
+    out.data.reserve(128 + sim.bodies.size() * sizeof(Body));
+
+    for (char c : CHECKPOINT_MAGIC) out.put(c);
+    out.put(CHECKPOINT_VERSION);
+    out.put<uint32_t>(sizeof(LD));
+
+    out.put(sim.time);
+    out.put(sim.dt);
+    out.put(sim.stepCount);
+    out.put<uint8_t>(sim.accelerationsCurrent);
+    out.put(sim.forceEvaluations);
+    out.put<int32_t>(static_cast<int32_t>(sim.solver));
+    out.put(sim.tree.theta);
+    out.put<int32_t>(static_cast<int32_t>(sim.precision));
+    out.put<int32_t>(static_cast<int32_t>(sim.isa));
+    out.put<int32_t>(sim.threads);
+    out.put(sim.trajectoryEvery);
+    out.put(sim.checkpointEvery);
+    out.put<int32_t>(static_cast<int32_t>(sim.collisionPolicy));
+    out.put<uint8_t>(sim.isFinished);
+    out.put(sim.collisions.total);
+    out.put<int32_t>(sim.fmm.order);
+    out.put(sim.fmm.theta);
+    out.put<int32_t>(sim.fmm.leafSize);
+    out.put(sim.nearRadius);
+    out.put<int32_t>(static_cast<int32_t>(sim.nearPrecision));
+    out.put(sim.neighbors.skin);
+    out.put<int32_t>(static_cast<int32_t>(sim.softening.type));
+    out.put(sim.softening.length);
+
+    out.putVector(sim.bodies);
+    sim.order.saveState(out);
+
+    out.put<int32_t>(static_cast<int32_t>(sim.integrator->type()));
+    sim.integrator->saveState(out);
+    return std::move(out.data);
+}
+
+bool deserializeCheckpoint(const char* data, size_t size, Simulation& sim, std::string& error) {
+    CheckpointReader in(data, size);
+
+    char magic[8];
+    for (char& c : magic) c = in.get<char>();
+    if (!in.ok || std::memcmp(magic, CHECKPOINT_MAGIC, sizeof(magic)) != 0) {
+        error = "not a checkpoint file";
+        return false;
+    }
+    uint32_t version = in.get<uint32_t>();
+    uint32_t ldSize = in.get<uint32_t>();
+    if (version != CHECKPOINT_VERSION) {
+        error = "unsupported checkpoint version " + std::to_string(version);
+        return false;
+    }
+    if (ldSize != sizeof(LD)) {
+        error = "checkpoint was written with a " + std::to_string(ldSize) + "-byte long double, this build uses "
+            + std::to_string(sizeof(LD));
+        return false;
+    }
+
+    sim.time = in.get<LD>();
+    sim.dt = in.get<LD>();
+    sim.stepCount = in.get<long long>();
+    sim.accelerationsCurrent = in.get<uint8_t>() != 0;
+    sim.forceEvaluations = in.get<long long>();
+    sim.solver = static_cast<ForceSolver>(in.get<int32_t>());
+    sim.tree.theta = in.get<LD>();
+    sim.precision = static_cast<Precision>(in.get<int32_t>());
+    // Same vector unit as the original run where possible, never one this CPU lacks
+    sim.isa = std::min(static_cast<ForceKernel::Isa>(in.get<int32_t>()), ForceKernel::detectIsa());
+    sim.threads = std::max(1, static_cast<int>(in.get<int32_t>()));
+    sim.trajectoryEvery = std::max(1LL, in.get<long long>());
+    sim.checkpointEvery = in.get<long long>();
+    sim.collisionPolicy = static_cast<CollisionPolicy>(in.get<int32_t>());
+    sim.isFinished = in.get<uint8_t>() != 0;
+    sim.collisions.total = in.get<long long>();
+    sim.fmm.order = in.get<int32_t>();
+    sim.fmm.theta = in.get<LD>();
+    sim.fmm.leafSize = std::max(1, static_cast<int>(in.get<int32_t>()));
+    sim.nearRadius = in.get<LD>();
+    sim.nearPrecision = static_cast<Precision>(in.get<int32_t>());
+    sim.neighbors.skin = in.get<LD>();
+    sim.softening.type = static_cast<SofteningType>(in.get<int32_t>());
+    sim.softening.length = in.get<LD>();
+
+    in.getVector(sim.bodies);
+    if (!sim.order.loadState(in, sim.bodies.size())) {
+        error = "truncated or corrupt checkpoint";
+        return false;
+    }
+
+    int32_t type = in.get<int32_t>();
+    if (!in.ok || type < 0 || type > static_cast<int32_t>(IntegratorType::BlockTimestep)) {
+        error = "truncated or corrupt checkpoint";
+        return false;
+    }
+    sim.setIntegrator(static_cast<IntegratorType>(type));
+    sim.integrator->loadState(in);
+    if (!in.ok) {
+        error = "truncated or corrupt checkpoint";
+        return false;
+    }
+    return true;
+}
+
+static bool writeFile(const std::string& path, const std::vector<char>& data, std::string& error) {
+    const std::string tmp = path + ".tmp";
+    FILE* f = std::fopen(tmp.c_str(), "wb");
+    if (!f) {
+        error = "cannot create " + tmp;
+        return false;
+    }
+    bool ok = std::fwrite(data.data(), 1, data.size(), f) == data.size();
+    ok = std::fclose(f) == 0 && ok;
+    if (!ok) {
+        error = "cannot write " + tmp;
+        return false;
+    }
+#ifdef _WIN32
+    std::remove(path.c_str()); // rename does not replace on Windows
+#endif
+    if (std::rename(tmp.c_str(), path.c_str()) != 0) {
+        error = "cannot rename " + tmp + " to " + path;
+        return false;
+    }
+    return true;
+}
+
+bool saveCheckpoint(const Simulation& sim, const std::string& path, std::string& error) {
+    return writeFile(path, serializeCheckpoint(sim), error);
+}
+
+bool loadCheckpoint(const std::string& path, Simulation& sim, std::string& error) {
+    FILE* f = std::fopen(path.c_str(), "rb");
+    if (!f) {
+        error = "cannot open " + path;
+        return false;
+    }
+    std::vector<char> data;
+    char chunk[1 << 16];
+    size_t got;
+    while ((got = std::fread(chunk, 1, sizeof(chunk), f)) > 0) {
+        data.insert(data.end(), chunk, chunk + got);
+    }
+    std::fclose(f);
+
+    if (!deserializeCheckpoint(data.data(), data.size(), sim, error)) {
+        error = path + ": " + error;
+        return false;
+    }
+    return true;
+}
+
+BackgroundCheckpointer::BackgroundCheckpointer(const std::string& path)
+    : path(path)
+    , thread(&BackgroundCheckpointer::writerLoop, this)
+{
+}
+
+BackgroundCheckpointer::~BackgroundCheckpointer() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    cv.notify_all();
+    thread.join();
+}
+
+void BackgroundCheckpointer::request(const Simulation& sim) {
+    auto data = std::make_unique<std::vector<char>>(serializeCheckpoint(sim));
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending = std::move(data); // an older snapshot nobody started writing is dropped
+    }
+    cv.notify_all();
+}
+
+long long BackgroundCheckpointer::writtenCount() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return written;
+}
+
+std::string BackgroundCheckpointer::lastError() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return error;
+}
+
+void BackgroundCheckpointer::writerLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        cv.wait(lock, [this] { return pending || stopping; });
+        if (!pending) return; // stopping and nothing left to write
+
+        std::unique_ptr<std::vector<char>> data = std::move(pending);
+        lock.unlock();
+        std::string writeError;
+        bool ok = writeFile(path, *data, writeError);
+        lock.lock();
+
+        if (ok) ++written;
+        error = ok ? std::string() : writeError;
+    }
+}
\ No newline at end of file
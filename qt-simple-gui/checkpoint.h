@@ -0,0 +1,137 @@
+#pragma once
+#include "helpers.h"
+#include "body.h"
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+
+class Simulation;
+
+// Raw little endian serialization used by checkpoints.
+// Values are stored bit for bit (long double included), which is what makes
+// a restart bit-identical; the header records sizeof(LD) so a file is only
+// accepted by a build with the same long double layout.
+// A long double keeps its sizeof(LD) slot, but only its value bytes are copied
+// (x87 extended: 10 of 16) and the padding is written as zeros; 2D bodies and
+// vectors go field by field, other structs by hand. So the same state always
+// gives the same bytes, and the reader can still copy whole Body arrays.
+class CheckpointWriter {
+public:
+    std::vector<char> data;
+
+    static constexpr size_t LD_VALUE_BYTES = std::numeric_limits<LD>::digits == 64 ? 10 : sizeof(LD);
+
+    template <typename T>
+    void put(const T& value) { write(value); }
+
+    template <typename T>
+    void putVector(const std::vector<T>& values) {
+        put<uint64_t>(values.size());
+        data.reserve(data.size() + values.size() * sizeof(T));
+        for (const T& value : values) write(value);
+    }
+
+private:
+    char* grow(size_t bytes) {
+        size_t at = data.size();
+        data.resize(at + bytes); // zero-filled
+        return &data[at];
+    }
+
+    template <typename T>
+    void write(const T& value) {
+        static_assert(std::is_arithmetic<T>::value, "structs go field by field: add a write() overload");
+        std::memcpy(grow(sizeof(T)), &value, sizeof(T));
+    }
+
+    void write(const LD& value) { std::memcpy(grow(sizeof(LD)), &value, LD_VALUE_BYTES); }
+
+    template <typename T>
+    void write(const Vec<2, T>& v) { write(v.x); write(v.y); }
+
+    template <int D, typename T>
+    void write(const BodyT<D, T>& b) {
+        static_assert(sizeof(BodyT<D, T>) == 2 * sizeof(T) + 3 * sizeof(Vec<D, T>), "padding between the fields");
+        write(b.mass); write(b.radius);
+        write(b.position); write(b.velocity); write(b.acceleration);
+    }
+};
+
+class CheckpointReader {
+public:
+    CheckpointReader(const char* data, size_t size) : p(data), end(data + size) {}
+
+    bool ok = true; // false after any read past the end
+
+    template <typename T>
+    T get() {
+        T value{};
+        if (static_cast<size_t>(end - p) < sizeof(T)) {
+            ok = false;
+            return value;
+        }
+        std::memcpy(&value, p, sizeof(T));
+        p += sizeof(T);
+        return value;
+    }
+
+    template <typename T>
+    void getVector(std::vector<T>& values) {
+        uint64_t n = get<uint64_t>();
+        if (!ok || n > static_cast<size_t>(end - p) / sizeof(T)) {
+            ok = false;
+            return;
+        }
+        values.resize(static_cast<size_t>(n));
+        if (n) std::memcpy(values.data(), p, values.size() * sizeof(T));
+        p += values.size() * sizeof(T);
+    }
+
+private:
+    const char* p;
+    const char* end;
+};
+
+// Complete simulation state: bodies (with accelerations), time, step counters,
+// solver settings and the integrator with its history.
+// Open trajectory/checkpoint files are not part of it.
+std::vector<char> serializeCheckpoint(const Simulation& sim);
+bool deserializeCheckpoint(const char* data, size_t size, Simulation& sim, std::string& error);
+
+bool saveCheckpoint(const Simulation& sim, const std::string& path, std::string& error);
+bool loadCheckpoint(const std::string& path, Simulation& sim, std::string& error);
+
+// Periodic checkpoints without stalling the step loop: request() takes an
+// in-memory copy of the state (a memcpy-sized job) and a background thread
+// writes it to 'path.tmp' and renames it over 'path', so a crash mid-write
+// never destroys the last good checkpoint. If the disk falls behind, a
+// newer snapshot replaces the one still waiting.
+class BackgroundCheckpointer {
+public:
+    explicit BackgroundCheckpointer(const std::string& path);
+    ~BackgroundCheckpointer(); // finishes the pending write
+
+    void request(const Simulation& sim);
+
+    long long writtenCount();
+    std::string lastError(); // empty while every write succeeded
+
+    const std::string path;
+
+private:
+    long long written = 0;
+    std::string error;
+    std::unique_ptr<std::vector<char>> pending;
+    bool stopping = false;
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::thread thread;
+
+    void writerLoop();
+};
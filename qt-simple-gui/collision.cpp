@@ -0,0 +1,219 @@
+﻿#include "collision.h"
+#include "simulation.h"
+#include <algorithm>
+#include <numeric>
+
+static bool overlap(const Body& a, const Body& b) {
+    LD dx = a.position.x - b.position.x;
+    LD dy = a.position.y - b.position.y;
+    LD r = a.radius + b.radius;
+    return dx * dx + dy * dy < r * r;
+}
+
+// --- SpatialHash ---
+
+void SpatialHash::chooseCellSize(const std::vector<Body>& bodies) {
+    LD sum = 0, maxRadius = 0;
+    for (const auto& b : bodies) {
+        sum += b.radius;
+        maxRadius = std::max(maxRadius, b.radius);
+    }
+    LD mean = bodies.empty() ? 0 : sum / bodies.size();
+    // A single planet among pebbles must not blow the cells up
+    cellSize = 2 * std::min(maxRadius, 4 * mean);
+    if (!(cellSize > 0)) cellSize = 1;
+
+    size_t table = 16;
+    while (table < 2 * bodies.size()) table *= 2;
+    mask = table - 1;
+    bucketStart.assign(table + 1, 0);
+}
+
+uint64_t SpatialHash::keyOf(const Body& b) const {
+    if (2 * b.radius > cellSize) return LARGE;
+    const LD limit = static_cast<LD>(1 << 30);
+    auto cell = [&](LD v) {
+        LD c = std::floor(v / cellSize);
+        c = std::max(std::min(c, limit), -limit);
+        return static_cast<uint32_t>(static_cast<int32_t>(c));
+    };
+    return (static_cast<uint64_t>(cell(b.position.x)) << 32) | cell(b.position.y);
+}
+
+size_t SpatialHash::bucketOf(int32_t ix, int32_t iy) const {
+    uint64_t h = static_cast<uint64_t>(static_cast<uint32_t>(ix)) * 0x9E3779B97F4A7C15ull
+        ^ static_cast<uint64_t>(static_cast<uint32_t>(iy)) * 0xC2B2AE3D27D4EB4Full;
+    return static_cast<size_t>(h ^ (h >> 29)) & mask;
+}
+
+static int32_t cellX(uint64_t key) { return static_cast<int32_t>(static_cast<uint32_t>(key >> 32)); }
+static int32_t cellY(uint64_t key) { return static_cast<int32_t>(static_cast<uint32_t>(key)); }
+
+// Counting sort of the grid bodies by bucket: O(N), no allocations after the first step
+void SpatialHash::rebuild() {
+    std::fill(bucketStart.begin(), bucketStart.end(), 0);
+    large.clear();
+    for (size_t i = 0; i < keys.size(); ++i) {
+        if (keys[i] == LARGE) large.push_back(static_cast<int>(i));
+        else ++bucketStart[bucketOf(cellX(keys[i]), cellY(keys[i])) + 1];
+    }
+    for (size_t k = 1; k < bucketStart.size(); ++k) bucketStart[k] += bucketStart[k - 1];
+
+    sorted.resize(keys.size() - large.size());
+    cursor.assign(bucketStart.begin(), bucketStart.end() - 1);
+    for (size_t i = 0; i < keys.size(); ++i) {
+        if (keys[i] == LARGE) continue;
+        sorted[cursor[bucketOf(cellX(keys[i]), cellY(keys[i]))]++] = static_cast<int>(i);
+    }
+    ++rebuilds;
+}
+
+void SpatialHash::findOverlaps(const std::vector<Body>& bodies, std::vector<std::pair<int, int>>& pairs) {
+    pairs.clear();
+    const size_t n = bodies.size();
+
+    // Radii only change when the body set does (merges), and so does the cell size
+    bool moved = false;
+    if (keys.size() != n) {
+        chooseCellSize(bodies);
+        keys.assign(n, 0);
+        moved = true;
+    }
+    for (size_t i = 0; i < n; ++i) {
+        uint64_t k = keyOf(bodies[i]);
+        if (k != keys[i]) {
+            keys[i] = k;
+            moved = true;
+        }
+    }
+    if (moved) rebuild();
+    else ++reuses;
+
+    // Narrow phase: the 3x3 cell neighbourhood of every grid body
+    for (size_t i = 0; i < n; ++i) {
+        if (keys[i] == LARGE) continue;
+        const int32_t cx = cellX(keys[i]), cy = cellY(keys[i]);
+        for (int dx = -1; dx <= 1; ++dx) {
+            for (int dy = -1; dy <= 1; ++dy) {
+                size_t bucket = bucketOf(cx + dx, cy + dy);
+                for (int k = bucketStart[bucket]; k < bucketStart[bucket + 1]; ++k) {
+                    int j = sorted[k];
+                    if (j > static_cast<int>(i) && overlap(bodies[i], bodies[j])) {
+                        pairs.emplace_back(static_cast<int>(i), j);
+                    }
+                }
+            }
+        }
+    }
+
+    // Bodies too big for the grid: against everyone
+    for (int l : large) {
+        for (size_t j = 0; j < n; ++j) {
+            int jj = static_cast<int>(j);
+            if (jj == l || (keys[j] == LARGE && jj < l)) continue; // large pairs once
+            if (overlap(bodies[l], bodies[j])) pairs.emplace_back(std::min(l, jj), std::max(l, jj));
+        }
+    }
+
+    // Neighbour cells that hash to the same bucket report a pair twice
+    std::sort(pairs.begin(), pairs.end());
+    pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end());
+}
+
+// --- CollisionDetector ---
+
+bool CollisionDetector::hasOverlap(const std::vector<Body>& bodies) {
+    grid.findOverlaps(bodies, pairs);
+    return !pairs.empty();
+}
+
+void CollisionDetector::record(const Simulation& sim, const std::pair<int, int>& p) {
+    if (events.size() == MAX_RECENT) events.erase(events.begin());
+    events.push_back({ ++total, sim.stepCount, sim.time, p.first, p.second });
+}
+
+int CollisionDetector::process(Simulation& sim) {
+    grid.findOverlaps(sim.bodies, pairs);
+
+    // Contacts are reported and remembered by external index, which a re-sort does not change
+    const std::vector<std::pair<int, int>>* reported = &pairs;
+    if (!sim.order.identity()) {
+        idPairs.clear();
+        for (const auto& p : pairs) {
+            const int a = sim.order.idOf(p.first), b = sim.order.idOf(p.second);
+            idPairs.emplace_back(std::min(a, b), std::max(a, b));
+        }
+        std::sort(idPairs.begin(), idPairs.end());
+        reported = &idPairs;
+    }
+
+    int fresh = 0;
+    for (const auto& p : *reported) {
+        // Log reports a contact once, when it begins
+        if (sim.collisionPolicy == CollisionPolicy::Log && std::binary_search(contacts.begin(), contacts.end(), p)) continue;
+        record(sim, p);
+        ++fresh;
+    }
+
+    switch (sim.collisionPolicy) {
+    case CollisionPolicy::Log:
+        contacts = *reported;
+        break;
+    case CollisionPolicy::Stop:
+        if (!pairs.empty()) sim.isFinished = true;
+        break;
+    case CollisionPolicy::Merge:
+        if (!pairs.empty()) merge(sim);
+        break;
+    default:
+        break;
+    }
+    return fresh;
+}
+
+int CollisionDetector::find(int i) {
+    while (parent[i] != i) {
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+    }
+    return i;
+}
+
+// Groups of mutually overlapping bodies collapse into their lowest external index,
+// so a chain a-b-c merges in one step regardless of pair or slot order.
+void CollisionDetector::merge(Simulation& sim) {
+    auto& bodies = sim.bodies;
+    const int n = static_cast<int>(bodies.size());
+    parent.resize(n);
+    std::iota(parent.begin(), parent.end(), 0);
+    for (const auto& p : pairs) {
+        int a = find(p.first), b = find(p.second);
+        if (a == b) continue;
+        if (sim.order.idOf(a) < sim.order.idOf(b)) parent[b] = a;
+        else parent[a] = b;
+    }
+
+    removed.assign(n, 0);
+    for (int i = 0; i < n; ++i) {
+        int root = find(i);
+        if (root == i) continue;
+        Body& a = bodies[root];
+        const Body& b = bodies[i];
+        LD m = a.mass + b.mass;
+        if (m > 0) {
+            a.position = (a.position * a.mass + b.position * b.mass) * (1 / m);
+            a.velocity = (a.velocity * a.mass + b.velocity * b.mass) * (1 / m);
+        }
+        a.mass = m;
+        a.radius = std::cbrt(a.radius * a.radius * a.radius + b.radius * b.radius * b.radius);
+        removed[i] = 1;
+    }
+
+    int out = 0;
+    for (int i = 0; i < n; ++i) {
+        if (!removed[i]) bodies[out++] = bodies[i];
+    }
+    bodies.resize(out);
+    sim.order.remove(removed);
+    sim.accelerationsCurrent = false;
+}
\ No newline at end of file
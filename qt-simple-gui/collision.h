@@ -0,0 +1,77 @@
+#pragma once
+#include "helpers.h"
+#include "body.h"
+#include <cstdint>
+#include <utility>
+
+class Simulation;
+
+enum class CollisionPolicy {
+    None,  // radii are ignored, no detection cost
+    Log,   // report new contacts, bodies pass through each other
+    Stop,  // finish the simulation at the first contact
+    Merge  // perfectly inelastic merge conserving mass, momentum and volume
+};
+
+struct CollisionEvent {
+    long long seq;  // 1, 2, 3, ... over the whole run
+    long long step;
+    LD time;
+    int a, b;       // external body indices (see BodyOrder) when the contact was found, before merging
+};
+
+// Broad phase: uniform grid hashed into a power-of-two bucket table.
+// Cells are twice the typical radius, so overlapping spheres share a cell or
+// are neighbours; the few bodies much bigger than that are kept out of the grid
+// and tested against everyone. Per-body cell keys are kept between steps:
+// while no body crosses a cell boundary the bucket order is reused as is.
+class SpatialHash {
+public:
+    // Pairs (i < j) whose spheres overlap, sorted and without duplicates
+    void findOverlaps(const std::vector<Body>& bodies, std::vector<std::pair<int, int>>& pairs);
+
+    LD cellSize = 0;
+    long long rebuilds = 0; // bucket sorts actually done
+    long long reuses = 0;   // steps where every body stayed in its cell
+
+private:
+    static constexpr uint64_t LARGE = ~0ull; // key of bodies outside the grid
+
+    std::vector<uint64_t> keys;  // packed cell coordinates per body
+    std::vector<int> bucketStart; // table size + 1 offsets into 'sorted'
+    std::vector<int> sorted;      // grid bodies ordered by bucket
+    std::vector<int> cursor;      // scratch for the counting sort
+    std::vector<int> large;
+    size_t mask = 0;
+
+    void chooseCellSize(const std::vector<Body>& bodies);
+    uint64_t keyOf(const Body& b) const;
+    size_t bucketOf(int32_t ix, int32_t iy) const;
+    void rebuild();
+};
+
+class CollisionDetector {
+public:
+    // Called by Simulation::step() after the integrator; applies sim.collisionPolicy.
+    // Returns the number of new contacts.
+    int process(Simulation& sim);
+    bool hasOverlap(const std::vector<Body>& bodies);
+
+    long long total = 0; // contacts reported so far
+    const std::vector<CollisionEvent>& recent() const { return events; }
+    static constexpr size_t MAX_RECENT = 256;
+
+    SpatialHash grid;
+
+private:
+    std::vector<std::pair<int, int>> pairs;
+    std::vector<std::pair<int, int>> idPairs;  // 'pairs' as external indices, while the bodies are re-sorted
+    std::vector<std::pair<int, int>> contacts; // Log: pairs already touching last step, external indices
+    std::vector<CollisionEvent> events;        // the last MAX_RECENT contacts
+    std::vector<int> parent;                   // Merge: union-find over overlapping groups
+    std::vector<char> removed;
+
+    void record(const Simulation& sim, const std::pair<int, int>& p);
+    int find(int i);
+    void merge(Simulation& sim);
+};
@@ -0,0 +1,32 @@
+﻿#include "diagnostics.h"
+#include "simulation.h"
+#include <algorithm>
+
+DiagnosticsSample Diagnostics::measure(const std::vector<Body>& bodies, LD potential) {
+    DiagnosticsSample s;
+    s.potential = potential;
+    for (const Body& b : bodies) {
+        const Vec2 p = b.velocity * b.mass;
+        s.kinetic += b.velocity.dot(p) / 2;
+        s.momentum += p;
+        s.angularMomentum += b.position.x * p.y - b.position.y * p.x;
+    }
+    return s;
+}
+
+void Diagnostics::record(const Simulation& sim, LD potential) {
+    DiagnosticsSample s = measure(sim.bodies, potential);
+    s.seq = ++total;
+    s.step = sim.stepCount;
+    s.time = sim.time;
+    if (s.seq == 1) first = s;
+    maxEnergyDrift = std::max(maxEnergyDrift, energyDrift(s));
+
+    if (samples.size() == MAX_RECENT) samples.erase(samples.begin());
+    samples.push_back(s);
+}
+
+LD Diagnostics::energyDrift(const DiagnosticsSample& s) const {
+    const LD e0 = first.energy();
+    return std::fabs(e0) > 0 ? std::fabs(s.energy() - e0) / std::fabs(e0) : std::fabs(s.energy() - e0);
+}
\ No newline at end of file
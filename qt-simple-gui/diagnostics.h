@@ -0,0 +1,45 @@
+#pragma once
+#include "helpers.h"
+#include "body.h"
+
+class Simulation;
+
+// Conserved quantities of the 2D run at one step
+struct DiagnosticsSample {
+    long long seq = 0;      // 1, 2, 3, ... over the whole run
+    long long step = 0;
+    LD time = 0;
+    LD kinetic = 0;         // J
+    LD potential = 0;       // J, from the force evaluation at the same positions
+    Vec2 momentum;          // kg m/s
+    LD angularMomentum = 0; // kg m^2/s, about the origin (z component)
+
+    LD energy() const { return kinetic + potential; }
+};
+
+// Energy, momentum and angular momentum every 'every' steps.
+// The potential is summed inside the pair loop of the step's last force
+// evaluation (Simulation::computePotential); kinetic energy and the momenta
+// are one O(N) pass over the bodies. Drifts are relative to the first sample.
+class Diagnostics {
+public:
+    long long every = 0; // 0 = off
+
+    bool due(long long step) const { return every > 0 && step % every == 0; }
+    void record(const Simulation& sim, LD potential);
+
+    long long total = 0; // samples taken so far
+    const std::vector<DiagnosticsSample>& recent() const { return samples; }
+    const DiagnosticsSample& reference() const { return first; }
+    static constexpr size_t MAX_RECENT = 256;
+
+    // |E - E0| / |E0|, and the largest value seen so far
+    LD energyDrift(const DiagnosticsSample& s) const;
+    LD maxEnergyDrift = 0;
+
+    static DiagnosticsSample measure(const std::vector<Body>& bodies, LD potential);
+
+private:
+    DiagnosticsSample first;
+    std::vector<DiagnosticsSample> samples; // the last MAX_RECENT
+};
\ No newline at end of file
@@ -0,0 +1,450 @@
+﻿#include "domain.h"
+#include "checkpoint.h"
+#include "physics.h"
+#include "simulation.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <numeric>
+
+// One tag per exchange; messages with the same source and tag arrive in order
+enum DomainTag {
+    TAG_BOXES = 1,
+    TAG_ESSENTIAL,
+    TAG_POTENTIAL,
+    TAG_BALANCE,
+    TAG_MIGRATE,
+    TAG_GATHER,
+    TAG_STATS
+};
+
+static const int HISTOGRAM_BINS = 1024;
+
+// An imbalance-triggered rebalance waits this long after the previous one,
+// so a load that cannot be split any better is not cut again on every step
+static const long long MIN_REBALANCE_SPACING = 10;
+
+bool DomainDecomposition::supports(const Scenario& scenario, std::string& error) {
+    const char* unsupported = nullptr;
+    if (scenario.dimensions != 2) unsupported = "dimensions 3";
+    else if (scenario.integrator == IntegratorType::DormandPrince45 || scenario.integrator == IntegratorType::BlockTimestep) unsupported = "integrator";
+    else if (scenario.solver == ForceSolver::Fmm) unsupported = "solver fmm";
+    else if (scenario.collisions != CollisionPolicy::None) unsupported = "collisions";
+    else if (scenario.precision != Precision::LongDouble) unsupported = "precision";
+    else if (scenario.nearRadius > 0) unsupported = "near-radius";
+    else if (!scenario.trajectory.empty()) unsupported = "trajectory";
+    else if (!scenario.checkpoint.empty()) unsupported = "checkpoint";
+    else if (scenario.diagnosticsEvery > 0) unsupported = "diagnostics-every";
+    if (unsupported) {
+        error = std::string("'") + unsupported + "' is not supported with more than one rank";
+        return false;
+    }
+    return true;
+}
+
+bool DomainDecomposition::fail() {
+    if (failure.empty()) failure = transport.error().empty() ? "transport failure" : transport.error();
+    return false;
+}
+
+bool DomainDecomposition::distribute(Simulation& sim, const std::vector<Body>& bodies) {
+    const size_t n = bodies.size();
+    const size_t ranks = static_cast<size_t>(transport.size());
+    const size_t me = static_cast<size_t>(transport.rank());
+    const size_t begin = n * me / ranks, end = n * (me + 1) / ranks;
+
+    sim.domain = this;
+    sim.bodies.assign(bodies.begin() + begin, bodies.begin() + end);
+    sim.accelerationsCurrent = false;
+    bodyIds.resize(end - begin);
+    std::iota(bodyIds.begin(), bodyIds.end(), static_cast<long long>(begin));
+    cost.clear(); // every body counts 1 until the first evaluation
+    counters.rankBodies.assign(ranks, 0);
+    counters.rankCost.assign(ranks, 0);
+    if (!rebalance(sim)) return false;
+    counters.rebalances = 0; // the initial cut is not one
+    counters.migrated = 0;
+    return true;
+}
+
+void DomainDecomposition::computeAccelerations(Simulation& sim) {
+    if (failed()) return;
+    const int ranks = transport.size(), me = transport.rank();
+    std::vector<Body>& bodies = sim.bodies;
+
+    // 1. Bounding boxes, with the cost of the previous evaluation for the balance check
+    LD minX = 0, minY = 0, maxX = 0, maxY = 0;
+    if (!bodies.empty()) {
+        minX = maxX = bodies[0].position.x;
+        minY = maxY = bodies[0].position.y;
+        for (const auto& b : bodies) {
+            minX = std::min(minX, b.position.x); maxX = std::max(maxX, b.position.x);
+            minY = std::min(minY, b.position.y); maxY = std::max(maxY, b.position.y);
+        }
+    }
+    double lastCost = 0;
+    for (uint32_t c : cost) lastCost += c;
+    CheckpointWriter box;
+    box.put<LD>(minX); box.put<LD>(minY); box.put<LD>(maxX); box.put<LD>(maxY);
+    box.put<uint64_t>(bodies.size());
+    box.put<double>(lastCost);
+    std::vector<std::vector<char>> boxes;
+    if (!transport.allGather(TAG_BOXES, box.data, boxes)) {
+        fail();
+        return;
+    }
+
+    // 2. Own tree and the exports
+    tree.theta = sim.solver == ForceSolver::BarnesHut ? sim.tree.theta : 0;
+    tree.softening = sim.softening;
+    tree.nearRadius = 0;
+    tree.interactions = &cost;
+    tree.build(bodies);
+
+    double maxCost = 0, sumCost = 0;
+    for (int r = 0; r < ranks; ++r) {
+        CheckpointReader in(boxes[r].data(), boxes[r].size());
+        const LD bMinX = in.get<LD>(), bMinY = in.get<LD>(), bMaxX = in.get<LD>(), bMaxY = in.get<LD>();
+        const uint64_t count = in.get<uint64_t>();
+        const double rankCost = in.get<double>();
+        counters.rankBodies[r] = static_cast<double>(count);
+        counters.rankCost[r] = rankCost;
+        maxCost = std::max(maxCost, rankCost);
+        sumCost += rankCost;
+        if (r == me) continue;
+
+        exports.clear();
+        if (count > 0) tree.essentialFor(bodies, bMinX, bMinY, bMaxX, bMaxY, exports);
+        static_assert(sizeof(PointMass) == 3 * sizeof(LD), "read back by getVector");
+        CheckpointWriter out; // as putVector, field by field
+        out.put<uint64_t>(exports.size());
+        for (const PointMass& p : exports) {
+            out.put(p.x); out.put(p.y); out.put(p.mass);
+        }
+        if (!transport.send(r, TAG_ESSENTIAL, std::move(out.data))) {
+            fail();
+            return;
+        }
+    }
+    counters.imbalance = sumCost > 0 ? maxCost * ranks / sumCost : 1;
+
+    // 3. Own bodies against the own tree, while the exports travel
+    LD localPotential = 0;
+    LD* potential = sim.computePotential ? &localPotential : nullptr;
+    if (sim.threads > 1) tree.computeAccelerations(bodies, sim.threadPool(), potential);
+    else tree.computeAccelerations(bodies, potential);
+
+    // 4. Imports, in rank order so the sums do not depend on which rank was first
+    auto waitStart = std::chrono::steady_clock::now();
+    imports.clear();
+    for (int r = 0; r < ranks; ++r) {
+        if (r == me) continue;
+        std::vector<PointMass> part;
+        if (!transport.receive(r, TAG_ESSENTIAL, message)) {
+            fail();
+            return;
+        }
+        CheckpointReader in(message.data(), message.size());
+        in.getVector(part);
+        if (!in.ok) {
+            failure = "malformed export from rank " + std::to_string(r);
+            return;
+        }
+        imports.insert(imports.end(), part.begin(), part.end());
+    }
+    counters.waitSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - waitStart).count();
+    counters.importedItems += imports.size();
+
+    importBodies.resize(imports.size());
+    for (size_t k = 0; k < imports.size(); ++k) {
+        importBodies[k] = Body(imports[k].mass, 0, { imports[k].x, imports[k].y });
+    }
+    importTree.theta = tree.theta;
+    importTree.softening = sim.softening;
+    importTree.build(importBodies);
+    LD pairs = 0;
+    importTree.addAccelerations(importBodies, bodies, sim.threads > 1 ? &sim.threadPool() : nullptr,
+        potential ? &pairs : nullptr, &cost);
+
+    if (potential) {
+        // Each cross-rank pair is counted once on either side, like the local pairs
+        std::vector<double> total = { static_cast<double>(localPotential - Physics::G * pairs / 2) };
+        if (!transport.allReduce(TAG_POTENTIAL, total)) {
+            fail();
+            return;
+        }
+        sim.potentialEnergy = total[0]; // summed in double
+    }
+    ++counters.evaluations;
+}
+
+bool DomainDecomposition::afterStep(Simulation& sim) {
+    if (failed()) return false;
+    const bool due = rebalanceEvery > 0 && sim.stepCount % rebalanceEvery == 0;
+    const bool skewed = imbalanceLimit > 0 && counters.imbalance > imbalanceLimit
+        && sim.stepCount - lastRebalance >= MIN_REBALANCE_SPACING;
+    if (!due && !skewed) return true;
+    return rebalance(sim);
+}
+
+// Orthogonal recursive bisection, all groups of a level at once. A group is a range of
+// ranks [first, first + size) and is named by 'first'; node[i] is the group of local body i.
+bool DomainDecomposition::rebalance(Simulation& sim) {
+    const int ranks = transport.size();
+    const std::vector<Body>& bodies = sim.bodies;
+    const size_t n = bodies.size();
+    std::vector<int> node(n, 0);
+    std::vector<int> groupSize(ranks, 0); // by first rank, 0 = not a group
+    groupSize[0] = ranks;
+    auto weight = [&](size_t i) { return cost.size() == n ? std::max<double>(cost[i], 1) : 1.0; };
+
+    while (true) {
+        std::vector<int> split; // groups of more than one rank; slot[g] = index in 'split'
+        std::vector<int> slot(ranks, -1);
+        for (int g = 0; g < ranks; ++g) {
+            if (groupSize[g] < 2) continue;
+            slot[g] = static_cast<int>(split.size());
+            split.push_back(g);
+        }
+        if (split.empty()) break;
+        const size_t groups = split.size();
+
+        // Bounding box of every group, as maxima of (-minX, -minY, maxX, maxY)
+        std::vector<double> bounds(4 * groups, -HUGE_VAL);
+        for (size_t i = 0; i < n; ++i) {
+            if (slot[node[i]] < 0) continue;
+            double* b = &bounds[4 * slot[node[i]]];
+            const double x = static_cast<double>(bodies[i].position.x), y = static_cast<double>(bodies[i].position.y);
+            b[0] = std::max(b[0], -x); b[1] = std::max(b[1], -y);
+            b[2] = std::max(b[2], x); b[3] = std::max(b[3], y);
+        }
+        if (!transport.allReduce(TAG_BALANCE, bounds, Transport::Reduce::Max)) return fail();
+
+        // Cut across the longer side. The first histogram finds the bin that holds the
+        // target weight, the second one splits that bin again
+        std::vector<int> axis(groups, 0);
+        std::vector<double> lo(groups, 0), width(groups, 0), cut(groups, 0);
+        std::vector<double> below(groups, 0); // weight left of the histogram range, minus the target
+        for (size_t s = 0; s < groups; ++s) {
+            const double* b = &bounds[4 * s];
+            axis[s] = b[2] + b[0] >= b[3] + b[1] ? 0 : 1;
+            if (b[2 + axis[s]] < -b[axis[s]]) continue; // no bodies
+            lo[s] = -b[axis[s]];
+            width[s] = (b[2 + axis[s]] + b[axis[s]]) / HISTOGRAM_BINS;
+        }
+        for (int pass = 0; pass < 2; ++pass) {
+            std::vector<double> histogram(groups * HISTOGRAM_BINS, 0);
+            for (size_t i = 0; i < n; ++i) {
+                const int s = slot[node[i]];
+                if (s < 0) continue;
+                double k = 0; // all bodies at one coordinate: one bin
+                if (width[s] > 0) {
+                    const double c = static_cast<double>(axis[s] ? bodies[i].position.y : bodies[i].position.x);
+                    k = std::floor((c - lo[s]) / width[s]);
+                    if (pass == 0) k = std::min<double>(k, HISTOGRAM_BINS - 1); // the body on the far edge
+                    if (k < 0 || k >= HISTOGRAM_BINS) continue; // outside the refined bin
+                }
+                histogram[s * HISTOGRAM_BINS + static_cast<size_t>(k)] += weight(i);
+            }
+            if (!transport.allReduce(TAG_BALANCE, histogram)) return fail();
+
+            for (size_t s = 0; s < groups; ++s) {
+                const double* h = &histogram[s * HISTOGRAM_BINS];
+                const int size = groupSize[split[s]];
+                if (pass == 0) {
+                    double total = 0;
+                    for (int k = 0; k < HISTOGRAM_BINS; ++k) total += h[k];
+                    below[s] = -total * (size / 2) / size;
+                }
+                if (width[s] <= 0) {
+                    cut[s] = lo[s]; // bodies at one coordinate (or none) stay together
+                    continue;
+                }
+                // The first bin where the running weight reaches the target
+                double sum = below[s];
+                int k = 0;
+                while (k < HISTOGRAM_BINS - 1 && sum + h[k] < 0) sum += h[k++];
+                if (pass == 0) {
+                    below[s] = sum;
+                    lo[s] += k * width[s];
+                    width[s] /= HISTOGRAM_BINS;
+                }
+                else {
+                    // Whichever edge of the bin is closer to the target
+                    cut[s] = lo[s] + (k + (-sum <= sum + h[k] ? 0 : 1)) * width[s];
+                }
+            }
+        }
+
+        // Bodies from the cut on go to the second half of the ranks
+        for (size_t i = 0; i < n; ++i) {
+            const int s = slot[node[i]];
+            if (s < 0) continue;
+            const double c = static_cast<double>(axis[s] ? bodies[i].position.y : bodies[i].position.x);
+            if (!(c < cut[s])) node[i] += groupSize[node[i]] / 2;
+        }
+        for (int g : split) {
+            const int size = groupSize[g];
+            groupSize[g] = size / 2;
+            groupSize[g + size / 2] = size - size / 2;
+        }
+    }
+
+    lastRebalance = sim.stepCount;
+    ++counters.rebalances;
+    return migrate(sim, node);
+}
+
+bool DomainDecomposition::migrate(Simulation& sim, const std::vector<int>& destination) {
+    const int ranks = transport.size(), me = transport.rank();
+    const size_t n = sim.bodies.size();
+    if (cost.size() != n) cost.assign(n, 1);
+
+    // Accelerations travel with the bodies, so they stay current
+    struct Part {
+        std::vector<long long> ids;
+        std::vector<Body> bodies;
+        std::vector<uint32_t> cost;
+
+        void add(long long id, const Body& body, uint32_t c) {
+            ids.push_back(id);
+            bodies.push_back(body);
+            cost.push_back(c);
+        }
+    };
+    std::vector<Part> parts(ranks);
+    for (size_t i = 0; i < n; ++i) {
+        parts[destination[i]].add(bodyIds[i], sim.bodies[i], cost[i]);
+        if (destination[i] != me) ++counters.migrated;
+    }
+    for (int r = 0; r < ranks; ++r) {
+        if (r == me) continue;
+        CheckpointWriter out;
+        out.putVector(parts[r].ids);
+        out.putVector(parts[r].bodies);
+        out.putVector(parts[r].cost);
+        if (!transport.send(r, TAG_MIGRATE, std::move(out.data))) return fail();
+    }
+
+    Part& kept = parts[me];
+    for (int r = 0; r < ranks; ++r) {
+        if (r == me) continue;
+        if (!transport.receive(r, TAG_MIGRATE, message)) return fail();
+        Part in;
+        CheckpointReader reader(message.data(), message.size());
+        reader.getVector(in.ids);
+        reader.getVector(in.bodies);
+        reader.getVector(in.cost);
+        if (!reader.ok || in.bodies.size() != in.ids.size() || in.cost.size() != in.ids.size()) {
+            failure = "malformed migration from rank " + std::to_string(r);
+            return false;
+        }
+        for (size_t i = 0; i < in.ids.size(); ++i) kept.add(in.ids[i], in.bodies[i], in.cost[i]);
+    }
+
+    // Original order within the rank, whatever the order of arrival
+    std::vector<size_t> order(kept.ids.size());
+    std::iota(order.begin(), order.end(), size_t(0));
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return kept.ids[a] < kept.ids[b]; });
+    sim.bodies.resize(order.size());
+    bodyIds.resize(order.size());
+    cost.resize(order.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        sim.bodies[i] = kept.bodies[order[i]];
+        bodyIds[i] = kept.ids[order[i]];
+        cost[i] = kept.cost[order[i]];
+    }
+    return true;
+}
+
+bool DomainDecomposition::gather(const Simulation& sim, std::vector<Body>& all) {
+    all.clear();
+    if (transport.rank() != 0) {
+        CheckpointWriter out;
+        out.putVector(bodyIds);
+        out.putVector(sim.bodies);
+        return transport.send(0, TAG_GATHER, std::move(out.data)) || fail();
+    }
+
+    std::vector<long long> ids;
+    std::vector<Body> part;
+    auto place = [&](const std::vector<long long>& from, const std::vector<Body>& source) {
+        for (size_t i = 0; i < from.size(); ++i) {
+            const size_t k = static_cast<size_t>(from[i]);
+            if (k >= all.size()) all.resize(k + 1);
+            all[k] = source[i];
+        }
+    };
+    place(bodyIds, sim.bodies);
+    for (int r = 1; r < transport.size(); ++r) {
+        if (!transport.receive(r, TAG_GATHER, message)) return fail();
+        CheckpointReader in(message.data(), message.size());
+        in.getVector(ids);
+        in.getVector(part);
+        if (!in.ok || ids.size() != part.size()) {
+            failure = "malformed bodies from rank " + std::to_string(r);
+            return false;
+        }
+        place(ids, part);
+    }
+    return true;
+}
+
+bool runDecomposed(const Scenario& scenario, const DomainRunSettings& settings,
+    const std::function<void(const Simulation&)>& output, DomainStats& stats, std::string& error) {
+    if (!DomainDecomposition::supports(scenario, error)) return false;
+
+    return runRanks(settings.transport, settings.ranks, [&](Transport& transport, std::string& rankError) {
+        Simulation sim;
+        scenario.apply(sim);
+        std::vector<Body> bodies;
+        bodies.swap(sim.bodies);
+        DomainDecomposition domain(transport);
+        domain.rebalanceEvery = settings.rebalanceEvery;
+        domain.imbalanceLimit = settings.imbalanceLimit;
+        if (!domain.distribute(sim, bodies)) {
+            rankError = domain.error();
+            return false;
+        }
+        bodies = std::vector<Body>();
+
+        Simulation whole; // rank 0: the gathered system for 'output'
+        while (sim.stepCount < scenario.steps) {
+            sim.step();
+            if (!domain.afterStep(sim)) break;
+            const long long step = sim.stepCount;
+            if (!((scenario.outputEvery > 0 && step % scenario.outputEvery == 0) || step == scenario.steps)) continue;
+            if (!domain.gather(sim, whole.bodies)) break;
+            if (transport.rank() == 0) {
+                whole.time = sim.time;
+                whole.dt = sim.dt;
+                whole.stepCount = sim.stepCount;
+                whole.forceEvaluations = sim.forceEvaluations;
+                output(whole);
+            }
+        }
+        if (domain.failed()) {
+            rankError = domain.error();
+            return false;
+        }
+
+        // Totals over the ranks
+        const DomainStats& own = domain.stats();
+        std::vector<double> sums = { static_cast<double>(own.migrated), static_cast<double>(own.importedItems),
+            static_cast<double>(transport.bytesSent()), static_cast<double>(transport.messagesSent()) };
+        std::vector<double> wait = { own.waitSeconds };
+        if (!transport.allReduce(TAG_STATS, sums) || !transport.allReduce(TAG_STATS, wait, Transport::Reduce::Max)) {
+            rankError = transport.error();
+            return false;
+        }
+        if (transport.rank() == 0) {
+            stats = own;
+            stats.migrated = static_cast<long long>(sums[0]);
+            stats.importedItems = static_cast<uint64_t>(sums[1]);
+            stats.bytesSent = static_cast<uint64_t>(sums[2]);
+            stats.messagesSent = static_cast<uint64_t>(sums[3]);
+            stats.waitSeconds = wait[0];
+        }
+        return true;
+    }, error);
+}
\ No newline at end of file
@@ -0,0 +1,107 @@
+#pragma once
+#include "helpers.h"
+#include "body.h"
+#include "barneshut.h"
+#include "scenario.h"
+#include "transport.h"
+#include <cstdint>
+#include <functional>
+#include <string>
+
+class Simulation;
+
+// Counters of a decomposed run
+struct DomainStats {
+    long long evaluations = 0;
+    long long rebalances = 0;
+    long long migrated = 0;         // bodies that changed rank
+    uint64_t importedItems = 0;     // cells and bodies received from other ranks, all evaluations
+    uint64_t bytesSent = 0;
+    uint64_t messagesSent = 0;
+    double imbalance = 1;           // busiest rank's cost / average cost, last evaluation
+    double waitSeconds = 0;         // spent waiting for imports after the local walk
+    std::vector<double> rankBodies; // per rank, last evaluation
+    std::vector<double> rankCost;
+};
+
+// Splits one 2D Simulation over the ranks of a Transport: every rank steps its own
+// bodies with the usual integrator, and Simulation::computeAccelerations() comes here.
+//
+// Partitioning is an orthogonal recursive bisection (ORB): the ranks are split into two
+// halves, the bodies' bounding box is cut across its longer side where the cost on either
+// side matches the halves' shares, and so on down to one rank per rectangle. A body's cost
+// is the number of bodies and cells it interacted with in the last evaluation, so dense
+// regions get smaller domains. Each cut comes from two rounds of cost histograms, each one
+// reduction over all ranks. Rebalancing cuts anew and migrates the bodies every
+// rebalanceEvery steps, and when the busiest rank has imbalanceLimit times the average cost.
+//
+// A force evaluation:
+// 1. the ranks exchange the bounding boxes of their bodies;
+// 2. each rank builds the Barnes-Hut tree of its bodies and sends every other rank the
+//    locally essential tree for that rank's box (BarnesHut::essentialFor);
+// 3. while those travel, it walks its own tree for its own bodies;
+// 4. then it builds a second tree of the point masses it received (in rank order)
+//    and adds the pull of that one.
+// The direct solver runs the same with theta 0: the exports are then the bodies themselves
+// and the sum is exact. Results depend on the number of ranks, never on timing or the transport.
+//
+// Every call except computeAccelerations() is collective: all ranks make it, in the same order.
+class DomainDecomposition {
+public:
+    explicit DomainDecomposition(Transport& transport) : transport(transport) {}
+
+    long long rebalanceEvery = 0; // steps between rebalances, 0 = only on imbalance
+    double imbalanceLimit = 1.25; // busiest rank's cost / average that triggers one, 0 = never
+
+    // Only what a rank can do with its own bodies: 2D, the fixed-step integrators,
+    // direct or Barnes-Hut in long double, no collisions, near-field split or output files
+    static bool supports(const Scenario& scenario, std::string& error);
+
+    // Takes this rank's slice of 'bodies' (the same list on every rank), balances by
+    // body count and attaches to 'sim'
+    bool distribute(Simulation& sim, const std::vector<Body>& bodies);
+
+    void computeAccelerations(Simulation& sim);
+
+    // After every step: rebalances when due
+    bool afterStep(Simulation& sim);
+
+    // Rank 0 gets every body in the order given to distribute(), the others an empty list
+    bool gather(const Simulation& sim, std::vector<Body>& all);
+
+    bool failed() const { return !failure.empty(); }
+    const std::string& error() const { return failure; }
+    const DomainStats& stats() const { return counters; }
+
+    const std::vector<long long>& ids() const { return bodyIds; } // index of each local body in the original list
+
+private:
+    Transport& transport;
+    BarnesHut tree;                 // of this rank's bodies
+    BarnesHut importTree;           // of the other ranks' exports
+    std::vector<long long> bodyIds;
+    std::vector<uint32_t> cost;     // per local body, last evaluation
+    std::vector<PointMass> exports, imports;
+    std::vector<Body> importBodies;
+    std::vector<char> message;
+    long long lastRebalance = 0;    // step
+    DomainStats counters;
+    std::string failure;
+
+    bool fail();
+    bool rebalance(Simulation& sim);
+    bool migrate(Simulation& sim, const std::vector<int>& destination);
+};
+
+struct DomainRunSettings {
+    int ranks = 2;
+    TransportType transport = TransportType::Local;
+    long long rebalanceEvery = 0;
+    double imbalanceLimit = 1.25;
+};
+
+// Runs the scenario's steps decomposed over settings.ranks ranks. On rank 0 (the caller),
+// 'output' gets the whole system (gathered, in scenario order) at every output-every step
+// and after the last one, and 'stats' the counters summed over the ranks.
+bool runDecomposed(const Scenario& scenario, const DomainRunSettings& settings,
+    const std::function<void(const Simulation&)>& output, DomainStats& stats, std::string& error);
\ No newline at end of file
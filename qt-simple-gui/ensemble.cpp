@@ -0,0 +1,428 @@
+﻿#include "ensemble.h"
+#include "physics.h"
+#include "threadpool.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <memory>
+#include <sstream>
+
+// --- Sweep spec ---
+
+static const char* const FIELD_NAMES[] = { "dt", "mass", "radius", "x", "y", "vx", "vy" };
+
+std::string SweepParameter::name() const {
+    if (field == Field::Dt) return "dt";
+    return "body" + std::to_string(body) + "." + FIELD_NAMES[static_cast<int>(field)];
+}
+
+// splitmix64 finalizer: a well-mixed 64-bit value for every (seed, run, parameter, draw)
+static uint64_t mix(uint64_t z) {
+    z += 0x9E3779B97F4A7C15ull;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+static double uniform01(uint64_t seed, long long run, int index, int draw) {
+    uint64_t h = mix(mix(mix(seed) ^ static_cast<uint64_t>(run)) ^ (static_cast<uint64_t>(index) << 8 | static_cast<uint64_t>(draw)));
+    return static_cast<double>(h >> 11) * (1.0 / 9007199254740992.0); // [0, 1), 53 bits
+}
+
+double SweepParameter::value(uint64_t seed, long long run, long long runs, int index) const {
+    switch (distribution) {
+    case Distribution::Uniform:
+        return a + (b - a) * uniform01(seed, run, index, 0);
+    case Distribution::Normal: {
+        // Box-Muller; 1 - u keeps the logarithm finite
+        double u1 = 1.0 - uniform01(seed, run, index, 0);
+        double u2 = uniform01(seed, run, index, 1);
+        return a + b * std::sqrt(-2.0 * std::log(u1)) * std::cos(2 * M_PI * u2);
+    }
+    case Distribution::Range:
+    default:
+        return runs > 1 ? a + (b - a) * static_cast<double>(run) / static_cast<double>(runs - 1) : a;
+    }
+}
+
+static bool parseVary(std::istringstream& ls, SweepParameter& p) {
+    std::string word;
+    if (!(ls >> word)) return false;
+    if (word == "dt") {
+        p.field = SweepParameter::Field::Dt;
+    }
+    else if (word == "body") {
+        std::string field;
+        if (!(ls >> p.body >> field) || p.body < 0) return false;
+        const int count = sizeof(FIELD_NAMES) / sizeof(FIELD_NAMES[0]);
+        int f = 1;
+        while (f < count && field != FIELD_NAMES[f]) ++f;
+        if (f == count) return false;
+        p.field = static_cast<SweepParameter::Field>(f);
+    }
+    else {
+        return false;
+    }
+
+    if (!(ls >> word >> p.a >> p.b)) return false;
+    if (word == "range") p.distribution = SweepParameter::Distribution::Range;
+    else if (word == "uniform") p.distribution = SweepParameter::Distribution::Uniform;
+    else if (word == "normal") p.distribution = SweepParameter::Distribution::Normal;
+    else return false;
+    return true;
+}
+
+bool loadSweep(std::istream& in, SweepSpec& spec, std::string& error) {
+    // The sweep settings are taken out here, everything else is the base scenario;
+    // consumed lines stay as empty lines so that scenario errors keep their line numbers
+    std::ostringstream scenarioText;
+    std::string line;
+    int lineNo = 0;
+    while (std::getline(in, line)) {
+        ++lineNo;
+        std::string content = line.substr(0, line.find('#'));
+        std::istringstream ls(content);
+        std::string key;
+        ls >> key;
+
+        bool ok = true;
+        if (key == "runs") ok = static_cast<bool>(ls >> spec.runs) && spec.runs >= 1;
+        else if (key == "seed") ok = static_cast<bool>(ls >> spec.seed);
+        else if (key == "vary") {
+            SweepParameter p;
+            ok = parseVary(ls, p);
+            if (ok) spec.parameters.push_back(p);
+        }
+        else {
+            scenarioText << line << "\n";
+            continue;
+        }
+        if (!ok) {
+            error = "line " + std::to_string(lineNo) + ": bad value for '" + key + "'";
+            return false;
+        }
+        scenarioText << "\n";
+    }
+
+    std::istringstream scenarioIn(scenarioText.str());
+    if (!loadScenario(scenarioIn, spec.base, error)) return false;
+
+    if (spec.base.dimensions != 2) {
+        error = "ensembles are 2D only";
+        return false;
+    }
+    for (const auto& p : spec.parameters) {
+        if (p.body >= static_cast<int>(spec.base.bodies.size())) {
+            error = "'vary " + p.name() + "': no body " + std::to_string(p.body);
+            return false;
+        }
+    }
+    return true;
+}
+
+bool loadSweepFile(const std::string& path, SweepSpec& spec, std::string& error) {
+    std::ifstream in(path);
+    if (!in) {
+        error = "cannot open " + path;
+        return false;
+    }
+    return loadSweep(in, spec, error);
+}
+
+// --- Batched integration ---
+
+namespace {
+
+const int L = Ensemble::LANES;
+
+// Per-body arrays hold LANES values each: body i of system s is element i * LANES + s
+struct Batch {
+    int n = 0;
+    std::vector<double> m, rad, x, y, vx, vy, ax, ay, prevX, prevY;
+    double dt[L], h[L];
+    double minR2[L], touching[L];
+    long long contact[L];
+    bool accelerationsCurrent = false;
+    ForceKernel::Isa isa = ForceKernel::Isa::Scalar;
+
+    void resize(int bodies) {
+        n = bodies;
+        const size_t size = static_cast<size_t>(bodies) * L;
+        for (auto* v : { &m, &rad, &x, &y, &vx, &vy, &ax, &ay, &prevX, &prevY }) v->assign(size, 0.0);
+        accelerationsCurrent = false;
+    }
+};
+
+// Pairs visited once (j > i), each one for all systems of the batch at once
+void computeAccelerations(Batch& b) {
+    const double g = static_cast<double>(Physics::G);
+    std::fill(b.ax.begin(), b.ax.end(), 0.0);
+    std::fill(b.ay.begin(), b.ay.end(), 0.0);
+    for (int i = 0; i < b.n; ++i) {
+        for (int j = i + 1; j < b.n; ++j) {
+            ForceKernel::PairLanes p = {
+                &b.x[i * L], &b.y[i * L], &b.m[i * L], &b.x[j * L], &b.y[j * L], &b.m[j * L],
+                &b.ax[i * L], &b.ay[i * L], &b.ax[j * L], &b.ay[j * L]
+            };
+            ForceKernel::pairAccelerations(p, L, g, b.isa);
+        }
+    }
+    b.accelerationsCurrent = true;
+}
+
+void kick(Batch& b, double fraction) {
+    for (int i = 0; i < b.n; ++i) {
+        double* vx = &b.vx[i * L];
+        double* vy = &b.vy[i * L];
+        const double* ax = &b.ax[i * L];
+        const double* ay = &b.ay[i * L];
+        for (int s = 0; s < L; ++s) {
+            vx[s] += ax[s] * (b.h[s] * fraction);
+            vy[s] += ay[s] * (b.h[s] * fraction);
+        }
+    }
+}
+
+void drift(Batch& b) {
+    for (int i = 0; i < b.n; ++i) {
+        double* x = &b.x[i * L];
+        double* y = &b.y[i * L];
+        const double* vx = &b.vx[i * L];
+        const double* vy = &b.vy[i * L];
+        for (int s = 0; s < L; ++s) {
+            x[s] += vx[s] * b.h[s];
+            y[s] += vy[s] * b.h[s];
+        }
+    }
+}
+
+void setStep(Batch& b, double weight) {
+    for (int s = 0; s < L; ++s) b.h[s] = b.dt[s] * weight;
+}
+
+void kickDriftKick(Batch& b, double weight) {
+    setStep(b, weight);
+    if (!b.accelerationsCurrent) computeAccelerations(b);
+    kick(b, 0.5);
+    drift(b);
+    computeAccelerations(b);
+    kick(b, 0.5);
+}
+
+void stepVelocityVerlet(Batch& b) {
+    setStep(b, 1.0);
+    if (!b.accelerationsCurrent) computeAccelerations(b);
+    b.prevX = b.ax;
+    b.prevY = b.ay;
+    for (int i = 0; i < b.n; ++i) {
+        double* x = &b.x[i * L];
+        double* y = &b.y[i * L];
+        const double* vx = &b.vx[i * L];
+        const double* vy = &b.vy[i * L];
+        const double* ax = &b.ax[i * L];
+        const double* ay = &b.ay[i * L];
+        for (int s = 0; s < L; ++s) {
+            x[s] += vx[s] * b.h[s] + ax[s] * (b.h[s] * b.h[s] / 2);
+            y[s] += vy[s] * b.h[s] + ay[s] * (b.h[s] * b.h[s] / 2);
+        }
+    }
+    computeAccelerations(b);
+    for (size_t k = 0; k < b.vx.size(); ++k) {
+        b.vx[k] += (b.prevX[k] + b.ax[k]) * (b.h[k % L] / 2);
+        b.vy[k] += (b.prevY[k] + b.ay[k]) * (b.h[k % L] / 2);
+    }
+}
+
+void stepEuler(Batch& b) {
+    setStep(b, 1.0);
+    computeAccelerations(b);
+    kick(b, 1.0);
+    drift(b);
+    b.accelerationsCurrent = false;
+}
+
+void step(Batch& b, IntegratorType type) {
+    switch (type) {
+    case IntegratorType::VelocityVerlet: stepVelocityVerlet(b); break;
+    case IntegratorType::LeapfrogKDK: kickDriftKick(b, 1.0); break;
+    case IntegratorType::Yoshida4: {
+        double w1, w0;
+        SymplecticSteps::yoshida4Weights(w1, w0);
+        kickDriftKick(b, w1);
+        kickDriftKick(b, w0);
+        kickDriftKick(b, w1);
+        break;
+    }
+    case IntegratorType::Euler:
+    default: stepEuler(b); break;
+    }
+}
+
+// Closest approach and radius overlaps after a step (no square roots).
+// Works on local copies, which the compiler knows are not aliased by the body arrays.
+void checkPairs(Batch& b) {
+    double minR2[L], touching[L];
+    for (int s = 0; s < L; ++s) {
+        minR2[s] = b.minR2[s];
+        touching[s] = 0;
+    }
+    for (int i = 0; i < b.n; ++i) {
+        for (int j = i + 1; j < b.n; ++j) {
+            const double* xi = &b.x[i * L]; const double* xj = &b.x[j * L];
+            const double* yi = &b.y[i * L]; const double* yj = &b.y[j * L];
+            const double* ri = &b.rad[i * L]; const double* rj = &b.rad[j * L];
+            for (int s = 0; s < L; ++s) {
+                double dx = xj[s] - xi[s], dy = yj[s] - yi[s];
+                double r2 = dx * dx + dy * dy;
+                double contact = ri[s] + rj[s];
+                minR2[s] = std::min(minR2[s], r2);
+                touching[s] = std::max(touching[s], r2 < contact * contact ? 1.0 : 0.0);
+            }
+        }
+    }
+    for (int s = 0; s < L; ++s) {
+        b.minR2[s] = minR2[s];
+        b.touching[s] = touching[s];
+    }
+}
+
+// Total energy of every system
+void energies(const Batch& b, double* e) {
+    const double g = static_cast<double>(Physics::G);
+    for (int s = 0; s < L; ++s) e[s] = 0;
+    for (int i = 0; i < b.n; ++i) {
+        const double* m = &b.m[i * L];
+        const double* vx = &b.vx[i * L];
+        const double* vy = &b.vy[i * L];
+        for (int s = 0; s < L; ++s) e[s] += m[s] * (vx[s] * vx[s] + vy[s] * vy[s]) / 2;
+        for (int j = i + 1; j < b.n; ++j) {
+            for (int s = 0; s < L; ++s) {
+                double dx = b.x[j * L + s] - b.x[i * L + s];
+                double dy = b.y[j * L + s] - b.y[i * L + s];
+                double r = std::sqrt(dx * dx + dy * dy);
+                e[s] -= r > 0 ? g * m[s] * b.m[j * L + s] / r : 0.0;
+            }
+        }
+    }
+}
+
+} // namespace
+
+bool Ensemble::supports(IntegratorType type) {
+    return type == IntegratorType::Euler || type == IntegratorType::VelocityVerlet
+        || type == IntegratorType::LeapfrogKDK || type == IntegratorType::Yoshida4;
+}
+
+bool Ensemble::run(const SweepSpec& spec, const std::function<void(const EnsembleRun&)>& sink, std::string& error) {
+    const Scenario& base = spec.base;
+    systemSteps = 0;
+    if (base.bodies.empty()) {
+        error = "no bodies";
+        return false;
+    }
+    if (!supports(base.integrator)) {
+        error = std::string("integrator ") + Integrator::name(base.integrator) + " is not supported in ensembles";
+        return false;
+    }
+    if (base.collisions == CollisionPolicy::Merge) {
+        error = "'collisions merge' is not supported in ensembles";
+        return false;
+    }
+    if (base.softening.enabled()) {
+        error = "'softening' is not supported in ensembles";
+        return false;
+    }
+
+    const int n = static_cast<int>(base.bodies.size());
+    const long long batches = (spec.runs + L - 1) / L;
+    const bool trackContacts = base.collisions != CollisionPolicy::None;
+    const bool stopAtContact = base.collisions == CollisionPolicy::Stop;
+
+    auto simulate = [&](long long batch, Batch& b, std::vector<EnsembleRun>& out) {
+        const long long first = batch * L;
+        const int lanes = static_cast<int>(std::min<long long>(L, spec.runs - first));
+        b.resize(n);
+        b.isa = isa;
+        out.assign(lanes, EnsembleRun());
+
+        // Unused lanes of the last batch repeat its first system
+        for (int s = 0; s < L; ++s) {
+            const long long run = first + std::min(s, lanes - 1);
+            double dt = static_cast<double>(base.dt);
+            for (int i = 0; i < n; ++i) {
+                const Body& body = base.bodies[i];
+                b.m[i * L + s] = static_cast<double>(body.mass);
+                b.rad[i * L + s] = static_cast<double>(body.radius);
+                b.x[i * L + s] = static_cast<double>(body.position.x);
+                b.y[i * L + s] = static_cast<double>(body.position.y);
+                b.vx[i * L + s] = static_cast<double>(body.velocity.x);
+                b.vy[i * L + s] = static_cast<double>(body.velocity.y);
+            }
+            for (size_t p = 0; p < spec.parameters.size(); ++p) {
+                const SweepParameter& param = spec.parameters[p];
+                const double v = param.value(spec.seed, run, spec.runs, static_cast<int>(p));
+                if (s < lanes) out[s].parameters.push_back(v);
+                const size_t k = static_cast<size_t>(param.body) * L + s;
+                switch (param.field) {
+                case SweepParameter::Field::Dt: dt = v; break;
+                case SweepParameter::Field::Mass: b.m[k] = v; break;
+                case SweepParameter::Field::Radius: b.rad[k] = v; break;
+                case SweepParameter::Field::X: b.x[k] = v; break;
+                case SweepParameter::Field::Y: b.y[k] = v; break;
+                case SweepParameter::Field::Vx: b.vx[k] = v; break;
+                case SweepParameter::Field::Vy: b.vy[k] = v; break;
+                }
+            }
+            b.dt[s] = dt;
+            if (s < lanes) out[s].dt = dt;
+            b.minR2[s] = HUGE_VAL;
+            b.contact[s] = -1;
+        }
+
+        double e0[L], e1[L];
+        energies(b, e0);
+        for (long long k = 1; k <= base.steps; ++k) {
+            step(b, base.integrator);
+            checkPairs(b);
+            if (!trackContacts) continue;
+            for (int s = 0; s < L; ++s) {
+                if (b.touching[s] == 0 || b.contact[s] >= 0) continue;
+                b.contact[s] = k;
+                if (stopAtContact) b.dt[s] = 0; // frozen: later steps leave it as it is
+            }
+        }
+        energies(b, e1);
+
+        for (int s = 0; s < lanes; ++s) {
+            EnsembleRun& r = out[s];
+            r.index = first + s;
+            r.contactStep = b.contact[s];
+            r.minDistance = std::sqrt(b.minR2[s]);
+            r.energyDrift = e0[s] != 0 ? std::fabs((e1[s] - e0[s]) / e0[s]) : std::fabs(e1[s] - e0[s]);
+            r.bodies.resize(n);
+            for (int i = 0; i < n; ++i) {
+                const size_t k = static_cast<size_t>(i) * L + s;
+                r.bodies[i] = Body(b.m[k], b.rad[k], { b.x[k], b.y[k] }, { b.vx[k], b.vy[k] });
+            }
+        }
+    };
+
+    std::unique_ptr<ThreadPool> pool;
+    if (threads > 1) pool.reset(new ThreadPool(threads));
+    const long long wave = pool ? 4LL * pool->size() : 1;
+
+    std::vector<Batch> scratch(pool ? pool->size() : 1); // one batch per worker
+    std::vector<std::vector<EnsembleRun>> results(static_cast<size_t>(wave));
+    for (long long start = 0; start < batches; start += wave) {
+        const long long count = std::min(wave, batches - start);
+        auto task = [&](size_t t, int worker) { simulate(start + static_cast<long long>(t), scratch[worker], results[t]); };
+        if (pool) pool->run(static_cast<size_t>(count), task);
+        else task(0, 0);
+
+        for (long long t = 0; t < count; ++t) {
+            for (const auto& r : results[static_cast<size_t>(t)]) sink(r);
+        }
+    }
+    systemSteps = spec.runs * base.steps;
+    return true;
+}
\ No newline at end of file
@@ -0,0 +1,83 @@
+#pragma once
+#include "helpers.h"
+#include "body.h"
+#include "forcekernel.h"
+#include "scenario.h"
+#include <cstdint>
+#include <functional>
+#include <istream>
+#include <string>
+
+// One varied setting of a sweep: 'vary <target> <distribution> <a> <b>'
+//
+//   targets        dt, or body <i> mass|radius|x|y|vx|vy   (i counts from 0)
+//   distributions  range a b    evenly spaced from a (first run) to b (last run)
+//                  uniform a b  random in [a, b)
+//                  normal m s   random with mean m and standard deviation s
+//
+// Random values depend only on the seed, the run and the parameter, so a run
+// gets the same setup whatever the batching and the number of threads.
+struct SweepParameter {
+    enum class Field { Dt, Mass, Radius, X, Y, Vx, Vy };
+    enum class Distribution { Range, Uniform, Normal };
+
+    Field field = Field::Dt;
+    int body = -1; // -1 for dt
+    Distribution distribution = Distribution::Range;
+    double a = 0, b = 0;
+
+    std::string name() const; // "dt", "body1.vx", ...
+    double value(uint64_t seed, long long run, long long runs, int index) const;
+};
+
+// A scenario (the base setup, see scenario.h) plus
+//   runs 10000
+//   seed 1
+//   vary body 1 vy normal 7500 50
+struct SweepSpec {
+    Scenario base;
+    long long runs = 1;
+    uint64_t seed = 1;
+    std::vector<SweepParameter> parameters;
+};
+
+bool loadSweep(std::istream& in, SweepSpec& spec, std::string& error);
+bool loadSweepFile(const std::string& path, SweepSpec& spec, std::string& error);
+
+// Summary of one member of the ensemble
+struct EnsembleRun {
+    long long index = 0;
+    std::vector<double> parameters; // the varied values, in SweepSpec::parameters order
+    LD dt = 0;
+    long long contactStep = -1;     // first step ending with overlapping radii, -1 = none
+    double minDistance = 0;         // closest approach of any pair at the end of a step (m)
+    double energyDrift = 0;         // |E - E0| / |E0| at the end
+    std::vector<Body> bodies;       // final state (the contact state with 'collisions stop')
+};
+
+// Runs thousands of small independent systems (2-10 bodies) at once.
+//
+// LANES systems share one batch: every per-body quantity is stored as
+// LANES consecutive doubles, one per system, so each pair of the few bodies
+// is a vector loop across the systems (ForceKernel::pairAccelerations).
+// All systems of a sweep have the same bodies and steps and advance in
+// lockstep; 'collisions stop' freezes a system by zeroing its time step.
+//
+// Batches are spread over a thread pool in waves, and the summaries of a wave
+// go to the sink in run order on the calling thread before the next wave starts.
+// Only the fixed-step integrators and the plain 1/r^2 law are supported (no softening);
+// the direct sum is exact, so solver, precision and theta of the base scenario are ignored.
+class Ensemble {
+public:
+    static constexpr int LANES = 32;
+
+    int threads = 1;
+    ForceKernel::Isa isa = ForceKernel::detectIsa();
+
+    static bool supports(IntegratorType type);
+
+    // Returns false with 'error' set if the spec cannot run as an ensemble
+    bool run(const SweepSpec& spec, const std::function<void(const EnsembleRun&)>& sink, std::string& error);
+
+    long long systemSteps = 0; // steps summed over all systems of the last run
+};
\ No newline at end of file
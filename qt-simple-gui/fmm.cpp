@@ -0,0 +1,521 @@
+﻿#include "fmm.h"
+#include "physics.h"
+#include <algorithm>
+#include <numeric>
+#include <random>
+
+using Complex = std::complex<double>;
+
+// Plain products: operator* on std::complex goes through the C99 Annex G
+// inf/nan recovery path, which costs several times more in the O(p^3) loops
+static inline Complex mul(Complex a, Complex b) {
+    return Complex(a.real() * b.real() - a.imag() * b.imag(), a.real() * b.imag() + a.imag() * b.real());
+}
+
+static inline Complex mulConj(Complex a, Complex b) { // a * conj(b)
+    return Complex(a.real() * b.real() + a.imag() * b.imag(), a.imag() * b.real() - a.real() * b.imag());
+}
+
+// Tables depending only on the order
+void FastMultipole::prepare() {
+    order = std::max(1, std::min(order, MAX_ORDER));
+    theta = std::max<LD>(0, std::min<LD>(theta, MAX_THETA));
+    if (preparedOrder == order) return;
+    preparedOrder = order;
+    const int p = order;
+
+    index.assign((p + 1) * (p + 1), -1);
+    int next = 0;
+    for (int k = 0; k <= p; ++k) {
+        for (int l = 0; l + k <= p; ++l) index[k * (p + 1) + l] = next++;
+    }
+
+    const int n = 2 * p + 1;
+    binomial.assign(n * n, 0.0);
+    for (int i = 0; i < n; ++i) {
+        binomial[i * n] = 1;
+        for (int k = 1; k <= i; ++k) binomial[i * n + k] = binomial[(i - 1) * n + k - 1] + (k < i ? binomial[(i - 1) * n + k] : 0);
+    }
+
+    // c_a = (1/2)_a / a! from (1 - x)^(-1/2), times the binomial series of (1 + x)^(-1/2-a)
+    inverseSqrt.assign((p + 1) * (p + 1), 0.0);
+    double c = 1;
+    for (int a = 0; a <= p; ++a) {
+        if (a > 0) c *= (a - 0.5) / a;
+        double b = 1;
+        for (int k = 0; k <= p; ++k) {
+            if (k > 0) b *= (-0.5 - a - (k - 1)) / k;
+            inverseSqrt[a * (p + 1) + k] = c * b;
+        }
+    }
+}
+
+// --- Tree ---
+
+void FastMultipole::build(const std::vector<Body>& bodies) {
+    const int n = static_cast<int>(bodies.size());
+    nodes.clear();
+    levels.clear();
+    permutation.resize(n);
+    std::iota(permutation.begin(), permutation.end(), 0);
+
+    LD minX = bodies[0].position.x, maxX = minX;
+    LD minY = bodies[0].position.y, maxY = minY;
+    LD maxMass = 0;
+    for (const auto& b : bodies) {
+        minX = std::min(minX, b.position.x); maxX = std::max(maxX, b.position.x);
+        minY = std::min(minY, b.position.y); maxY = std::max(maxY, b.position.y);
+        maxMass = std::max(maxMass, b.mass);
+    }
+    const LD cx = (minX + maxX) / 2, cy = (minY + maxY) / 2;
+    const LD half = std::max(maxX - minX, maxY - minY) / 2 * 1.0001L + MIN_NUMBER;
+    lengthScale = static_cast<double>(half);
+    massScale = maxMass > 0 ? static_cast<double>(maxMass) : 1.0;
+    minDistance = static_cast<double>(MIN_NUMBER / half);
+    law = SofteningLaw<double>(softening, half);
+
+    bx.resize(n); by.resize(n);
+    for (int i = 0; i < n; ++i) {
+        bx[i] = static_cast<double>((bodies[i].position.x - cx) / half);
+        by[i] = static_cast<double>((bodies[i].position.y - cy) / half);
+    }
+
+    FmmNode root;
+    root.halfSize = 1;
+    root.end = n;
+    nodes.push_back(root);
+    split(0);
+
+    px.resize(n); py.resize(n); pm.resize(n);
+    for (int k = 0; k < n; ++k) {
+        const int b = permutation[k];
+        px[k] = bx[b];
+        py[k] = by[b];
+        pm[k] = static_cast<double>(bodies[b].mass) / massScale;
+    }
+
+    for (int i = 0; i < static_cast<int>(nodes.size()); ++i) {
+        int level = nodes[i].level;
+        if (static_cast<int>(levels.size()) <= level) levels.resize(level + 1);
+        levels[level].push_back(i);
+    }
+}
+
+// Partitions the node's slice of 'permutation' into quadrants and recurses.
+// Children of a node are allocated together, so they are contiguous.
+void FastMultipole::split(int node) {
+    // Copies only: push_back() below may move the node array
+    const FmmNode self = nodes[node];
+    if (self.end - self.begin <= leafSize || self.level >= MAX_DEPTH) return;
+
+    auto begin = permutation.begin() + self.begin, end = permutation.begin() + self.end;
+    auto midY = std::partition(begin, end, [&](int b) { return by[b] < self.boxY; });
+    auto midX0 = std::partition(begin, midY, [&](int b) { return bx[b] < self.boxX; });
+    auto midX1 = std::partition(midY, end, [&](int b) { return bx[b] < self.boxX; });
+    const decltype(begin) bounds[5] = { begin, midX0, midY, midX1, end };
+
+    const double h = self.halfSize / 2;
+    const int first = static_cast<int>(nodes.size());
+    for (int q = 0; q < 4; ++q) {
+        if (bounds[q] == bounds[q + 1]) continue;
+        FmmNode child;
+        child.boxX = self.boxX + ((q & 1) ? h : -h);
+        child.boxY = self.boxY + ((q & 2) ? h : -h);
+        child.halfSize = h;
+        child.begin = static_cast<int>(bounds[q] - permutation.begin());
+        child.end = static_cast<int>(bounds[q + 1] - permutation.begin());
+        child.parent = node;
+        child.level = self.level + 1;
+        nodes.push_back(child);
+    }
+    nodes[node].firstChild = first;
+    nodes[node].childCount = static_cast<int>(nodes.size()) - first;
+
+    const int count = nodes[node].childCount;
+    for (int c = first; c < first + count; ++c) {
+        split(c);
+    }
+}
+
+// Target subtrees for the dual walk: the first tree level with enough cells.
+// Fixed regardless of the thread count, which keeps the result deterministic.
+void FastMultipole::chooseTiles() {
+    tileRoots.assign(1, 0);
+    while (tileRoots.size() < 64) {
+        std::vector<int> next;
+        for (int t : tileRoots) {
+            const FmmNode& nd = nodes[t];
+            if (nd.childCount == 0) next.push_back(t);
+            for (int c = 0; c < nd.childCount; ++c) next.push_back(nd.firstChild + c);
+        }
+        if (next.size() == tileRoots.size()) break; // only leaves left
+        tileRoots.swap(next);
+    }
+}
+
+// --- Passes ---
+
+// P2M for leaves, M2M from the children otherwise
+void FastMultipole::upward(int node) {
+    FmmNode& nd = nodes[node];
+    const int p = order;
+    Complex* M = &multipole[static_cast<size_t>(node) * terms()];
+    std::fill(M, M + terms(), Complex(0, 0));
+
+    Complex weighted(0, 0);
+    double mass = 0;
+    if (nd.childCount == 0) {
+        for (int k = nd.begin; k < nd.end; ++k) {
+            mass += pm[k];
+            weighted += pm[k] * Complex(px[k], py[k]);
+        }
+    }
+    else {
+        for (int c = nd.firstChild; c < nd.firstChild + nd.childCount; ++c) {
+            mass += nodes[c].mass;
+            weighted += nodes[c].mass * nodes[c].center;
+        }
+    }
+    nd.mass = mass;
+    nd.center = mass > 0 ? weighted / mass : Complex(nd.boxX, nd.boxY);
+
+    Complex pw[MAX_ORDER + 1];
+    if (nd.childCount == 0) {
+        double radius = 0;
+        for (int k = nd.begin; k < nd.end; ++k) {
+            Complex d = Complex(px[k], py[k]) - nd.center;
+            radius = std::max(radius, std::abs(d));
+            pw[0] = 1;
+            for (int i = 1; i <= p; ++i) pw[i] = mul(pw[i - 1], d);
+            for (int a = 0; a <= p; ++a) {
+                for (int b = 0; a + b <= p; ++b) M[idx(a, b)] += pm[k] * mulConj(pw[a], pw[b]);
+            }
+        }
+        nd.radius = radius;
+        return;
+    }
+
+    // M2M: M'_kl = sum C(k,a) C(l,b) d^(k-a) conj(d)^(l-b) M_ab, first over a, then over b
+    double radius = 0;
+    Complex T[(MAX_ORDER + 1) * (MAX_ORDER + 1)];
+    for (int c = nd.firstChild; c < nd.firstChild + nd.childCount; ++c) {
+        const Complex* Mc = &multipole[static_cast<size_t>(c) * terms()];
+        Complex d = nodes[c].center - nd.center;
+        radius = std::max(radius, std::abs(d) + nodes[c].radius);
+        pw[0] = 1;
+        for (int i = 1; i <= p; ++i) pw[i] = mul(pw[i - 1], d);
+
+        for (int k = 0; k <= p; ++k) {
+            for (int b = 0; k + b <= p; ++b) {
+                Complex s(0, 0);
+                for (int a = 0; a <= k; ++a) s += choose(k, a) * mul(pw[k - a], Mc[idx(a, b)]);
+                T[k * (p + 1) + b] = s;
+            }
+        }
+        for (int k = 0; k <= p; ++k) {
+            for (int l = 0; k + l <= p; ++l) {
+                Complex s(0, 0);
+                for (int b = 0; b <= l; ++b) s += choose(l, b) * mulConj(T[k * (p + 1) + b], pw[l - b]);
+                M[idx(k, l)] += s;
+            }
+        }
+    }
+    // The box bounds the bodies as well; whichever is tighter
+    double corner = std::abs(nd.center - Complex(nd.boxX, nd.boxY)) + nd.halfSize * std::sqrt(2.0);
+    nd.radius = std::min(radius, corner);
+}
+
+// L_kl += sum_ab M_ab g(a,k) conj(g(b,l)), g(a,k) = c_a B(a,k) R^(-1/2-a-k)
+void FastMultipole::m2l(int source, int target) {
+    const int p = order;
+    const Complex* M = &multipole[static_cast<size_t>(source) * terms()];
+    Complex* L = &local[static_cast<size_t>(target) * terms()];
+
+    const Complex R = nodes[target].center - nodes[source].center;
+    Complex rp[2 * MAX_ORDER + 1]; // R^(-1/2-n)
+    rp[0] = 1.0 / std::sqrt(R);
+    const Complex inv = 1.0 / R;
+    for (int i = 1; i <= 2 * p; ++i) rp[i] = mul(rp[i - 1], inv);
+
+    Complex g[(MAX_ORDER + 1) * (MAX_ORDER + 1)];
+    for (int a = 0; a <= p; ++a) {
+        for (int k = 0; k <= p; ++k) g[a * (p + 1) + k] = inverseSqrt[a * (p + 1) + k] * rp[a + k];
+    }
+
+    Complex T[(MAX_ORDER + 1) * (MAX_ORDER + 1)];
+    for (int a = 0; a <= p; ++a) {
+        for (int l = 0; l <= p; ++l) {
+            Complex s(0, 0);
+            for (int b = 0; a + b <= p; ++b) s += mulConj(M[idx(a, b)], g[b * (p + 1) + l]);
+            T[a * (p + 1) + l] = s;
+        }
+    }
+    for (int k = 0; k <= p; ++k) {
+        for (int l = 0; k + l <= p; ++l) {
+            Complex s(0, 0);
+            for (int a = 0; a <= p; ++a) s += mul(g[a * (p + 1) + k], T[a * (p + 1) + l]);
+            L[idx(k, l)] += s;
+        }
+    }
+}
+
+// Direct sum onto the target leaf's bodies (one-sided, so target subtrees never share writes)
+template <bool Potential, bool Softened>
+void FastMultipole::p2p(int source, int target) {
+    const FmmNode& s = nodes[source];
+    const FmmNode& t = nodes[target];
+    for (int i = t.begin; i < t.end; ++i) {
+        double sx = 0, sy = 0, sp = 0;
+        for (int j = s.begin; j < s.end; ++j) {
+            double dx = px[j] - px[i], dy = py[j] - py[i];
+            double r2 = dx * dx + dy * dy;
+            double r = std::sqrt(r2);
+            if (r < minDistance) continue;
+            if (Softened) {
+                double f = pm[j] * law.inverseCube(r);
+                sx += dx * f;
+                sy += dy * f;
+                if (Potential) sp += pm[j] * law.inverse(r);
+                continue;
+            }
+            double f = pm[j] / (r2 * r);
+            sx += dx * f;
+            sy += dy * f;
+            if (Potential) sp += f * r2; // m / r without another division
+        }
+        ax[i] += sx;
+        ay[i] += sy;
+        if (Potential) phi[i] += sp;
+    }
+}
+
+// Size of the first omitted term in the pull of 'source' on 'target', with the ratio of
+// errorBound. The local expansion sees the whole mass of B at the ratio rA / d; the moments
+// of B only the mass that is spread out, at (rA + rB) / d: a star at the center of a cell
+// of light bodies is a point mass to the multipole side.
+double FastMultipole::truncationEstimate(int target, int source, double distance) const {
+    const FmmNode& A = nodes[target];
+    const FmmNode& B = nodes[source];
+    double spread = 0; // sum_(k+l=p) |M_kl| / rB^p, at most the mass
+    if (B.radius > 0) {
+        const Complex* M = &multipole[static_cast<size_t>(source) * terms()];
+        for (int k = 0; k <= order; ++k) spread += std::abs(M[idx(k, order - k)]);
+        spread = std::min(B.mass, spread / std::pow(B.radius, order));
+    }
+    auto term = [this](double q) { return (order + 1) * std::pow(q, order) / (1 - q); };
+    const double expansion = B.mass * term(A.radius / distance);
+    const double moments = spread * term((A.radius + B.radius) / distance);
+    return (expansion + moments) / (distance * distance);
+}
+
+void FastMultipole::walk(int target, int source, long long& m2lCount, long long& p2pCount) {
+    const FmmNode& A = nodes[target];
+    const FmmNode& B = nodes[source];
+    if (B.mass == 0) return;
+
+    const double distance = std::abs(A.center - B.center);
+    if (target != source && A.radius + B.radius < static_cast<double>(theta) * distance) {
+        m2l(source, target);
+        ++m2lCount;
+        // Only for picking error samples; the tile owns 'target'
+        if (errorSamples > 0) truncation[target] += truncationEstimate(target, source, distance);
+        return;
+    }
+    const bool leafA = A.childCount == 0, leafB = B.childCount == 0;
+    if (leafA && leafB) {
+        const bool softened = softening.enabled();
+        if (wantPotential) softened ? p2p<true, true>(source, target) : p2p<true, false>(source, target);
+        else softened ? p2p<false, true>(source, target) : p2p<false, false>(source, target);
+        p2pCount += static_cast<long long>(A.end - A.begin) * (B.end - B.begin);
+    }
+    else if (leafB || (!leafA && A.radius >= B.radius)) {
+        for (int c = A.firstChild; c < A.firstChild + A.childCount; ++c) walk(c, source, m2lCount, p2pCount);
+    }
+    else {
+        for (int c = B.firstChild; c < B.firstChild + B.childCount; ++c) walk(target, c, m2lCount, p2pCount);
+    }
+}
+
+// L2L from the parent, then L2P for leaves
+void FastMultipole::downward(int node) {
+    const FmmNode& nd = nodes[node];
+    const int p = order;
+    Complex* L = &local[static_cast<size_t>(node) * terms()];
+
+    if (nd.parent >= 0) {
+        truncation[node] += truncation[nd.parent];
+
+        // L'_ab = sum C(k,a) C(l,b) e^(k-a) conj(e)^(l-b) L_kl, first over k, then over l
+        const Complex* Lp = &local[static_cast<size_t>(nd.parent) * terms()];
+        Complex e = nd.center - nodes[nd.parent].center;
+        Complex pw[MAX_ORDER + 1];
+        pw[0] = 1;
+        for (int i = 1; i <= p; ++i) pw[i] = mul(pw[i - 1], e);
+
+        Complex T[(MAX_ORDER + 1) * (MAX_ORDER + 1)];
+        for (int a = 0; a <= p; ++a) {
+            for (int l = 0; a + l <= p; ++l) {
+                Complex s(0, 0);
+                for (int k = a; k + l <= p; ++k) s += choose(k, a) * mul(pw[k - a], Lp[idx(k, l)]);
+                T[a * (p + 1) + l] = s;
+            }
+        }
+        for (int a = 0; a <= p; ++a) {
+            for (int b = 0; a + b <= p; ++b) {
+                Complex s(0, 0);
+                for (int l = b; a + l <= p; ++l) s += choose(l, b) * mulConj(T[a * (p + 1) + l], pw[l - b]);
+                L[idx(a, b)] += s;
+            }
+        }
+    }
+    if (nd.childCount > 0) return;
+
+    // a_x + i a_y = 2G dPhi/dconj(z) = 2G sum l L_kl rho^k conj(rho)^(l-1) (G applied by run())
+    Complex pw[MAX_ORDER + 1];
+    for (int i = nd.begin; i < nd.end; ++i) {
+        Complex rho = Complex(px[i], py[i]) - nd.center;
+        pw[0] = 1;
+        for (int j = 1; j <= p; ++j) pw[j] = mul(pw[j - 1], rho);
+        Complex acc(0, 0);
+        for (int k = 0; k < p; ++k) {
+            for (int l = 1; k + l <= p; ++l) acc += static_cast<double>(l) * mul(L[idx(k, l)], mulConj(pw[k], pw[l - 1]));
+        }
+        ax[i] += 2 * acc.real();
+        ay[i] += 2 * acc.imag();
+
+        // Phi = sum L_kl rho^k conj(rho)^l, real up to rounding
+        if (wantPotential) {
+            double sum = 0;
+            for (int k = 0; k <= p; ++k) {
+                for (int l = 0; k + l <= p; ++l) sum += mulConj(mul(L[idx(k, l)], pw[k]), pw[l]).real();
+            }
+            phi[i] += sum;
+        }
+    }
+}
+
+void FastMultipole::run(std::vector<Body>& bodies, ThreadPool* pool, LD* potential) {
+    lastStats = FmmStats();
+    if (bodies.empty()) return;
+    prepare();
+    build(bodies);
+    chooseTiles();
+
+    const size_t n = bodies.size();
+    multipole.assign(nodes.size() * terms(), Complex(0, 0));
+    local.assign(nodes.size() * terms(), Complex(0, 0));
+    truncation.assign(nodes.size(), 0.0);
+    ax.assign(n, 0.0);
+    ay.assign(n, 0.0);
+    wantPotential = potential != nullptr;
+    if (wantPotential) phi.assign(n, 0.0);
+
+    // Runs fn on every index of the list, split into tiles when there is a pool
+    auto forEach = [&](const std::vector<int>& list, const std::function<void(int)>& fn) {
+        const size_t tiles = pool ? std::min(list.size() / 8, static_cast<size_t>(4 * pool->size())) : 0;
+        if (tiles < 2) {
+            for (int i : list) fn(i);
+            return;
+        }
+        pool->run(tiles, [&](size_t t, int) {
+            for (size_t k = t * list.size() / tiles; k < (t + 1) * list.size() / tiles; ++k) fn(list[k]);
+        });
+    };
+
+    // Upward: deepest level first, cells of one level are independent
+    for (int level = static_cast<int>(levels.size()) - 1; level >= 0; --level) {
+        forEach(levels[level], [this](int node) { upward(node); });
+    }
+
+    // Interactions: every tile owns the locals and accelerations of its subtree
+    std::vector<long long> m2lCounts(tileRoots.size(), 0), p2pCounts(tileRoots.size(), 0);
+    std::vector<int> tiles(tileRoots.size());
+    std::iota(tiles.begin(), tiles.end(), 0);
+    forEach(tiles, [&](int t) { walk(tileRoots[t], 0, m2lCounts[t], p2pCounts[t]); });
+
+    // Downward: top level first
+    for (const auto& level : levels) {
+        forEach(level, [this](int node) { downward(node); });
+    }
+
+    const LD unit = Physics::G * massScale / (static_cast<LD>(lengthScale) * lengthScale);
+    for (size_t k = 0; k < n; ++k) {
+        bodies[permutation[k]].acceleration = { ax[k] * unit, ay[k] * unit };
+    }
+    if (potential) {
+        LD energy = 0;
+        for (size_t k = 0; k < n; ++k) energy += pm[k] * phi[k];
+        *potential = -Physics::G * massScale * massScale / lengthScale * energy / 2;
+    }
+
+    lastStats.nodes = nodes.size();
+    for (const auto& nd : nodes) lastStats.leaves += nd.childCount == 0;
+    lastStats.m2l = std::accumulate(m2lCounts.begin(), m2lCounts.end(), 0LL);
+    lastStats.p2p = std::accumulate(p2pCounts.begin(), p2pCounts.end(), 0LL);
+    const double t = std::min(static_cast<double>(theta), 0.999);
+    lastStats.errorBound = (order + 1) * std::pow(t, order) / (1 - t); // derivative of the truncated series
+    sampleError(bodies);
+}
+
+// Direct sum for errorSamples bodies: O(errorSamples * N).
+// Half are the bodies with the largest truncation estimate relative to their own
+// acceleration, the rest a fixed pseudo-random draw from the others, weighted up
+// to stand for all of them in the rms.
+void FastMultipole::sampleError(const std::vector<Body>& bodies) {
+    const size_t n = bodies.size();
+    const size_t samples = std::min(static_cast<size_t>(std::max(errorSamples, 0)), n);
+    if (samples == 0) return;
+
+    // Estimated relative error per body, in tree order
+    std::vector<double> estimate(n, 0.0);
+    for (size_t node = 0; node < nodes.size(); ++node) {
+        if (nodes[node].childCount > 0) continue;
+        for (int k = nodes[node].begin; k < nodes[node].end; ++k) {
+            const double a = std::hypot(ax[k], ay[k]);
+            estimate[k] = a > 0 ? truncation[node] / a : 0;
+        }
+    }
+
+    std::vector<int> picks(n);
+    std::iota(picks.begin(), picks.end(), 0);
+    const size_t worst = samples / 2;
+    std::nth_element(picks.begin(), picks.begin() + worst, picks.end(),
+                     [&](int a, int b) { return estimate[a] > estimate[b]; });
+    std::mt19937 rng(12345); // fixed, so the figures repeat
+    std::shuffle(picks.begin() + worst, picks.end(), rng);
+
+    const SofteningLaw<LD> exactLaw(softening);
+    auto relativeError = [&](const Body& target) -> double {
+        LD exactX = 0, exactY = 0;
+        for (const Body& source : bodies) {
+            Vec2 d = source.position - target.position;
+            LD r = d.norm();
+            if (r < MIN_NUMBER) continue;
+            LD f = Physics::G * source.mass * exactLaw.inverseCube(r);
+            exactX += d.x * f;
+            exactY += d.y * f;
+        }
+        LD exact = std::sqrt(exactX * exactX + exactY * exactY);
+        if (exact <= 0) return 0;
+        LD ex = target.acceleration.x - exactX, ey = target.acceleration.y - exactY;
+        return static_cast<double>(std::sqrt(ex * ex + ey * ey) / exact);
+    };
+
+    double worstSum2 = 0, restSum2 = 0, largest = 0;
+    for (size_t s = 0; s < samples; ++s) {
+        const double rel = relativeError(bodies[permutation[picks[s]]]);
+        (s < worst ? worstSum2 : restSum2) += rel * rel;
+        largest = std::max(largest, rel);
+    }
+    const double restWeight = samples > worst ? static_cast<double>(n - worst) / (samples - worst) : 0;
+    lastStats.sampledRmsError = std::sqrt((worstSum2 + restWeight * restSum2) / n);
+    lastStats.sampledMaxError = largest;
+}
+
+void FastMultipole::computeAccelerations(std::vector<Body>& bodies, LD* potential) {
+    run(bodies, nullptr, potential);
+}
+
+void FastMultipole::computeAccelerations(std::vector<Body>& bodies, ThreadPool& pool, LD* potential) {
+    run(bodies, &pool, potential);
+}
\ No newline at end of file
@@ -0,0 +1,115 @@
+#pragma once
+#include "helpers.h"
+#include "body.h"
+#include "softening.h"
+#include "threadpool.h"
+#include <complex>
+
+// One cell of the adaptive quadtree. Cells split until they hold at most
+// FastMultipole::leafSize bodies; empty quadrants get no node.
+struct FmmNode {
+    double boxX = 0, boxY = 0, halfSize = 0; // square used for splitting
+    std::complex<double> center;              // expansion center (center of mass)
+    double radius = 0;                        // farthest body from the center
+    double mass = 0;
+
+    int begin = 0, end = 0;                   // bodies [begin, end) in tree order
+    int parent = -1;
+    int firstChild = -1, childCount = 0;      // children are contiguous
+    int level = 0;
+};
+
+struct FmmStats {
+    size_t nodes = 0, leaves = 0;
+    long long m2l = 0;              // cell-cell interactions
+    long long p2p = 0;              // body-body interactions
+    // Relative acceleration error vs the direct sum. Most bodies are near machine precision and
+    // a few with a weak net pull orders of magnitude worse, so evenly spaced samples miss the
+    // tail: half the samples are the bodies with the largest estimated error (see sampleError).
+    double sampledRmsError = 0;     // over all bodies, estimated: usually within 2x, clustered systems up to ~15x low
+    double sampledMaxError = 0;     // worst sampled body: usually the worst body, never above it
+    double errorBound = 0;          // a priori, per cell-cell term: (p+1) theta^p / (1 - theta). Only
+                                    // for comparing settings, it is orders of magnitude above both
+};
+
+// Fast multipole method for the 1/r potential of point masses in the plane.
+//
+// With z = x + iy, 1/|z - w| = z^(-1/2) conj(z)^(-1/2) (1 - w/z)^(-1/2) conj(1 - w/z)^(-1/2),
+// so expansions are double power series in z and conj(z) with complex coefficients
+// M_kl = sum m dz^k conj(dz)^l, truncated at total degree k + l <= order.
+// All translation operators (M2M, M2L, L2L) factor into two 1D sums: O(p^3) each.
+//
+// Interactions come from a dual tree walk: two cells interact through their
+// expansions when (rA + rB) < theta * distance, leaves that are too close
+// are summed directly. The walk is split into independent target subtrees,
+// so the result does not depend on the number of threads.
+class FastMultipole {
+public:
+    int order = 8;     // p: error ~ theta^(p+1)
+    LD theta = 0.5;    // separation criterion, clamped to MAX_THETA
+    int leafSize = 32;
+    int errorSamples = 32; // bodies checked against the direct sum after each evaluation, 0 = off
+    // Applied to the direct (P2P) part only: keep the leaves wider than the softening range
+    // (spline: 2.8 eps), or close pairs in well-separated cells stay Newtonian
+    Softening softening;
+
+    // With 'potential' the same expansions also give the potential energy (J)
+    void computeAccelerations(std::vector<Body>& bodies, LD* potential = nullptr);
+    void computeAccelerations(std::vector<Body>& bodies, ThreadPool& pool, LD* potential = nullptr);
+
+    const FmmStats& stats() const { return lastStats; }
+    size_t nodeCount() const { return nodes.size(); }
+
+    static constexpr int MAX_ORDER = 30;
+    static constexpr LD MAX_THETA = 0.9; // the expansions diverge as theta approaches 1
+    static constexpr int MAX_DEPTH = 64;
+
+private:
+    using Complex = std::complex<double>;
+
+    std::vector<FmmNode> nodes;
+    std::vector<std::vector<int>> levels; // node indices per tree level
+    std::vector<int> tileRoots;           // independent target subtrees for the dual walk
+    std::vector<Complex> multipole, local; // terms() coefficients per node
+    std::vector<double> truncation;        // per node: estimated M2L error of its accelerations, ancestors included
+
+    // Bodies in tree order, positions relative to the root box in units of its
+    // half size and masses in units of the largest one, so that powers up to
+    // MAX_ORDER neither overflow nor lose the small offsets inside a cell
+    std::vector<int> permutation;
+    std::vector<double> bx, by; // same, in the caller's order (used while splitting)
+    std::vector<double> px, py, pm, ax, ay;
+    std::vector<double> phi;    // sum of m / r per body, only while wantPotential
+    bool wantPotential = false;
+    double lengthScale = 1, massScale = 1;
+    double minDistance = 0;     // MIN_NUMBER in scaled units
+    SofteningLaw<double> law;   // 'softening' in scaled units
+
+    // Tables for the current order
+    int preparedOrder = -1;
+    std::vector<int> index;        // (k, l) -> coefficient, k + l <= p
+    std::vector<double> binomial;  // C(n, k), n <= 2p
+    std::vector<double> inverseSqrt; // c_a B(a, k): coefficient of R^(-1/2-a-k) in M2L
+
+    FmmStats lastStats;
+
+    int terms() const { return (order + 1) * (order + 2) / 2; }
+    int idx(int k, int l) const { return index[k * (order + 1) + l]; }
+    double choose(int n, int k) const { return binomial[n * (2 * order + 1) + k]; }
+
+    void prepare();
+    void build(const std::vector<Body>& bodies);
+    void split(int node);
+    void chooseTiles();
+
+    void upward(int node);
+    void downward(int node);
+    void walk(int target, int source, long long& m2l, long long& p2p);
+    double truncationEstimate(int target, int source, double distance) const;
+    void m2l(int source, int target);
+    template <bool Potential, bool Softened>
+    void p2p(int source, int target);
+
+    void run(std::vector<Body>& bodies, ThreadPool* pool, LD* potential);
+    void sampleError(const std::vector<Body>& bodies);
+};
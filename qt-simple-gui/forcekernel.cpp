@@ -0,0 +1,561 @@
+﻿#include "forcekernel.h"
+#include <cmath>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define KERNEL_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+// MSVC allows intrinsics of any instruction set without per-function flags
+#define KERNEL_TARGET_AVX2
+#define KERNEL_TARGET_AVX512
+#else
+#define KERNEL_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#define KERNEL_TARGET_AVX512 __attribute__((target("avx512f")))
+#endif
+#else
+#define KERNEL_X86 0
+#endif
+
+namespace ForceKernel {
+
+Isa detectIsa() {
+#if KERNEL_X86
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return Isa::Scalar;
+
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    bool fma = (info[2] & (1 << 12)) != 0;
+    if (!osxsave || !avx) return Isa::Scalar;
+
+    // The OS must save the YMM (and for AVX-512 the ZMM/opmask) registers
+    unsigned long long xcr0 = _xgetbv(0);
+    __cpuidex(info, 7, 0);
+    bool avx2 = (info[1] & (1 << 5)) != 0;
+    bool avx512f = (info[1] & (1 << 16)) != 0;
+
+    if (avx512f && (xcr0 & 0xE6) == 0xE6) return Isa::Avx512;
+    if (avx2 && fma && (xcr0 & 0x6) == 0x6) return Isa::Avx2;
+#else
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) return Isa::Avx512;
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) return Isa::Avx2;
+#endif
+#endif
+    return Isa::Scalar;
+}
+
+const char* isaName(Isa isa) {
+    switch (isa) {
+    case Isa::Avx512: return "AVX-512";
+    case Isa::Avx2: return "AVX2";
+    case Isa::Scalar:
+    default: return "scalar";
+    }
+}
+
+// Constants of one evaluation, in store units
+template <typename T>
+struct KernelParams {
+    T cut;           // pairs with r2 <= cut are dropped; at least minDistanceSquared()
+    T eps2;          // Plummer kernels: softening length squared
+    NearPairs* near; // Split kernels: receives the dropped pairs
+};
+
+// Reference kernel; also handles the tails of the vector loops.
+// Self-interaction drops out through r2 <= cut (r2 is exactly 0 for j == i).
+// With Potential the loop also sums m_j / r into phii, with Split the dropped pairs are listed,
+// and with Plummer r2 + eps2 takes the place of r2 in the force and the potential.
+template <bool Potential, bool Split, bool Plummer, typename T>
+static void accumulateScalar(const BodyStore<T>& s, size_t i, size_t jBegin, size_t jEnd, const KernelParams<T>& kp,
+                             T& axi, T& ayi, T& phii) {
+    const T xi = s.x[i], yi = s.y[i];
+    for (size_t j = jBegin; j < jEnd; ++j) {
+        T dx = s.x[j] - xi;
+        T dy = s.y[j] - yi;
+        T r2 = dx * dx + dy * dy;
+        if (!(r2 > kp.cut)) {
+            if (Split && j > i) kp.near->pairs.emplace_back(static_cast<int>(i), static_cast<int>(j));
+            continue;
+        }
+        T inv = T(1) / std::sqrt(Plummer ? r2 + kp.eps2 : r2);
+        T f = s.mass[j] * inv * inv * inv;
+        axi += f * dx;
+        ayi += f * dy;
+        if (Potential) phii += s.mass[j] * inv;
+    }
+}
+
+// Returns sum_i m_i phi_i / 2 in store units (0 without Potential)
+template <bool Potential, bool Split, bool Plummer, typename T>
+static T directSumScalar(BodyStore<T>& s, const KernelParams<T>& kp) {
+    const size_t n = s.size();
+    T energy = 0;
+    for (size_t i = 0; i < n; ++i) {
+        T axi = 0, ayi = 0, phii = 0;
+        accumulateScalar<Potential, Split, Plummer>(s, i, 0, n, kp, axi, ayi, phii);
+        s.ax[i] = axi;
+        s.ay[i] = ayi;
+        energy += s.mass[i] * phii;
+    }
+    return energy / 2;
+}
+
+// One row of the symmetric sum from column jBegin on; also the tail of the vector rows
+template <bool Potential, bool Split, bool Plummer, typename T>
+static void symmetricRowScalar(const BodyStore<T>& s, size_t i, size_t jBegin, size_t begin, T cut, T eps2, T* rx, T* ry,
+                               T& axi, T& ayi, T& phii, std::vector<std::pair<int, int>>* near) {
+    const size_t n = s.size();
+    const T xi = s.x[i], yi = s.y[i], mi = s.mass[i];
+    for (size_t j = jBegin; j < n; ++j) {
+        T dx = s.x[j] - xi;
+        T dy = s.y[j] - yi;
+        T r2 = dx * dx + dy * dy;
+        if (!(r2 > cut)) {
+            if (Split) near->emplace_back(static_cast<int>(i), static_cast<int>(j));
+            continue;
+        }
+        T inv = T(1) / std::sqrt(Plummer ? r2 + eps2 : r2);
+        T inv3 = inv * inv * inv;
+        axi += s.mass[j] * inv3 * dx;
+        ayi += s.mass[j] * inv3 * dy;
+        rx[j - begin] -= mi * inv3 * dx;
+        ry[j - begin] -= mi * inv3 * dy;
+        if (Potential) phii += s.mass[j] * inv;
+    }
+}
+
+// The potential sums N terms of very different size: in double for float stores too
+template <bool Potential, bool Split, bool Plummer, typename T>
+static double symmetricRowsScalar(const BodyStore<T>& s, size_t begin, size_t end, T cut, T eps2, T* rx, T* ry,
+                                  std::vector<std::pair<int, int>>* near) {
+    double energy = 0;
+    for (size_t i = begin; i < end; ++i) {
+        T axi = 0, ayi = 0, phii = 0;
+        symmetricRowScalar<Potential, Split, Plummer>(s, i, i + 1, begin, cut, eps2, rx, ry, axi, ayi, phii, near);
+        rx[i - begin] += axi;
+        ry[i - begin] += ayi;
+        if (Potential) energy += static_cast<double>(s.mass[i]) * phii;
+    }
+    return energy;
+}
+
+// Ensemble pair kernel; the vector versions take 4 or 8 systems at a time and finish here
+static void pairLanesScalar(const PairLanes& p, size_t begin, size_t end, double g) {
+    for (size_t s = begin; s < end; ++s) {
+        double dx = p.xj[s] - p.xi[s];
+        double dy = p.yj[s] - p.yi[s];
+        double r2 = dx * dx + dy * dy;
+        if (!(r2 > 0)) continue;
+        double inv = 1.0 / std::sqrt(r2);
+        double inv3 = g * inv * inv * inv;
+        p.axi[s] += p.mj[s] * inv3 * dx;
+        p.ayi[s] += p.mj[s] * inv3 * dy;
+        p.axj[s] -= p.mi[s] * inv3 * dx;
+        p.ayj[s] -= p.mi[s] * inv3 * dy;
+    }
+}
+
+#if KERNEL_X86
+
+KERNEL_TARGET_AVX2 static inline double hsum(__m256d v) {
+    __m128d lo = _mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1));
+    return _mm_cvtsd_f64(_mm_add_sd(lo, _mm_unpackhi_pd(lo, lo)));
+}
+
+KERNEL_TARGET_AVX2 static inline float hsum(__m256 v) {
+    __m128 lo = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    lo = _mm_add_ps(lo, _mm_movehl_ps(lo, lo));
+    lo = _mm_add_ss(lo, _mm_shuffle_ps(lo, lo, 1));
+    return _mm_cvtss_f32(lo);
+}
+
+// Split kernels: records the lanes of the block starting at j that the cutoff dropped
+static inline void recordNear(std::vector<std::pair<int, int>>& pairs, size_t i, size_t j, unsigned lanes) {
+    for (size_t k = j; lanes != 0; ++k, lanes >>= 1) {
+        if ((lanes & 1) && k > i) pairs.emplace_back(static_cast<int>(i), static_cast<int>(k));
+    }
+}
+
+// The vector kernels are instantiated with and without the potential, the near-field split
+// and the softening, so the plain force evaluation keeps its exact instruction stream
+template <bool Potential, bool Split, bool Plummer>
+KERNEL_TARGET_AVX2 static double directSumAvx2(BodyStore<double>& s, const KernelParams<double>& kp) {
+    const size_t n = s.size();
+    const size_t nv = n & ~size_t(3);
+    const __m256d minR2 = _mm256_set1_pd(kp.cut);
+    const __m256d eps2 = _mm256_set1_pd(kp.eps2);
+    const __m256d one = _mm256_set1_pd(1.0);
+    double energy = 0;
+
+    for (size_t i = 0; i < n; ++i) {
+        const __m256d xi = _mm256_set1_pd(s.x[i]);
+        const __m256d yi = _mm256_set1_pd(s.y[i]);
+        __m256d axv = _mm256_setzero_pd();
+        __m256d ayv = _mm256_setzero_pd();
+        __m256d phiv = _mm256_setzero_pd();
+
+        for (size_t j = 0; j < nv; j += 4) {
+            __m256d dx = _mm256_sub_pd(_mm256_loadu_pd(&s.x[j]), xi);
+            __m256d dy = _mm256_sub_pd(_mm256_loadu_pd(&s.y[j]), yi);
+            __m256d r2 = _mm256_fmadd_pd(dy, dy, _mm256_mul_pd(dx, dx));
+            __m256d mask = _mm256_cmp_pd(r2, minR2, _CMP_GT_OQ);
+            if (Split) recordNear(kp.near->pairs, i, j, ~_mm256_movemask_pd(mask) & 0xFu);
+            __m256d inv = _mm256_div_pd(one, _mm256_sqrt_pd(Plummer ? _mm256_add_pd(r2, eps2) : r2));
+            __m256d mj = _mm256_loadu_pd(&s.mass[j]);
+            __m256d f = _mm256_mul_pd(mj, _mm256_mul_pd(inv, _mm256_mul_pd(inv, inv)));
+            f = _mm256_and_pd(f, mask); // drops self and too-close pairs (inf/NaN lanes)
+            axv = _mm256_fmadd_pd(f, dx, axv);
+            ayv = _mm256_fmadd_pd(f, dy, ayv);
+            if (Potential) phiv = _mm256_add_pd(phiv, _mm256_and_pd(_mm256_mul_pd(mj, inv), mask));
+        }
+
+        double axi = hsum(axv), ayi = hsum(ayv), phii = Potential ? hsum(phiv) : 0.0;
+        accumulateScalar<Potential, Split, Plummer>(s, i, nv, n, kp, axi, ayi, phii);
+        s.ax[i] = axi;
+        s.ay[i] = ayi;
+        if (Potential) energy += s.mass[i] * phii;
+    }
+    return energy / 2;
+}
+
+template <bool Potential, bool Split, bool Plummer>
+KERNEL_TARGET_AVX2 static float directSumAvx2(BodyStore<float>& s, const KernelParams<float>& kp) {
+    const size_t n = s.size();
+    const size_t nv = n & ~size_t(7);
+    const __m256 minR2 = _mm256_set1_ps(kp.cut);
+    const __m256 eps2 = _mm256_set1_ps(kp.eps2);
+    const __m256 one = _mm256_set1_ps(1.0f);
+    double energy = 0; // N terms of very different size: summed in double
+
+    for (size_t i = 0; i < n; ++i) {
+        const __m256 xi = _mm256_set1_ps(s.x[i]);
+        const __m256 yi = _mm256_set1_ps(s.y[i]);
+        __m256 axv = _mm256_setzero_ps();
+        __m256 ayv = _mm256_setzero_ps();
+        __m256 phiv = _mm256_setzero_ps();
+
+        for (size_t j = 0; j < nv; j += 8) {
+            __m256 dx = _mm256_sub_ps(_mm256_loadu_ps(&s.x[j]), xi);
+            __m256 dy = _mm256_sub_ps(_mm256_loadu_ps(&s.y[j]), yi);
+            __m256 r2 = _mm256_fmadd_ps(dy, dy, _mm256_mul_ps(dx, dx));
+            __m256 mask = _mm256_cmp_ps(r2, minR2, _CMP_GT_OQ);
+            if (Split) recordNear(kp.near->pairs, i, j, ~_mm256_movemask_ps(mask) & 0xFFu);
+            __m256 inv = _mm256_div_ps(one, _mm256_sqrt_ps(Plummer ? _mm256_add_ps(r2, eps2) : r2));
+            __m256 mj = _mm256_loadu_ps(&s.mass[j]);
+            __m256 f = _mm256_mul_ps(mj, _mm256_mul_ps(inv, _mm256_mul_ps(inv, inv)));
+            f = _mm256_and_ps(f, mask);
+            axv = _mm256_fmadd_ps(f, dx, axv);
+            ayv = _mm256_fmadd_ps(f, dy, ayv);
+            if (Potential) phiv = _mm256_add_ps(phiv, _mm256_and_ps(_mm256_mul_ps(mj, inv), mask));
+        }
+
+        float axi = hsum(axv), ayi = hsum(ayv), phii = Potential ? hsum(phiv) : 0.0f;
+        accumulateScalar<Potential, Split, Plummer>(s, i, nv, n, kp, axi, ayi, phii);
+        s.ax[i] = axi;
+        s.ay[i] = ayi;
+        if (Potential) energy += static_cast<double>(s.mass[i]) * phii;
+    }
+    return static_cast<float>(energy / 2);
+}
+
+// Symmetric rows (see symmetricRows): the reactions on j are read, updated and written back
+// four or eight columns at a time; the row's own sum is added once at the end
+template <bool Potential, bool Split, bool Plummer>
+KERNEL_TARGET_AVX2 static double symmetricRowsAvx2(const BodyStore<double>& s, size_t begin, size_t end, double cut, double eps2,
+                                                   double* rx, double* ry, std::vector<std::pair<int, int>>* near) {
+    const size_t n = s.size();
+    const __m256d minR2 = _mm256_set1_pd(cut);
+    const __m256d eps2v = _mm256_set1_pd(eps2);
+    const __m256d one = _mm256_set1_pd(1.0);
+    double energy = 0;
+
+    for (size_t i = begin; i < end; ++i) {
+        const __m256d xi = _mm256_set1_pd(s.x[i]);
+        const __m256d yi = _mm256_set1_pd(s.y[i]);
+        const __m256d mi = _mm256_set1_pd(s.mass[i]);
+        __m256d axv = _mm256_setzero_pd();
+        __m256d ayv = _mm256_setzero_pd();
+        __m256d phiv = _mm256_setzero_pd();
+
+        size_t j = i + 1;
+        for (; j + 4 <= n; j += 4) {
+            __m256d dx = _mm256_sub_pd(_mm256_loadu_pd(&s.x[j]), xi);
+            __m256d dy = _mm256_sub_pd(_mm256_loadu_pd(&s.y[j]), yi);
+            __m256d r2 = _mm256_fmadd_pd(dy, dy, _mm256_mul_pd(dx, dx));
+            __m256d mask = _mm256_cmp_pd(r2, minR2, _CMP_GT_OQ);
+            if (Split) recordNear(*near, i, j, ~_mm256_movemask_pd(mask) & 0xFu);
+            __m256d inv = _mm256_div_pd(one, _mm256_sqrt_pd(Plummer ? _mm256_add_pd(r2, eps2v) : r2));
+            __m256d inv3 = _mm256_and_pd(_mm256_mul_pd(inv, _mm256_mul_pd(inv, inv)), mask);
+            __m256d mj = _mm256_loadu_pd(&s.mass[j]);
+            __m256d f = _mm256_mul_pd(mj, inv3);
+            axv = _mm256_fmadd_pd(f, dx, axv);
+            ayv = _mm256_fmadd_pd(f, dy, ayv);
+            __m256d g = _mm256_mul_pd(mi, inv3);
+            _mm256_storeu_pd(&rx[j - begin], _mm256_fnmadd_pd(g, dx, _mm256_loadu_pd(&rx[j - begin])));
+            _mm256_storeu_pd(&ry[j - begin], _mm256_fnmadd_pd(g, dy, _mm256_loadu_pd(&ry[j - begin])));
+            if (Potential) phiv = _mm256_add_pd(phiv, _mm256_and_pd(_mm256_mul_pd(mj, inv), mask));
+        }
+
+        double axi = hsum(axv), ayi = hsum(ayv), phii = Potential ? hsum(phiv) : 0.0;
+        symmetricRowScalar<Potential, Split, Plummer>(s, i, j, begin, cut, eps2, rx, ry, axi, ayi, phii, near);
+        rx[i - begin] += axi;
+        ry[i - begin] += ayi;
+        if (Potential) energy += s.mass[i] * phii;
+    }
+    return energy;
+}
+
+template <bool Potential, bool Split, bool Plummer>
+KERNEL_TARGET_AVX2 static double symmetricRowsAvx2(const BodyStore<float>& s, size_t begin, size_t end, float cut, float eps2,
+                                                   float* rx, float* ry, std::vector<std::pair<int, int>>* near) {
+    const size_t n = s.size();
+    const __m256 minR2 = _mm256_set1_ps(cut);
+    const __m256 eps2v = _mm256_set1_ps(eps2);
+    const __m256 one = _mm256_set1_ps(1.0f);
+    double energy = 0;
+
+    for (size_t i = begin; i < end; ++i) {
+        const __m256 xi = _mm256_set1_ps(s.x[i]);
+        const __m256 yi = _mm256_set1_ps(s.y[i]);
+        const __m256 mi = _mm256_set1_ps(s.mass[i]);
+        __m256 axv = _mm256_setzero_ps();
+        __m256 ayv = _mm256_setzero_ps();
+        __m256 phiv = _mm256_setzero_ps();
+
+        size_t j = i + 1;
+        for (; j + 8 <= n; j += 8) {
+            __m256 dx = _mm256_sub_ps(_mm256_loadu_ps(&s.x[j]), xi);
+            __m256 dy = _mm256_sub_ps(_mm256_loadu_ps(&s.y[j]), yi);
+            __m256 r2 = _mm256_fmadd_ps(dy, dy, _mm256_mul_ps(dx, dx));
+            __m256 mask = _mm256_cmp_ps(r2, minR2, _CMP_GT_OQ);
+            if (Split) recordNear(*near, i, j, ~_mm256_movemask_ps(mask) & 0xFFu);
+            __m256 inv = _mm256_div_ps(one, _mm256_sqrt_ps(Plummer ? _mm256_add_ps(r2, eps2v) : r2));
+            __m256 inv3 = _mm256_and_ps(_mm256_mul_ps(inv, _mm256_mul_ps(inv, inv)), mask);
+            __m256 mj = _mm256_loadu_ps(&s.mass[j]);
+            __m256 f = _mm256_mul_ps(mj, inv3);
+            axv = _mm256_fmadd_ps(f, dx, axv);
+            ayv = _mm256_fmadd_ps(f, dy, ayv);
+            __m256 g = _mm256_mul_ps(mi, inv3);
+            _mm256_storeu_ps(&rx[j - begin], _mm256_fnmadd_ps(g, dx, _mm256_loadu_ps(&rx[j - begin])));
+            _mm256_storeu_ps(&ry[j - begin], _mm256_fnmadd_ps(g, dy, _mm256_loadu_ps(&ry[j - begin])));
+            if (Potential) phiv = _mm256_add_ps(phiv, _mm256_and_ps(_mm256_mul_ps(mj, inv), mask));
+        }
+
+        float axi = hsum(axv), ayi = hsum(ayv), phii = Potential ? hsum(phiv) : 0.0f;
+        symmetricRowScalar<Potential, Split, Plummer>(s, i, j, begin, cut, eps2, rx, ry, axi, ayi, phii, near);
+        rx[i - begin] += axi;
+        ry[i - begin] += ayi;
+        if (Potential) energy += static_cast<double>(s.mass[i]) * phii;
+    }
+    return energy;
+}
+
+// AVX-512 handles the tail with masked loads: padded lanes have zero mass
+template <bool Potential, bool Split, bool Plummer>
+KERNEL_TARGET_AVX512 static double directSumAvx512(BodyStore<double>& s, const KernelParams<double>& kp) {
+    const size_t n = s.size();
+    const __m512d minR2 = _mm512_set1_pd(kp.cut);
+    const __m512d eps2 = _mm512_set1_pd(kp.eps2);
+    const __m512d one = _mm512_set1_pd(1.0);
+    double energy = 0;
+
+    for (size_t i = 0; i < n; ++i) {
+        const __m512d xi = _mm512_set1_pd(s.x[i]);
+        const __m512d yi = _mm512_set1_pd(s.y[i]);
+        __m512d axv = _mm512_setzero_pd();
+        __m512d ayv = _mm512_setzero_pd();
+        __m512d phiv = _mm512_setzero_pd();
+
+        for (size_t j = 0; j < n; j += 8) {
+            __mmask8 live = n - j >= 8 ? __mmask8(0xFF) : __mmask8((1u << (n - j)) - 1);
+            __m512d dx = _mm512_sub_pd(_mm512_maskz_loadu_pd(live, &s.x[j]), xi);
+            __m512d dy = _mm512_sub_pd(_mm512_maskz_loadu_pd(live, &s.y[j]), yi);
+            __m512d r2 = _mm512_fmadd_pd(dy, dy, _mm512_mul_pd(dx, dx));
+            __mmask8 k = _mm512_mask_cmp_pd_mask(live, r2, minR2, _CMP_GT_OQ);
+            if (Split) recordNear(kp.near->pairs, i, j, static_cast<unsigned>(live & ~k));
+            __m512d inv = _mm512_maskz_div_pd(k, one, _mm512_sqrt_pd(Plummer ? _mm512_add_pd(r2, eps2) : r2));
+            __m512d mj = _mm512_maskz_loadu_pd(live, &s.mass[j]);
+            __m512d f = _mm512_maskz_mul_pd(k, mj, _mm512_mul_pd(inv, _mm512_mul_pd(inv, inv)));
+            axv = _mm512_fmadd_pd(f, dx, axv);
+            ayv = _mm512_fmadd_pd(f, dy, ayv);
+            if (Potential) phiv = _mm512_fmadd_pd(mj, inv, phiv); // inv is zero outside k
+        }
+
+        s.ax[i] = _mm512_reduce_add_pd(axv);
+        s.ay[i] = _mm512_reduce_add_pd(ayv);
+        if (Potential) energy += s.mass[i] * _mm512_reduce_add_pd(phiv);
+    }
+    return energy / 2;
+}
+
+template <bool Potential, bool Split, bool Plummer>
+KERNEL_TARGET_AVX512 static float directSumAvx512(BodyStore<float>& s, const KernelParams<float>& kp) {
+    const size_t n = s.size();
+    const __m512 minR2 = _mm512_set1_ps(kp.cut);
+    const __m512 eps2 = _mm512_set1_ps(kp.eps2);
+    const __m512 one = _mm512_set1_ps(1.0f);
+    double energy = 0;
+
+    for (size_t i = 0; i < n; ++i) {
+        const __m512 xi = _mm512_set1_ps(s.x[i]);
+        const __m512 yi = _mm512_set1_ps(s.y[i]);
+        __m512 axv = _mm512_setzero_ps();
+        __m512 ayv = _mm512_setzero_ps();
+        __m512 phiv = _mm512_setzero_ps();
+
+        for (size_t j = 0; j < n; j += 16) {
+            __mmask16 live = n - j >= 16 ? __mmask16(0xFFFF) : __mmask16((1u << (n - j)) - 1);
+            __m512 dx = _mm512_sub_ps(_mm512_maskz_loadu_ps(live, &s.x[j]), xi);
+            __m512 dy = _mm512_sub_ps(_mm512_maskz_loadu_ps(live, &s.y[j]), yi);
+            __m512 r2 = _mm512_fmadd_ps(dy, dy, _mm512_mul_ps(dx, dx));
+            __mmask16 k = _mm512_mask_cmp_ps_mask(live, r2, minR2, _CMP_GT_OQ);
+            if (Split) recordNear(kp.near->pairs, i, j, static_cast<unsigned>(live & ~k));
+            __m512 inv = _mm512_maskz_div_ps(k, one, _mm512_sqrt_ps(Plummer ? _mm512_add_ps(r2, eps2) : r2));
+            __m512 mj = _mm512_maskz_loadu_ps(live, &s.mass[j]);
+            __m512 f = _mm512_maskz_mul_ps(k, mj, _mm512_mul_ps(inv, _mm512_mul_ps(inv, inv)));
+            axv = _mm512_fmadd_ps(f, dx, axv);
+            ayv = _mm512_fmadd_ps(f, dy, ayv);
+            if (Potential) phiv = _mm512_fmadd_ps(mj, inv, phiv);
+        }
+
+        s.ax[i] = _mm512_reduce_add_ps(axv);
+        s.ay[i] = _mm512_reduce_add_ps(ayv);
+        if (Potential) energy += static_cast<double>(s.mass[i]) * _mm512_reduce_add_ps(phiv);
+    }
+    return static_cast<float>(energy / 2);
+}
+
+KERNEL_TARGET_AVX2 static void pairLanesAvx2(const PairLanes& p, size_t count, double g) {
+    const size_t nv = count & ~size_t(3);
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d one = _mm256_set1_pd(1.0);
+    const __m256d gv = _mm256_set1_pd(g);
+    for (size_t s = 0; s < nv; s += 4) {
+        __m256d dx = _mm256_sub_pd(_mm256_loadu_pd(p.xj + s), _mm256_loadu_pd(p.xi + s));
+        __m256d dy = _mm256_sub_pd(_mm256_loadu_pd(p.yj + s), _mm256_loadu_pd(p.yi + s));
+        __m256d r2 = _mm256_fmadd_pd(dy, dy, _mm256_mul_pd(dx, dx));
+        __m256d mask = _mm256_cmp_pd(r2, zero, _CMP_GT_OQ);
+        __m256d inv = _mm256_div_pd(one, _mm256_sqrt_pd(r2));
+        __m256d inv3 = _mm256_and_pd(_mm256_mul_pd(gv, _mm256_mul_pd(inv, _mm256_mul_pd(inv, inv))), mask);
+        __m256d fi = _mm256_mul_pd(_mm256_loadu_pd(p.mj + s), inv3);
+        __m256d fj = _mm256_mul_pd(_mm256_loadu_pd(p.mi + s), inv3);
+        _mm256_storeu_pd(p.axi + s, _mm256_fmadd_pd(fi, dx, _mm256_loadu_pd(p.axi + s)));
+        _mm256_storeu_pd(p.ayi + s, _mm256_fmadd_pd(fi, dy, _mm256_loadu_pd(p.ayi + s)));
+        _mm256_storeu_pd(p.axj + s, _mm256_fnmadd_pd(fj, dx, _mm256_loadu_pd(p.axj + s)));
+        _mm256_storeu_pd(p.ayj + s, _mm256_fnmadd_pd(fj, dy, _mm256_loadu_pd(p.ayj + s)));
+    }
+    pairLanesScalar(p, nv, count, g);
+}
+
+KERNEL_TARGET_AVX512 static void pairLanesAvx512(const PairLanes& p, size_t count, double g) {
+    const size_t nv = count & ~size_t(7);
+    const __m512d one = _mm512_set1_pd(1.0);
+    const __m512d gv = _mm512_set1_pd(g);
+    for (size_t s = 0; s < nv; s += 8) {
+        __m512d dx = _mm512_sub_pd(_mm512_loadu_pd(p.xj + s), _mm512_loadu_pd(p.xi + s));
+        __m512d dy = _mm512_sub_pd(_mm512_loadu_pd(p.yj + s), _mm512_loadu_pd(p.yi + s));
+        __m512d r2 = _mm512_fmadd_pd(dy, dy, _mm512_mul_pd(dx, dx));
+        __mmask8 k = _mm512_cmp_pd_mask(r2, _mm512_setzero_pd(), _CMP_GT_OQ);
+        __m512d inv = _mm512_maskz_div_pd(k, one, _mm512_sqrt_pd(r2));
+        __m512d inv3 = _mm512_mul_pd(gv, _mm512_mul_pd(inv, _mm512_mul_pd(inv, inv)));
+        __m512d fi = _mm512_mul_pd(_mm512_loadu_pd(p.mj + s), inv3);
+        __m512d fj = _mm512_mul_pd(_mm512_loadu_pd(p.mi + s), inv3);
+        _mm512_storeu_pd(p.axi + s, _mm512_fmadd_pd(fi, dx, _mm512_loadu_pd(p.axi + s)));
+        _mm512_storeu_pd(p.ayi + s, _mm512_fmadd_pd(fi, dy, _mm512_loadu_pd(p.ayi + s)));
+        _mm512_storeu_pd(p.axj + s, _mm512_fnmadd_pd(fj, dx, _mm512_loadu_pd(p.axj + s)));
+        _mm512_storeu_pd(p.ayj + s, _mm512_fnmadd_pd(fj, dy, _mm512_loadu_pd(p.ayj + s)));
+    }
+    pairLanesScalar(p, nv, count, g);
+}
+
+#endif
+
+void pairAccelerations(const PairLanes& p, size_t count, double g, Isa isa) {
+#if KERNEL_X86
+    if (isa == Isa::Avx512) { pairLanesAvx512(p, count, g); return; }
+    if (isa == Isa::Avx2) { pairLanesAvx2(p, count, g); return; }
+#endif
+    pairLanesScalar(p, 0, count, g);
+}
+
+template <bool Potential, bool Split, bool Plummer, typename T>
+static T runKernel(BodyStore<T>& store, Isa isa, const KernelParams<T>& kp) {
+#if KERNEL_X86
+    if (isa == Isa::Avx512) return directSumAvx512<Potential, Split, Plummer>(store, kp);
+    if (isa == Isa::Avx2) return directSumAvx2<Potential, Split, Plummer>(store, kp);
+#endif
+    return directSumScalar<Potential, Split, Plummer>(store, kp);
+}
+
+// Runtime flags to template arguments, one at a time
+template <bool Potential, bool Split, typename T>
+static T selectPlummer(BodyStore<T>& store, Isa isa, const KernelParams<T>& kp) {
+    if (kp.eps2 > 0) return runKernel<Potential, Split, true>(store, isa, kp);
+    return runKernel<Potential, Split, false>(store, isa, kp);
+}
+
+template <bool Potential, typename T>
+static T selectSplit(BodyStore<T>& store, Isa isa, const KernelParams<T>& kp) {
+    if (kp.near) return selectPlummer<Potential, true>(store, isa, kp);
+    return selectPlummer<Potential, false>(store, isa, kp);
+}
+
+template <typename T>
+static T dispatch(BodyStore<T>& store, Isa isa, bool potential, NearPairs* near, LD plummer) {
+    KernelParams<T> kp;
+    kp.cut = near ? store.nearDistanceSquared(near->radius) : store.minDistanceSquared();
+    kp.eps2 = store.softeningSquared(plummer);
+    kp.near = near;
+    if (near) near->pairs.clear();
+    return potential ? selectSplit<true>(store, isa, kp) : selectSplit<false>(store, isa, kp);
+}
+
+// Symmetric rows; AVX-512 machines run the AVX2 version
+template <bool Potential, bool Split, bool Plummer, typename T>
+static double runRows(const BodyStore<T>& s, Isa isa, size_t begin, size_t end, T cut, T eps2, T* rx, T* ry,
+                      std::vector<std::pair<int, int>>* near) {
+#if KERNEL_X86
+    if (isa != Isa::Scalar) return symmetricRowsAvx2<Potential, Split, Plummer>(s, begin, end, cut, eps2, rx, ry, near);
+#endif
+    return symmetricRowsScalar<Potential, Split, Plummer>(s, begin, end, cut, eps2, rx, ry, near);
+}
+
+template <bool Potential, typename T>
+static double selectRows(const BodyStore<T>& s, Isa isa, size_t begin, size_t end, T cut, T eps2, T* rx, T* ry,
+                         std::vector<std::pair<int, int>>* near) {
+    if (near) {
+        if (eps2 > 0) return runRows<Potential, true, true>(s, isa, begin, end, cut, eps2, rx, ry, near);
+        return runRows<Potential, true, false>(s, isa, begin, end, cut, eps2, rx, ry, near);
+    }
+    if (eps2 > 0) return runRows<Potential, false, true>(s, isa, begin, end, cut, eps2, rx, ry, near);
+    return runRows<Potential, false, false>(s, isa, begin, end, cut, eps2, rx, ry, near);
+}
+
+double symmetricRows(const BodyStore<double>& store, Isa isa, size_t begin, size_t end, double cut, double eps2,
+                     double* rx, double* ry, bool potential, std::vector<std::pair<int, int>>* near) {
+    if (potential) return selectRows<true>(store, isa, begin, end, cut, eps2, rx, ry, near);
+    return selectRows<false>(store, isa, begin, end, cut, eps2, rx, ry, near);
+}
+
+double symmetricRows(const BodyStore<float>& store, Isa isa, size_t begin, size_t end, float cut, float eps2,
+                     float* rx, float* ry, bool potential, std::vector<std::pair<int, int>>* near) {
+    if (potential) return selectRows<true>(store, isa, begin, end, cut, eps2, rx, ry, near);
+    return selectRows<false>(store, isa, begin, end, cut, eps2, rx, ry, near);
+}
+
+void directSum(BodyStore<double>& store, Isa isa, double* potential, NearPairs* near, LD plummer) {
+    double energy = dispatch(store, isa, potential != nullptr, near, plummer);
+    if (potential) *potential = energy;
+}
+
+void directSum(BodyStore<float>& store, Isa isa, float* potential, NearPairs* near, LD plummer) {
+    float energy = dispatch(store, isa, potential != nullptr, near, plummer);
+    if (potential) *potential = energy;
+}
+
+}
\ No newline at end of file
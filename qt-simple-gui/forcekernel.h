@@ -0,0 +1,52 @@
+#pragma once
+#include "bodystore.h"
+#include <utility>
+
+enum class Precision {
+    LongDouble, // reference path on Simulation::bodies
+    Double,
+    Float
+};
+
+// Direct-sum kernels on the SoA store.
+// The instruction set is picked once at runtime; Scalar is always available.
+namespace ForceKernel {
+    enum class Isa { Scalar, Avx2, Avx512 };
+
+    Isa detectIsa();
+    const char* isaName(Isa isa);
+
+    // Near field of a mixed-precision sum (see Simulation::nearRadius): the kernels leave out
+    // every pair closer than 'radius' (m) and list it here once, as (i, j) with i < j,
+    // for the caller to sum from the original long double positions.
+    struct NearPairs {
+        LD radius = 0;
+        std::vector<std::pair<int, int>> pairs;
+    };
+
+    // Fills store.ax/ay (store units, see BodyStore::accelerationScale).
+    // With 'potential' the same pass also returns sum m_i m_j / r_ij over the pairs (see BodyStore::potentialScale).
+    // With 'near' the close pairs are skipped and listed instead (the list is replaced).
+    // 'plummer' is a Plummer softening length in m (see softening.h), 0 = none.
+    void directSum(BodyStore<double>& store, Isa isa, double* potential = nullptr, NearPairs* near = nullptr, LD plummer = 0);
+    void directSum(BodyStore<float>& store, Isa isa, float* potential = nullptr, NearPairs* near = nullptr, LD plummer = 0);
+
+    // Rows [begin, end) of the symmetric sum that ParallelDirectSum tiles: every pair (i, j > i)
+    // adds its pull on i to rx/ry[i - begin] and subtracts the reaction on j from rx/ry[j - begin].
+    // cut and eps2 are squared store units; pairs with r2 <= cut are dropped and, with 'near',
+    // appended to it. With 'potential' returns sum m_i m_j / r over the rows' pairs
+    // (in double for both stores), else 0.
+    double symmetricRows(const BodyStore<double>& store, Isa isa, size_t begin, size_t end, double cut, double eps2,
+                         double* rx, double* ry, bool potential, std::vector<std::pair<int, int>>* near);
+    double symmetricRows(const BodyStore<float>& store, Isa isa, size_t begin, size_t end, float cut, float eps2,
+                         float* rx, float* ry, bool potential, std::vector<std::pair<int, int>>* near);
+
+    // Ensemble layout (see ensemble.h): the same pair of bodies in 'count' independent
+    // systems, every pointer addressing 'count' consecutive values. With d = r_j - r_i,
+    // adds g m_j d / r^3 to a_i and subtracts g m_i d / r^3 from a_j; coincident bodies are skipped.
+    struct PairLanes {
+        const double *xi, *yi, *mi, *xj, *yj, *mj;
+        double *axi, *ayi, *axj, *ayj;
+    };
+    void pairAccelerations(const PairLanes& p, size_t count, double g, Isa isa);
+}
@@ -0,0 +1,270 @@
+﻿#include "generators.h"
+#include "physics.h"
+#include "threadpool.h"
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <random>
+#include <sstream>
+
+namespace {
+    // Uniform and normal draws on top of the engine, identical on every standard library
+    struct Stream {
+        std::mt19937_64 engine;
+
+        Stream(uint64_t seed, uint64_t block) {
+            std::seed_seq seq{ static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32),
+                static_cast<uint32_t>(block), static_cast<uint32_t>(block >> 32) };
+            engine.seed(seq);
+        }
+
+        // [0, 1) with 53 random bits
+        double uniform() { return static_cast<double>(engine() >> 11) * (1.0 / 9007199254740992.0); }
+        // (0, 1], safe for log and negative powers
+        double positive() { return 1.0 - uniform(); }
+        double normal() { return std::sqrt(-2 * std::log(positive())) * std::cos(2 * M_PI * uniform()); }
+    };
+
+    template <int D>
+    Vec<D, LD> makeVec(LD x, LD y, LD z);
+
+    template <>
+    Vec<2, LD> makeVec<2>(LD x, LD y, LD) { return { x, y }; }
+
+    template <>
+    Vec<3, LD> makeVec<3>(LD x, LD y, LD z) { return { x, y, z }; }
+
+    // Random direction on the unit sphere
+    void isotropic(Stream& s, double& x, double& y, double& z) {
+        const double cz = 2 * s.uniform() - 1;
+        const double phi = 2 * M_PI * s.uniform();
+        const double sz = std::sqrt(1 - cz * cz);
+        x = sz * std::cos(phi);
+        y = sz * std::sin(phi);
+        z = cz;
+    }
+
+    LD sphereRadius(LD mass) {
+        return std::cbrt(3 * mass / (4 * M_PI * 1000));
+    }
+}
+
+// Sampled in double, which is all the random numbers carry; 'phase' is the ring's rotation in turns
+template <int D>
+static BodyT<D, LD> sampleBody(const GeneratorSpec& spec, size_t index, Stream& s, LD m, LD r, double phase) {
+    const double a = static_cast<double>(spec.scale);
+    const double G = static_cast<double>(Physics::G);
+    const double speed = static_cast<double>(spec.speed);
+    double x = 0, y = 0, z = 0, vx = 0, vy = 0, vz = 0;
+
+    switch (spec.type) {
+    case GeneratorType::Plummer: {
+        // Aarseth, Henon & Wielen (1974): radius from the inverse cumulative mass,
+        // speed by rejection from q^2 (1 - q^2)^3.5 as a fraction of the escape speed.
+        // Radii beyond 30 scale lengths (0.4% of the mass) are drawn again
+        double radius;
+        do {
+            radius = a / std::sqrt(std::pow(s.positive(), -2.0 / 3) - 1);
+        } while (!(radius < 30 * a));
+        double q, g;
+        do {
+            q = s.uniform();
+            g = 0.1 * s.uniform();
+        } while (g > q * q * std::pow(1 - q * q, 3.5));
+        const double escape = std::sqrt(2 * G * static_cast<double>(spec.mass) / a) / std::sqrt(std::sqrt(1 + radius * radius / (a * a)));
+        isotropic(s, x, y, z);
+        x *= radius; y *= radius; z *= radius;
+        isotropic(s, vx, vy, vz);
+        vx *= q * escape; vy *= q * escape; vz *= q * escape;
+        break;
+    }
+    case GeneratorType::ExponentialDisk: {
+        // R ~ Gamma(2, scale) is the radius of an exponential surface density;
+        // the circular speed counts the central mass and the disk mass inside R
+        const double radius = -a * std::log(s.positive() * s.positive());
+        const double phi = 2 * M_PI * s.uniform();
+        const double inside = static_cast<double>(spec.mass) * (1 - (1 + radius / a) * std::exp(-radius / a));
+        const double circular = radius > 0 ? std::sqrt(G * (static_cast<double>(spec.centralMass) + inside) / radius) : 0;
+        x = radius * std::cos(phi);
+        y = radius * std::sin(phi);
+        z = D == 3 ? 0.05 * a * s.normal() : 0;
+        vx = -circular * std::sin(phi) + speed * s.normal();
+        vy = circular * std::cos(phi) + speed * s.normal();
+        vz = D == 3 ? speed * s.normal() : 0;
+        break;
+    }
+    case GeneratorType::UniformBox:
+        x = a * (2 * s.uniform() - 1);
+        y = a * (2 * s.uniform() - 1);
+        z = D == 3 ? a * (2 * s.uniform() - 1) : 0;
+        vx = speed * (2 * s.uniform() - 1);
+        vy = speed * (2 * s.uniform() - 1);
+        vz = D == 3 ? speed * (2 * s.uniform() - 1) : 0;
+        break;
+    case GeneratorType::KeplerRing: {
+        const double phi = 2 * M_PI * (phase + static_cast<double>(index) / spec.count);
+        const double circular = std::sqrt(G * static_cast<double>(spec.centralMass) / a);
+        x = a * std::cos(phi);
+        y = a * std::sin(phi);
+        vx = -circular * std::sin(phi);
+        vy = circular * std::cos(phi);
+        break;
+    }
+    }
+    return BodyT<D, LD>(m, r, makeVec<D>(x, y, z), makeVec<D>(vx, vy, vz));
+}
+
+template <int D>
+static void generate(const GeneratorSpec& spec, std::vector<BodyT<D, LD>>& bodies, int threads) {
+    const size_t first = bodies.size();
+    const bool central = spec.centralMass > 0
+        && (spec.type == GeneratorType::ExponentialDisk || spec.type == GeneratorType::KeplerRing);
+    if (central) {
+        bodies.push_back(BodyT<D, LD>(spec.centralMass, spec.bodyRadius > 0 ? spec.bodyRadius : sphereRadius(spec.centralMass)));
+    }
+    if (spec.count == 0) return;
+
+    const size_t start = bodies.size();
+    const LD m = spec.mass / spec.count;
+    const LD r = spec.bodyRadius > 0 ? spec.bodyRadius : sphereRadius(m);
+    bodies.resize(start + spec.count);
+    // Drawn apart from the blocks so that they all agree on it
+    const double phase = Stream(spec.seed, ~0ULL).uniform();
+
+    const size_t blocks = (spec.count + GENERATOR_BLOCK - 1) / GENERATOR_BLOCK;
+    auto fill = [&](size_t block, int) {
+        Stream s(spec.seed, block);
+        const size_t stop = std::min(spec.count, (block + 1) * GENERATOR_BLOCK);
+        for (size_t i = block * GENERATOR_BLOCK; i < stop; ++i) {
+            bodies[start + i] = sampleBody<D>(spec, i, s, m, r, phase);
+        }
+    };
+    const int workers = std::min(threads > 0 ? threads : ThreadPool::hardwareThreads(), static_cast<int>(blocks));
+    if (workers > 1) {
+        ThreadPool pool(workers);
+        pool.run(blocks, fill);
+    }
+    else {
+        for (size_t b = 0; b < blocks; ++b) fill(b, 0);
+    }
+
+    // Center of mass at rest at the origin
+    LD total = 0;
+    Vec<D, LD> weighted, momentum;
+    for (size_t i = first; i < bodies.size(); ++i) {
+        total += bodies[i].mass;
+        weighted += bodies[i].position * bodies[i].mass;
+        momentum += bodies[i].velocity * bodies[i].mass;
+    }
+    if (total > 0) {
+        const Vec<D, LD> shift = weighted * (1 / total);
+        const Vec<D, LD> drift = momentum * (1 / total);
+        for (size_t i = first; i < bodies.size(); ++i) {
+            bodies[i].position -= shift;
+            bodies[i].velocity -= drift;
+        }
+    }
+}
+
+void generateBodies(const GeneratorSpec& spec, std::vector<Body>& bodies, int threads) {
+    generate<2>(spec, bodies, threads);
+}
+
+void generateBodies(const GeneratorSpec& spec, std::vector<Body3>& bodies, int threads) {
+    generate<3>(spec, bodies, threads);
+}
+
+const char* generatorName(GeneratorType type) {
+    switch (type) {
+    case GeneratorType::Plummer: return "plummer";
+    case GeneratorType::ExponentialDisk: return "disk";
+    case GeneratorType::UniformBox: return "box";
+    case GeneratorType::KeplerRing: return "ring";
+    }
+    return "";
+}
+
+GeneratorSpec defaultGenerator(GeneratorType type) {
+    GeneratorSpec spec;
+    spec.type = type;
+    switch (type) {
+    case GeneratorType::Plummer: // star cluster: 10^4 suns within a parsec
+        spec.count = 10000;
+        spec.mass = 2e34;
+        spec.scale = 3e16;
+        break;
+    case GeneratorType::ExponentialDisk: // small galaxy with a central bulge
+        spec.count = 20000;
+        spec.mass = 2e40;
+        spec.scale = 1e20;
+        spec.centralMass = 2e40;
+        spec.speed = 1e4;
+        break;
+    case GeneratorType::UniformBox: // cold collapse
+        spec.count = 10000;
+        spec.mass = 1e30;
+        spec.scale = 1e12;
+        break;
+    case GeneratorType::KeplerRing: // asteroids at 1 AU around the sun
+        spec.count = 1000;
+        spec.mass = 1e21;
+        spec.scale = 1.496e11;
+        spec.centralMass = 1.989e30;
+        break;
+    }
+    return spec;
+}
+
+bool parseGenerator(const std::string& text, GeneratorSpec& spec, std::string& error) {
+    std::istringstream in(text);
+    std::string word;
+    if (!(in >> word)) {
+        error = "missing generator type";
+        return false;
+    }
+    GeneratorType type;
+    if (word == "plummer") type = GeneratorType::Plummer;
+    else if (word == "disk") type = GeneratorType::ExponentialDisk;
+    else if (word == "box") type = GeneratorType::UniformBox;
+    else if (word == "ring") type = GeneratorType::KeplerRing;
+    else {
+        error = "unknown generator '" + word + "' (plummer, disk, box, ring)";
+        return false;
+    }
+
+    GeneratorSpec result = defaultGenerator(type);
+    while (in >> word) {
+        const size_t eq = word.find('=');
+        const std::string key = word.substr(0, eq);
+        std::istringstream value(eq == std::string::npos ? "" : word.substr(eq + 1));
+        bool ok;
+        if (key == "n") ok = static_cast<bool>(value >> result.count) && result.count > 0;
+        else if (key == "mass") ok = static_cast<bool>(value >> result.mass) && result.mass > 0;
+        else if (key == "scale") ok = static_cast<bool>(value >> result.scale) && result.scale > 0;
+        else if (key == "central") ok = static_cast<bool>(value >> result.centralMass) && result.centralMass >= 0;
+        else if (key == "speed") ok = static_cast<bool>(value >> result.speed) && result.speed >= 0;
+        else if (key == "radius") ok = static_cast<bool>(value >> result.bodyRadius) && result.bodyRadius >= 0;
+        else if (key == "seed") ok = static_cast<bool>(value >> result.seed);
+        else {
+            error = "unknown generator setting '" + key + "'";
+            return false;
+        }
+        if (!ok || !(value >> std::ws).eof()) {
+            error = "bad value for generator setting '" + key + "'";
+            return false;
+        }
+    }
+    spec = result;
+    return true;
+}
+
+std::string formatGenerator(const GeneratorSpec& spec) {
+    std::ostringstream os;
+    os << std::setprecision(6) << generatorName(spec.type) << " n=" << spec.count
+        << " mass=" << static_cast<double>(spec.mass) << " scale=" << static_cast<double>(spec.scale);
+    if (spec.centralMass > 0) os << " central=" << static_cast<double>(spec.centralMass);
+    if (spec.speed > 0) os << " speed=" << static_cast<double>(spec.speed);
+    if (spec.bodyRadius > 0) os << " radius=" << static_cast<double>(spec.bodyRadius);
+    os << " seed=" << spec.seed;
+    return os.str();
+}
\ No newline at end of file
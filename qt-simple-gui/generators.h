@@ -0,0 +1,46 @@
+#pragma once
+#include "helpers.h"
+#include "body.h"
+#include <cstdint>
+#include <string>
+
+// Procedural initial conditions. All bodies of one generator share the same mass
+// (total mass / count) and, with bodyRadius = 0, the radius of a sphere of 1000 kg/m^3.
+//
+// The bodies are made in blocks of GENERATOR_BLOCK on a thread pool. Each block draws
+// from its own random stream seeded with (seed, block index), and the sampling uses no
+// standard distribution objects (their output differs between standard libraries), so a
+// seed gives the same bodies for any thread count and on any platform.
+// Afterwards the center of mass is moved to the origin and its velocity to zero.
+enum class GeneratorType {
+    Plummer,         // Plummer sphere of radius 'scale' in virial equilibrium (projected onto the plane in 2D)
+    ExponentialDisk, // surface density ~ exp(-R / scale), circular orbits plus a dispersion of 'speed'
+    UniformBox,      // positions uniform in [-scale, scale], velocity components uniform in [-speed, speed]
+    KeplerRing,      // evenly spaced on a circle of radius 'scale' on circular orbits around centralMass
+};
+
+static const size_t GENERATOR_BLOCK = 4096;
+
+struct GeneratorSpec {
+    GeneratorType type = GeneratorType::Plummer;
+    size_t count = 1000;
+    LD mass = 1e30;      // total mass of the generated bodies (kg)
+    LD scale = 1e11;     // m
+    LD centralMass = 0;  // disk and ring: a body at the center (kg), 0 = none
+    LD speed = 0;        // m/s
+    LD bodyRadius = 0;   // m, 0 = from the mass
+    uint64_t seed = 1;
+};
+
+// Appends spec.count bodies (and the central one, if any) to 'bodies'; 'threads' = 0 uses every hardware thread
+void generateBodies(const GeneratorSpec& spec, std::vector<Body>& bodies, int threads = 0);
+void generateBodies(const GeneratorSpec& spec, std::vector<Body3>& bodies, int threads = 0);
+
+// Text form used by scenarios and the setup page:
+//   "disk n=20000 mass=2e40 scale=1e20 central=2e40 speed=1e4 radius=0 seed=7"
+// The type is plummer, disk, box or ring; every key is optional and defaults to
+// defaultGenerator(type).
+bool parseGenerator(const std::string& text, GeneratorSpec& spec, std::string& error);
+std::string formatGenerator(const GeneratorSpec& spec);
+const char* generatorName(GeneratorType type);
+GeneratorSpec defaultGenerator(GeneratorType type);
\ No newline at end of file
@@ -0,0 +1,268 @@
+﻿#include "integrator.h"
+#include "simulation.h"
+#include "physics.h"
+#include "checkpoint.h"
+#include <algorithm>
+
+std::unique_ptr<Integrator> Integrator::create(IntegratorType type) {
+    switch (type) {
+    case IntegratorType::VelocityVerlet: return std::make_unique<VelocityVerletIntegrator>();
+    case IntegratorType::LeapfrogKDK: return std::make_unique<LeapfrogIntegrator>();
+    case IntegratorType::Yoshida4: return std::make_unique<Yoshida4Integrator>();
+    case IntegratorType::DormandPrince45: return std::make_unique<DormandPrinceIntegrator>();
+    case IntegratorType::BlockTimestep: return std::make_unique<BlockTimestepIntegrator>();
+    case IntegratorType::Euler:
+    default: return std::make_unique<EulerIntegrator>();
+    }
+}
+
+const char* Integrator::name(IntegratorType type) {
+    switch (type) {
+    case IntegratorType::VelocityVerlet: return "Velocity Verlet";
+    case IntegratorType::LeapfrogKDK: return "Leapfrog KDK";
+    case IntegratorType::Yoshida4: return "Yoshida 4";
+    case IntegratorType::DormandPrince45: return "Dormand-Prince 4(5)";
+    case IntegratorType::BlockTimestep: return "Block time steps";
+    case IntegratorType::Euler:
+    default: return "Euler";
+    }
+}
+
+void EulerIntegrator::step(Simulation& sim) {
+    SymplecticSteps::euler(sim);
+}
+
+void VelocityVerletIntegrator::step(Simulation& sim) {
+    SymplecticSteps::velocityVerlet(sim, previous);
+}
+
+void LeapfrogIntegrator::step(Simulation& sim) {
+    SymplecticSteps::kickDriftKick(sim, sim.dt);
+}
+
+void Yoshida4Integrator::step(Simulation& sim) {
+    SymplecticSteps::yoshida4(sim);
+}
+
+// Dormand & Prince (1980) RK5(4)7M tableau
+static const LD DP_A[7][6] = {
+    { 0 },
+    { 1.0L / 5 },
+    { 3.0L / 40, 9.0L / 40 },
+    { 44.0L / 45, -56.0L / 15, 32.0L / 9 },
+    { 19372.0L / 6561, -25360.0L / 2187, 64448.0L / 6561, -212.0L / 729 },
+    { 9017.0L / 3168, -355.0L / 33, 46732.0L / 5247, 49.0L / 176, -5103.0L / 18656 },
+    { 35.0L / 384, 0, 500.0L / 1113, 125.0L / 192, -2187.0L / 6784, 11.0L / 84 },
+};
+
+// Difference between the 5th and 4th order weights
+static const LD DP_E[7] = {
+    35.0L / 384 - 5179.0L / 57600,
+    0,
+    500.0L / 1113 - 7571.0L / 16695,
+    125.0L / 192 - 393.0L / 640,
+    -2187.0L / 6784 + 92097.0L / 339200,
+    11.0L / 84 - 187.0L / 2100,
+    -1.0L / 40,
+};
+
+// Integrates exactly sim.dt with as many internal substeps as the tolerance needs.
+// The last stage is evaluated at the new positions (FSAL), so an accepted
+// substep costs 6 force evaluations.
+void DormandPrinceIntegrator::step(Simulation& sim) {
+    const size_t n = sim.bodies.size();
+    x0.resize(n); v0.resize(n);
+    for (int s = 0; s < STAGES; ++s) { kx[s].resize(n); kv[s].resize(n); }
+
+    if (h <= 0) h = sim.dt;
+    if (!sim.accelerationsCurrent) sim.computeAccelerations();
+
+    const LD minStep = sim.dt * 1e-12L;
+    LD remaining = sim.dt;
+    while (remaining > 0) {
+        const LD hs = std::min(h, remaining);
+
+        for (size_t i = 0; i < n; ++i) {
+            const Body& b = sim.bodies[i];
+            x0[i] = b.position;
+            v0[i] = b.velocity;
+            kx[0][i] = b.velocity;
+            kv[0][i] = b.acceleration;
+        }
+
+        for (int s = 1; s < STAGES; ++s) {
+            for (size_t i = 0; i < n; ++i) {
+                Vec2 dx = { 0, 0 }, dv = { 0, 0 };
+                for (int j = 0; j < s; ++j) {
+                    dx = dx + kx[j][i] * DP_A[s][j];
+                    dv = dv + kv[j][i] * DP_A[s][j];
+                }
+                sim.bodies[i].position = x0[i] + dx * hs;
+                kx[s][i] = v0[i] + dv * hs;
+            }
+            sim.computeAccelerations();
+            for (size_t i = 0; i < n; ++i) {
+                kv[s][i] = sim.bodies[i].acceleration;
+            }
+        }
+
+        // Error estimate, scaled per body by the size of its state
+        LD err = 0;
+        for (size_t i = 0; i < n; ++i) {
+            Vec2 ex = { 0, 0 }, ev = { 0, 0 };
+            for (int s = 0; s < STAGES; ++s) {
+                ex = ex + kx[s][i] * DP_E[s];
+                ev = ev + kv[s][i] * DP_E[s];
+            }
+            LD scaleX = absoluteTolerance + relativeTolerance * std::max(x0[i].norm(), sim.bodies[i].position.norm());
+            LD scaleV = absoluteTolerance + relativeTolerance * std::max(v0[i].norm(), kx[STAGES - 1][i].norm());
+            err = std::max({ err, (ex * hs).norm() / scaleX, (ev * hs).norm() / scaleV });
+        }
+
+        bool accepted = err <= 1 || hs <= minStep;
+        if (accepted) {
+            // Positions and accelerations already hold the last stage
+            for (size_t i = 0; i < n; ++i) {
+                sim.bodies[i].velocity = kx[STAGES - 1][i];
+            }
+            remaining -= hs;
+            if (remaining < minStep) remaining = 0;
+        }
+        else {
+            for (size_t i = 0; i < n; ++i) {
+                sim.bodies[i].position = x0[i];
+                sim.bodies[i].acceleration = kv[0][i];
+            }
+            ++rejectedSteps;
+        }
+
+        LD factor = err > 0 ? 0.9L * std::pow(err, -0.2L) : 5;
+        factor = std::min<LD>(5, std::max<LD>(0.2L, factor));
+        // A substep clipped to the end of dt says nothing about the preferred step size
+        if (!(accepted && hs < h)) h = hs * factor;
+    }
+}
+
+void DormandPrinceIntegrator::saveState(CheckpointWriter& out) const {
+    out.put(relativeTolerance);
+    out.put(absoluteTolerance);
+    out.put(h);
+    out.put(rejectedSteps);
+}
+
+void DormandPrinceIntegrator::loadState(CheckpointReader& in) {
+    relativeTolerance = in.get<LD>();
+    absoluteTolerance = in.get<LD>();
+    h = in.get<LD>();
+    rejectedSteps = in.get<long long>();
+}
+
+int BlockTimestepIntegrator::levelFor(const Simulation& sim, size_t i) const {
+    LD a = sim.bodies[i].acceleration.norm();
+    LD j = jerk[i].norm();
+    if (a < MIN_NUMBER || j < MIN_NUMBER) return 0;
+
+    LD wanted = eta * a / j;
+    int k = 0;
+    LD h = sim.dt;
+    while (h > wanted && k < MAX_LEVEL) {
+        h /= 2;
+        ++k;
+    }
+    return k;
+}
+
+void BlockTimestepIntegrator::step(Simulation& sim) {
+    const size_t n = sim.bodies.size();
+    const long long blockTicks = 1LL << MAX_LEVEL;
+    const LD tick = sim.dt / blockTicks;
+    auto span = [](int k) { return 1LL << (MAX_LEVEL - k); };
+    // Whole-system equivalents: n body forces count as one force evaluation
+    const long long countedBefore = n > 0 ? activeForceEvaluations / static_cast<long long>(n) : 0;
+
+    // (Re)start: full force + jerk evaluation and initial levels
+    if (!sim.accelerationsCurrent || level.size() != n) {
+        active.resize(n);
+        for (size_t i = 0; i < n; ++i) active[i] = static_cast<int>(i);
+        jerk.assign(n, { 0, 0 });
+        Physics::computeAccelerationsAndJerks(sim, active, jerk);
+        activeForceEvaluations += static_cast<long long>(n);
+        level.resize(n);
+        for (size_t i = 0; i < n; ++i) level[i] = levelFor(sim, i);
+    }
+
+    // Opening half kicks
+    nextEnd.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+        Body& b = sim.bodies[i];
+        b.velocity = b.velocity + b.acceleration * (tick * span(level[i]) / 2);
+        nextEnd[i] = span(level[i]);
+    }
+
+    long long t = 0;
+    while (t < blockTicks) {
+        long long tNext = blockTicks;
+        for (size_t i = 0; i < n; ++i) tNext = std::min(tNext, nextEnd[i]);
+
+        // Drift everyone: inactive bodies are predicted, active ones reach the end of their step
+        const LD drift = tick * (tNext - t);
+        for (auto& b : sim.bodies) {
+            b.position = b.position + b.velocity * drift;
+        }
+        t = tNext;
+
+        active.clear();
+        for (size_t i = 0; i < n; ++i) {
+            if (nextEnd[i] == t) active.push_back(static_cast<int>(i));
+        }
+        Physics::computeAccelerationsAndJerks(sim, active, jerk);
+        activeForceEvaluations += static_cast<long long>(active.size());
+
+        for (int i : active) {
+            Body& b = sim.bodies[i];
+            b.velocity = b.velocity + b.acceleration * (tick * span(level[i]) / 2); // closing kick
+
+            // Finer levels are always allowed; coarser ones one at a time and only on their own grid
+            int wanted = levelFor(sim, i);
+            if (wanted > level[i]) {
+                level[i] = wanted;
+            }
+            else if (wanted < level[i] && t % span(level[i] - 1) == 0) {
+                level[i] -= 1;
+            }
+
+            if (t < blockTicks) {
+                b.velocity = b.velocity + b.acceleration * (tick * span(level[i]) / 2); // opening kick
+                nextEnd[i] = t + span(level[i]);
+            }
+        }
+    }
+
+    // Every step ends on the block boundary, so all forces belong to the final positions
+    sim.accelerationsCurrent = true;
+    if (n > 0) sim.forceEvaluations += activeForceEvaluations / static_cast<long long>(n) - countedBefore;
+}
+
+void BlockTimestepIntegrator::saveState(CheckpointWriter& out) const {
+    out.put(eta);
+    out.putVector(level);
+    out.putVector(jerk);
+    out.put(activeForceEvaluations);
+}
+
+void BlockTimestepIntegrator::permute(const std::vector<uint32_t>& order) {
+    if (level.size() != order.size()) return; // restarts on the next step anyway
+    std::vector<int> oldLevel(level);
+    std::vector<Vec2> oldJerk(jerk);
+    for (size_t i = 0; i < order.size(); ++i) {
+        level[i] = oldLevel[order[i]];
+        jerk[i] = oldJerk[order[i]];
+    }
+}
+
+void BlockTimestepIntegrator::loadState(CheckpointReader& in) {
+    eta = in.get<LD>();
+    in.getVector(level);
+    in.getVector(jerk);
+    activeForceEvaluations = in.get<long long>();
+}
\ No newline at end of file
@@ -0,0 +1,196 @@
+#pragma once
+#include "helpers.h"
+#include "body.h"
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+class Simulation;
+class CheckpointWriter;
+class CheckpointReader;
+
+enum class IntegratorType {
+    Euler,           // semi-implicit (symplectic) Euler, 1st order
+    VelocityVerlet,  // 2nd order, symplectic
+    LeapfrogKDK,     // kick-drift-kick, 2nd order, symplectic
+    Yoshida4,        // 4th order symplectic (three KDK substeps)
+    DormandPrince45, // adaptive embedded Runge-Kutta 5(4) with error control
+    BlockTimestep    // leapfrog KDK with individual power-of-two steps per body
+};
+
+// Advances all bodies by sim.dt. Simulation::step() owns time and stepCount.
+// Schemes that need a(t) at the start of a step take it from the previous step
+// (Simulation::accelerationsCurrent), so they cost one force evaluation per step.
+class Integrator {
+public:
+    virtual ~Integrator() = default;
+
+    virtual IntegratorType type() const = 0;
+    virtual void step(Simulation& sim) = 0;
+
+    // History that a restart needs to continue bit-identically (see checkpoint.h)
+    virtual void saveState(CheckpointWriter&) const {}
+    virtual void loadState(CheckpointReader&) {}
+    // Per-body history follows the bodies when they are re-sorted (see bodyorder.h):
+    // slot i takes over what slot order[i] had
+    virtual void permute(const std::vector<uint32_t>&) {}
+
+    static std::unique_ptr<Integrator> create(IntegratorType type);
+    static const char* name(IntegratorType type);
+};
+
+// The fixed-step symplectic schemes, written once for any state that has
+// 'bodies' (position, velocity, acceleration), 'dt', 'accelerationsCurrent'
+// and computeAccelerations(): the Integrator classes below run them on
+// Simulation, BasicSimulation on its own bodies of any dimension and precision.
+class SymplecticSteps {
+public:
+    // v_new = v + a * dt, r_new = r + v_new * dt
+    template <typename State>
+    static void euler(State& s) {
+        s.computeAccelerations();
+        for (auto& b : s.bodies) {
+            b.velocity = b.velocity + b.acceleration * s.dt;
+            b.position = b.position + b.velocity * s.dt;
+        }
+        // The accelerations belong to the old positions now
+        s.accelerationsCurrent = false;
+    }
+
+    // 'previous' holds a(t) while a(t + dt) is computed
+    template <typename State, typename Vector>
+    static void velocityVerlet(State& s, std::vector<Vector>& previous) {
+        const auto dt = s.dt;
+        if (!s.accelerationsCurrent) s.computeAccelerations();
+
+        previous.resize(s.bodies.size());
+        for (size_t i = 0; i < s.bodies.size(); ++i) {
+            auto& b = s.bodies[i];
+            previous[i] = b.acceleration;
+            b.position = b.position + b.velocity * dt + b.acceleration * (dt * dt / 2);
+        }
+
+        s.computeAccelerations();
+
+        for (size_t i = 0; i < s.bodies.size(); ++i) {
+            auto& b = s.bodies[i];
+            b.velocity = b.velocity + (previous[i] + b.acceleration) * (dt / 2);
+        }
+    }
+
+    // One kick-drift-kick substep of length h; forces at the end stay in the bodies
+    template <typename State, typename T>
+    static void kickDriftKick(State& s, T h) {
+        if (!s.accelerationsCurrent) s.computeAccelerations();
+
+        for (auto& b : s.bodies) {
+            b.velocity = b.velocity + b.acceleration * (h / 2);
+            b.position = b.position + b.velocity * h;
+        }
+
+        s.computeAccelerations();
+
+        for (auto& b : s.bodies) {
+            b.velocity = b.velocity + b.acceleration * (h / 2);
+        }
+    }
+
+    // Yoshida (1990) weights of the three substeps w1, w0, w1
+    template <typename T>
+    static void yoshida4Weights(T& w1, T& w0) {
+        const T cbrt2 = std::cbrt(static_cast<T>(2));
+        w1 = 1 / (2 - cbrt2);
+        w0 = -cbrt2 / (2 - cbrt2);
+    }
+
+    // Symmetric composition of three leapfrog steps; the closing kick of one
+    // substep and the opening kick of the next share a force evaluation
+    template <typename State>
+    static void yoshida4(State& s) {
+        std::decay_t<decltype(s.dt)> w1, w0;
+        yoshida4Weights(w1, w0);
+        kickDriftKick(s, w1 * s.dt);
+        kickDriftKick(s, w0 * s.dt);
+        kickDriftKick(s, w1 * s.dt);
+    }
+};
+
+class EulerIntegrator : public Integrator {
+public:
+    IntegratorType type() const override { return IntegratorType::Euler; }
+    void step(Simulation& sim) override;
+};
+
+class VelocityVerletIntegrator : public Integrator {
+public:
+    IntegratorType type() const override { return IntegratorType::VelocityVerlet; }
+    void step(Simulation& sim) override;
+
+private:
+    std::vector<Vec2> previous; // a(t) while a(t + dt) is computed
+};
+
+class LeapfrogIntegrator : public Integrator {
+public:
+    IntegratorType type() const override { return IntegratorType::LeapfrogKDK; }
+    void step(Simulation& sim) override;
+};
+
+class Yoshida4Integrator : public Integrator {
+public:
+    IntegratorType type() const override { return IntegratorType::Yoshida4; }
+    void step(Simulation& sim) override;
+};
+
+class DormandPrinceIntegrator : public Integrator {
+public:
+    IntegratorType type() const override { return IntegratorType::DormandPrince45; }
+    void step(Simulation& sim) override;
+    void saveState(CheckpointWriter& out) const override;
+    void loadState(CheckpointReader& in) override;
+
+    LD relativeTolerance = 1e-10;
+    LD absoluteTolerance = 1e-12;
+
+    // History: step size carried over to the next call (0 = pick from dt)
+    LD h = 0;
+    long long rejectedSteps = 0;
+
+private:
+    static constexpr int STAGES = 7;
+    std::vector<Vec2> x0, v0;
+    std::vector<Vec2> kx[STAGES], kv[STAGES]; // stage derivatives of position and velocity
+};
+
+
+// Hierarchical (block) time steps: body i advances with dt / 2^level[i].
+// Levels come from the acceleration/jerk criterion h = eta * |a| / |jerk|.
+// At each sub-step only the bodies whose step ends there ("active") get new forces;
+// all others are drifted with their current velocities (predicted) in the meantime.
+// One call still advances the whole system by exactly sim.dt.
+// Forces and jerks always come from the long double direct sum (on sim.threads
+// threads); scenarios and the GUI reject other solvers and precisions with it.
+class BlockTimestepIntegrator : public Integrator {
+public:
+    IntegratorType type() const override { return IntegratorType::BlockTimestep; }
+    void step(Simulation& sim) override;
+    void saveState(CheckpointWriter& out) const override;
+    void loadState(CheckpointReader& in) override;
+    void permute(const std::vector<uint32_t>& order) override;
+
+    static constexpr int MAX_LEVEL = 16;
+    LD eta = 0.02L;
+
+    // History
+    std::vector<int> level;
+    std::vector<Vec2> jerk;
+    long long activeForceEvaluations = 0; // sum of active-set sizes, restarts included
+
+private:
+    std::vector<long long> nextEnd; // in ticks of dt / 2^MAX_LEVEL
+    std::vector<int> active;
+
+    int levelFor(const Simulation& sim, size_t i) const;
+};
\ No newline at end of file
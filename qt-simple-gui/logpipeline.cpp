@@ -0,0 +1,183 @@
+﻿#include "logpipeline.h"
+#include "profiler.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <iterator>
+
+// The producer never signals (it must not take a mutex), so the ring is polled
+static const std::chrono::milliseconds POLL{ 10 };
+// Lines waiting for the UI beyond this are dropped oldest first; the UI shows fewer anyway
+static const size_t MAX_QUEUED = 1 << 16;
+
+LogPipeline::LogPipeline(size_t capacity)
+    : ring(capacity)
+{
+    thread = std::thread(&LogPipeline::loop, this);
+}
+
+LogPipeline::~LogPipeline() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
+    }
+    wake.notify_one();
+    thread.join();
+}
+
+bool LogPipeline::push(const LogRecord& record) {
+    if (ring.push(record)) return true;
+    droppedRecords.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+void LogPipeline::note(const std::string& line) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        notes.push_back(line);
+    }
+    wake.notify_one();
+}
+
+bool LogPipeline::openFile(const std::string& path, std::string& error, uint64_t maxBytes, int keep) {
+    std::lock_guard<std::mutex> lock(fileMutex);
+    file.close();
+    file.clear();
+    file.open(path, std::ios::out | std::ios::trunc | std::ios::binary);
+    if (!file) {
+        error = "cannot create " + path;
+        return false;
+    }
+    filePath = path;
+    fileBytes = 0;
+    maxFileBytes = maxBytes;
+    keepFiles = keep;
+    return true;
+}
+
+void LogPipeline::closeFile() {
+    std::lock_guard<std::mutex> lock(fileMutex);
+    file.close();
+}
+
+size_t LogPipeline::take(std::vector<std::string>& lines, size_t limit) {
+    std::lock_guard<std::mutex> lock(mutex);
+    const size_t skipped = output.size() > limit ? output.size() - limit : 0;
+    lines.insert(lines.end(), std::make_move_iterator(output.begin() + skipped), std::make_move_iterator(output.end()));
+    output.clear();
+    return skipped;
+}
+
+void LogPipeline::flush() {
+    std::unique_lock<std::mutex> lock(mutex);
+    wake.notify_one();
+    idle.wait(lock, [this] { return !busy && notes.empty() && ring.empty(); });
+}
+
+void LogPipeline::loop() {
+    if (Profiler::enabled) Profiler::instance().setThreadName("log");
+    std::vector<LogRecord> batch(ring.capacity());
+    std::vector<std::string> lines;
+    std::vector<std::string> pendingNotes;
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait_for(lock, POLL, [this] { return quit || !notes.empty() || !ring.empty(); });
+            if (quit && notes.empty() && ring.empty()) return;
+            pendingNotes.swap(notes);
+            busy = true;
+        }
+
+        PROFILE_SCOPE(ProfilePhase::Output);
+        // At most one ring's worth per batch, so the UI sees progress under a flood
+        lines.clear();
+        for (auto& n : pendingNotes) lines.push_back(std::move(n));
+        pendingNotes.clear();
+        const size_t n = ring.pop(batch.begin(), batch.size());
+        for (size_t i = 0; i < n; ++i) {
+            lines.emplace_back();
+            format(batch[i], lines.back());
+        }
+        const long long drops = droppedRecords.load(std::memory_order_relaxed);
+        if (drops > reportedDrops) {
+            lines.push_back("(" + std::to_string(drops - reportedDrops) + " log records dropped, the log could not keep up)");
+            reportedDrops = drops;
+        }
+        write(lines);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            output.insert(output.end(), std::make_move_iterator(lines.begin()), std::make_move_iterator(lines.end()));
+            if (output.size() > MAX_QUEUED) output.erase(output.begin(), output.end() - MAX_QUEUED);
+            busy = false;
+        }
+        idle.notify_all();
+    }
+}
+
+// "0" or "1.234567e+08", as BodyTableModel::formatDouble
+static const char* scientific(char* buf, double v) {
+    if (v == 0.0) return "0";
+    std::snprintf(buf, 32, "%.6e", v);
+    return buf;
+}
+
+void LogPipeline::format(const LogRecord& r, std::string& line) const {
+    char text[512];
+    char s[6][32];
+    switch (r.kind) {
+    case LogRecord::Kind::Time:
+        std::snprintf(text, sizeof(text), "t = %.1f s", r.v[0]);
+        break;
+    case LogRecord::Kind::Body:
+        std::snprintf(text, sizeof(text), "  [%d] pos=(%.6e, %.6e), vel=(%.6e, %.6e), acc=(%.6e, %.6e), |v|=%s, |a|=%s",
+            r.a, r.v[0], r.v[1], r.v[2], r.v[3], r.v[4], r.v[5],
+            scientific(s[0], std::sqrt(r.v[2] * r.v[2] + r.v[3] * r.v[3])),
+            scientific(s[1], std::sqrt(r.v[4] * r.v[4] + r.v[5] * r.v[5])));
+        break;
+    case LogRecord::Kind::Collision:
+        std::snprintf(text, sizeof(text), "💥 Collision of bodies %d and %d at t = %.1f s (step %lld)", r.a, r.b, r.v[0], r.step);
+        break;
+    case LogRecord::Kind::MissedCollisions:
+        std::snprintf(text, sizeof(text), "💥 %lld more collisions", r.step);
+        break;
+    case LogRecord::Kind::Diagnostics:
+        std::snprintf(text, sizeof(text), "  E=%s J (dE/E0=%s, max %s), P=(%.6e, %.6e), L=%s (step %lld)",
+            scientific(s[0], r.v[0]), scientific(s[1], r.v[1]), scientific(s[2], r.v[2]), r.v[3], r.v[4],
+            scientific(s[5], r.v[5]), r.step);
+        break;
+    case LogRecord::Kind::Separator:
+        std::snprintf(text, sizeof(text), "-----");
+        break;
+    case LogRecord::Kind::Finished:
+        std::snprintf(text, sizeof(text), r.a ? "⏹ Simulation finished (collision)." : "⏹ Simulation finished (max steps reached).");
+        break;
+    }
+    line.assign(text);
+}
+
+void LogPipeline::write(const std::vector<std::string>& lines) {
+    std::lock_guard<std::mutex> lock(fileMutex);
+    if (!file.is_open() || lines.empty()) return;
+    for (const auto& line : lines) {
+        file << line << '\n';
+        fileBytes += line.size() + 1;
+        if (fileBytes >= maxFileBytes) rotate();
+    }
+    file.flush();
+}
+
+// path.(keep - 1) -> path.keep, ..., path -> path.1, then a fresh path
+void LogPipeline::rotate() {
+    file.close();
+    for (int k = keepFiles; k >= 1; --k) {
+        const std::string from = k == 1 ? filePath : filePath + "." + std::to_string(k - 1);
+        const std::string to = filePath + "." + std::to_string(k);
+        std::remove(to.c_str());
+        std::rename(from.c_str(), to.c_str());
+    }
+    file.clear();
+    file.open(filePath, std::ios::out | std::ios::trunc | std::ios::binary);
+    fileBytes = 0;
+}
\ No newline at end of file
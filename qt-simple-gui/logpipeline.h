@@ -0,0 +1,87 @@
+#pragma once
+#include "spscring.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// One line of the simulation log in binary form, filled on the stepping thread.
+// The meaning of the fields depends on the kind; all text is made by the formatter.
+struct LogRecord {
+    enum class Kind : uint8_t {
+        Time,             // v[0] = time
+        Body,             // a = index, v = position, velocity, acceleration
+        Collision,        // a, b = bodies, step, v[0] = time
+        MissedCollisions, // step = how many events were not seen
+        Diagnostics,      // step, v = energy, drift, max drift, momentum x/y, angular momentum
+        Separator,
+        Finished,         // a = 1 if stopped by a collision
+    };
+
+    Kind kind = Kind::Separator;
+    int a = 0, b = 0;
+    long long step = 0;
+    double v[6] = {};
+};
+
+// Log path from the stepping thread to the UI (and optionally a file):
+// - the stepper push()es records into a lock-free ring and never waits; when the
+//   ring is full the record is dropped and counted, so a slow formatter can only
+//   lose log lines, never slow the simulation;
+// - a formatter thread drains the ring in batches of up to a ring's worth,
+//   turns the records into text lines, spills them to the log file and queues them;
+// - the UI take()s the queued lines on its refresh, at most as many as it shows.
+class LogPipeline {
+public:
+    explicit LogPipeline(size_t capacity = 1 << 16);
+    ~LogPipeline();
+
+    // Stepping thread only (the single producer). Returns false if the record was dropped
+    bool push(const LogRecord& record);
+
+    // Any thread: a line of text, such as the setup messages of the UI. Takes a mutex
+    void note(const std::string& line);
+
+    // Also write every line to 'path'. Past maxBytes the file is renamed to path.1
+    // (path.1 to path.2 and so on, keeping 'keep' old files) and a new one is started
+    bool openFile(const std::string& path, std::string& error, uint64_t maxBytes = 16 << 20, int keep = 3);
+    void closeFile();
+
+    // UI side: appends the newest queued lines (at most 'limit') to 'lines' and forgets the rest.
+    // Returns how many older lines were skipped
+    size_t take(std::vector<std::string>& lines, size_t limit);
+
+    // Waits until everything pushed or noted so far has been formatted
+    void flush();
+
+    long long dropped() const { return droppedRecords.load(std::memory_order_relaxed); }
+
+private:
+    SpscRing<LogRecord> ring;
+    std::atomic<long long> droppedRecords{ 0 };
+    long long reportedDrops = 0; // formatter only
+
+    std::thread thread;
+    std::mutex mutex; // notes, output and the formatter's sleep
+    std::condition_variable wake;
+    std::condition_variable idle;
+    std::vector<std::string> notes;
+    std::vector<std::string> output;
+    bool quit = false;
+    bool busy = false;
+
+    std::mutex fileMutex; // the formatter writes, the UI opens and closes
+    std::ofstream file;
+    std::string filePath;
+    uint64_t fileBytes = 0, maxFileBytes = 0;
+    int keepFiles = 0;
+
+    void loop();
+    void format(const LogRecord& r, std::string& line) const;
+    void write(const std::vector<std::string>& lines);
+    void rotate();
+};
\ No newline at end of file
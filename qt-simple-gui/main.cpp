@@ -1,8 +1,10 @@
 #include "mainwindow.h"
+#include "profiler.h"
 #include <QApplication>
 
 int main(int argc, char* argv[]) {
     QApplication app(argc, argv);
+    if (Profiler::enabled) Profiler::instance().setThreadName("ui");
 
     MainWindow w;
     w.show();
@@ -1,7 +1,14 @@
 ﻿#include "mainwindow.h"
 #include "simulation.h"
+#include "simulationworker.h"
+#include "bodytablemodel.h"
+#include "profilerpane.h"
+#include "orbitview.h"
+#include "profiler.h"
 #include "physics.h"
 #include "helpers.h"
+#include "bodylist.h"
+#include "generators.h"
 
 #include <QApplication>
 #include <QFont>
@@ -15,36 +22,45 @@
 #include <QSlider>
 #include <QGroupBox>
 #include <QSet>
+#include <QFileDialog>
+#include <QMessageBox>
+#include <QSignalBlocker>
 #include <algorithm>
 #include <sstream>
 #include <iomanip>
 #include <cmath>
 #include <climits>
 
+// Lines kept in the log view; the log file, if any, has all of them
+static const int LOG_VIEW_LINES = 5000;
+
 QString MainWindow::formatDouble(double value) {
-    if (value == 0.0) return "0";
-    std::stringstream ss;
-    ss << std::scientific << std::setprecision(6) << value;
-    return QString::fromStdString(ss.str());
+    return BodyTableModel::formatDouble(value);
 }
 
-// Helper: map slider position to real time (ms)
+// Helper: map slider position to real time per step (ms), 0 = as fast as possible
 int MainWindow::sliderPosToInterval(int pos) {
-    static const int steps[] = { 1000, 500, 250, 50, 10 };
+    static const int steps[] = { 1000, 500, 250, 50, 10, 0 };
     if (pos < 0) pos = 0;
-    if (pos > 4) pos = 4;
+    if (pos > 5) pos = 5;
     return steps[pos];
 }
 
 // Helper: reverse mapping (for initialization)
 int MainWindow::intervalToSliderPos(int interval) {
-    static const int steps[] = { 1000, 500, 250, 50, 10 };
-    for (int i = 0; i < 5; ++i) {
+    static const int steps[] = { 1000, 500, 250, 50, 10, 0 };
+    for (int i = 0; i < 6; ++i) {
         if (interval == steps[i]) return i;
     }
     return 1; // default to 50
 }
 
+// The slider sets a target rate of simulated seconds per real second
+void MainWindow::applySpeed() {
+    int interval = sliderPosToInterval(speedSlider->value());
+    worker->setTargetRate(interval > 0 ? simDt * 1000.0 / interval : 0.0);
+}
+
 void MainWindow::removeSelectedBody() {
     if (bodiesTable->rowCount() <= 1) {
         return;
@@ -70,11 +86,11 @@ void MainWindow::removeSelectedBody() {
 
 MainWindow::MainWindow(QWidget* parent)
     : QMainWindow(parent)
-    , sim(nullptr)
-    , stepCount(0)
-    , maxSteps(INT_MAX)
+    , worker(new SimulationWorker())
+    , snapshot(nullptr)
+    , currentRun(0)
+    , simDt(10.0)
     , logInterval(100.0)
-    , lastLogTime(-logInterval)
     , isRunning(false)
 {
     // --- Setup Page ---
@@ -89,36 +105,205 @@ MainWindow::MainWindow(QWidget* parent)
     maxStepsEdit = new QLineEdit("0");
     setupLayout->addWidget(maxStepsEdit);
 
+    setupLayout->addWidget(new QLabel("Integrator:"));
+    integratorCombo = new QComboBox();
+    for (IntegratorType type : { IntegratorType::Euler, IntegratorType::VelocityVerlet, IntegratorType::LeapfrogKDK,
+        IntegratorType::Yoshida4, IntegratorType::DormandPrince45, IntegratorType::BlockTimestep }) {
+        integratorCombo->addItem(Integrator::name(type), static_cast<int>(type));
+    }
+    setupLayout->addWidget(integratorCombo);
+
+    setupLayout->addWidget(new QLabel("Force solver:"));
+    solverCombo = new QComboBox();
+    solverCombo->addItem("Direct sum (exact)", static_cast<int>(ForceSolver::Direct));
+    solverCombo->addItem("Barnes-Hut tree", static_cast<int>(ForceSolver::BarnesHut));
+    solverCombo->addItem("Fast multipole (FMM)", static_cast<int>(ForceSolver::Fmm));
+    setupLayout->addWidget(solverCombo);
+
+    setupLayout->addWidget(new QLabel("Collisions (uses body radii):"));
+    collisionCombo = new QComboBox();
+    collisionCombo->addItem("Ignore", static_cast<int>(CollisionPolicy::None));
+    collisionCombo->addItem("Log contacts", static_cast<int>(CollisionPolicy::Log));
+    collisionCombo->addItem("Stop at first contact", static_cast<int>(CollisionPolicy::Stop));
+    collisionCombo->addItem("Merge (inelastic)", static_cast<int>(CollisionPolicy::Merge));
+    setupLayout->addWidget(collisionCombo);
+
+    setupLayout->addWidget(new QLabel("Opening angle (theta, tree solvers only):"));
+    thetaEdit = new QLineEdit("0.5");
+    setupLayout->addWidget(thetaEdit);
+
+    setupLayout->addWidget(new QLabel("Expansion order (FMM only):"));
+    fmmOrderSpin = new QSpinBox();
+    fmmOrderSpin->setRange(1, FastMultipole::MAX_ORDER);
+    fmmOrderSpin->setValue(8);
+    setupLayout->addWidget(fmmOrderSpin);
+
+    setupLayout->addWidget(new QLabel("Softening (keeps close encounters finite):"));
+    QHBoxLayout* softeningLayout = new QHBoxLayout();
+    softeningCombo = new QComboBox();
+    softeningCombo->addItem("None (1/r^2)", static_cast<int>(SofteningType::None));
+    softeningCombo->addItem("Plummer", static_cast<int>(SofteningType::Plummer));
+    softeningCombo->addItem("Spline (Newtonian beyond 2.8 eps)", static_cast<int>(SofteningType::Spline));
+    softeningLayout->addWidget(softeningCombo);
+    softeningLayout->addWidget(new QLabel("eps"));
+    softeningEdit = new QLineEdit("0");
+    softeningLayout->addWidget(softeningEdit);
+    softeningLayout->addWidget(new QLabel("m"));
+    setupLayout->addLayout(softeningLayout);
+
+    setupLayout->addWidget(new QLabel(QString("Direct sum precision (vector unit: %1):")
+        .arg(ForceKernel::isaName(ForceKernel::detectIsa()))));
+    precisionCombo = new QComboBox();
+    precisionCombo->addItem("long double (reference)");
+    precisionCombo->addItem("double (SIMD)");
+    precisionCombo->addItem("float (SIMD)");
+    setupLayout->addWidget(precisionCombo);
+
+    setupLayout->addWidget(new QLabel("Near field (SIMD direct sum, Barnes-Hut; pairs closer than this, 0 = off):"));
+    QHBoxLayout* nearLayout = new QHBoxLayout();
+    nearRadiusEdit = new QLineEdit("0");
+    nearLayout->addWidget(nearRadiusEdit);
+    nearLayout->addWidget(new QLabel("m, summed in"));
+    nearPrecisionCombo = new QComboBox();
+    nearPrecisionCombo->addItem("long double", static_cast<int>(Precision::LongDouble));
+    nearPrecisionCombo->addItem("double", static_cast<int>(Precision::Double));
+    nearLayout->addWidget(nearPrecisionCombo);
+    setupLayout->addLayout(nearLayout);
+
+    setupLayout->addWidget(new QLabel("Force threads:"));
+    threadsSpin = new QSpinBox();
+    threadsSpin->setRange(1, ThreadPool::hardwareThreads());
+    threadsSpin->setValue(1);
+    setupLayout->addWidget(threadsSpin);
+
+    setupLayout->addWidget(new QLabel("Body order (re-sorted for cache locality when drifted; rows and names stay with their bodies):"));
+    sortEverySpin = new QSpinBox();
+    sortEverySpin->setRange(0, 100000000);
+    sortEverySpin->setValue(100);
+    sortEverySpin->setPrefix("check every ");
+    sortEverySpin->setSuffix(" steps");
+    sortEverySpin->setSpecialValueText("off");
+    setupLayout->addWidget(sortEverySpin);
+
+    setupLayout->addWidget(new QLabel("Trajectory file (empty = not recorded):"));
+    QHBoxLayout* trajectoryLayout = new QHBoxLayout();
+    trajectoryEdit = new QLineEdit();
+    trajectoryLayout->addWidget(trajectoryEdit);
+    trajectoryLayout->addWidget(new QLabel("every"));
+    trajectoryEverySpin = new QSpinBox();
+    trajectoryEverySpin->setRange(1, 1000000);
+    trajectoryEverySpin->setValue(100);
+    trajectoryEverySpin->setSuffix(" steps");
+    trajectoryLayout->addWidget(trajectoryEverySpin);
+    trajectoryFloatCheck = new QCheckBox("float32");
+    trajectoryLayout->addWidget(trajectoryFloatCheck);
+    setupLayout->addLayout(trajectoryLayout);
+
+    setupLayout->addWidget(new QLabel("Checkpoint file (empty = none):"));
+    QHBoxLayout* checkpointLayout = new QHBoxLayout();
+    checkpointEdit = new QLineEdit();
+    checkpointLayout->addWidget(checkpointEdit);
+    checkpointLayout->addWidget(new QLabel("every"));
+    checkpointEverySpin = new QSpinBox();
+    checkpointEverySpin->setRange(1, 100000000);
+    checkpointEverySpin->setValue(100000);
+    checkpointEverySpin->setSuffix(" steps");
+    checkpointLayout->addWidget(checkpointEverySpin);
+    setupLayout->addLayout(checkpointLayout);
+
+    setupLayout->addWidget(new QLabel("Log file (empty = log view only; rotated at 16 MB, 3 old files kept):"));
+    logFileEdit = new QLineEdit();
+    setupLayout->addWidget(logFileEdit);
+
+    setupLayout->addWidget(new QLabel("Energy / momentum diagnostics (shown in the log):"));
+    diagnosticsEverySpin = new QSpinBox();
+    diagnosticsEverySpin->setRange(0, 100000000);
+    diagnosticsEverySpin->setValue(0);
+    diagnosticsEverySpin->setPrefix("every ");
+    diagnosticsEverySpin->setSuffix(" steps");
+    diagnosticsEverySpin->setSpecialValueText("off");
+    setupLayout->addWidget(diagnosticsEverySpin);
+
+    setupLayout->addWidget(new QLabel("Replay keyframes (memory for scrubbing back on the timeline; spill file, empty = keep fewer keyframes):"));
+    QHBoxLayout* replayLayout = new QHBoxLayout();
+    replayBudgetSpin = new QSpinBox();
+    replayBudgetSpin->setRange(0, 1 << 20);
+    replayBudgetSpin->setValue(256);
+    replayBudgetSpin->setSuffix(" MB");
+    replayBudgetSpin->setSpecialValueText("off");
+    replayLayout->addWidget(replayBudgetSpin);
+    replaySpillEdit = new QLineEdit();
+    replayLayout->addWidget(replaySpillEdit);
+    setupLayout->addLayout(replayLayout);
+
     setupLayout->addWidget(new QLabel("Bodies:"));
     bodiesTable = new QTableWidget(0, 6);
     bodiesTable->setHorizontalHeaderLabels({ "Mass", "Radius", "X", "Y", "VX", "VY" });
     bodiesTable->setEditTriggers(QAbstractItemView::DoubleClicked | QAbstractItemView::EditKeyPressed);
     setupLayout->addWidget(bodiesTable);
 
-    QPushButton* addBodyBtn = new QPushButton("Add Body");
+    // Large setups are kept as a list and only summarized; the table is hidden meanwhile
+    bulkSummaryLabel = new QLabel();
+    bulkSummaryLabel->setWordWrap(true);
+    bulkSummaryLabel->setFont(QFont("Courier New", 10));
+    bulkSummaryLabel->setVisible(false);
+    setupLayout->addWidget(bulkSummaryLabel);
+
+    QHBoxLayout* generatorLayout = new QHBoxLayout();
+    generatorCombo = new QComboBox();
+    for (GeneratorType type : { GeneratorType::Plummer, GeneratorType::ExponentialDisk,
+        GeneratorType::UniformBox, GeneratorType::KeplerRing }) {
+        generatorCombo->addItem(generatorName(type), static_cast<int>(type));
+    }
+    generatorEdit = new QLineEdit();
+    generatorEdit->setToolTip("n, mass (total), scale, central, speed, radius, seed");
+    QPushButton* generateBtn = new QPushButton("Generate");
+    QPushButton* importBtn = new QPushButton("Import Bodies...");
+    // Parameters of the selected generator, editable before Generate
+    auto showGeneratorDefaults = [this]() {
+        const GeneratorSpec spec = defaultGenerator(static_cast<GeneratorType>(generatorCombo->currentData().toInt()));
+        const std::string text = formatGenerator(spec);
+        generatorEdit->setText(QString::fromStdString(text.substr(text.find(' ') + 1)));
+    };
+    connect(generatorCombo, QOverload<int>::of(&QComboBox::currentIndexChanged), this, showGeneratorDefaults);
+    showGeneratorDefaults();
+    connect(generateBtn, &QPushButton::clicked, this, &MainWindow::generateBulkBodies);
+    connect(importBtn, &QPushButton::clicked, this, &MainWindow::importBodyList);
+    generatorLayout->addWidget(generatorCombo);
+    generatorLayout->addWidget(generatorEdit, 1);
+    generatorLayout->addWidget(generateBtn);
+    generatorLayout->addWidget(importBtn);
+    setupLayout->addLayout(generatorLayout);
+
+    addBodyButton = new QPushButton("Add Body");
     QPushButton* resetBtn = new QPushButton("Reset to Default");
     startButton = new QPushButton("▶ Start Simulation");
-    QPushButton* removeBodyBtn = new QPushButton("Remove Selected");
+    removeBodyButton = new QPushButton("Remove Selected");
+    QPushButton* loadCheckpointBtn = new QPushButton("Load Checkpoint...");
 
-    connect(addBodyBtn, &QPushButton::clicked, this, &MainWindow::addBodyRow);
+    connect(addBodyButton, &QPushButton::clicked, this, &MainWindow::addBodyRow);
     connect(resetBtn, &QPushButton::clicked, this, &MainWindow::resetToDefault);
     connect(startButton, &QPushButton::clicked, this, &MainWindow::startSimulation);
-    connect(removeBodyBtn, &QPushButton::clicked, this, &MainWindow::removeSelectedBody);
+    connect(removeBodyButton, &QPushButton::clicked, this, &MainWindow::removeSelectedBody);
+    connect(loadCheckpointBtn, &QPushButton::clicked, this, &MainWindow::loadCheckpointFile);
 
     QHBoxLayout* btnLayout = new QHBoxLayout();
-    btnLayout->addWidget(addBodyBtn);
-    btnLayout->addWidget(removeBodyBtn);
+    btnLayout->addWidget(addBodyButton);
+    btnLayout->addWidget(removeBodyButton);
     btnLayout->addWidget(resetBtn);
+    btnLayout->addWidget(loadCheckpointBtn);
     btnLayout->addWidget(startButton);
     setupLayout->addLayout(btnLayout);
 
     // --- Simulation Page ---
     simPage = new QWidget(this);
 
-    propertiesTable = new QTableWidget();
-    propertiesTable->setColumnCount(5);
-    propertiesTable->setHorizontalHeaderLabels({ "ID", "Mass", "Position", "Velocity", "Acceleration" });
+    bodyModel = new BodyTableModel(this);
+    propertiesTable = new QTableView();
+    propertiesTable->setModel(bodyModel);
     propertiesTable->horizontalHeader()->setStretchLastSection(true);
+    // Fixed row height: the view never measures rows it does not paint
+    propertiesTable->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
     propertiesTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
     propertiesTable->setMinimumHeight(300);
     propertiesTable->horizontalHeader()->setSectionsMovable(true);
@@ -129,11 +314,11 @@ MainWindow::MainWindow(QWidget* parent)
     distanceLabel->setFont(QFont("Courier New", 10));
     distanceLabel->setMinimumWidth(220);
 
-    propertiesTable->setStyleSheet("QTableWidget { background-color: #f9f9f9; gridline-color: #ddd; }"
+    propertiesTable->setStyleSheet("QTableView { background-color: #f9f9f9; gridline-color: #ddd; }"
         "QHeaderView::section { background-color: #e0e0e0; padding: 4px; }");
     distanceLabel->setStyleSheet("QLabel { background-color: #e8f4f8; padding: 6px; border-radius: 4px; }");
-    logView = new QTextEdit();
-    logView->setStyleSheet("QTextEdit { background-color: #fdf6e3; color: #586e75; }");
+    logView = new QPlainTextEdit();
+    logView->setStyleSheet("QPlainTextEdit { background-color: #fdf6e3; color: #586e75; }");
 
     connect(body1Combo, QOverload<int>::of(&QComboBox::activated), this, &MainWindow::updateDistance);
     connect(body2Combo, QOverload<int>::of(&QComboBox::activated), this, &MainWindow::updateDistance);
@@ -147,28 +332,36 @@ MainWindow::MainWindow(QWidget* parent)
     selectorLayout->addWidget(new QLabel("Body 2:"));
     selectorLayout->addWidget(body2Combo);
     selectorLayout->addWidget(distanceLabel);
+    profilerPane = new ProfilerPane();
+    selectorLayout->addWidget(profilerPane);
     selectorLayout->addStretch();
     selectorWidget->setMaximumWidth(220);
 
+    orbitView = new OrbitView();
+
     topSplitter = new QSplitter(Qt::Horizontal);
+    topSplitter->addWidget(orbitView);
     topSplitter->addWidget(propertiesTable);
     topSplitter->addWidget(selectorWidget);
-    topSplitter->setSizes({ 900, 220 });
+    topSplitter->setSizes({ 500, 500, 220 });
 
     logView->setReadOnly(true);
     logView->setFont(QFont("Courier New", 10));
-    logView->append("🌌 Gravity Simulator Log\n");
+    // Oldest lines are dropped past this, so appends stay cheap however long the run
+    logView->setMaximumBlockCount(LOG_VIEW_LINES);
+    logView->appendPlainText("🌌 Gravity Simulator Log\n");
 
     // --- Speed Slider with aligned labels ---
     QGroupBox* sliderBox = new QGroupBox("Speed");
     speedSlider = new QSlider(Qt::Vertical);
-    speedSlider->setRange(0, 4);
+    speedSlider->setRange(0, 5);
     speedSlider->setTickPosition(QSlider::TicksBothSides);
     speedSlider->setTickInterval(1);
     speedSlider->setSingleStep(1);
     speedSlider->setPageStep(1);
     speedSlider->setFixedHeight(200);
 
+    QLabel* labelMax = new QLabel("max");
     QLabel* label10 = new QLabel("10");
     QLabel* label50 = new QLabel("50");
     QLabel* label250 = new QLabel("250");
@@ -176,6 +369,7 @@ MainWindow::MainWindow(QWidget* parent)
     QLabel* label1000 = new QLabel("1000");
 
     auto center = Qt::AlignHCenter | Qt::AlignVCenter;
+    labelMax->setAlignment(center);
     label10->setAlignment(center);
     label50->setAlignment(center);
     label250->setAlignment(center);
@@ -184,7 +378,7 @@ MainWindow::MainWindow(QWidget* parent)
 
     QFont smallFont = font();
     smallFont.setPointSize(8);
-    for (auto* lbl : { label10, label50, label250, label500, label1000 }) {
+    for (auto* lbl : { labelMax, label10, label50, label250, label500, label1000 }) {
         lbl->setFont(smallFont);
         lbl->setFixedWidth(30);
     }
@@ -193,7 +387,8 @@ MainWindow::MainWindow(QWidget* parent)
     sliderLayout->setSpacing(5);
 
     QVBoxLayout* labelsLayout = new QVBoxLayout();
-    labelsLayout->setSpacing(38);
+    labelsLayout->setSpacing(26);
+    labelsLayout->addWidget(labelMax);
     labelsLayout->addWidget(label10);
     labelsLayout->addWidget(label50);
     labelsLayout->addWidget(label250);
@@ -212,11 +407,8 @@ MainWindow::MainWindow(QWidget* parent)
     speedSlider->setValue(intervalToSliderPos(50));
 
     // Connect slider
-    connect(speedSlider, &QSlider::valueChanged, this, [this](int pos) {
-        int interval = sliderPosToInterval(pos);
-        if (isRunning) {
-            timer->start(interval);
-        }
+    connect(speedSlider, &QSlider::valueChanged, this, [this](int) {
+        applySpeed();
         });
 
     // --- Combine log and slider horizontally (same height) ---
@@ -231,7 +423,7 @@ MainWindow::MainWindow(QWidget* parent)
     mainSplitter = new QSplitter(Qt::Vertical);
     mainSplitter->addWidget(topSplitter);
     mainSplitter->addWidget(logAndSliderWidget);
-    mainSplitter->setSizes({ 350, 250 });
+    mainSplitter->setSizes({ 500, 200 });
 
     // --- Control Buttons ---
     pauseButton = new QPushButton("⏹ Stop");
@@ -244,15 +436,32 @@ MainWindow::MainWindow(QWidget* parent)
         setWindowTitle("Gravity Simulator — Setup");
         restartButton->setEnabled(false);
         isRunning = false;
+        timer->stop();
+        worker->stop();
+        snapshot = nullptr;
+        updatePropertiesTable(nullptr);
         });
 
     QHBoxLayout* controlLayout = new QHBoxLayout();
     controlLayout->addWidget(pauseButton);
     controlLayout->addWidget(restartButton);
 
+    // --- Timeline: dragging back replays from the keyframes, Resume returns to the live run ---
+    timelineSlider = new QSlider(Qt::Horizontal);
+    timelineSlider->setEnabled(false);
+    timelineLabel = new QLabel();
+    timelineLabel->setFont(QFont("Courier New", 10));
+    timelineLabel->setMinimumWidth(360);
+    connect(timelineSlider, &QSlider::valueChanged, this, &MainWindow::scrubTimeline);
+
+    QHBoxLayout* timelineLayout = new QHBoxLayout();
+    timelineLayout->addWidget(timelineSlider, 1);
+    timelineLayout->addWidget(timelineLabel);
+
     // --- Final sim page layout ---
     QVBoxLayout* simLayout = new QVBoxLayout(simPage);
     simLayout->addLayout(controlLayout);
+    simLayout->addLayout(timelineLayout);
     simLayout->addWidget(mainSplitter);
 
     // --- Main Stack ---
@@ -260,17 +469,18 @@ MainWindow::MainWindow(QWidget* parent)
     stack->addWidget(setupPage);
     stack->addWidget(simPage);
     setCentralWidget(stack);
-    resize(1400, 700);
+    resize(1400, 800);
     setWindowTitle("Gravity Simulator — Setup");
 
     resetToDefault();
 
+    // ~60 Hz: the UI samples whatever the worker has published last
     timer = new QTimer(this);
-    connect(timer, &QTimer::timeout, this, &MainWindow::onSimulationStep);
+    connect(timer, &QTimer::timeout, this, &MainWindow::onDisplayRefresh);
 }
 
 MainWindow::~MainWindow() {
-    delete sim;
+    delete worker; // joins the stepping thread
 }
 
 void MainWindow::addBodyRow() {
@@ -285,6 +495,61 @@ void MainWindow::resetToDefault() {
     bodiesTable->setRowCount(2);
     setBodyRow(0, 5.97e24, 6.37e6, 0, 0, 0, 0);
     setBodyRow(1, 1000, 1, 7.37e6, 0, 0, 7500);
+    bulkBodies.clear();
+    bulkBodies.shrink_to_fit();
+    showBulkBodies();
+}
+
+void MainWindow::importBodyList() {
+    QString path = QFileDialog::getOpenFileName(this, "Import bodies", QString(),
+        "Body lists (*.csv *.txt *.bin);;All files (*)");
+    if (path.isEmpty()) return;
+
+    std::vector<Body> bodies;
+    std::string error;
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    const bool ok = loadBodyList(path.toStdString(), bodies, error, threadsSpin->value());
+    QApplication::restoreOverrideCursor();
+    if (!ok) {
+        QMessageBox::warning(this, "Import bodies", QString::fromStdString(error));
+        return;
+    }
+    if (bodies.empty()) {
+        QMessageBox::warning(this, "Import bodies", path + " has no bodies");
+        return;
+    }
+    bulkBodies = std::move(bodies);
+    showBulkBodies();
+}
+
+void MainWindow::generateBulkBodies() {
+    GeneratorSpec spec;
+    std::string error;
+    const QString text = generatorCombo->currentText() + " " + generatorEdit->text();
+    if (!parseGenerator(text.toStdString(), spec, error)) {
+        QMessageBox::warning(this, "Generate bodies", QString::fromStdString(error));
+        return;
+    }
+
+    std::vector<Body> bodies;
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    generateBodies(spec, bodies, threadsSpin->value());
+    QApplication::restoreOverrideCursor();
+    bulkBodies = std::move(bodies);
+    showBulkBodies();
+}
+
+// The table for hand-made setups, or the summary of the bulk list
+void MainWindow::showBulkBodies() {
+    const bool bulk = !bulkBodies.empty();
+    bodiesTable->setVisible(!bulk);
+    addBodyButton->setEnabled(!bulk);
+    removeBodyButton->setEnabled(!bulk);
+    bulkSummaryLabel->setVisible(bulk);
+    if (bulk) {
+        bulkSummaryLabel->setText(QString::fromStdString(summarizeBodies(bulkBodies).describe())
+            + "\n(Reset to Default returns to the table)");
+    }
 }
 
 void MainWindow::setBodyRow(int row, double mass, double rad, double x, double y, double vx, double vy) {
@@ -297,49 +562,150 @@ void MainWindow::setBodyRow(int row, double mass, double rad, double x, double y
 }
 
 void MainWindow::startSimulation() {
-    delete sim;
-    sim = new Simulation();
+    auto sim = std::make_unique<Simulation>();
 
     bool ok;
     double dt = dtEdit->text().toDouble(&ok);
     if (!ok || dt <= 0) dt = 10.0;
     sim->dt = dt;
+    simDt = dt;
+
+    long long maxStepsInput = maxStepsEdit->text().toLongLong(&ok);
+    long long maxSteps = (ok && maxStepsInput > 0) ? maxStepsInput : 0;
+
+    sim->setIntegrator(static_cast<IntegratorType>(integratorCombo->currentData().toInt()));
+    sim->solver = static_cast<ForceSolver>(solverCombo->currentData().toInt());
+    sim->collisionPolicy = static_cast<CollisionPolicy>(collisionCombo->currentData().toInt());
+    double theta = thetaEdit->text().toDouble(&ok);
+    sim->tree.theta = (ok && theta >= 0) ? theta : 0.5;
+    sim->fmm.theta = sim->tree.theta;
+    sim->fmm.order = fmmOrderSpin->value();
+    sim->softening.type = static_cast<SofteningType>(softeningCombo->currentData().toInt());
+    double eps = softeningEdit->text().toDouble(&ok);
+    sim->softening.length = (ok && eps > 0) ? eps : 0;
+
+    static const Precision precisions[] = { Precision::LongDouble, Precision::Double, Precision::Float };
+    sim->precision = precisions[std::max(0, precisionCombo->currentIndex())];
+    double nearRadius = nearRadiusEdit->text().toDouble(&ok);
+    sim->nearRadius = (ok && nearRadius > 0) ? nearRadius : 0;
+    sim->nearPrecision = static_cast<Precision>(nearPrecisionCombo->currentData().toInt());
+    sim->threads = threadsSpin->value();
+    sim->order.every = sortEverySpin->value();
+    if (sim->integrator->type() == IntegratorType::BlockTimestep
+        && (sim->solver != ForceSolver::Direct || sim->precision != Precision::LongDouble)) {
+        appendToLog("Block time steps need the direct sum in long double precision");
+        return;
+    }
+
+    if (!bulkBodies.empty()) {
+        sim->bodies.reserve(bulkBodies.size());
+        for (const Body& b : bulkBodies) sim->addBody(b);
+    }
+    else {
+        for (int i = 0; i < bodiesTable->rowCount(); ++i) {
+            auto readCell = [&](int col) -> double {
+                QTableWidgetItem* item = bodiesTable->item(i, col);
+                if (!item) return 0.0;
+                QString text = item->text();
+                bool ok; double v = text.toDouble(&ok);
+                return ok ? v : 0.0;
+                };
+            Body b(readCell(0), readCell(1), { readCell(2), readCell(3) }, { readCell(4), readCell(5) });
+            sim->addBody(b);
+        }
+    }
+
+    launch(std::move(sim), maxSteps);
+}
+
+void MainWindow::loadCheckpointFile() {
+    QString path = QFileDialog::getOpenFileName(this, "Load checkpoint", QString(), "Checkpoints (*.ckp);;All files (*)");
+    if (path.isEmpty()) return;
+
+    // The checkpoint holds the whole state, so the setup fields (and the table) are skipped
+    auto sim = std::make_unique<Simulation>();
+    std::string error;
+    if (!loadCheckpoint(path.toStdString(), *sim, error)) {
+        QMessageBox::warning(this, "Load checkpoint", QString::fromStdString(error));
+        return;
+    }
+    simDt = static_cast<double>(sim->dt);
+
+    bool ok;
+    long long maxStepsInput = maxStepsEdit->text().toLongLong(&ok);
+    long long maxSteps = (ok && maxStepsInput > 0) ? maxStepsInput : 0;
+
+    appendToLog(QString("Restarting from %1 at step %2").arg(path).arg(sim->stepCount));
+    launch(std::move(sim), maxSteps);
+}
 
-    int maxStepsInput = maxStepsEdit->text().toInt(&ok);
-    maxSteps = (ok && maxStepsInput > 0) ? maxStepsInput : INT_MAX;
+void MainWindow::launch(std::unique_ptr<Simulation> sim, long long maxSteps) {
+    QString trajectoryPath = trajectoryEdit->text().trimmed();
+    if (!trajectoryPath.isEmpty()) {
+        sim->trajectory.reset(new TrajectoryWriter());
+        sim->trajectoryEvery = trajectoryEverySpin->value();
+        std::string error;
+        if (sim->trajectory->open(trajectoryPath.toStdString(), trajectoryFloatCheck->isChecked(), error)) {
+            sim->trajectory->record(*sim);
+            appendToLog("Recording trajectory to " + trajectoryPath);
+        }
+        else {
+            sim->trajectory.reset();
+            appendToLog(QString("Trajectory not recorded: %1").arg(QString::fromStdString(error)));
+        }
+    }
 
-    for (int i = 0; i < bodiesTable->rowCount(); ++i) {
-        auto readCell = [&](int col) -> double {
-            QTableWidgetItem* item = bodiesTable->item(i, col);
-            if (!item) return 0.0;
-            QString text = item->text();
-            bool ok; double v = text.toDouble(&ok);
-            return ok ? v : 0.0;
-            };
-        Body b(readCell(0), readCell(1), { readCell(2), readCell(3) }, { readCell(4), readCell(5) });
-        sim->addBody(b);
+    QString checkpointPath = checkpointEdit->text().trimmed();
+    if (!checkpointPath.isEmpty()) {
+        sim->checkpointer.reset(new BackgroundCheckpointer(checkpointPath.toStdString()));
+        sim->checkpointEvery = checkpointEverySpin->value();
+        appendToLog(QString("Checkpoint every %1 steps to %2").arg(sim->checkpointEvery).arg(checkpointPath));
+    }
+
+    QString logPath = logFileEdit->text().trimmed();
+    if (!logPath.isEmpty()) {
+        std::string error;
+        if (worker->log.openFile(logPath.toStdString(), error)) appendToLog("Writing the log to " + logPath);
+        else appendToLog(QString("Log file not written: %1").arg(QString::fromStdString(error)));
+    }
+    else {
+        worker->log.closeFile();
     }
 
     stack->setCurrentWidget(simPage);
     setWindowTitle("Gravity Simulator — Running");
-    stepCount = 0;
-    lastLogTime = -logInterval;
+    sim->diagnostics.every = diagnosticsEverySpin->value();
     isRunning = true;
     pauseButton->setText("⏹ Stop");
     restartButton->setEnabled(false);
-    timer->start(sliderPosToInterval(speedSlider->value()));
+
+    snapshot = nullptr;
+    updatePropertiesTable(nullptr);
+    profilerPane->reset();
+    orbitView->reset();
+    ++currentRun;
+    applySpeed();
+    {
+        QSignalBlocker block(timelineSlider);
+        timelineSlider->setRange(0, 0);
+    }
+    timelineSlider->setEnabled(false);
+    timelineLabel->clear();
+    worker->start(std::move(sim), maxSteps, logInterval,
+        static_cast<size_t>(replayBudgetSpin->value()) << 20, replaySpillEdit->text().trimmed().toStdString());
+    timer->start(16);
 }
 
 void MainWindow::togglePause() {
     if (isRunning) {
-        timer->stop();
+        worker->pause();
         pauseButton->setText("▶ Resume");
         restartButton->setEnabled(true);
         isRunning = false;
     }
     else {
-        int interval = sliderPosToInterval(speedSlider->value());
-        timer->start(interval);
+        applySpeed();
+        worker->resume();
         pauseButton->setText("⏹ Stop");
         restartButton->setEnabled(false);
         isRunning = true;
@@ -347,33 +713,29 @@ void MainWindow::togglePause() {
     pauseButton->setStyleSheet(isRunning ? "background-color: #ffebee;" : "background-color: #e8f5e9;");
 }
 
-void MainWindow::updatePropertiesTable(const Simulation& sim) {
-    propertiesTable->setRowCount(static_cast<int>(sim.bodies.size()));
-    for (size_t i = 0; i < sim.bodies.size(); ++i) {
-        const auto& b = sim.bodies[i];
-        int row = static_cast<int>(i);
-        propertiesTable->setItem(row, 0, new QTableWidgetItem(QString::number(i)));
-        propertiesTable->setItem(row, 1, new QTableWidgetItem(formatDouble(b.mass)));
-        propertiesTable->setItem(row, 2, new QTableWidgetItem(b.position.toString()));
-        propertiesTable->setItem(row, 3, new QTableWidgetItem(b.velocity.toString()));
-        propertiesTable->setItem(row, 4, new QTableWidgetItem(b.acceleration.toString()));
-    }
+void MainWindow::updatePropertiesTable(const SimulationSnapshot* snap) {
+    // rowAt() is -1 below the last row, which the model reads as "to the end"
+    bodyModel->setSnapshot(snap, propertiesTable->rowAt(0), propertiesTable->rowAt(propertiesTable->viewport()->height() - 1));
+    if (!snap) return;
 
     int prev1 = body1Combo->currentIndex();
     int prev2 = body2Combo->currentIndex();
 
-    if (body1Combo->count() != static_cast<int>(sim.bodies.size())) {
+    const int n = static_cast<int>(snap->bodies.size());
+    if (body1Combo->count() != n) {
+        QStringList names;
+        names.reserve(n);
+        for (int i = 0; i < n; ++i) {
+            names.append(QString("Body %1").arg(i));
+        }
         body1Combo->clear();
         body2Combo->clear();
-        for (size_t i = 0; i < sim.bodies.size(); ++i) {
-            QString name = QString("Body %1").arg(i);
-            body1Combo->addItem(name);
-            body2Combo->addItem(name);
-        }
-        if (sim.bodies.size() >= 2) {
-            int i1 = (prev1 >= 0 && prev1 < static_cast<int>(sim.bodies.size())) ? prev1 : 0;
-            int i2 = (prev2 >= 0 && prev2 < static_cast<int>(sim.bodies.size()) && prev2 != i1) ? prev2 : 1;
-            if (i1 == i2 && sim.bodies.size() > 1) i2 = (i1 + 1) % sim.bodies.size();
+        body1Combo->addItems(names);
+        body2Combo->addItems(names);
+        if (n >= 2) {
+            int i1 = (prev1 >= 0 && prev1 < n) ? prev1 : 0;
+            int i2 = (prev2 >= 0 && prev2 < n && prev2 != i1) ? prev2 : 1;
+            if (i1 == i2) i2 = (i1 + 1) % n;
             body1Combo->setCurrentIndex(i1);
             body2Combo->setCurrentIndex(i2);
         }
@@ -382,56 +744,98 @@ void MainWindow::updatePropertiesTable(const Simulation& sim) {
 }
 
 void MainWindow::updateDistance() {
-    if (!sim || sim->bodies.size() < 2) {
+    if (!snapshot || snapshot->bodies.size() < 2) {
         distanceLabel->setText("Distance: —");
         return;
     }
     int i1 = body1Combo->currentIndex();
     int i2 = body2Combo->currentIndex();
-    if (i1 < 0 || i2 < 0 || i1 >= static_cast<int>(sim->bodies.size()) ||
-        i2 >= static_cast<int>(sim->bodies.size()) || i1 == i2) {
+    if (i1 < 0 || i2 < 0 || i1 >= static_cast<int>(snapshot->bodies.size()) ||
+        i2 >= static_cast<int>(snapshot->bodies.size()) || i1 == i2) {
         distanceLabel->setText("Distance: —");
         return;
     }
-    LD d = Physics::calculateDistance(sim->bodies[i1], sim->bodies[i2]);
+    LD d = Physics::calculateDistance(snapshot->bodies[i1], snapshot->bodies[i2]);
     distanceLabel->setText(QString("Distance: %1 m").arg(formatDouble(d)));
 }
 
-void MainWindow::onSimulationStep() {
-    if (stepCount >= maxSteps) {
-        timer->stop();
+void MainWindow::onDisplayRefresh() {
+    drainLog();
+    if (!worker->poll()) return;
+    PROFILE_SCOPE(ProfilePhase::UiUpdate);
+    // poll() recycled the previous front snapshot, so the old pointer must not be kept
+    const SimulationSnapshot& snap = worker->snapshot();
+    if (snap.run != currentRun) { // left over from the previous simulation
+        snapshot = nullptr;
+        updatePropertiesTable(nullptr);
+        return;
+    }
+    snapshot = &snap;
+
+    updatePropertiesTable(snapshot);
+    profilerPane->onSnapshot(snap);
+    orbitView->onSnapshot(snap);
+    updateTimeline(snap);
+
+    // The worker logs the finish itself
+    if (snap.finished && isRunning) {
         pauseButton->setText("▶ Resume");
         restartButton->setEnabled(true);
         isRunning = false;
-        appendToLog("⏹ Simulation finished (max steps reached).");
+    }
+}
+
+// Follows the live step, or shows the replayed one; left alone while the user drags it
+void MainWindow::updateTimeline(const SimulationSnapshot& snap) {
+    if (snap.replayFirst < 0) {
+        timelineSlider->setEnabled(false);
+        timelineLabel->setText("Replay off");
         return;
     }
-    sim->step();
-    stepCount++;
-    updatePropertiesTable(*sim);
-
-    if (sim->time - lastLogTime >= logInterval) {
-        lastLogTime = sim->time;
-        appendToLog(QString("t = %1 s").arg(sim->time, 0, 'f', 1));
-        for (size_t i = 0; i < sim->bodies.size(); ++i) {
-            const auto& b = sim->bodies[i];
-            double speed = std::sqrt(b.velocity.x * b.velocity.x + b.velocity.y * b.velocity.y);
-            double acc = std::sqrt(b.acceleration.x * b.acceleration.x + b.acceleration.y * b.acceleration.y);
-            appendToLog(QString("  [%1] pos=%2, vel=%3, acc=%4, |v|=%5, |a|=%6")
-                .arg(static_cast<int>(i))
-                .arg(b.position.toString())
-                .arg(b.velocity.toString())
-                .arg(b.acceleration.toString())
-                .arg(formatDouble(speed))
-                .arg(formatDouble(acc)));
-        }
-        appendToLog("-----");
+    timelineSlider->setEnabled(snap.replayLast > snap.replayFirst);
+    if (!timelineSlider->isSliderDown()) {
+        const long long span = snap.replayLast - snap.replayFirst;
+        timelineFirst = snap.replayFirst;
+        timelineStride = std::max(1LL, (span + INT_MAX - 1) / INT_MAX);
+        QSignalBlocker block(timelineSlider);
+        timelineSlider->setRange(0, static_cast<int>(span / timelineStride));
+        timelineSlider->setValue(static_cast<int>((snap.stepCount - timelineFirst) / timelineStride));
+    }
+    timelineLabel->setText(QString("%1 step %2 of %3, t = %4 s")
+        .arg(snap.replayed ? "replay" : "live  ")
+        .arg(snap.stepCount)
+        .arg(snap.replayLast)
+        .arg(static_cast<double>(snap.time), 0, 'g', 6));
+}
+
+// Moving the timeline pauses the live run; Resume continues it from where it was
+void MainWindow::scrubTimeline(int value) {
+    worker->seek(timelineFirst + static_cast<long long>(value) * timelineStride);
+    if (isRunning) {
+        pauseButton->setText("▶ Resume");
+        pauseButton->setStyleSheet("background-color: #e8f5e9;");
+        restartButton->setEnabled(true);
+        isRunning = false;
     }
 }
 
+// Lines from the UI go through the pipeline too, so they reach the log file in order
 void MainWindow::appendToLog(const QString& text) {
-    logView->append(text);
-    QTextCursor c = logView->textCursor();
-    c.movePosition(QTextCursor::End);
-    logView->setTextCursor(c);
+    worker->log.note(text.toStdString());
+}
+
+// Everything formatted since the last refresh, as one append
+void MainWindow::drainLog() {
+    logLines.clear();
+    const size_t skipped = worker->log.take(logLines, LOG_VIEW_LINES);
+    if (logLines.empty()) return;
+
+    QString text;
+    if (skipped > 0) text = QString("(%1 lines not shown)\n").arg(skipped);
+    for (size_t i = 0; i < logLines.size(); ++i) {
+        if (i > 0) text += '\n';
+        text += QString::fromStdString(logLines[i]);
+    }
+    // Keeps following the end unless the user scrolled up
+    logView->appendPlainText(text);
 }
\ No newline at end of file
@@ -1,8 +1,9 @@
-﻿#pragma once
+#pragma once
 
 #include <QMainWindow>
 #include <QTableWidget>
-#include <QTextEdit>
+#include <QTableView>
+#include <QPlainTextEdit>
 #include <QSplitter>
 #include <QTimer>
 #include <QComboBox>
@@ -11,8 +12,18 @@
 #include <QLineEdit>
 #include <QStackedWidget>
 #include <QSlider>
+#include <QSpinBox>
+#include <QCheckBox>
 
+#include <memory>
+
+#include "body.h"
 class Simulation;
+class SimulationWorker;
+class BodyTableModel;
+class ProfilerPane;
+class OrbitView;
+struct SimulationSnapshot;
 
 class MainWindow : public QMainWindow
 {
@@ -23,20 +34,29 @@ public:
     ~MainWindow();
 
 public slots:
-    void onSimulationStep();
+    void onDisplayRefresh();
     void updateDistance();
     void togglePause();
     void startSimulation();
+    void loadCheckpointFile();
     void addBodyRow();
     void resetToDefault();
     void removeSelectedBody();
+    void importBodyList();
+    void generateBulkBodies();
+    void scrubTimeline(int value);
 
 private:
-    void updatePropertiesTable(const Simulation& sim);
+    void launch(std::unique_ptr<Simulation> sim, long long maxSteps);
+    void updatePropertiesTable(const SimulationSnapshot* snap);
     void appendToLog(const QString& text);
+    void drainLog();
+    void updateTimeline(const SimulationSnapshot& snap);
     int intervalToSliderPos(int interval);
     int sliderPosToInterval(int pos);
+    void applySpeed();
     QString formatDouble(double value);
+    void showBulkBodies();
 
     // UI Pages
     QStackedWidget* stack;
@@ -46,29 +66,64 @@ private:
     // Setup Page UI
     QLineEdit* dtEdit;
     QLineEdit* maxStepsEdit;
+    QComboBox* integratorCombo;
+    QComboBox* solverCombo;
+    QComboBox* collisionCombo;
+    QLineEdit* thetaEdit;
+    QSpinBox* fmmOrderSpin;
+    QComboBox* softeningCombo;
+    QLineEdit* softeningEdit;
+    QComboBox* precisionCombo;
+    QLineEdit* nearRadiusEdit;
+    QComboBox* nearPrecisionCombo;
+    QSpinBox* threadsSpin;
+    QSpinBox* sortEverySpin;
+    QLineEdit* trajectoryEdit;
+    QSpinBox* trajectoryEverySpin;
+    QCheckBox* trajectoryFloatCheck;
+    QLineEdit* checkpointEdit;
+    QSpinBox* checkpointEverySpin;
+    QLineEdit* logFileEdit;
+    QSpinBox* diagnosticsEverySpin;
+    QSpinBox* replayBudgetSpin;
+    QLineEdit* replaySpillEdit;
     QPushButton* startButton;
+    QPushButton* addBodyButton;
+    QPushButton* removeBodyButton;
+    QComboBox* generatorCombo;
+    QLineEdit* generatorEdit;
+    QLabel* bulkSummaryLabel;
 
     // Simulation Page UI
     QSplitter* mainSplitter;
     QSplitter* topSplitter;
-    QTableWidget* propertiesTable;
-    QTextEdit* logView;
+    OrbitView* orbitView;
+    QTableView* propertiesTable;
+    BodyTableModel* bodyModel;
+    QPlainTextEdit* logView;
     QComboBox* body1Combo;
     QComboBox* body2Combo;
     QLabel* distanceLabel;
+    ProfilerPane* profilerPane;
     QPushButton* pauseButton;
     QPushButton* restartButton;
     QSlider* speedSlider;
+    QSlider* timelineSlider;
+    QLabel* timelineLabel;
 
     // Logic
-    Simulation* sim;
-    QTimer* timer;
-    int stepCount;
-    int maxSteps;
-    double logInterval;
-    double lastLogTime;
+    SimulationWorker* worker;            // owns the Simulation and steps it on its own thread
+    const SimulationSnapshot* snapshot;  // latest state from the worker, nullptr before the first one
+    QTimer* timer;                       // display refresh, independent of the step rate
+    int currentRun;
+    double simDt;
+    double logInterval;  // simulated seconds between body listings in the log
+    std::vector<std::string> logLines; // reused by drainLog()
     bool isRunning;
+    long long timelineFirst = 0;  // step at slider position 0
+    long long timelineStride = 1; // steps per slider position, so that long runs fit in an int
 
     QTableWidget* bodiesTable;
+    std::vector<Body> bulkBodies; // imported or generated; replaces the table while not empty
     void setBodyRow(int row, double mass, double rad, double x, double y, double vx, double vy);
 };
\ No newline at end of file
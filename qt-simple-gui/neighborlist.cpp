@@ -0,0 +1,68 @@
+﻿#include "neighborlist.h"
+#include <algorithm>
+
+static uint64_t packCell(int32_t ix, int32_t iy) {
+    return (static_cast<uint64_t>(static_cast<uint32_t>(ix)) << 32) | static_cast<uint32_t>(iy);
+}
+
+bool NeighborList::update(const std::vector<Body>& bodies, LD newCutoff) {
+    const LD newSkin = skin > 0 ? skin : newCutoff / 4;
+    bool stale = newCutoff != cutoff || newSkin != builtSkin || reference.size() != bodies.size();
+
+    // Half the skin: two bodies moving towards each other may close it together
+    const LD limit = newSkin / 2;
+    for (size_t i = 0; i < bodies.size() && !stale; ++i) {
+        Vec2 d = bodies[i].position - reference[i];
+        stale = d.dot(d) > limit * limit;
+    }
+    if (!stale) {
+        ++reuses;
+        return false;
+    }
+
+    cutoff = newCutoff;
+    builtSkin = newSkin;
+    build(bodies);
+    return true;
+}
+
+// Uniform grid with cells of cutoff + skin, sorted by cell: every close pair
+// lies in the same or in neighbouring cells. O(N log N)
+void NeighborList::build(const std::vector<Body>& bodies) {
+    const size_t n = bodies.size();
+    const LD reach = cutoff + builtSkin;
+    reference.resize(n);
+    cells.resize(n);
+    list.clear();
+
+    const LD bound = static_cast<LD>(1 << 30);
+    auto cell = [&](LD v) {
+        LD c = std::floor(v / reach);
+        return static_cast<int32_t>(std::max(std::min(c, bound), -bound));
+    };
+    for (size_t i = 0; i < n; ++i) {
+        reference[i] = bodies[i].position;
+        cells[i] = { packCell(cell(bodies[i].position.x), cell(bodies[i].position.y)), static_cast<int>(i) };
+    }
+    std::sort(cells.begin(), cells.end());
+
+    for (size_t i = 0; i < n; ++i) {
+        const Vec2& p = bodies[i].position;
+        const int32_t cx = cell(p.x), cy = cell(p.y);
+        for (int32_t dx = -1; dx <= 1; ++dx) {
+            for (int32_t dy = -1; dy <= 1; ++dy) {
+                const uint64_t key = packCell(cx + dx, cy + dy);
+                auto first = std::lower_bound(cells.begin(), cells.end(), std::make_pair(key, 0));
+                for (auto it = first; it != cells.end() && it->first == key; ++it) {
+                    const int j = it->second;
+                    if (j <= static_cast<int>(i)) continue;
+                    Vec2 d = bodies[j].position - p;
+                    if (d.dot(d) < reach * reach) list.emplace_back(static_cast<int>(i), j);
+                }
+            }
+        }
+    }
+    // Same order whatever the grid: the near field is summed in list order
+    std::sort(list.begin(), list.end());
+    ++rebuilds;
+}
\ No newline at end of file
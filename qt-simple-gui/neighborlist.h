@@ -0,0 +1,34 @@
+#pragma once
+#include "helpers.h"
+#include "body.h"
+#include <cstdint>
+#include <utility>
+
+// Verlet neighbour list: every pair (i < j) that was closer than cutoff + skin
+// when the list was built. While no body has moved more than skin / 2 since then,
+// the list still contains every pair closer than cutoff, so update() keeps it and
+// only checks the displacements: O(N) per step instead of a new grid search.
+//
+// Used for the near field of the split force evaluations (see Simulation::nearRadius);
+// callers filter the pairs by their current distance.
+class NeighborList {
+public:
+    LD skin = 0; // m; 0 = a quarter of the cutoff
+
+    // Returns true if the list had to be rebuilt
+    bool update(const std::vector<Body>& bodies, LD cutoff);
+
+    const std::vector<std::pair<int, int>>& pairs() const { return list; }
+    LD builtCutoff() const { return cutoff; }
+
+    long long rebuilds = 0; // grid searches actually done
+    long long reuses = 0;   // updates that kept the list
+
+private:
+    std::vector<std::pair<int, int>> list;
+    std::vector<Vec2> reference;                 // positions at the last build
+    std::vector<std::pair<uint64_t, int>> cells; // (packed cell, body), sorted
+    LD cutoff = -1, builtSkin = 0;
+
+    void build(const std::vector<Body>& bodies);
+};
\ No newline at end of file
@@ -0,0 +1,204 @@
+﻿#include "orbitrenderer.h"
+#include <algorithm>
+
+static const uint32_t BACKGROUND = 0xff0b0e14;
+
+// Splat weights: the current frame, and the newest trail frame (fading linearly to 1)
+static const uint32_t CURRENT_WEIGHT = 256;
+static const uint32_t TRAIL_WEIGHT = 96;
+
+OrbitRenderer::OrbitRenderer() {
+    // Logarithmic in the accumulated weight: one body is clearly visible, a crowded pixel
+    // saturates only at about 64 bodies. Background, blue, light blue, white
+    struct Stop { float t, r, g, b; };
+    static const Stop stops[] = {
+        { 0.0f, 11, 14, 20 }, { 0.15f, 30, 50, 120 }, { 0.45f, 80, 150, 255 }, { 0.75f, 200, 225, 255 }, { 1.0f, 255, 255, 255 },
+    };
+    const float top = std::log1p((PALETTE - 1) * 4 / 24.0f);
+    for (int k = 0; k < PALETTE; ++k) {
+        const float t = std::log1p(k * 4 / 24.0f) / top;
+        int s = 1;
+        while (s < 4 && stops[s].t < t) ++s;
+        const Stop& a = stops[s - 1];
+        const Stop& b = stops[s];
+        const float f = (t - a.t) / (b.t - a.t);
+        auto channel = [f](float x, float y) { return static_cast<uint32_t>(x + (y - x) * f + 0.5f); };
+        palette[k] = 0xff000000 | channel(a.r, b.r) << 16 | channel(a.g, b.g) << 8 | channel(a.b, b.b);
+    }
+    palette[0] = BACKGROUND;
+}
+
+void OrbitRenderer::reset() {
+    bodyCount = 0;
+    frames = 0;
+    head = 0;
+    needsFit = true;
+}
+
+void OrbitRenderer::setSize(int width, int height) {
+    viewWidth = std::max(width, 0);
+    viewHeight = std::max(height, 0);
+    pixelBuffer.assign(static_cast<size_t>(viewWidth) * viewHeight, BACKGROUND);
+    accum.assign(pixelBuffer.size(), 0);
+}
+
+void OrbitRenderer::push(const std::vector<Body>& bodies) {
+    const size_t n = bodies.size();
+    LD mass = 0, sumX = 0, sumY = 0;
+    for (const Body& b : bodies) {
+        mass += b.mass;
+        sumX += b.mass * b.position.x;
+        sumY += b.mass * b.position.y;
+    }
+    const LD cx = mass > 0 ? sumX / mass : 0;
+    const LD cy = mass > 0 ? sumY / mass : 0;
+
+    if (n != bodyCount || frames == 0) {
+        // First frame, or bodies merged: the old trails no longer line up
+        bodyCount = n;
+        capacity = std::max(trailLength, 0) + 1;
+        ring.assign(static_cast<size_t>(capacity) * 2 * n, 0.0f);
+        radius.resize(n);
+        frames = 0;
+        head = 0;
+        anchorX = cx;
+        anchorY = cy;
+    }
+    comX = cx - anchorX;
+    comY = cy - anchorY;
+
+    float* slot = &ring[static_cast<size_t>(head) * 2 * n];
+    for (size_t i = 0; i < n; ++i) {
+        slot[2 * i] = static_cast<float>(bodies[i].position.x - anchorX);
+        slot[2 * i + 1] = static_cast<float>(bodies[i].position.y - anchorY);
+        radius[i] = static_cast<float>(bodies[i].radius);
+    }
+    head = (head + 1) % capacity;
+    frames = std::min(frames + 1, capacity);
+
+    if (needsFit) fit();
+}
+
+void OrbitRenderer::fit() {
+    if (frames == 0 || viewWidth == 0 || viewHeight == 0) {
+        needsFit = true;
+        return;
+    }
+    needsFit = false;
+
+    // Distance from the center of mass plus the body radius, so a planet stays inside.
+    // In double: squared galactic distances overflow a float
+    const float* p = frame(0);
+    const double cx = static_cast<double>(comX), cy = static_cast<double>(comY);
+    scratch.resize(bodyCount);
+    for (size_t i = 0; i < bodyCount; ++i) {
+        const double dx = p[2 * i] - cx, dy = p[2 * i + 1] - cy;
+        scratch[i] = std::sqrt(dx * dx + dy * dy) + radius[i];
+    }
+    const size_t trim = bodyCount >= 200 ? bodyCount / 200 : 0;
+    LD extent = 0;
+    if (bodyCount > 0) {
+        auto k = scratch.begin() + (bodyCount - 1 - trim);
+        std::nth_element(scratch.begin(), k, scratch.end());
+        extent = *k;
+    }
+    if (!(extent > 0) || !std::isfinite(static_cast<double>(extent))) extent = 1;
+
+    viewX = anchorX + comX;
+    viewY = anchorY + comY;
+    scale = std::min(viewWidth, viewHeight) / (2.2L * extent);
+}
+
+void OrbitRenderer::zoom(double factor, double px, double py) {
+    const LD wx = viewX + (px - viewWidth / 2.0) / scale;
+    const LD wy = viewY - (py - viewHeight / 2.0) / scale;
+    scale *= factor;
+    viewX = wx - (px - viewWidth / 2.0) / scale;
+    viewY = wy + (py - viewHeight / 2.0) / scale;
+}
+
+void OrbitRenderer::pan(double dx, double dy) {
+    viewX -= dx / scale;
+    viewY += dy / scale;
+}
+
+bool OrbitRenderer::render() {
+    discList.clear();
+    for (auto& t : trailList) t.clear();
+    visible = 0;
+    framesUsed = 0;
+    if (pixelBuffer.empty()) return false;
+    if (frames == 0) {
+        std::fill(pixelBuffer.begin(), pixelBuffer.end(), BACKGROUND);
+        return false;
+    }
+
+    // Pixel of a ring point: (x * s + bx, by - y * s)
+    const float s = static_cast<float>(scale);
+    const float bx = static_cast<float>(viewWidth / 2.0L - (viewX - anchorX) * scale);
+    const float by = static_cast<float>(viewHeight / 2.0L + (viewY - anchorY) * scale);
+    const float w = static_cast<float>(viewWidth), h = static_cast<float>(viewHeight);
+
+    const float* p = frame(0);
+    for (size_t i = 0; i < bodyCount; ++i) {
+        const float x = p[2 * i] * s + bx, y = by - p[2 * i + 1] * s;
+        visible += x >= 0 && x < w && y >= 0 && y < h;
+    }
+
+    if (visible > splatThreshold) {
+        splat(s, bx, by);
+        return true;
+    }
+    std::fill(pixelBuffer.begin(), pixelBuffer.end(), BACKGROUND);
+    sprites(s, bx, by);
+    return false;
+}
+
+void OrbitRenderer::splat(float s, float bx, float by) {
+    const size_t perFrame = std::max<size_t>(bodyCount, 1);
+    framesUsed = static_cast<int>(std::max<size_t>(1, std::min<size_t>(frames, splatBudget / perFrame)));
+    std::fill(accum.begin(), accum.end(), 0);
+
+    const float w = static_cast<float>(viewWidth), h = static_cast<float>(viewHeight);
+    for (int age = framesUsed - 1; age >= 0; --age) {
+        const uint32_t weight = age == 0 ? CURRENT_WEIGHT : 1 + TRAIL_WEIGHT * (framesUsed - age) / framesUsed;
+        const float* p = frame(age);
+        for (size_t i = 0; i < bodyCount; ++i) {
+            const float x = p[2 * i] * s + bx, y = by - p[2 * i + 1] * s;
+            // Written so that NaN positions are culled too
+            if (!(x >= 0 && x < w && y >= 0 && y < h)) continue;
+            accum[static_cast<int>(y) * viewWidth + static_cast<int>(x)] += weight;
+        }
+    }
+
+    for (size_t k = 0; k < accum.size(); ++k) {
+        pixelBuffer[k] = palette[std::min<uint32_t>(accum[k] >> 2, PALETTE - 1)];
+    }
+}
+
+void OrbitRenderer::sprites(float s, float bx, float by) {
+    framesUsed = frames;
+    const float w = static_cast<float>(viewWidth), h = static_cast<float>(viewHeight);
+
+    const float* p = frame(0);
+    for (size_t i = 0; i < bodyCount; ++i) {
+        const float x = p[2 * i] * s + bx, y = by - p[2 * i + 1] * s;
+        const float r = std::max(1.5f, radius[i] * s);
+        if (!(x + r >= 0 && x - r < w && y + r >= 0 && y - r < h)) continue;
+        discList.push_back({ x, y, r });
+    }
+
+    trailList.resize(std::max(frames - 1, 0));
+    for (int age = 1; age < frames; ++age) {
+        const float* newer = frame(age - 1);
+        const float* older = frame(age);
+        auto& list = trailList[age - 1];
+        for (size_t i = 0; i < bodyCount; ++i) {
+            const Segment seg = { newer[2 * i] * s + bx, by - newer[2 * i + 1] * s, older[2 * i] * s + bx, by - older[2 * i + 1] * s };
+            // Culled when both ends are beyond the same edge
+            if (std::max(seg.x1, seg.x2) < 0 || std::min(seg.x1, seg.x2) >= w) continue;
+            if (std::max(seg.y1, seg.y2) < 0 || std::min(seg.y1, seg.y2) >= h) continue;
+            list.push_back(seg);
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,75 @@
+#pragma once
+#include "helpers.h"
+#include "body.h"
+#include <cstdint>
+
+// CPU rasterizer behind the orbit view, kept free of Qt so the benchmarks can time it.
+//
+// push() records the positions of one display frame in a ring of the last trailLength + 1
+// frames (float, relative to an anchor near the bodies). render() culls against the
+// viewport and picks a level of detail from the number of bodies in view:
+// - up to splatThreshold: sprite lists (discs, and trail segments grouped by age) that the
+//   widget draws with one batched QPainter pass over pixels();
+// - above it: density splatting straight into pixels(), one point per body and frame,
+//   older trail frames at lower weight, through a logarithmic color table.
+class OrbitRenderer {
+public:
+    struct Disc { float x, y, r; };
+    struct Segment { float x1, y1, x2, y2; };
+
+    int trailLength = 24;            // frames behind the current one; takes effect on the next reset()
+    size_t splatThreshold = 3000;    // bodies in view above which density splatting is used
+    size_t splatBudget = 2000000;    // points splatted per frame at most; the oldest trail frames go first
+
+    OrbitRenderer();
+
+    void reset(); // forget the trails and fit the view to the next frame
+    void setSize(int width, int height);
+    void push(const std::vector<Body>& bodies);
+
+    // View: world point at the center of the viewport and pixels per meter, y pointing up
+    void fit(); // center of mass, with 99.5% of the bodies in view (all of them below 200)
+    void zoom(double factor, double px, double py); // keeps the world point under pixel (px, py)
+    void pan(double dx, double dy);                 // pixels
+    LD pixelsPerMeter() const { return scale; }
+
+    // Returns true if the frame was splatted (pixels() is complete), false for sprites
+    bool render();
+
+    const uint32_t* pixels() const { return pixelBuffer.data(); } // 0xAARRGGBB, row-major
+    uint32_t* pixels() { return pixelBuffer.data(); }
+    int width() const { return viewWidth; }
+    int height() const { return viewHeight; }
+
+    const std::vector<Disc>& discs() const { return discList; }
+    const std::vector<std::vector<Segment>>& trails() const { return trailList; } // [age - 1], newest first
+    size_t visibleCount() const { return visible; }
+    int trailFrames() const { return framesUsed; } // frames drawn by the last render(), current included
+
+private:
+    static constexpr int PALETTE = 4096;
+
+    int viewWidth = 0, viewHeight = 0;
+    LD viewX = 0, viewY = 0, scale = 1;
+    bool needsFit = true;
+
+    std::vector<float> ring; // capacity frames of (x, y) per body
+    std::vector<float> radius;
+    size_t bodyCount = 0;
+    int capacity = 0, head = 0, frames = 0;
+    LD anchorX = 0, anchorY = 0;
+    LD comX = 0, comY = 0; // of the latest frame, relative to the anchor
+
+    std::vector<uint32_t> pixelBuffer;
+    std::vector<uint32_t> accum;
+    uint32_t palette[PALETTE];
+    std::vector<Disc> discList;
+    std::vector<std::vector<Segment>> trailList;
+    std::vector<double> scratch;
+    size_t visible = 0;
+    int framesUsed = 0;
+
+    const float* frame(int age) const { return &ring[static_cast<size_t>((head - 1 - age + capacity) % capacity) * 2 * bodyCount]; }
+    void splat(float s, float bx, float by);
+    void sprites(float s, float bx, float by);
+};
\ No newline at end of file
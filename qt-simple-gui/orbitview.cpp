@@ -0,0 +1,144 @@
+﻿#include "orbitview.h"
+#include "snapshot.h"
+#include "profiler.h"
+
+#include <QElapsedTimer>
+#include <QFont>
+#include <QImage>
+#include <QMouseEvent>
+#include <QPainter>
+#include <QWheelEvent>
+#include <cmath>
+
+OrbitView::OrbitView(QWidget* parent)
+    : QWidget(parent)
+{
+    setMinimumSize(300, 300);
+    // Every pixel is painted from the image, nothing to erase first
+    setAttribute(Qt::WA_OpaquePaintEvent);
+    setCursor(Qt::OpenHandCursor);
+}
+
+void OrbitView::reset() {
+    renderer.reset();
+    time = 0;
+    dirty = true;
+    update();
+}
+
+void OrbitView::onSnapshot(const SimulationSnapshot& snap) {
+    renderer.push(snap.bodies);
+    time = static_cast<double>(snap.time);
+    dirty = true;
+    update();
+}
+
+void OrbitView::renderFrame() {
+    PROFILE_SCOPE(ProfilePhase::Render);
+    QElapsedTimer clock;
+    clock.start();
+
+    splatted = renderer.render();
+    if (!splatted) {
+        // Sprites go over the cleared buffer in one pass: trails oldest first, then the bodies
+        QImage image(reinterpret_cast<uchar*>(renderer.pixels()), renderer.width(), renderer.height(), QImage::Format_RGB32);
+        QPainter painter(&image);
+        painter.setRenderHint(QPainter::Antialiasing);
+
+        const auto& trails = renderer.trails();
+        const int ages = static_cast<int>(trails.size());
+        for (int a = ages - 1; a >= 0; --a) {
+            if (trails[a].empty()) continue;
+            lines.resize(0);
+            lines.reserve(static_cast<int>(trails[a].size()));
+            for (const auto& s : trails[a]) lines.append(QLineF(s.x1, s.y1, s.x2, s.y2));
+            const int alpha = 30 + 170 * (ages - a) / ages;
+            painter.setPen(QPen(QColor(120, 170, 255, alpha), 1.0));
+            painter.drawLines(lines);
+        }
+
+        painter.setPen(Qt::NoPen);
+        painter.setBrush(QColor(235, 240, 255));
+        for (const auto& d : renderer.discs()) painter.drawEllipse(QPointF(d.x, d.y), d.r, d.r);
+    }
+
+    renderMs = clock.nsecsElapsed() / 1e6;
+    dirty = false;
+}
+
+void OrbitView::paintEvent(QPaintEvent*) {
+    if (renderer.width() != width() || renderer.height() != height()) {
+        renderer.setSize(width(), height());
+        dirty = true;
+    }
+    if (dirty) renderFrame();
+
+    QPainter painter(this);
+    painter.drawImage(0, 0, QImage(reinterpret_cast<const uchar*>(renderer.pixels()), renderer.width(), renderer.height(), QImage::Format_RGB32));
+    drawOverlay(painter);
+}
+
+// Time, counts and render cost in the top left corner, a scale bar in the bottom left
+void OrbitView::drawOverlay(QPainter& painter) {
+    painter.setPen(QColor(180, 190, 210));
+    painter.setFont(QFont("Courier New", 9));
+    painter.drawText(8, 16, QString("t = %1 s").arg(time, 0, 'g', 6));
+    painter.drawText(8, 30, QString("%1 in view, %2, %3 ms")
+        .arg(renderer.visibleCount())
+        .arg(splatted ? "density" : "sprites")
+        .arg(renderMs, 0, 'f', 1));
+
+    // Longest 1, 2 or 5 x 10^k meters that fits in 120 pixels
+    const double metersPerPixel = 1.0 / static_cast<double>(renderer.pixelsPerMeter());
+    if (!(metersPerPixel > 0) || !std::isfinite(metersPerPixel)) return;
+    const double target = 120 * metersPerPixel;
+    const double decade = std::pow(10.0, std::floor(std::log10(target)));
+    double length = decade;
+    for (double m : { 2.0, 5.0 }) {
+        if (m * decade <= target) length = m * decade;
+    }
+    const int pixels = static_cast<int>(length / metersPerPixel);
+    const int y = height() - 12;
+    painter.drawLine(8, y, 8 + pixels, y);
+    painter.drawLine(8, y - 3, 8, y + 3);
+    painter.drawLine(8 + pixels, y - 3, 8 + pixels, y + 3);
+    painter.drawText(8, y - 6, QString("%1 m").arg(length, 0, 'g', 3));
+}
+
+void OrbitView::resizeEvent(QResizeEvent*) {
+    renderer.setSize(width(), height());
+    dirty = true;
+}
+
+void OrbitView::wheelEvent(QWheelEvent* event) {
+    // One notch (120) zooms by 1.25
+    const double factor = std::pow(1.25, event->angleDelta().y() / 120.0);
+    renderer.zoom(factor, event->position().x(), event->position().y());
+    dirty = true;
+    update();
+    event->accept();
+}
+
+void OrbitView::mousePressEvent(QMouseEvent* event) {
+    lastMouse = event->pos();
+    setCursor(Qt::ClosedHandCursor);
+}
+
+void OrbitView::mouseMoveEvent(QMouseEvent* event) {
+    if (!(event->buttons() & Qt::LeftButton)) return;
+    const QPoint delta = event->pos() - lastMouse;
+    lastMouse = event->pos();
+    renderer.pan(delta.x(), delta.y());
+    dirty = true;
+    update();
+}
+
+void OrbitView::mouseReleaseEvent(QMouseEvent*) {
+    setCursor(Qt::OpenHandCursor);
+}
+
+void OrbitView::mouseDoubleClickEvent(QMouseEvent*) {
+    renderer.fit();
+    dirty = true;
+    update();
+}
\ No newline at end of file
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <QWidget>
+#include <QPoint>
+#include <QVector>
+#include <QLineF>
+
+#include "orbitrenderer.h"
+
+struct SimulationSnapshot;
+
+// Live picture of the bodies with fading trails, redrawn for every new snapshot.
+// The frame is rendered on the CPU into one QImage (see OrbitRenderer for the level
+// of detail) and only when something changed; plain repaints just copy it.
+// Wheel zooms around the cursor, dragging pans, a double click fits the view again.
+class OrbitView : public QWidget
+{
+public:
+    explicit OrbitView(QWidget* parent = nullptr);
+
+    // New run: forget the trails and fit the view to the first snapshot
+    void reset();
+    // Called for every new snapshot; copies the positions, the snapshot is not kept
+    void onSnapshot(const SimulationSnapshot& snap);
+
+protected:
+    void paintEvent(QPaintEvent* event) override;
+    void resizeEvent(QResizeEvent* event) override;
+    void wheelEvent(QWheelEvent* event) override;
+    void mousePressEvent(QMouseEvent* event) override;
+    void mouseMoveEvent(QMouseEvent* event) override;
+    void mouseReleaseEvent(QMouseEvent* event) override;
+    void mouseDoubleClickEvent(QMouseEvent* event) override;
+
+private:
+    OrbitRenderer renderer;
+    bool dirty = true;     // the image no longer matches the bodies or the view
+    bool splatted = false; // level of detail of the last frame
+    double renderMs = 0;
+    double time = 0;
+    QPoint lastMouse;
+    QVector<QLineF> lines; // reused for the trail batches
+
+    void renderFrame();
+    void drawOverlay(QPainter& painter);
+};
\ No newline at end of file
@@ -0,0 +1,176 @@
+#pragma once
+#include "bodystore.h"
+#include "forcekernel.h"
+#include "threadpool.h"
+#include <algorithm>
+#include <type_traits>
+
+// Multithreaded direct sum on the SoA store.
+// Each pair is visited once (j > i) and both bodies get their share (Newton's third law).
+// The i-range is cut into tiles with equal pair counts and the tiles are run on a work-stealing pool.
+//
+// Every tile writes into its own accumulation buffer, so there are no atomics;
+// the buffers are then summed per body in tile order. The tiling depends on N only,
+// which makes the result bit-identical for any number of threads, one included.
+// Tile t buffers the bodies from its first row on, so large N gets fewer tiles:
+// all buffers together stay within MAX_BUFFERED values per component.
+// The optional potential (sum of m_i m_j / r over the pairs) is summed per tile the same way,
+// in long double, and so is the optional near-pair list (see ForceKernel::NearPairs),
+// concatenated in tile order.
+// 'plummer' is a Plummer softening length in m, as for ForceKernel::directSum.
+// double and float tiles run on the vector unit 'isa' (ForceKernel::symmetricRows),
+// long double tiles on the scalar loop below.
+template <typename T>
+class ParallelDirectSum {
+public:
+    static constexpr size_t MAX_TILES = 64;
+    static constexpr size_t MIN_ROWS_PER_TILE = 16;
+    static constexpr size_t MAX_BUFFERED = size_t(1) << 22;
+
+    void compute(BodyStore<T>& s, ThreadPool& pool, LD* potential = nullptr, ForceKernel::NearPairs* near = nullptr,
+                 LD plummer = 0, ForceKernel::Isa isa = ForceKernel::Isa::Scalar) {
+        const size_t n = s.size();
+        makeTiles(n);
+        const size_t tiles = bounds.size() - 1;
+
+        const T cut = near ? s.nearDistanceSquared(near->radius) : s.minDistanceSquared();
+        const T eps2 = s.softeningSquared(plummer);
+        runTiles(s, pool, tiles, isa, cut, eps2, potential != nullptr, near != nullptr, std::is_same<T, LD>());
+        if (near) {
+            near->pairs.clear();
+            for (size_t t = 0; t < tiles; ++t) near->pairs.insert(near->pairs.end(), tileNear[t].begin(), tileNear[t].end());
+        }
+        if (potential) {
+            LD sum = 0;
+            for (size_t t = 0; t < tiles; ++t) sum += tileEnergy[t];
+            *potential = sum;
+        }
+
+        // Reduction, also in parallel: each chunk of bodies sums the tile buffers in tile order
+        const size_t chunk = 1024;
+        pool.run((n + chunk - 1) / chunk, [&](size_t c, int) {
+            size_t kEnd = std::min(n, (c + 1) * chunk);
+            for (size_t k = c * chunk; k < kEnd; ++k) {
+                T sx = 0, sy = 0;
+                for (size_t t = 0; t < tiles && bounds[t] <= k; ++t) {
+                    sx += accX[t][k - bounds[t]];
+                    sy += accY[t][k - bounds[t]];
+                }
+                s.ax[k] = sx;
+                s.ay[k] = sy;
+            }
+        });
+    }
+
+private:
+    std::vector<size_t> bounds; // tile t covers rows [bounds[t], bounds[t + 1])
+    std::vector<std::vector<T>> accX, accY; // tile t buffer covers bodies [bounds[t], n)
+    std::vector<LD> tileEnergy;
+    std::vector<std::vector<std::pair<int, int>>> tileNear;
+
+    void makeTiles(size_t n) {
+        size_t tiles = std::max<size_t>(1, std::min({ MAX_TILES, n / MIN_ROWS_PER_TILE, MAX_BUFFERED / std::max<size_t>(n, 1) }));
+        bounds.assign(tiles + 1, n);
+        bounds[0] = 0;
+
+        // Row i has (n - 1 - i) pairs; place the cuts so that all tiles have the same number of pairs
+        const double nn = static_cast<double>(n);
+        const double totalPairs = nn * (nn - 1) / 2;
+        for (size_t t = 1; t < tiles; ++t) {
+            double target = totalPairs * t / tiles;
+            double row = nn - std::sqrt(std::max(0.0, nn * nn - 2 * target));
+            bounds[t] = std::min(n, std::max(bounds[t - 1], static_cast<size_t>(row)));
+        }
+
+        accX.resize(tiles);
+        accY.resize(tiles);
+        tileEnergy.resize(tiles);
+        tileNear.resize(tiles);
+    }
+
+    // double and float: ForceKernel::symmetricRows on the vector unit
+    void runTiles(BodyStore<T>& s, ThreadPool& pool, size_t tiles, ForceKernel::Isa isa, T cut, T eps2, bool potential,
+                  bool split, std::false_type) {
+        pool.run(tiles, [&](size_t t, int) { tileEnergy[t] = vectorTile(s, isa, t, cut, eps2, potential, split); });
+    }
+
+    // long double: computeTile below
+    void runTiles(BodyStore<T>& s, ThreadPool& pool, size_t tiles, ForceKernel::Isa, T cut, T eps2, bool potential,
+                  bool split, std::true_type) {
+        if (potential) selectSplit<true>(s, pool, tiles, cut, eps2, split);
+        else selectSplit<false>(s, pool, tiles, cut, eps2, split);
+    }
+
+    template <bool Potential>
+    void selectSplit(BodyStore<T>& s, ThreadPool& pool, size_t tiles, T cut, T eps2, bool split) {
+        if (split) selectPlummer<Potential, true>(s, pool, tiles, cut, eps2);
+        else selectPlummer<Potential, false>(s, pool, tiles, cut, eps2);
+    }
+
+    template <bool Potential, bool Split>
+    void selectPlummer(BodyStore<T>& s, ThreadPool& pool, size_t tiles, T cut, T eps2) {
+        if (eps2 > 0) pool.run(tiles, [&](size_t t, int) { tileEnergy[t] = computeTile<Potential, Split, true>(s, t, cut, eps2); });
+        else pool.run(tiles, [&](size_t t, int) { tileEnergy[t] = computeTile<Potential, Split, false>(s, t, cut, eps2); });
+    }
+
+    LD vectorTile(BodyStore<T>& s, ForceKernel::Isa isa, size_t t, const T cut, const T eps2, bool potential, bool split) {
+        const size_t begin = bounds[t];
+        tileNear[t].clear();
+        accX[t].assign(s.size() - begin, T(0));
+        accY[t].assign(s.size() - begin, T(0));
+        return ForceKernel::symmetricRows(s, isa, begin, bounds[t + 1], cut, eps2, accX[t].data(), accY[t].data(),
+                                          potential, split ? &tileNear[t] : nullptr);
+    }
+
+    // Returns the tile's share of the potential (0 without Potential).
+    // Pairs with r2 <= cut are dropped; with Split they are also listed in tileNear[t].
+    // With Plummer r2 + eps2 takes the place of r2 in the force and the potential.
+    template <bool Potential, bool Split, bool Plummer>
+    T computeTile(BodyStore<T>& s, size_t t, const T cut, const T eps2) {
+        const size_t n = s.size();
+        const size_t begin = bounds[t], end = bounds[t + 1];
+        if (Split) tileNear[t].clear();
+
+        std::vector<T>& bx = accX[t];
+        std::vector<T>& by = accY[t];
+        bx.assign(n - begin, T(0));
+        by.assign(n - begin, T(0));
+
+        const T* x = s.x.data();
+        const T* y = s.y.data();
+        const T* m = s.mass.data();
+        T* rx = bx.data(); // rx[k] belongs to body begin + k
+        T* ry = by.data();
+        T energy = 0;
+
+        for (size_t i = begin; i < end; ++i) {
+            const T xi = x[i], yi = y[i], mi = m[i];
+            T axi = 0, ayi = 0, phii = 0, dropped = 0;
+            for (size_t j = i + 1; j < n; ++j) {
+                T dx = x[j] - xi;
+                T dy = y[j] - yi;
+                T r2 = dx * dx + dy * dy;
+                T inv = T(1) / std::sqrt(Plummer ? r2 + eps2 : r2);
+                T inv3 = r2 > cut ? inv * inv * inv : T(0); // select, not branch: keeps the loop vectorizable
+                axi += m[j] * inv3 * dx;
+                ayi += m[j] * inv3 * dy;
+                rx[j - begin] -= mi * inv3 * dx;
+                ry[j - begin] -= mi * inv3 * dy;
+                if (Potential) phii += r2 > cut ? m[j] * inv : T(0);
+                if (Split) dropped += r2 > cut ? T(0) : T(1);
+            }
+            if (Split && dropped > 0) {
+                // Rare: find the dropped pairs again with the same arithmetic
+                for (size_t j = i + 1; j < n; ++j) {
+                    T dx = x[j] - xi;
+                    T dy = y[j] - yi;
+                    if (!(dx * dx + dy * dy > cut)) tileNear[t].emplace_back(static_cast<int>(i), static_cast<int>(j));
+                }
+            }
+            rx[i - begin] += axi;
+            ry[i - begin] += ayi;
+            if (Potential) energy += mi * phii;
+        }
+        return energy;
+    }
+};
@@ -1,35 +1,202 @@
 ﻿#include "physics.h"
 #include "simulation.h"
 #include "helpers.h"
+#include "profiler.h"
 #include <cmath>
+#include <algorithm>
+
+// Every solver fills sim.potentialEnergy from its own force loop when sim.computePotential is set
 
 void Physics::computeAccelerations(Simulation& sim) {
-    size_t n = sim.bodies.size();
+    directSum(sim.bodies, sim.computePotential ? &sim.potentialEnergy : nullptr, sim.softening);
+}
+
+// Near field of a split evaluation: adds the listed pairs, with 'radius' > 0 only those
+// closer than that (the same test the tree walk uses to skip them).
+// The separation is taken from the long double positions, so two close bodies far from
+// the origin keep all their digits; T only sets the precision of the force itself.
+template <typename T>
+static void addNearField(Simulation& sim, const std::vector<std::pair<int, int>>& pairs, LD radius) {
+    const T g = static_cast<T>(Physics::G);
+    const SofteningLaw<T> law(sim.softening);
+    T energy = 0; // sum of m_i m_j / r
+    for (const auto& pair : pairs) {
+        Body& a = sim.bodies[pair.first];
+        Body& b = sim.bodies[pair.second];
+        Vec2 d = b.position - a.position;
+        const LD distance = d.norm();
+        if (distance < MIN_NUMBER || (radius > 0 && !(distance < radius))) continue;
+
+        const T dx = static_cast<T>(d.x), dy = static_cast<T>(d.y);
+        const T r = std::sqrt(dx * dx + dy * dy);
+        const T inv3 = g * law.inverseCube(r);
+        const T ma = static_cast<T>(a.mass), mb = static_cast<T>(b.mass);
+        a.acceleration += Vec2{ static_cast<LD>(mb * inv3 * dx), static_cast<LD>(mb * inv3 * dy) };
+        b.acceleration -= Vec2{ static_cast<LD>(ma * inv3 * dx), static_cast<LD>(ma * inv3 * dy) };
+        if (sim.computePotential) energy += ma * mb * law.inverse(r);
+    }
+    if (sim.computePotential) sim.potentialEnergy -= Physics::G * static_cast<LD>(energy);
+}
+
+// Split radius of the solver: the user's near radius (Barnes-Hut, SIMD direct sum)
+// or the spline support, whichever is larger; 0 = no split
+static LD splitRadius(const Simulation& sim, bool useNearRadius) {
+    LD radius = useNearRadius ? sim.nearRadius : 0;
+    if (sim.softening.enabled() && sim.softening.type == SofteningType::Spline) {
+        radius = std::max(radius, sim.softening.range());
+    }
+    return radius;
+}
+
+// Plummer length for the vector kernels; the spline goes through the split instead
+static LD plummerLength(const Simulation& sim) {
+    return sim.softening.enabled() && sim.softening.type == SofteningType::Plummer ? sim.softening.length : 0;
+}
+
+void Physics::computeAccelerationsBarnesHut(Simulation& sim) {
+    LD* potential = sim.computePotential ? &sim.potentialEnergy : nullptr;
+    const LD radius = splitRadius(sim, true);
+    sim.tree.softening = sim.softening;
+    sim.tree.nearRadius = radius;
+    // The tree is rebuilt every step, but its nodes come from the same arena
+    sim.tree.build(sim.bodies);
+    if (sim.threads > 1) {
+        sim.tree.computeAccelerations(sim.bodies, sim.threadPool(), potential);
+    }
+    else {
+        sim.tree.computeAccelerations(sim.bodies, potential);
+    }
+    if (radius > 0) {
+        // The neighbour list only has to be searched again once bodies have crossed its skin
+        sim.neighbors.update(sim.bodies, radius);
+        addNearField<LD>(sim, sim.neighbors.pairs(), radius);
+    }
+}
+
+void Physics::computeAccelerationsFmm(Simulation& sim) {
+    LD* potential = sim.computePotential ? &sim.potentialEnergy : nullptr;
+    sim.fmm.softening = sim.softening;
+    if (sim.threads > 1) {
+        sim.fmm.computeAccelerations(sim.bodies, sim.threadPool(), potential);
+    }
+    else {
+        sim.fmm.computeAccelerations(sim.bodies, potential);
+    }
+}
+
+// The pair list of a split direct sum, or null when every pair stays in the kernel.
+// The O(N^2) kernel visits every pair anyway, so it lists them itself; no neighbour search needed.
+static ForceKernel::NearPairs* nearPairs(Simulation& sim) {
+    const LD radius = splitRadius(sim, sim.precision != Precision::LongDouble);
+    if (!(radius > 0)) return nullptr;
+    sim.nearPairs.radius = radius;
+    return &sim.nearPairs;
+}
 
-    // Resetting acceleration
-    // Without resetting the simulation goes wrong
-    for (auto& body : sim.bodies) {
-        body.acceleration = { 0, 0 };
+static void addNearField(Simulation& sim) {
+    if (sim.nearPrecision == Precision::Double) addNearField<double>(sim, sim.nearPairs.pairs, 0);
+    else addNearField<LD>(sim, sim.nearPairs.pairs, 0);
+}
+
+void Physics::computeAccelerationsSoA(Simulation& sim) {
+    // Gather/scatter are O(N), the kernel itself is O(N^2)
+    ForceKernel::NearPairs* near = nearPairs(sim);
+    const LD plummer = plummerLength(sim);
+    if (sim.precision == Precision::Float) {
+        float pairs = 0;
+        sim.storeFloat.gather(sim.bodies);
+        ForceKernel::directSum(sim.storeFloat, sim.isa, sim.computePotential ? &pairs : nullptr, near, plummer);
+        sim.storeFloat.scatterAccelerations(sim.bodies, G);
+        if (sim.computePotential) sim.potentialEnergy = pairs * sim.storeFloat.potentialScale(G);
     }
+    else {
+        double pairs = 0;
+        sim.storeDouble.gather(sim.bodies);
+        ForceKernel::directSum(sim.storeDouble, sim.isa, sim.computePotential ? &pairs : nullptr, near, plummer);
+        sim.storeDouble.scatterAccelerations(sim.bodies, G);
+        if (sim.computePotential) sim.potentialEnergy = pairs * sim.storeDouble.potentialScale(G);
+    }
+    if (near) addNearField(sim);
+}
 
-    // Each body is attracted to all the other bodies
-    for (size_t i = 0; i < n; ++i) {
-        for (size_t j = 0; j < n; ++j) {
-            if (i == j) continue;
+template <typename T>
+static void parallelDirectSum(Simulation& sim, BodyStore<T>& store, ParallelDirectSum<T>& kernel) {
+    LD pairs = 0;
+    ForceKernel::NearPairs* near = nearPairs(sim);
+    store.gather(sim.bodies);
+    kernel.compute(store, sim.threadPool(), sim.computePotential ? &pairs : nullptr, near, plummerLength(sim), sim.isa);
+    store.scatterAccelerations(sim.bodies, Physics::G);
+    if (sim.computePotential) sim.potentialEnergy = pairs * store.potentialScale(Physics::G);
+    if (near) addNearField(sim);
+}
+
+void Physics::computeAccelerationsParallel(Simulation& sim) {
+    switch (sim.precision) {
+    case Precision::Float:
+        parallelDirectSum(sim, sim.storeFloat, sim.parallelFloat);
+        break;
+    case Precision::Double:
+        parallelDirectSum(sim, sim.storeDouble, sim.parallelDouble);
+        break;
+    case Precision::LongDouble:
+    default:
+        parallelDirectSum(sim, sim.storeLongDouble, sim.parallelLongDouble);
+        break;
+    }
+}
 
-            const Body& source = sim.bodies[j];
-            Body& target = sim.bodies[i];
+// Only the 'active' bodies get new values, the rest are left untouched.
+// jerk = G * m * (dv / r^3 - 3 (dr . dv) dr / r^5)
+// With softening the jerk uses the Plummer form (r^2 + eps^2 for r^2) for either law:
+// it only sets the time steps.
+static void accelerationAndJerk(Simulation& sim, int i, const SofteningLaw<LD>& law, Vec2& jerk) {
+    Body& target = sim.bodies[i];
+    const bool softened = sim.softening.enabled();
+    const LD eps2 = softened ? sim.softening.length * sim.softening.length : 0;
+    Vec2 acc = { 0, 0 };
+    Vec2 jrk = { 0, 0 };
+    for (size_t j = 0; j < sim.bodies.size(); ++j) {
+        if (static_cast<int>(j) == i) continue;
+        const Body& source = sim.bodies[j];
+        Vec2 dr = source.position - target.position;
+        Vec2 dv = source.velocity - target.velocity;
+        LD r = dr.norm();
+        if (r < MIN_NUMBER) continue;
 
-            Vec2 r_vec = source.position - target.position;
-            LD r = r_vec.norm();
+        if (softened) {
+            LD s2 = r * r + eps2;
+            LD jerk3 = Physics::G * source.mass / (s2 * std::sqrt(s2));
+            LD rv = (dr.x * dv.x + dr.y * dv.y) / s2;
+            acc = acc + dr * (Physics::G * source.mass * law.inverseCube(r));
+            jrk = jrk + (dv - dr * (3 * rv)) * jerk3;
+            continue;
+        }
 
-            // Zero division prevention
-            if (r < MIN_NUMBER) continue;
+        LD inv3 = Physics::G * source.mass / (r * r * r);
+        LD rv = (dr.x * dv.x + dr.y * dv.y) / (r * r);
+        acc = acc + dr * inv3;
+        jrk = jrk + (dv - dr * (3 * rv)) * inv3;
+    }
+    target.acceleration = acc;
+    jerk = jrk;
+}
 
-            // Acceleration: a = G * M_source / r^2 * r_vec 
-            // We sum it up with the acceleration this body has
-            // from all other bodies (two 'for')
-            target.acceleration = target.acceleration + r_vec * (G * source.mass / (r * r * r));
+void Physics::computeAccelerationsAndJerks(Simulation& sim, const std::vector<int>& active, std::vector<Vec2>& jerks) {
+    PROFILE_SCOPE(ProfilePhase::Force);
+    PROFILE_COUNT(ProfileCounter::Interactions, static_cast<int64_t>(active.size()) * (static_cast<int64_t>(sim.bodies.size()) - 1));
+    const size_t tile = 64;
+    const SofteningLaw<LD> law(sim.softening);
+    if (sim.threads > 1 && active.size() > tile) {
+        sim.threadPool().run((active.size() + tile - 1) / tile, [&](size_t t, int) {
+            size_t end = std::min(active.size(), (t + 1) * tile);
+            for (size_t k = t * tile; k < end; ++k) {
+                accelerationAndJerk(sim, active[k], law, jerks[active[k]]);
+            }
+        });
+    }
+    else {
+        for (int i : active) {
+            accelerationAndJerk(sim, i, law, jerks[i]);
         }
     }
 }
@@ -1,11 +1,73 @@
 #pragma once
 #include "helpers.h"
 #include "simulation.h"
+#include "softening.h"
 
 class Physics {
 public:
     static constexpr LD G = 6.67430e-11;
 
     static void computeAccelerations(Simulation& sim);
+
+    // Exact pairwise sum in any dimension and precision; the reference 2D solver
+    // above is its <2, long double> instantiation.
+    // With 'potential' the same loop also returns the potential energy (J).
+    template <int D, typename T>
+    static void directSum(std::vector<BodyT<D, T>>& bodies, T* potential = nullptr, const Softening& softening = Softening());
+    static void computeAccelerationsBarnesHut(Simulation& sim);
+    static void computeAccelerationsFmm(Simulation& sim);
+    // Full N^2 vector kernel on one thread, for comparison; runs use the symmetric tiles of
+    // computeAccelerationsParallel at every thread count (see ParallelDirectSum)
+    static void computeAccelerationsSoA(Simulation& sim);
+    static void computeAccelerationsParallel(Simulation& sim);
+
+    // Direct sum for a subset of bodies, also returning da/dt (for time step criteria)
+    static void computeAccelerationsAndJerks(Simulation& sim, const std::vector<int>& active, std::vector<Vec2>& jerks);
     static LD calculateDistance(const Body& a, const Body& b);
-};
\ No newline at end of file
+};
+
+template <int D, typename T>
+void Physics::directSum(std::vector<BodyT<D, T>>& bodies, T* potential, const Softening& softening) {
+    using Vector = Vec<D, T>;
+    const T g = static_cast<T>(G);
+    const size_t n = bodies.size();
+    const bool softened = softening.enabled();
+    const SofteningLaw<T> law(softening);
+
+    // Resetting acceleration
+    // Without resetting the simulation goes wrong
+    for (auto& body : bodies) {
+        body.acceleration = Vector();
+    }
+
+    // Each body is attracted to all the other bodies
+    T energy = 0;
+    for (size_t i = 0; i < n; ++i) {
+        BodyT<D, T>& target = bodies[i];
+        T phi = 0; // sum of m_j / r_ij, only with 'potential'
+        for (size_t j = 0; j < n; ++j) {
+            if (i == j) continue;
+
+            const BodyT<D, T>& source = bodies[j];
+            Vector r_vec = source.position - target.position;
+            T r = r_vec.norm();
+
+            // Zero division prevention
+            if (r < static_cast<T>(MIN_NUMBER)) continue;
+
+            if (softened) {
+                target.acceleration = target.acceleration + r_vec * (g * source.mass * law.inverseCube(r));
+                if (potential) phi += source.mass * law.inverse(r);
+                continue;
+            }
+
+            // Acceleration: a = G * M_source / r^2 * r_vec
+            target.acceleration = target.acceleration + r_vec * (g * source.mass / (r * r * r));
+            if (potential) phi += source.mass / r;
+        }
+        energy += target.mass * phi;
+    }
+
+    // Every pair was visited twice
+    if (potential) *potential = -g * energy / 2;
+}
\ No newline at end of file
@@ -0,0 +1,153 @@
+﻿#include "profiler.h"
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+
+thread_local ProfileScope* ProfileScope::current = nullptr;
+
+Profiler& Profiler::instance() {
+    static Profiler profiler;
+    return profiler;
+}
+
+int64_t Profiler::now() {
+    using Clock = std::chrono::steady_clock;
+    static const Clock::time_point origin = Clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - origin).count();
+}
+
+const char* Profiler::phaseName(ProfilePhase phase) {
+    switch (phase) {
+    case ProfilePhase::Force: return "force";
+    case ProfilePhase::Integrate: return "integrate";
+    case ProfilePhase::Collision: return "collision";
+    case ProfilePhase::Sort: return "sort";
+    case ProfilePhase::Output: return "output";
+    case ProfilePhase::UiUpdate: return "ui update";
+    case ProfilePhase::Render: return "render";
+    default: return "?";
+    }
+}
+
+const char* Profiler::counterName(ProfileCounter counter) {
+    switch (counter) {
+    case ProfileCounter::Steps: return "steps";
+    case ProfileCounter::Interactions: return "interactions";
+    default: return "?";
+    }
+}
+
+// The ring is created on the thread's first event and outlives the thread,
+// so its events can still be exported after a worker has finished
+Profiler::ThreadRing& Profiler::ring() {
+    thread_local ThreadRing* mine = nullptr;
+    if (!mine) {
+        std::lock_guard<std::mutex> lock(mutex);
+        rings.push_back(std::make_unique<ThreadRing>());
+        mine = rings.back().get();
+        mine->id = static_cast<int>(rings.size());
+        mine->name = "thread " + std::to_string(mine->id);
+    }
+    return *mine;
+}
+
+void Profiler::setThreadName(const std::string& name) {
+    ThreadRing& r = ring();
+    std::lock_guard<std::mutex> lock(mutex);
+    r.name = name;
+}
+
+// Single writer per ring: plain load + store instead of read-modify-write
+static void add(std::atomic<int64_t>& value, int64_t n) {
+    value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+void Profiler::record(ProfilePhase phase, int64_t start, int64_t duration, int64_t exclusive) {
+    ThreadRing& r = ring();
+    const int p = static_cast<int>(phase);
+    const uint64_t k = r.written.load(std::memory_order_relaxed);
+    RingSlot& e = r.events[k % RING_SIZE];
+    e.sequence.store(2 * k + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release); // the odd sequence is visible before any field changes
+    e.start.store(start, std::memory_order_relaxed);
+    e.duration.store(duration, std::memory_order_relaxed);
+    e.phase.store(p, std::memory_order_relaxed);
+    e.sequence.store(2 * k + 2, std::memory_order_release);
+    r.written.store(k + 1, std::memory_order_release);
+    add(r.ns[p], exclusive);
+    add(r.calls[p], 1);
+}
+
+void Profiler::count(ProfileCounter counter, int64_t n) {
+    add(ring().counters[static_cast<int>(counter)], n);
+}
+
+ProfileTotals Profiler::totals() const {
+    ProfileTotals t;
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const auto& r : rings) {
+        for (int p = 0; p < PROFILE_PHASES; ++p) {
+            t.ns[p] += r->ns[p].load(std::memory_order_relaxed);
+            t.calls[p] += r->calls[p].load(std::memory_order_relaxed);
+        }
+        for (int c = 0; c < PROFILE_COUNTERS; ++c) {
+            t.counters[c] += r->counters[c].load(std::memory_order_relaxed);
+        }
+    }
+    return t;
+}
+
+bool Profiler::writeChromeTrace(const std::string& path, std::string& error) const {
+    std::ofstream out(path);
+    if (!out) {
+        error = "cannot create " + path;
+        return false;
+    }
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    auto separator = [&]() -> std::ostream& {
+        out << (first ? "\n" : ",\n");
+        first = false;
+        return out;
+    };
+
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const auto& r : rings) {
+        separator() << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << r->id
+            << ",\"args\":{\"name\":\"" << r->name << "\"}}";
+
+        // The owner keeps writing while we copy: keep event k only if its slot
+        // still holds k, complete, both before and after the fields are read
+        const uint64_t end = r->written.load(std::memory_order_acquire);
+        const uint64_t begin = end > RING_SIZE ? end - RING_SIZE : 0;
+        std::vector<ProfileEvent> events;
+        events.reserve(static_cast<size_t>(end - begin));
+        for (uint64_t k = begin; k < end; ++k) {
+            const RingSlot& slot = r->events[k % RING_SIZE];
+            if (slot.sequence.load(std::memory_order_acquire) != 2 * k + 2) continue;
+            ProfileEvent e;
+            e.start = slot.start.load(std::memory_order_relaxed);
+            e.duration = slot.duration.load(std::memory_order_relaxed);
+            e.phase = slot.phase.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.sequence.load(std::memory_order_relaxed) != 2 * k + 2) continue; // overwritten meanwhile
+            events.push_back(e);
+        }
+
+        for (const auto& e : events) {
+            // Microseconds with ns resolution
+            separator() << "{\"name\":\"" << phaseName(static_cast<ProfilePhase>(e.phase))
+                << "\",\"cat\":\"gravity\",\"ph\":\"X\",\"pid\":1,\"tid\":" << r->id
+                << ",\"ts\":" << e.start / 1000 << "." << std::setfill('0') << std::setw(3) << e.start % 1000
+                << ",\"dur\":" << e.duration / 1000 << "." << std::setw(3) << e.duration % 1000 << std::setfill(' ')
+                << "}";
+        }
+    }
+    out << "\n]}\n";
+
+    if (!out) {
+        error = "cannot write " + path;
+        return false;
+    }
+    return true;
+}
\ No newline at end of file
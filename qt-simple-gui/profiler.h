@@ -0,0 +1,130 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Scoped timers and counters for the hot phases of a run.
+//
+// PROFILE_SCOPE(phase) times the enclosing block, PROFILE_COUNT(counter, n) adds to a counter.
+// Both expand to nothing unless the build defines GRAVITY_PROFILING, so a normal
+// build carries no profiling code at all; the Profiler class itself always exists
+// (with empty totals) so the GUI pane and the exporters compile either way.
+//
+// When enabled, every thread writes into its own ring buffer of the most recent
+// events and its own per-phase totals: no locks and no shared cache lines on the
+// hot path. Phase totals are exclusive (a Force scope inside Integrate is not
+// counted twice), trace events keep the full nesting. Ring slots are seqlocks:
+// an exporter that catches a slot mid-write drops that event instead of waiting.
+
+enum class ProfilePhase { Force, Integrate, Collision, Sort, Output, UiUpdate, Render, Count };
+enum class ProfileCounter { Steps, Interactions, Count };
+
+constexpr int PROFILE_PHASES = static_cast<int>(ProfilePhase::Count);
+constexpr int PROFILE_COUNTERS = static_cast<int>(ProfileCounter::Count);
+
+struct ProfileEvent {
+    int64_t start = 0;    // ns since Profiler::origin()
+    int64_t duration = 0; // ns, including nested scopes
+    int32_t phase = 0;
+};
+
+struct ProfileTotals {
+    int64_t ns[PROFILE_PHASES] = {};    // exclusive time per phase
+    int64_t calls[PROFILE_PHASES] = {};
+    int64_t counters[PROFILE_COUNTERS] = {};
+};
+
+class Profiler {
+public:
+    static constexpr size_t RING_SIZE = 1 << 15; // events kept per thread
+
+#ifdef GRAVITY_PROFILING
+    static constexpr bool enabled = true;
+#else
+    static constexpr bool enabled = false;
+#endif
+
+    static Profiler& instance();
+    static int64_t now(); // ns since origin
+
+    static const char* phaseName(ProfilePhase phase);
+    static const char* counterName(ProfileCounter counter);
+
+    // Name shown for the calling thread in traces
+    void setThreadName(const std::string& name);
+
+    void record(ProfilePhase phase, int64_t start, int64_t duration, int64_t exclusive);
+    void count(ProfileCounter counter, int64_t n);
+
+    // Sums over all threads; consistent per value, not across values
+    ProfileTotals totals() const;
+
+    // Chrome trace (chrome://tracing, Perfetto) of the events still in the rings
+    bool writeChromeTrace(const std::string& path, std::string& error) const;
+
+private:
+    // 'sequence' is 2k + 1 while event k is written into the slot and 2k + 2 once it is complete
+    struct RingSlot {
+        std::atomic<uint64_t> sequence{ 0 };
+        std::atomic<int64_t> start{ 0 };
+        std::atomic<int64_t> duration{ 0 };
+        std::atomic<int32_t> phase{ 0 };
+    };
+
+    struct ThreadRing {
+        std::string name;
+        int id = 0;
+        std::vector<RingSlot> events = std::vector<RingSlot>(RING_SIZE);
+        std::atomic<uint64_t> written{ 0 };
+        // Written by the owning thread only, read by anyone
+        std::atomic<int64_t> ns[PROFILE_PHASES] = {};
+        std::atomic<int64_t> calls[PROFILE_PHASES] = {};
+        std::atomic<int64_t> counters[PROFILE_COUNTERS] = {};
+    };
+
+    mutable std::mutex mutex; // guards 'rings' (registration and readers only)
+    std::vector<std::unique_ptr<ThreadRing>> rings;
+
+    ThreadRing& ring();
+};
+
+// RAII timer behind PROFILE_SCOPE; tracks nesting per thread for exclusive times
+class ProfileScope {
+public:
+    explicit ProfileScope(ProfilePhase phase) : phase(phase), parent(current), start(Profiler::now()) {
+        current = this;
+    }
+
+    ~ProfileScope() {
+        const int64_t duration = Profiler::now() - start;
+        current = parent;
+        if (parent) parent->children += duration;
+        Profiler::instance().record(phase, start, duration, duration - children);
+    }
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    ProfilePhase phase;
+    ProfileScope* parent;
+    int64_t start;
+    int64_t children = 0;
+
+    static thread_local ProfileScope* current;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#ifdef GRAVITY_PROFILING
+#define PROFILE_SCOPE(phase) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(phase)
+#define PROFILE_COUNT(counter, n) Profiler::instance().count(counter, n)
+#else
+#define PROFILE_SCOPE(phase) ((void)0)
+#define PROFILE_COUNT(counter, n) ((void)0)
+#endif
\ No newline at end of file
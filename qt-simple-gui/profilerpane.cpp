@@ -0,0 +1,82 @@
+﻿#include "profilerpane.h"
+#include "snapshot.h"
+
+#include <QFileDialog>
+#include <QFont>
+#include <QLabel>
+#include <QMessageBox>
+#include <QPushButton>
+#include <QVBoxLayout>
+
+static const qint64 WINDOW_MS = 500;
+
+ProfilerPane::ProfilerPane(QWidget* parent)
+    : QGroupBox("Performance", parent)
+{
+    ratesLabel = new QLabel("—");
+    phasesLabel = new QLabel(Profiler::enabled ? "—" : "Phase timing: build with\nGRAVITY_PROFILING");
+    phasesLabel->setFont(QFont("Courier New", 9));
+    exportButton = new QPushButton("Export trace...");
+    exportButton->setEnabled(Profiler::enabled);
+    connect(exportButton, &QPushButton::clicked, this, [this] { exportTrace(); });
+
+    QVBoxLayout* layout = new QVBoxLayout(this);
+    layout->setContentsMargins(5, 5, 5, 5);
+    layout->addWidget(ratesLabel);
+    layout->addWidget(phasesLabel);
+    layout->addWidget(exportButton);
+}
+
+void ProfilerPane::reset() {
+    hasWindow = false;
+    ratesLabel->setText("—");
+    if (Profiler::enabled) phasesLabel->setText("—");
+}
+
+void ProfilerPane::onSnapshot(const SimulationSnapshot& snap) {
+    if (!hasWindow || snap.stepCount < windowSteps) {
+        clock.start();
+        hasWindow = true;
+        windowSteps = snap.stepCount;
+        windowEvaluations = snap.forceEvaluations;
+        windowTotals = Profiler::instance().totals();
+        return;
+    }
+    const qint64 ms = clock.elapsed();
+    if (ms < WINDOW_MS) return;
+    const double seconds = ms / 1000.0;
+
+    // Pairwise-equivalent interactions, as in the benchmark suite
+    const double n = static_cast<double>(snap.bodies.size());
+    const double steps = (snap.stepCount - windowSteps) / seconds;
+    const double interactions = (snap.forceEvaluations - windowEvaluations) * n * (n - 1) / seconds;
+    ratesLabel->setText(QString("%1 steps/s\n%2 interactions/s")
+        .arg(steps, 0, 'g', 4).arg(interactions, 0, 'g', 4));
+
+    if (Profiler::enabled) {
+        const ProfileTotals totals = Profiler::instance().totals();
+        int64_t sum = 0;
+        for (int p = 0; p < PROFILE_PHASES; ++p) sum += totals.ns[p] - windowTotals.ns[p];
+        QStringList lines;
+        for (int p = 0; p < PROFILE_PHASES; ++p) {
+            double share = sum > 0 ? 100.0 * (totals.ns[p] - windowTotals.ns[p]) / sum : 0.0;
+            lines.append(QString("%1 %2%").arg(Profiler::phaseName(static_cast<ProfilePhase>(p)), -10)
+                .arg(share, 5, 'f', 1));
+        }
+        phasesLabel->setText(lines.join('\n'));
+        windowTotals = totals;
+    }
+
+    clock.restart();
+    windowSteps = snap.stepCount;
+    windowEvaluations = snap.forceEvaluations;
+}
+
+void ProfilerPane::exportTrace() {
+    QString path = QFileDialog::getSaveFileName(this, "Export trace", "trace.json", "Chrome trace (*.json)");
+    if (path.isEmpty()) return;
+    std::string error;
+    if (!Profiler::instance().writeChromeTrace(path.toStdString(), error)) {
+        QMessageBox::warning(this, "Export trace", QString::fromStdString(error));
+    }
+}
\ No newline at end of file
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <QGroupBox>
+#include <QElapsedTimer>
+
+#include "profiler.h"
+
+class QLabel;
+class QPushButton;
+struct SimulationSnapshot;
+
+// Live statistics on the simulation page: step and interaction rates (from the
+// snapshots, so always available) and the time split between the profiled phases
+// (only in builds with GRAVITY_PROFILING). Rates are averaged over about half a second.
+class ProfilerPane : public QGroupBox
+{
+public:
+    explicit ProfilerPane(QWidget* parent = nullptr);
+
+    // Forget the previous run's window
+    void reset();
+    // Called for every new snapshot
+    void onSnapshot(const SimulationSnapshot& snap);
+
+private:
+    QLabel* ratesLabel;
+    QLabel* phasesLabel;
+    QPushButton* exportButton;
+
+    QElapsedTimer clock;
+    bool hasWindow = false;
+    long long windowSteps = 0;
+    long long windowEvaluations = 0;
+    ProfileTotals windowTotals;
+
+    void exportTrace();
+};
\ No newline at end of file
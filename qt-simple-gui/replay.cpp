@@ -0,0 +1,234 @@
+﻿#include "replay.h"
+#include "checkpoint.h"
+#include "profiler.h"
+#include "simulation.h"
+#include <algorithm>
+
+static bool seekFile(FILE* f, uint64_t offset) {
+#ifdef _WIN32
+    return _fseeki64(f, static_cast<long long>(offset), SEEK_SET) == 0;
+#else
+    return fseeko(f, static_cast<off_t>(offset), SEEK_SET) == 0;
+#endif
+}
+
+ReplayCache::ReplayCache()
+    : spillThread(&ReplayCache::spillLoop, this)
+{
+}
+
+ReplayCache::~ReplayCache() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    spillThread.join();
+    if (spillFile) {
+        std::fclose(spillFile);
+        std::remove(spillPath.c_str());
+    }
+}
+
+void ReplayCache::reset(size_t memoryBudget, const std::string& spillPath, long long keyframeEvery) {
+    std::string openError;
+    bool haveFile;
+    {
+        std::lock_guard<std::mutex> file(fileMutex);
+        if (spillFile) {
+            std::fclose(spillFile);
+            std::remove(this->spillPath.c_str());
+        }
+        spillFile = nullptr;
+        spillBytes = 0;
+        ++fileGeneration;
+        this->spillPath = spillPath;
+        if (memoryBudget > 0 && !spillPath.empty()) {
+            spillFile = std::fopen(spillPath.c_str(), "w+b");
+            if (!spillFile) openError = "cannot create " + spillPath;
+        }
+        haveFile = spillFile != nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    keyframes.clear();
+    budget = memoryBudget;
+    bytesInMemory = 0;
+    spilled = 0;
+    every = std::max(1LL, keyframeEvery);
+    spilling = haveFile;
+    spillFailure = openError;
+    first.store(-1, std::memory_order_release);
+    last.store(-1, std::memory_order_release);
+    lastKey = -1;
+    cursor.reset();
+}
+
+void ReplayCache::record(const Simulation& sim) {
+    if (budget == 0) return;
+    last.store(sim.stepCount, std::memory_order_release);
+    if (lastKey >= 0 && (sim.stepCount % every != 0 || sim.stepCount == lastKey)) return;
+
+    PROFILE_SCOPE(ProfilePhase::Output);
+    Keyframe k;
+    auto data = std::make_shared<const std::vector<char>>(serializeCheckpoint(sim));
+    k.size = data->size();
+    k.data = std::move(data);
+    k.diagnosticsEvery = sim.diagnostics.every;
+
+    bool spill = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        bytesInMemory += k.size;
+        keyframes[sim.stepCount] = std::move(k);
+        lastKey = sim.stepCount;
+        if (first.load(std::memory_order_relaxed) < 0) first.store(sim.stepCount, std::memory_order_release);
+        if (bytesInMemory > budget) {
+            if (spilling) spill = true;
+            else thin();
+        }
+    }
+    if (spill) wake.notify_all();
+}
+
+// Drops every other keyframe until the rest fit; the first and the newest always stay
+void ReplayCache::thin() {
+    while (bytesInMemory > budget && keyframes.size() > 2) {
+        every *= 2;
+        const long long newest = keyframes.rbegin()->first;
+        for (auto it = std::next(keyframes.begin()); it != keyframes.end();) {
+            if (it->first % every != 0 && it->first != newest && it->second.data) {
+                bytesInMemory -= it->second.size;
+                it = keyframes.erase(it);
+            }
+            else {
+                ++it;
+            }
+        }
+    }
+}
+
+// Oldest keyframe still in memory, other than the newest (the likeliest to be wanted)
+std::map<long long, ReplayCache::Keyframe>::iterator ReplayCache::nextToSpill() {
+    if (keyframes.size() < 2) return keyframes.end();
+    const auto newest = std::prev(keyframes.end());
+    for (auto it = keyframes.begin(); it != newest; ++it) {
+        if (it->second.data) return it;
+    }
+    return keyframes.end();
+}
+
+void ReplayCache::spillLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        wake.wait(lock, [this] {
+            return stopping || (spilling && bytesInMemory > budget && nextToSpill() != keyframes.end());
+        });
+        if (stopping) return;
+
+        auto it = nextToSpill();
+        const long long step = it->first;
+        const std::shared_ptr<const std::vector<char>> data = it->second.data;
+        lock.unlock();
+
+        bool ok;
+        uint64_t offset = 0, generation = 0;
+        {
+            std::lock_guard<std::mutex> file(fileMutex);
+            generation = fileGeneration;
+            offset = spillBytes;
+            ok = spillFile && seekFile(spillFile, offset)
+                && std::fwrite(data->data(), 1, data->size(), spillFile) == data->size()
+                && std::fflush(spillFile) == 0;
+            if (ok) spillBytes += data->size();
+        }
+
+        lock.lock();
+        uint64_t current;
+        {
+            std::lock_guard<std::mutex> file(fileMutex);
+            current = fileGeneration;
+        }
+        if (current != generation) continue; // reset() in the meantime
+        if (!ok) {
+            // Memory only from now on; the next record() thins
+            spillFailure = "cannot write the replay spill file";
+            spilling = false;
+            continue;
+        }
+        it = keyframes.find(step);
+        if (it != keyframes.end() && it->second.data == data) {
+            it->second.data.reset();
+            it->second.offset = offset;
+            bytesInMemory -= it->second.size;
+            ++spilled;
+        }
+    }
+}
+
+const Simulation* ReplayCache::seek(long long step, std::string& error, const std::atomic<bool>* interrupt) {
+    long long keyStep;
+    Keyframe key;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (keyframes.empty()) {
+            error = "nothing recorded yet";
+            return nullptr;
+        }
+        step = std::max(keyframes.begin()->first, std::min(step, last.load(std::memory_order_relaxed)));
+        auto it = std::prev(keyframes.upper_bound(step));
+        keyStep = it->first;
+        key = it->second;
+    }
+
+    // The last replayed state is at least as close as the keyframe if it lies between the two
+    if (!cursor || cursor->stepCount < keyStep || cursor->stepCount > step) {
+        std::vector<char> fromFile;
+        const std::vector<char>* image = key.data.get();
+        if (!image) {
+            fromFile.resize(static_cast<size_t>(key.size));
+            std::lock_guard<std::mutex> file(fileMutex);
+            if (!spillFile || !seekFile(spillFile, key.offset)
+                || std::fread(fromFile.data(), 1, fromFile.size(), spillFile) != fromFile.size()) {
+                error = "cannot read the replay spill file";
+                return nullptr;
+            }
+            image = &fromFile;
+        }
+        auto sim = std::make_unique<Simulation>();
+        if (!deserializeCheckpoint(image->data(), image->size(), *sim, error)) return nullptr;
+        sim->diagnostics.every = key.diagnosticsEvery;
+        cursor = std::move(sim);
+    }
+
+    while (cursor->stepCount < step && !cursor->isFinished) {
+        if (interrupt && interrupt->load(std::memory_order_acquire)) break;
+        cursor->step();
+    }
+    return cursor.get();
+}
+
+size_t ReplayCache::keyframeCount() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return keyframes.size();
+}
+
+size_t ReplayCache::spilledCount() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return spilled;
+}
+
+size_t ReplayCache::memoryBytes() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return bytesInMemory;
+}
+
+long long ReplayCache::keyframeSpacing() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return every;
+}
+
+std::string ReplayCache::spillError() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return spillFailure;
+}
\ No newline at end of file
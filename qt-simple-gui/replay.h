@@ -0,0 +1,91 @@
+#pragma once
+#include "helpers.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class Simulation;
+
+// Keyframes of a run, for going back to any earlier step.
+//
+// The stepping thread calls record() after every step. Every keyframeEvery steps it keeps
+// a checkpoint image of the whole state (serializeCheckpoint, a memcpy-sized job).
+// seek() rebuilds step k by loading the nearest keyframe at or before k and running
+// Simulation::step up to k, so a replayed step is bit-identical to the live one (the same
+// guarantee as a checkpoint restart). A seek forward from the last replayed step goes on
+// from there instead of loading a keyframe again.
+//
+// Keyframes are kept within memoryBudget bytes. Past it, with a spill file, the oldest
+// ones move to that file on a background thread. Without one, every other keyframe is
+// dropped and keyframeEvery doubles: the whole run stays reachable, a seek just re-runs
+// up to keyframeEvery steps.
+class ReplayCache {
+public:
+    ReplayCache();
+    ~ReplayCache();
+
+    ReplayCache(const ReplayCache&) = delete;
+    ReplayCache& operator=(const ReplayCache&) = delete;
+
+    // reset(), record() and seek() must not run at the same time (the worker calls all three
+    // on its thread); the accessors below can be called from anywhere.
+
+    // Forgets every keyframe. memoryBudget = 0 turns recording off; an empty spillPath thins instead of spilling
+    void reset(size_t memoryBudget, const std::string& spillPath = std::string(), long long keyframeEvery = 64);
+
+    // After every step of the live simulation (and once before the first)
+    void record(const Simulation& sim);
+
+    // Steps [firstStep(), lastStep()] can be rebuilt; both are -1 before the first record()
+    long long firstStep() const { return first.load(std::memory_order_acquire); }
+    long long lastStep() const { return last.load(std::memory_order_acquire); }
+
+    size_t keyframeCount();
+    size_t spilledCount();
+    size_t memoryBytes();
+    long long keyframeSpacing();
+    std::string spillError(); // empty while every spill succeeded
+
+    // Returns the state at 'step' (clamped to the range), valid until the next seek() or reset(),
+    // or nullptr with 'error' set. When *interrupt turns true the re-run stops early and an
+    // earlier step is returned; the next seek continues from it
+    const Simulation* seek(long long step, std::string& error, const std::atomic<bool>* interrupt = nullptr);
+
+private:
+    struct Keyframe {
+        std::shared_ptr<const std::vector<char>> data; // null once spilled
+        uint64_t offset = 0, size = 0;                 // in the spill file
+        long long diagnosticsEvery = 0;                // not part of a checkpoint
+    };
+
+    std::mutex mutex; // shared with the spill thread
+    std::condition_variable wake;
+    std::map<long long, Keyframe> keyframes;
+    size_t budget = 0, bytesInMemory = 0, spilled = 0;
+    long long every = 64;
+    bool spilling = false;
+    bool stopping = false;
+    std::string spillFailure;
+    std::atomic<long long> first{ -1 }, last{ -1 };
+    long long lastKey = -1; // record() side
+
+    std::mutex fileMutex; // the spill file, written by the spill thread and read by seek()
+    std::string spillPath; // removed again by reset() and the destructor
+    FILE* spillFile = nullptr;
+    uint64_t spillBytes = 0;
+    uint64_t fileGeneration = 0; // bumped by reset(), so a write in flight can tell
+
+    std::thread spillThread;
+    std::unique_ptr<Simulation> cursor; // the last state seek() returned
+
+    void thin();
+    std::map<long long, Keyframe>::iterator nextToSpill();
+    void spillLoop();
+};
\ No newline at end of file
@@ -0,0 +1,213 @@
+﻿#include "scenario.h"
+#include "bodylist.h"
+#include "generators.h"
+#include <fstream>
+#include <sstream>
+
+void Scenario::apply(Simulation& sim) const {
+    sim.dt = dt;
+    sim.setIntegrator(integrator);
+    sim.solver = solver;
+    sim.collisionPolicy = collisions;
+    sim.tree.theta = theta;
+    sim.fmm.theta = theta;
+    sim.fmm.order = fmmOrder;
+    sim.precision = precision;
+    sim.nearRadius = nearRadius;
+    sim.nearPrecision = nearPrecision;
+    sim.neighbors.skin = nearSkin;
+    sim.softening = softening;
+    sim.threads = threads;
+    sim.order.every = sortEvery;
+    sim.order.threshold = sortThreshold;
+    sim.trajectoryEvery = trajectoryEvery;
+    sim.checkpointEvery = checkpointEvery;
+    sim.diagnostics.every = diagnosticsEvery;
+    for (const auto& b : bodies) {
+        sim.addBody(b);
+    }
+}
+
+static bool parseIntegrator(const std::string& s, IntegratorType& out) {
+    if (s == "euler") out = IntegratorType::Euler;
+    else if (s == "verlet") out = IntegratorType::VelocityVerlet;
+    else if (s == "leapfrog") out = IntegratorType::LeapfrogKDK;
+    else if (s == "yoshida4") out = IntegratorType::Yoshida4;
+    else if (s == "dopri45") out = IntegratorType::DormandPrince45;
+    else if (s == "block") out = IntegratorType::BlockTimestep;
+    else return false;
+    return true;
+}
+
+static bool parseCollisions(const std::string& s, CollisionPolicy& out) {
+    if (s == "none") out = CollisionPolicy::None;
+    else if (s == "log") out = CollisionPolicy::Log;
+    else if (s == "stop") out = CollisionPolicy::Stop;
+    else if (s == "merge") out = CollisionPolicy::Merge;
+    else return false;
+    return true;
+}
+
+static bool parseSoftening(const std::string& s, SofteningType& out) {
+    if (s == "none") out = SofteningType::None;
+    else if (s == "plummer") out = SofteningType::Plummer;
+    else if (s == "spline") out = SofteningType::Spline;
+    else return false;
+    return true;
+}
+
+static bool parsePrecision(const std::string& s, Precision& out) {
+    if (s == "long-double") out = Precision::LongDouble;
+    else if (s == "double") out = Precision::Double;
+    else if (s == "float") out = Precision::Float;
+    else return false;
+    return true;
+}
+
+bool loadScenario(std::istream& in, Scenario& scenario, std::string& error) {
+    std::string line;
+    int lineNo = 0;
+
+    while (std::getline(in, line)) {
+        ++lineNo;
+        size_t hash = line.find('#');
+        if (hash != std::string::npos) line.erase(hash);
+
+        std::istringstream ls(line);
+        std::string key;
+        if (!(ls >> key)) continue; // empty line
+
+        bool ok = true;
+        std::string word;
+        if (key == "name") {
+            std::getline(ls >> std::ws, scenario.name);
+        }
+        else if (key == "dt") ok = static_cast<bool>(ls >> scenario.dt) && scenario.dt > 0;
+        else if (key == "steps") ok = static_cast<bool>(ls >> scenario.steps) && scenario.steps >= 0;
+        else if (key == "output-every") ok = static_cast<bool>(ls >> scenario.outputEvery) && scenario.outputEvery >= 0;
+        else if (key == "theta") ok = static_cast<bool>(ls >> scenario.theta) && scenario.theta >= 0;
+        else if (key == "fmm-order") {
+            ok = static_cast<bool>(ls >> scenario.fmmOrder) && scenario.fmmOrder >= 1
+                && scenario.fmmOrder <= FastMultipole::MAX_ORDER;
+        }
+        else if (key == "threads") ok = static_cast<bool>(ls >> scenario.threads) && scenario.threads >= 1;
+        else if (key == "sort-every") ok = static_cast<bool>(ls >> scenario.sortEvery) && scenario.sortEvery >= 0;
+        else if (key == "sort-threshold") {
+            ok = static_cast<bool>(ls >> scenario.sortThreshold) && scenario.sortThreshold >= 0 && scenario.sortThreshold <= 1;
+        }
+        else if (key == "ranks") ok = static_cast<bool>(ls >> scenario.ranks) && scenario.ranks >= 1;
+        else if (key == "transport") ok = static_cast<bool>(ls >> word) && parseTransport(word, scenario.transport);
+        else if (key == "rebalance-every") ok = static_cast<bool>(ls >> scenario.rebalanceEvery) && scenario.rebalanceEvery >= 0;
+        else if (key == "trajectory") ok = static_cast<bool>(ls >> scenario.trajectory);
+        else if (key == "trajectory-every") ok = static_cast<bool>(ls >> scenario.trajectoryEvery) && scenario.trajectoryEvery >= 1;
+        else if (key == "trajectory-float32") scenario.trajectoryFloat32 = true;
+        else if (key == "checkpoint") ok = static_cast<bool>(ls >> scenario.checkpoint);
+        else if (key == "checkpoint-every") ok = static_cast<bool>(ls >> scenario.checkpointEvery) && scenario.checkpointEvery >= 0;
+        else if (key == "diagnostics-every") ok = static_cast<bool>(ls >> scenario.diagnosticsEvery) && scenario.diagnosticsEvery >= 0;
+        else if (key == "integrator") ok = static_cast<bool>(ls >> word) && parseIntegrator(word, scenario.integrator);
+        else if (key == "collisions") ok = static_cast<bool>(ls >> word) && parseCollisions(word, scenario.collisions);
+        else if (key == "precision") ok = static_cast<bool>(ls >> word) && parsePrecision(word, scenario.precision);
+        else if (key == "near-radius") ok = static_cast<bool>(ls >> scenario.nearRadius) && scenario.nearRadius >= 0;
+        else if (key == "near-skin") ok = static_cast<bool>(ls >> scenario.nearSkin) && scenario.nearSkin >= 0;
+        else if (key == "softening") {
+            ok = static_cast<bool>(ls >> word) && parseSoftening(word, scenario.softening.type);
+            if (ok && scenario.softening.type != SofteningType::None) {
+                ok = static_cast<bool>(ls >> scenario.softening.length) && scenario.softening.length > 0;
+            }
+        }
+        else if (key == "near-precision") {
+            ok = static_cast<bool>(ls >> word) && parsePrecision(word, scenario.nearPrecision)
+                && scenario.nearPrecision != Precision::Float;
+        }
+        else if (key == "solver") {
+            ok = static_cast<bool>(ls >> word);
+            if (word == "direct") scenario.solver = ForceSolver::Direct;
+            else if (word == "barnes-hut") scenario.solver = ForceSolver::BarnesHut;
+            else if (word == "fmm") scenario.solver = ForceSolver::Fmm;
+            else ok = false;
+        }
+        else if (key == "dimensions") {
+            if (!scenario.bodies.empty() || !scenario.bodies3d.empty()) {
+                error = "line " + std::to_string(lineNo) + ": 'dimensions' must come before the first body";
+                return false;
+            }
+            ok = static_cast<bool>(ls >> scenario.dimensions) && (scenario.dimensions == 2 || scenario.dimensions == 3);
+        }
+        else if (key == "body" && scenario.dimensions == 3) {
+            LD m, r, x, y, z, vx, vy, vz;
+            ok = static_cast<bool>(ls >> m >> r >> x >> y >> z >> vx >> vy >> vz);
+            if (ok) scenario.bodies3d.push_back(Body3(m, r, { x, y, z }, { vx, vy, vz }));
+        }
+        else if (key == "body") {
+            LD m, r, x, y, vx, vy;
+            ok = static_cast<bool>(ls >> m >> r >> x >> y >> vx >> vy);
+            if (ok) scenario.bodies.push_back(Body(m, r, { x, y }, { vx, vy }));
+        }
+        else if (key == "bodies-file") {
+            std::string path, fileError;
+            ok = static_cast<bool>(ls >> path) && scenario.dimensions == 2;
+            if (ok && !loadBodyList(path, scenario.bodies, fileError)) {
+                error = "line " + std::to_string(lineNo) + ": " + fileError;
+                return false;
+            }
+        }
+        else if (key == "generate") {
+            std::string text, generatorError;
+            std::getline(ls >> std::ws, text);
+            GeneratorSpec spec;
+            if (!parseGenerator(text, spec, generatorError)) {
+                error = "line " + std::to_string(lineNo) + ": " + generatorError;
+                return false;
+            }
+            if (scenario.dimensions == 3) generateBodies(spec, scenario.bodies3d);
+            else generateBodies(spec, scenario.bodies);
+        }
+        else {
+            error = "line " + std::to_string(lineNo) + ": unknown setting '" + key + "'";
+            return false;
+        }
+
+        if (!ok) {
+            error = "line " + std::to_string(lineNo) + ": bad value for '" + key + "'";
+            return false;
+        }
+    }
+
+    if (scenario.bodies.empty() && scenario.bodies3d.empty()) {
+        error = "no bodies";
+        return false;
+    }
+    if (scenario.integrator == IntegratorType::BlockTimestep) {
+        const char* unsupported = nullptr;
+        if (scenario.solver != ForceSolver::Direct) unsupported = "solver";
+        else if (scenario.precision != Precision::LongDouble) unsupported = "precision";
+        if (unsupported) {
+            error = std::string("'") + unsupported + "' is not supported with block time steps (long double direct sum only)";
+            return false;
+        }
+    }
+    if (scenario.dimensions == 3) {
+        const char* unsupported = nullptr;
+        if (!Simulation3D::supports(scenario.integrator)) unsupported = "integrator";
+        else if (scenario.solver != ForceSolver::Direct) unsupported = "solver";
+        else if (scenario.collisions != CollisionPolicy::None) unsupported = "collisions";
+        else if (!scenario.trajectory.empty()) unsupported = "trajectory";
+        else if (!scenario.checkpoint.empty()) unsupported = "checkpoint";
+        else if (scenario.diagnosticsEvery > 0) unsupported = "diagnostics-every";
+        else if (scenario.nearRadius > 0) unsupported = "near-radius";
+        if (unsupported) {
+            error = std::string("'") + unsupported + "' is not supported in 3D";
+            return false;
+        }
+    }
+    return true;
+}
+
+bool loadScenarioFile(const std::string& path, Scenario& scenario, std::string& error) {
+    std::ifstream in(path);
+    if (!in) {
+        error = "cannot open " + path;
+        return false;
+    }
+    return loadScenario(in, scenario, error);
+}
\ No newline at end of file
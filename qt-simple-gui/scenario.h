@@ -0,0 +1,98 @@
+#pragma once
+#include "helpers.h"
+#include "simulation.h"
+#include "basicsimulation.h"
+#include "transport.h"
+#include <istream>
+#include <string>
+
+// Plain-text description of a run, one setting per line ('#' starts a comment):
+//
+//   dt 0.001
+//   steps 10000000
+//   integrator leapfrog      (euler, verlet, leapfrog, yoshida4, dopri45, block)
+//   solver barnes-hut        (direct, barnes-hut, fmm)
+//   theta 0.5                (opening angle of both tree solvers)
+//   fmm-order 8              (expansion order of the fmm solver)
+//   collisions merge         (none, log, stop, merge)
+//   precision double         (long-double, double, float)
+//   near-radius 1e9          (mixed precision: pairs closer than this (m) are summed
+//                             from the long double positions, see Simulation::nearRadius)
+//   near-precision double    (long-double, double: arithmetic of those pairs)
+//   near-skin 1e8            (Barnes-Hut neighbour list skin (m), 0 = a quarter of the radius)
+//   softening spline 1e6     (none, plummer, spline; length eps in m, see softening.h)
+//   threads 4
+//   sort-every 100           (steps between checks of the body order, re-sorted along a
+//                             Morton curve when it has drifted; 0 = never, see bodyorder.h)
+//   sort-threshold 0.1       (share of out-of-order neighbours that triggers a re-sort)
+//   ranks 4                  (splits the run over this many ranks, see domain.h)
+//   transport socket         (local, socket: how the ranks talk, see transport.h)
+//   rebalance-every 100      (steps between domain rebalances, 0 = only on imbalance)
+//   output-every 100000      (steps between snapshots, 0 = only the last one)
+//   trajectory run.trj       (binary trajectory file, see trajectory.h)
+//   trajectory-every 100     (steps between recorded frames)
+//   trajectory-float32       (store frames in single precision)
+//   checkpoint run.ckp       (periodic restart file, see checkpoint.h)
+//   checkpoint-every 100000  (steps between checkpoints)
+//   diagnostics-every 1000   (steps between energy/momentum samples, 0 = off)
+//   body <mass> <radius> <x> <y> <vx> <vy>
+//   bodies-file disk.csv     (appends a CSV or binary body list, see bodylist.h)
+//   generate plummer n=100000 scale=3e16 seed=7
+//                            (appends generated bodies, see generators.h)
+//
+// 'dimensions 3' (before the first body) switches to 3D bodies,
+//   body <mass> <radius> <x> <y> <z> <vx> <vy> <vz>
+// ('generate' works in 3D too, 'bodies-file' does not)
+// which run on BasicSimulation: direct solver, symplectic integrators, softening, no
+// collisions, trajectories, checkpoints, diagnostics or near-field split, one thread.
+struct Scenario {
+    std::string name;
+    LD dt = 1.0;
+    long long steps = 1000;
+    long long outputEvery = 0;
+    IntegratorType integrator = IntegratorType::Euler;
+    ForceSolver solver = ForceSolver::Direct;
+    CollisionPolicy collisions = CollisionPolicy::None;
+    LD theta = 0.5;
+    int fmmOrder = 8;
+    Precision precision = Precision::LongDouble;
+    LD nearRadius = 0;
+    Precision nearPrecision = Precision::LongDouble;
+    LD nearSkin = 0;
+    Softening softening;
+    int threads = 1;
+    long long sortEvery = 0;
+    double sortThreshold = 0.1;
+    int ranks = 1;
+    TransportType transport = TransportType::Local;
+    long long rebalanceEvery = 0;
+    std::string trajectory; // empty = not recorded
+    long long trajectoryEvery = 1;
+    bool trajectoryFloat32 = false;
+    std::string checkpoint; // empty = no checkpoints
+    long long checkpointEvery = 0;
+    long long diagnosticsEvery = 0;
+    int dimensions = 2;
+    std::vector<Body> bodies;
+    std::vector<Body3> bodies3d; // dimensions 3
+
+    // Copies the settings and bodies into a fresh simulation
+    // (trajectory and checkpoint files are opened by the caller)
+    void apply(Simulation& sim) const;
+
+    // 3D scenarios, in the working precision T
+    template <typename T>
+    void apply(BasicSimulation<3, T>& sim) const {
+        auto convert = [](const Vec3& v) { return Vec<3, T>{ static_cast<T>(v.x), static_cast<T>(v.y), static_cast<T>(v.z) }; };
+        sim.dt = static_cast<T>(dt);
+        sim.setIntegrator(integrator);
+        sim.softening = softening;
+        for (const auto& b : bodies3d) {
+            sim.addBody(BodyT<3, T>(static_cast<T>(b.mass), static_cast<T>(b.radius), convert(b.position), convert(b.velocity)));
+        }
+    }
+};
+
+// Returns false and fills 'error' (with the line number) on malformed input
+bool loadScenario(std::istream& in, Scenario& scenario, std::string& error);
+bool loadScenarioFile(const std::string& path, Scenario& scenario, std::string& error);
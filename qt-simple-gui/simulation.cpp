@@ -1,13 +1,101 @@
 ﻿#include "simulation.h"
+#include "domain.h"
 #include "physics.h"
+#include "profiler.h"
+
+ThreadPool& Simulation::threadPool() {
+    if (!pool || pool->size() != threads) {
+        pool.reset(new ThreadPool(threads));
+    }
+    return *pool;
+}
+
+void Simulation::computeAccelerations() {
+    PROFILE_SCOPE(ProfilePhase::Force);
+    // Pairwise-equivalent work, whatever the solver actually does
+    PROFILE_COUNT(ProfileCounter::Interactions, static_cast<int64_t>(bodies.size()) * (static_cast<int64_t>(bodies.size()) - 1));
+    if (domain) {
+        domain->computeAccelerations(*this);
+    }
+    else {
+        switch (solver) {
+        case ForceSolver::BarnesHut:
+            Physics::computeAccelerationsBarnesHut(*this);
+            break;
+        case ForceSolver::Fmm:
+            Physics::computeAccelerationsFmm(*this);
+            break;
+        case ForceSolver::Direct:
+        default:
+            // Any thread count, one thread included: the fixed tiles make the sum order
+            // depend on N only, so the trajectory does not depend on 'threads'
+            Physics::computeAccelerationsParallel(*this);
+            break;
+        }
+    }
+    ++forceEvaluations;
+    accelerationsCurrent = true;
+    potentialCurrent = computePotential;
+}
 
 void Simulation::step() {
-    Physics::computeAccelerations(*this);
+    if (isFinished) return;
+    if (diagnostics.every > 0 && diagnostics.total == 0) {
+        sampleDiagnostics(); // the reference: state before the first step
+    }
 
-    for (auto& body : bodies) {
-        body.velocity = body.velocity + body.acceleration * dt;
-        body.position = body.position + body.velocity * dt;
+    // The potential is only summed on steps that end with a sample
+    const bool sample = diagnostics.due(stepCount + 1);
+    computePotential = sample;
+    potentialCurrent = false;
+    {
+        PROFILE_SCOPE(ProfilePhase::Integrate);
+        integrator->step(*this);
     }
+    computePotential = false;
 
     time += dt;
+    ++stepCount;
+    PROFILE_COUNT(ProfileCounter::Steps, 1);
+
+    if (collisionPolicy != CollisionPolicy::None) {
+        PROFILE_SCOPE(ProfilePhase::Collision);
+        collisions.process(*this);
+    }
+
+    // Not on decomposed ranks: their bodies move between ranks anyway (see domain.h)
+    if (order.every > 0 && stepCount % order.every == 0 && !domain) {
+        PROFILE_SCOPE(ProfilePhase::Sort);
+        order.update(*this);
+    }
+
+    if (sample) sampleDiagnostics();
+
+    PROFILE_SCOPE(ProfilePhase::Output);
+    if (trajectory && stepCount % trajectoryEvery == 0) {
+        trajectory->record(*this);
+    }
+    if (checkpointer && checkpointEvery > 0 && stepCount % checkpointEvery == 0) {
+        checkpointer->request(*this);
+    }
+}
+
+void Simulation::sampleDiagnostics() {
+    if (!(potentialCurrent && accelerationsCurrent)) {
+        // No evaluation at these positions yet (Euler, block time steps, merged bodies):
+        // one extra evaluation. If the accelerations were current, the integrator's
+        // values are kept, so sampling never changes the trajectory.
+        const bool keep = accelerationsCurrent;
+        if (keep) {
+            savedAccelerations.resize(bodies.size());
+            for (size_t i = 0; i < bodies.size(); ++i) savedAccelerations[i] = bodies[i].acceleration;
+        }
+        computePotential = true;
+        computeAccelerations();
+        computePotential = false;
+        if (keep) {
+            for (size_t i = 0; i < bodies.size(); ++i) bodies[i].acceleration = savedAccelerations[i];
+        }
+    }
+    diagnostics.record(*this, potentialEnergy);
 }
\ No newline at end of file
@@ -1,16 +1,121 @@
 #pragma once
 #include "helpers.h"
 #include "body.h"
+#include "barneshut.h"
+#include "bodyorder.h"
+#include "checkpoint.h"
+#include "collision.h"
+#include "diagnostics.h"
+#include "fmm.h"
+#include "forcekernel.h"
+#include "integrator.h"
+#include "neighborlist.h"
+#include "parallelforce.h"
+#include "softening.h"
+#include "threadpool.h"
+#include "trajectory.h"
+#include <memory>
+
+class DomainDecomposition;
+
+enum class ForceSolver {
+    Direct,    // exact pairwise sum, O(N^2)
+    BarnesHut, // quadtree approximation, O(N log N)
+    Fmm        // fast multipole method, O(N)
+};
 
 class Simulation {
 public:
     std::vector<Body> bodies;
     LD time = 0.0; // total time (s)
     LD dt = 1.0; // step (s)
+    long long stepCount = 0;
+
+    // Slot order of 'bodies': optionally re-sorted for locality, checked every order.every
+    // steps. Anything shown or written per body goes through order.idOf() / slotOf().
+    BodyOrder order;
+
+    std::unique_ptr<Integrator> integrator = Integrator::create(IntegratorType::Euler);
+
+    // True while Body::acceleration matches the current positions.
+    // Anything that moves, adds or removes bodies outside of step() must clear it.
+    bool accelerationsCurrent = false;
+    long long forceEvaluations = 0;
+
+    // Contacts between body spheres (Body::radius), checked after every step
+    CollisionPolicy collisionPolicy = CollisionPolicy::None;
+    CollisionDetector collisions;
+    bool isFinished = false; // set by CollisionPolicy::Stop; step() does nothing afterwards
+
+    ForceSolver solver = ForceSolver::Direct;
+    BarnesHut tree; // kept between steps so its node arena is reused
+    FastMultipole fmm;
+
+    // Softened pair law for every solver (see softening.h); the FMM softens its direct part only
+    Softening softening;
+
+    // Working precision of the direct sum, which always runs the fixed tiles of ParallelDirectSum
+    // on a structure-of-arrays copy of the bodies; Double and Float on the vector unit 'isa'.
+    Precision precision = Precision::LongDouble;
+    ForceKernel::Isa isa = ForceKernel::detectIsa();
+    BodyStore<double> storeDouble;
+    BodyStore<float> storeFloat;
+
+    // Near/far split: with nearRadius > 0 (m) the Double/Float direct sum leaves out the pairs
+    // closer than that and sums them from the long double positions in nearPrecision
+    // (LongDouble or Double), so close encounters keep their accuracy while the far field
+    // stays in the vector kernels. 0 = every pair in the working precision.
+    // Barnes-Hut splits the same way, in long double, with the pairs taken from 'neighbors'.
+    // Spline softening always splits at its support, so its far field stays Newtonian.
+    LD nearRadius = 0;
+    Precision nearPrecision = Precision::LongDouble;
+    ForceKernel::NearPairs nearPairs; // filled by every split direct sum
+    NeighborList neighbors;           // near pairs of the split tree walk, reused while the skin allows
+
+    // Force evaluation threads; 1 keeps everything on the calling thread
+    int threads = 1;
+    std::unique_ptr<ThreadPool> pool;
+    BodyStore<LD> storeLongDouble; // the long double direct sum at any thread count
+    ParallelDirectSum<LD> parallelLongDouble;
+    ParallelDirectSum<double> parallelDouble;
+    ParallelDirectSum<float> parallelFloat;
+
+    // Optional trajectory recording: a frame every trajectoryEvery steps
+    std::unique_ptr<TrajectoryWriter> trajectory;
+    long long trajectoryEvery = 1;
+
+    // Conserved-quantity samples (see diagnostics.h); diagnostics.every = 0 turns them off.
+    // While computePotential is set every force evaluation also fills potentialEnergy;
+    // step() sets it only for the steps that end with a sample.
+    Diagnostics diagnostics;
+    bool computePotential = false;
+    bool potentialCurrent = false; // potentialEnergy belongs to the last evaluation
+    LD potentialEnergy = 0;
+    std::vector<Vec2> savedAccelerations; // scratch for sampleDiagnostics()
+
+    // Optional periodic checkpoints (see checkpoint.h); 0 = none
+    std::unique_ptr<BackgroundCheckpointer> checkpointer;
+    long long checkpointEvery = 0;
+
+    // Set on the ranks of a decomposed run: 'bodies' are this rank's share, and forces come
+    // from every rank's bodies through the decomposition (see domain.h)
+    DomainDecomposition* domain = nullptr;
+
+    ThreadPool& threadPool();
 
     void addBody(const Body& body) {
         bodies.push_back(body);
+        order.append();
+        accelerationsCurrent = false;
+    }
+
+    void setIntegrator(IntegratorType type) {
+        integrator = Integrator::create(type);
     }
 
+    bool hasCollision() { return collisions.hasOverlap(bodies); }
+
+    void computeAccelerations();
     void step();
+    void sampleDiagnostics(); // records the current state, evaluating the potential if needed
 };
\ No newline at end of file
@@ -0,0 +1,274 @@
+﻿#include "simulationworker.h"
+#include "profiler.h"
+
+using Clock = std::chrono::steady_clock;
+
+SimulationWorker::SimulationWorker() {
+    thread = std::thread(&SimulationWorker::loop, this);
+}
+
+SimulationWorker::~SimulationWorker() {
+    post({ CommandType::Quit });
+    thread.join();
+}
+
+void SimulationWorker::start(std::unique_ptr<Simulation> simulation, long long steps, double interval,
+    size_t replayBudget, const std::string& replaySpill) {
+    Command c{ CommandType::Start };
+    c.sim = std::move(simulation);
+    c.maxSteps = steps;
+    c.logInterval = interval;
+    c.replayBudget = replayBudget;
+    c.replaySpill = replaySpill;
+    post(std::move(c));
+}
+
+void SimulationWorker::pause() { post({ CommandType::Pause }); }
+void SimulationWorker::resume() { post({ CommandType::Resume }); }
+void SimulationWorker::stop() { post({ CommandType::Stop }); }
+
+void SimulationWorker::seek(long long step) {
+    Command c{ CommandType::Seek };
+    c.maxSteps = step;
+    post(std::move(c));
+}
+
+void SimulationWorker::setTargetRate(double simSecondsPerSecond) {
+    Command c{ CommandType::SetRate };
+    c.rate = simSecondsPerSecond;
+    post(std::move(c));
+}
+
+bool SimulationWorker::poll() {
+    return snapshots.update();
+}
+
+void SimulationWorker::post(Command command) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        commands.push_back(std::move(command));
+        pending.store(true, std::memory_order_release);
+    }
+    wake.notify_one();
+}
+
+void SimulationWorker::loop() {
+    if (Profiler::enabled) Profiler::instance().setThreadName("simulation");
+    auto lastPublish = Clock::now();
+
+    while (true) {
+        // The mutex is only taken when there is something to do or nothing to run
+        if (pending.load(std::memory_order_acquire) || !(running || seeking)) {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this] { return !commands.empty() || running || seeking; });
+            while (!commands.empty()) {
+                Command c = std::move(commands.front());
+                commands.pop_front();
+                apply(c);
+            }
+            pending.store(false, std::memory_order_relaxed);
+            if (quit) return;
+        }
+        if (seeking) {
+            replayStep();
+            continue;
+        }
+        if (!running) continue;
+
+        if ((maxSteps > 0 && sim->stepCount >= maxSteps) || sim->isFinished) {
+            running = false;
+            publish(*sim, true);
+            writeLog(true);
+            continue;
+        }
+
+        if (rate > 0) {
+            // Step k is due once the wall clock catches up with the simulated time
+            auto due = paceWall + std::chrono::duration_cast<Clock::duration>(
+                std::chrono::duration<double>(static_cast<double>(sim->time - paceSimTime) / rate));
+            if (due > Clock::now()) {
+                std::unique_lock<std::mutex> lock(mutex);
+                if (wake.wait_until(lock, due, [this] { return !commands.empty(); })) continue;
+            }
+        }
+
+        sim->step();
+        replay.record(*sim);
+        writeLog();
+
+        auto now = Clock::now();
+        if (now - lastPublish >= publishInterval || rate > 0) {
+            publish(*sim);
+            lastPublish = now;
+        }
+    }
+}
+
+void SimulationWorker::apply(Command& c) {
+    switch (c.type) {
+    case CommandType::Start:
+        sim = std::move(c.sim);
+        maxSteps = c.maxSteps;
+        ++run;
+        running = sim != nullptr;
+        seeking = false;
+        resetPacing();
+        logInterval = c.logInterval;
+        replay.reset(c.replayBudget, c.replaySpill);
+        if (sim) {
+            lastLogTime = sim->time - logInterval;
+            lastLogWall = Clock::now() - logWallInterval;
+            lastLoggedCollision = sim->collisions.total;
+            lastLoggedDiagnostics = 0;
+            replay.record(*sim);
+            publish(*sim);
+            writeLog();
+        }
+        break;
+    case CommandType::Pause:
+        running = false;
+        if (sim && !seeking) publish(*sim);
+        break;
+    case CommandType::Resume:
+        running = sim != nullptr;
+        seeking = false;
+        resetPacing();
+        if (sim) publish(*sim);
+        break;
+    case CommandType::Stop:
+        running = false;
+        seeking = false;
+        sim.reset();
+        replay.reset(0);
+        break;
+    case CommandType::Seek:
+        // Only the newest target counts; the re-run happens in the loop, where a new command interrupts it
+        running = false;
+        seeking = sim != nullptr;
+        seekTarget = c.maxSteps;
+        break;
+    case CommandType::SetRate:
+        rate = c.rate;
+        resetPacing();
+        break;
+    case CommandType::Quit:
+        running = false;
+        quit = true;
+        break;
+    }
+}
+
+void SimulationWorker::publish(const Simulation& state, bool finished, bool replayed) {
+    PROFILE_SCOPE(ProfilePhase::Output);
+    SimulationSnapshot& s = snapshots.writeSlot();
+    state.order.toExternal(state.bodies, s.bodies); // reuses the slot's capacity; rows stay put across re-sorts
+    s.time = state.time;
+    s.stepCount = state.stepCount;
+    s.forceEvaluations = state.forceEvaluations;
+    s.run = run;
+    s.running = running;
+    s.finished = finished;
+    s.collided = state.isFinished;
+    s.replayed = replayed;
+    s.replayFirst = replay.firstStep();
+    s.replayLast = replay.lastStep();
+    s.collisions = state.collisions.recent(); // at most MAX_RECENT events
+    s.collisionCount = state.collisions.total;
+    s.diagnosticsCount = state.diagnostics.total;
+    if (s.diagnosticsCount > 0) {
+        s.diagnostics = state.diagnostics.recent().back();
+        s.energyDrift = state.diagnostics.energyDrift(s.diagnostics);
+        s.maxEnergyDrift = state.diagnostics.maxEnergyDrift;
+    }
+    snapshots.publish();
+}
+
+// One seek, or part of it if a command came in meanwhile; the next loop picks it up from there
+void SimulationWorker::replayStep() {
+    std::string error;
+    const Simulation* state = replay.seek(seekTarget, error, &pending);
+    if (!state) {
+        log.note("Replay failed: " + error);
+        seeking = false;
+        return;
+    }
+    publish(*state, false, true);
+    if (state->stepCount >= std::min(seekTarget, replay.lastStep()) || state->isFinished) seeking = false;
+}
+
+// Log records for what happened since the last call: every collision, and a listing of
+// the bodies (with the latest diagnostics sample) once per logInterval of simulated time
+void SimulationWorker::writeLog(bool finished) {
+    const CollisionDetector& collisions = sim->collisions;
+    if (collisions.total > lastLoggedCollision) {
+        // Events older than the detector's window were dropped; the count still says how many
+        const auto& events = collisions.recent();
+        LogRecord r;
+        r.kind = LogRecord::Kind::MissedCollisions;
+        r.step = events.empty() ? 0 : events.front().seq - lastLoggedCollision - 1;
+        if (r.step > 0) log.push(r);
+        for (const auto& e : events) {
+            if (e.seq <= lastLoggedCollision) continue;
+            r.kind = LogRecord::Kind::Collision;
+            r.a = e.a;
+            r.b = e.b;
+            r.step = e.step;
+            r.v[0] = static_cast<double>(e.time);
+            log.push(r);
+        }
+        lastLoggedCollision = collisions.total;
+    }
+
+    if (finished) {
+        LogRecord r;
+        r.kind = LogRecord::Kind::Finished;
+        r.a = sim->isFinished ? 1 : 0;
+        log.push(r);
+    }
+
+    if (logInterval <= 0 || sim->time - lastLogTime < logInterval) return;
+    const auto now = Clock::now();
+    if (now - lastLogWall < logWallInterval && !finished) return;
+    PROFILE_SCOPE(ProfilePhase::Output);
+    lastLogTime = sim->time;
+    lastLogWall = now;
+
+    LogRecord r;
+    r.kind = LogRecord::Kind::Time;
+    r.v[0] = static_cast<double>(sim->time);
+    log.push(r);
+    r.kind = LogRecord::Kind::Body;
+    for (size_t i = 0; i < sim->bodies.size(); ++i) {
+        const Body& b = sim->bodies[sim->order.slotOf(i)];
+        r.a = static_cast<int>(i);
+        r.v[0] = static_cast<double>(b.position.x);
+        r.v[1] = static_cast<double>(b.position.y);
+        r.v[2] = static_cast<double>(b.velocity.x);
+        r.v[3] = static_cast<double>(b.velocity.y);
+        r.v[4] = static_cast<double>(b.acceleration.x);
+        r.v[5] = static_cast<double>(b.acceleration.y);
+        log.push(r);
+    }
+    // Only the latest sample; the full series is available from the headless runner
+    const Diagnostics& diagnostics = sim->diagnostics;
+    if (diagnostics.total > lastLoggedDiagnostics) {
+        const DiagnosticsSample& d = diagnostics.recent().back();
+        r.kind = LogRecord::Kind::Diagnostics;
+        r.step = d.step;
+        r.v[0] = static_cast<double>(d.energy());
+        r.v[1] = static_cast<double>(diagnostics.energyDrift(d));
+        r.v[2] = static_cast<double>(diagnostics.maxEnergyDrift);
+        r.v[3] = static_cast<double>(d.momentum.x);
+        r.v[4] = static_cast<double>(d.momentum.y);
+        r.v[5] = static_cast<double>(d.angularMomentum);
+        log.push(r);
+        lastLoggedDiagnostics = diagnostics.total;
+    }
+    r.kind = LogRecord::Kind::Separator;
+    log.push(r);
+}
+
+void SimulationWorker::resetPacing() {
+    paceWall = Clock::now();
+    paceSimTime = sim ? sim->time : 0;
+}
\ No newline at end of file
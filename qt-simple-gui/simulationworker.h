@@ -0,0 +1,94 @@
+#pragma once
+#include "simulation.h"
+#include "logpipeline.h"
+#include "replay.h"
+#include "snapshot.h"
+#include "triplebuffer.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+// Runs a Simulation on its own thread, flat out or at a target sim-time rate.
+// Control goes in as posted commands, state comes out as snapshots
+// through a triple buffer and log records through 'log', so neither side
+// ever waits for the other.
+class SimulationWorker {
+public:
+    SimulationWorker();
+    ~SimulationWorker();
+
+    // All of these only post a command and return immediately.
+    // Every logInterval simulated seconds (0 = never) the bodies are written to the log.
+    // Keyframes for seek() are kept within replayBudget bytes (0 = none), see ReplayCache
+    void start(std::unique_ptr<Simulation> sim, long long maxSteps, double logInterval = 0,
+        size_t replayBudget = 0, const std::string& replaySpill = std::string());
+    void pause();
+    void resume(); // also leaves a replay, back to the live state
+    // Pauses the live run and publishes the state at an earlier step, rebuilt from the
+    // replay keyframes. A newer seek interrupts one still re-running
+    void seek(long long step);
+    void stop();
+    void setTargetRate(double simSecondsPerSecond); // 0 = as fast as possible
+
+    // UI side: picks up the newest published snapshot, if any.
+    // The returned reference is valid until the next call.
+    bool poll();
+    const SimulationSnapshot& snapshot() const { return snapshots.front(); }
+
+    // At most one snapshot per this interval while running (at least one per step)
+    std::chrono::milliseconds publishInterval{ 8 };
+    // At most one body listing per this interval, however short logInterval is in wall time
+    std::chrono::milliseconds logWallInterval{ 16 };
+
+    LogPipeline log; // filled by the stepping thread only; notes and take() from anywhere
+    ReplayCache replay; // recorded and replayed on the stepping thread; its counters from anywhere
+
+private:
+    enum class CommandType { Start, Pause, Resume, Stop, SetRate, Seek, Quit };
+    struct Command {
+        CommandType type;
+        std::unique_ptr<Simulation> sim;
+        long long maxSteps = 0; // also the target of Seek
+        double rate = 0;
+        double logInterval = 0;
+        size_t replayBudget = 0;
+        std::string replaySpill;
+    };
+
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<Command> commands;
+    std::atomic<bool> pending{ false };
+
+    TripleBuffer<SimulationSnapshot> snapshots;
+
+    // Worker thread state
+    std::unique_ptr<Simulation> sim;
+    long long maxSteps = 0;
+    double rate = 0;
+    int run = 0;
+    bool running = false;
+    bool seeking = false;
+    long long seekTarget = 0;
+    bool quit = false;
+    std::chrono::steady_clock::time_point paceWall;
+    LD paceSimTime = 0;
+    double logInterval = 0;
+    LD lastLogTime = 0;
+    std::chrono::steady_clock::time_point lastLogWall;
+    long long lastLoggedCollision = 0;
+    long long lastLoggedDiagnostics = 0;
+
+    void post(Command command);
+    void loop();
+    void apply(Command& command);
+    void publish(const Simulation& state, bool finished = false, bool replayed = false);
+    void replayStep();
+    void writeLog(bool finished = false);
+    void resetPacing();
+};
@@ -0,0 +1,27 @@
+#pragma once
+#include "helpers.h"
+#include "body.h"
+#include "collision.h"
+#include "diagnostics.h"
+
+// Immutable copy of the simulation state handed from the stepping thread to the UI
+struct SimulationSnapshot {
+    std::vector<Body> bodies;
+    LD time = 0;
+    long long stepCount = 0;
+    long long forceEvaluations = 0;
+    int run = 0;           // increases with every started simulation, to drop stale snapshots
+    bool running = false;
+    bool finished = false; // max steps reached or stopped by a collision
+    bool collided = false; // finished because of CollisionPolicy::Stop
+
+    bool replayed = false;     // rebuilt from the replay keyframes, not the live state
+    long long replayFirst = -1, replayLast = -1; // steps that can be replayed, see ReplayCache
+
+    long long collisionCount = 0;
+    std::vector<CollisionEvent> collisions; // the most recent ones, see CollisionDetector::recent()
+
+    long long diagnosticsCount = 0; // samples so far; 'diagnostics' is the latest one
+    DiagnosticsSample diagnostics;
+    LD energyDrift = 0, maxEnergyDrift = 0;
+};
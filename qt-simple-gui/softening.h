@@ -0,0 +1,82 @@
+#pragma once
+#include "helpers.h"
+#include <limits>
+
+// Short-range change of the 1/r^2 law, so that close encounters stay finite
+// instead of blowing up the step.
+//
+// Plummer: every pair is evaluated as if r^2 were r^2 + eps^2, at all distances.
+// Spline: the cubic spline kernel used by GADGET (Springel 2001). The force is
+// exactly Newtonian beyond h = 2.8 eps, where eps is the Plummer-equivalent length
+// (both give the same potential at r = 0).
+enum class SofteningType { None, Plummer, Spline };
+
+struct Softening {
+    static constexpr LD SPLINE_SUPPORT = 2.8L; // h / eps
+
+    SofteningType type = SofteningType::None;
+    LD length = 0; // eps (m)
+
+    bool enabled() const { return type != SofteningType::None && length > 0; }
+
+    // Beyond this distance (m) the force is exactly Newtonian: 0 without softening, infinite for Plummer
+    LD range() const {
+        if (!enabled()) return 0;
+        if (type == SofteningType::Spline) return SPLINE_SUPPORT * length;
+        return std::numeric_limits<LD>::infinity();
+    }
+};
+
+// The softened pair law in the caller's precision and length unit: with d = r_j - r_i,
+// a_i += G m_j d * inverseCube(r) and phi_i += m_j * inverse(r) replace 1/r^3 and 1/r.
+template <typename T>
+class SofteningLaw {
+public:
+    SofteningLaw() : type(SofteningType::None), eps2(0), h(0) {}
+
+    explicit SofteningLaw(const Softening& s, LD unit = 1)
+        : type(s.enabled() ? s.type : SofteningType::None) {
+        const LD eps = s.length / unit;
+        eps2 = static_cast<T>(eps * eps);
+        h = static_cast<T>(Softening::SPLINE_SUPPORT * eps);
+    }
+
+    T inverseCube(T r) const {
+        switch (type) {
+        case SofteningType::Plummer: {
+            T s2 = r * r + eps2;
+            return 1 / (s2 * std::sqrt(s2));
+        }
+        case SofteningType::Spline: {
+            if (r >= h) break;
+            const T u = r / h;
+            const T h3 = h * h * h;
+            if (u < T(0.5)) return (T(32) / 3 + u * u * (32 * u - T(38.4))) / h3;
+            return (T(64) / 3 - 48 * u + T(38.4) * u * u - T(32) / 3 * u * u * u - 1 / (15 * u * u * u)) / h3;
+        }
+        case SofteningType::None:
+        default: break;
+        }
+        return 1 / (r * r * r);
+    }
+
+    T inverse(T r) const {
+        switch (type) {
+        case SofteningType::Plummer: return 1 / std::sqrt(r * r + eps2);
+        case SofteningType::Spline: {
+            if (r >= h) break;
+            const T u = r / h;
+            if (u < T(0.5)) return (T(2.8) - u * u * (T(16) / 3 + u * u * (T(6.4) * u - T(9.6)))) / h;
+            return (T(3.2) - 1 / (15 * u) - u * u * (T(32) / 3 + u * (-16 + u * (T(9.6) - T(32) / 15 * u)))) / h;
+        }
+        case SofteningType::None:
+        default: break;
+        }
+        return 1 / r;
+    }
+
+private:
+    SofteningType type;
+    T eps2; // Plummer, in units of 'unit'
+    T h;    // spline support
+};
\ No newline at end of file
@@ -0,0 +1,61 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+// Lock-free single-producer/single-consumer queue of fixed capacity (a power of two).
+// push() never waits: when the ring is full it returns false and the caller decides
+// what to drop. The two indices live on separate cache lines, and each side keeps a
+// cached copy of the other's index, so a push or pop touches shared memory only
+// when the cached value says the ring looks full or empty.
+template <typename T>
+class SpscRing {
+public:
+    explicit SpscRing(size_t capacity) {
+        size_t size = 2;
+        while (size < capacity) size <<= 1;
+        slots.resize(size);
+        mask = size - 1;
+    }
+
+    size_t capacity() const { return slots.size(); }
+
+    // Producer only
+    bool push(const T& value) {
+        const size_t h = head.load(std::memory_order_relaxed);
+        if (h - tailCache == slots.size()) {
+            tailCache = tail.load(std::memory_order_acquire);
+            if (h - tailCache == slots.size()) return false;
+        }
+        slots[h & mask] = value;
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer only: moves up to 'max' values to 'out', returns how many
+    template <typename Out>
+    size_t pop(Out out, size_t max) {
+        const size_t t = tail.load(std::memory_order_relaxed);
+        if (headCache == t) {
+            headCache = head.load(std::memory_order_acquire);
+            if (headCache == t) return 0;
+        }
+        const size_t n = std::min(max, headCache - t);
+        for (size_t i = 0; i < n; ++i) *out++ = slots[(t + i) & mask];
+        tail.store(t + n, std::memory_order_release);
+        return n;
+    }
+
+    // Either side; exact only when the other side is idle
+    bool empty() const { return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire); }
+
+private:
+    std::vector<T> slots;
+    size_t mask = 0;
+
+    alignas(64) std::atomic<size_t> head{ 0 }; // next slot to write
+    size_t tailCache = 0;                      // producer's view of tail
+    alignas(64) std::atomic<size_t> tail{ 0 }; // next slot to read
+    size_t headCache = 0;                      // consumer's view of head
+};
\ No newline at end of file
@@ -0,0 +1,112 @@
+﻿#include "threadpool.h"
+#include <algorithm>
+
+static uint64_t packRange(uint32_t begin, uint32_t end) {
+    return (static_cast<uint64_t>(begin) << 32) | end;
+}
+
+ThreadPool::ThreadPool(int threadCount)
+    : ranges(new TileRange[std::max(1, threadCount)]) {
+    for (int w = 1; w < threadCount; ++w) {
+        threads.emplace_back(&ThreadPool::workerLoop, this, w);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& t : threads) t.join();
+}
+
+int ThreadPool::hardwareThreads() {
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+void ThreadPool::run(size_t tiles, const std::function<void(size_t, int)>& fn) {
+    const int workers = size();
+    if (workers == 1 || tiles <= 1) {
+        for (size_t t = 0; t < tiles; ++t) fn(t, 0);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        // Initial split: contiguous, equally sized blocks
+        for (int w = 0; w < workers; ++w) {
+            uint32_t begin = static_cast<uint32_t>(tiles * w / workers);
+            uint32_t end = static_cast<uint32_t>(tiles * (w + 1) / workers);
+            ranges[w].bounds.store(packRange(begin, end), std::memory_order_relaxed);
+        }
+        task = &fn;
+        running = workers;
+        ++generation;
+    }
+    wake.notify_all();
+
+    work(0);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    finished.wait(lock, [this] { return running == 0; });
+    task = nullptr;
+}
+
+void ThreadPool::workerLoop(int worker) {
+    uint64_t seen = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&] { return stopping || generation != seen; });
+            if (stopping) return;
+            seen = generation;
+        }
+        work(worker);
+    }
+}
+
+void ThreadPool::work(int worker) {
+    const int workers = size();
+    size_t tile;
+
+    while (takeFront(worker, tile)) {
+        (*task)(tile, worker);
+    }
+    // Own block is empty: help the others, starting with the next worker
+    for (int k = 1; k < workers; ++k) {
+        int victim = (worker + k) % workers;
+        while (stealBack(victim, tile)) {
+            (*task)(tile, worker);
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (--running == 0) finished.notify_one();
+}
+
+bool ThreadPool::takeFront(int worker, size_t& tile) {
+    auto& bounds = ranges[worker].bounds;
+    uint64_t v = bounds.load(std::memory_order_acquire);
+    while (true) {
+        uint32_t begin = static_cast<uint32_t>(v >> 32), end = static_cast<uint32_t>(v);
+        if (begin >= end) return false;
+        if (bounds.compare_exchange_weak(v, packRange(begin + 1, end), std::memory_order_acq_rel)) {
+            tile = begin;
+            return true;
+        }
+    }
+}
+
+bool ThreadPool::stealBack(int victim, size_t& tile) {
+    auto& bounds = ranges[victim].bounds;
+    uint64_t v = bounds.load(std::memory_order_acquire);
+    while (true) {
+        uint32_t begin = static_cast<uint32_t>(v >> 32), end = static_cast<uint32_t>(v);
+        if (begin >= end) return false;
+        if (bounds.compare_exchange_weak(v, packRange(begin, end - 1), std::memory_order_acq_rel)) {
+            tile = end - 1;
+            return true;
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,52 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads running "tiles" of work with work stealing.
+// Every worker starts with a contiguous block of tiles, takes them from the front
+// and, when it runs dry, steals from the back of another worker's block.
+class ThreadPool {
+public:
+    explicit ThreadPool(int threadCount);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    int size() const { return static_cast<int>(threads.size()) + 1; }
+
+    // Runs task(tile, worker) for every tile in [0, tiles) and waits for all of them.
+    // The calling thread takes part as worker 0.
+    void run(size_t tiles, const std::function<void(size_t, int)>& task);
+
+    static int hardwareThreads();
+
+private:
+    // [begin, end) packed into one word so that the owner (front) and
+    // thieves (back) can both claim tiles with a single CAS
+    struct alignas(64) TileRange {
+        std::atomic<uint64_t> bounds{ 0 };
+    };
+
+    std::vector<std::thread> threads;
+    std::unique_ptr<TileRange[]> ranges;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable finished;
+    const std::function<void(size_t, int)>* task = nullptr;
+    uint64_t generation = 0;
+    int running = 0;
+    bool stopping = false;
+
+    void workerLoop(int worker);
+    void work(int worker);
+    bool takeFront(int worker, size_t& tile);
+    bool stealBack(int victim, size_t& tile);
+};
@@ -0,0 +1,286 @@
+﻿#include "trajectory.h"
+#include "simulation.h"
+#include <cstring>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static const char TRAJECTORY_MAGIC[8] = { 'N', 'B', 'O', 'D', 'Y', 'T', 'R', 'J' };
+static const uint32_t TRAJECTORY_VERSION = 1;
+static const int TRAJECTORY_ARRAYS = 5; // mass, x, y, vx, vy
+
+template <typename T>
+static void put(std::vector<char>& buf, T value) {
+    size_t at = buf.size();
+    buf.resize(at + sizeof(T));
+    std::memcpy(&buf[at], &value, sizeof(T));
+}
+
+static size_t frameBytes(uint64_t bodies, bool float32) {
+    return sizeof(TrajectoryFrameHeader) + TRAJECTORY_ARRAYS * bodies * (float32 ? 4 : 8);
+}
+
+// --- Writer ---
+
+TrajectoryWriter::~TrajectoryWriter() {
+    close();
+}
+
+bool TrajectoryWriter::open(const std::string& path, bool useFloat32, std::string& error) {
+    close();
+    file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        error = "cannot create " + path;
+        return false;
+    }
+    float32 = useFloat32;
+
+    TrajectoryHeader header = {};
+    std::memcpy(header.magic, TRAJECTORY_MAGIC, sizeof(header.magic));
+    header.version = TRAJECTORY_VERSION;
+    header.flags = float32 ? uint32_t(TRAJECTORY_FLOAT32) : 0u;
+    if (std::fwrite(&header, sizeof(header), 1, file) != 1) {
+        error = "cannot write " + path;
+        std::fclose(file);
+        file = nullptr;
+        return false;
+    }
+
+    filePath = path;
+    writeError.clear();
+    fileBytes = sizeof(header);
+    index.clear();
+    active.clear();
+    active.reserve(bufferBytes + (1 << 16));
+    stopping = false;
+    hasPending = false;
+    thread = std::thread(&TrajectoryWriter::writerLoop, this);
+    return true;
+}
+
+void TrajectoryWriter::record(const Simulation& sim) {
+    if (!file) return;
+    const auto& bodies = sim.bodies;
+
+    index.push_back(fileBytes + active.size());
+    TrajectoryFrameHeader fh = { static_cast<uint64_t>(sim.stepCount), static_cast<double>(sim.time), bodies.size() };
+    put(active, fh);
+
+    // Structure of arrays: each quantity contiguous within the frame, bodies in external order
+    for (int a = 0; a < TRAJECTORY_ARRAYS; ++a) {
+        for (size_t i = 0; i < bodies.size(); ++i) {
+            const Body& b = bodies[sim.order.slotOf(i)];
+            LD v = a == 0 ? b.mass : a == 1 ? b.position.x : a == 2 ? b.position.y : a == 3 ? b.velocity.x : b.velocity.y;
+            if (float32) put(active, static_cast<float>(v));
+            else put(active, static_cast<double>(v));
+        }
+    }
+
+    if (active.size() >= bufferBytes) handOver();
+}
+
+void TrajectoryWriter::handOver() {
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [this] { return !hasPending; }); // previous buffer still on its way to disk
+    std::swap(active, pending);
+    hasPending = true;
+    fileBytes += pending.size();
+    active.clear();
+    lock.unlock();
+    cv.notify_all();
+}
+
+void TrajectoryWriter::writerLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        cv.wait(lock, [this] { return hasPending || stopping; });
+        if (hasPending) {
+            lock.unlock();
+            bool ok = std::fwrite(pending.data(), 1, pending.size(), file) == pending.size();
+            lock.lock();
+            if (!ok && writeError.empty()) writeError = "short write to " + filePath;
+            pending.clear();
+            hasPending = false;
+            cv.notify_all();
+        }
+        else if (stopping) {
+            return;
+        }
+    }
+}
+
+void TrajectoryWriter::close() {
+    if (!file) return;
+
+    if (!active.empty()) handOver();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    cv.notify_all();
+    thread.join();
+
+    // Index after the last frame, then make the header point at it
+    uint64_t indexOffset = fileBytes;
+    bool ok = std::fwrite(index.data(), sizeof(uint64_t), index.size(), file) == index.size();
+
+    // A header without an index (frameCount/indexOffset 0) makes the reader scan the frames
+    TrajectoryHeader header = {};
+    std::memcpy(header.magic, TRAJECTORY_MAGIC, sizeof(header.magic));
+    header.version = TRAJECTORY_VERSION;
+    header.flags = float32 ? uint32_t(TRAJECTORY_FLOAT32) : 0u;
+    if (ok && writeError.empty()) {
+        header.frameCount = index.size();
+        header.indexOffset = indexOffset;
+    }
+    ok = std::fseek(file, 0, SEEK_SET) == 0 && std::fwrite(&header, sizeof(header), 1, file) == 1 && ok;
+    ok = std::fclose(file) == 0 && ok;
+    file = nullptr;
+    if (!ok && writeError.empty()) writeError = "short write to " + filePath;
+}
+
+std::string TrajectoryWriter::lastError() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return writeError;
+}
+
+// --- Reader ---
+
+TrajectoryReader::~TrajectoryReader() {
+    close();
+}
+
+bool TrajectoryReader::open(const std::string& path, std::string& error) {
+    close();
+
+#ifdef _WIN32
+    HANDLE f = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (f == INVALID_HANDLE_VALUE) {
+        error = "cannot open " + path;
+        return false;
+    }
+    LARGE_INTEGER fileSize;
+    GetFileSizeEx(f, &fileSize);
+    size = static_cast<size_t>(fileSize.QuadPart);
+    HANDLE mapping = size > 0 ? CreateFileMappingA(f, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+    data = mapping ? static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0)) : nullptr;
+    fileHandle = f;
+    mappingHandle = mapping;
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        error = "cannot open " + path;
+        return false;
+    }
+    struct stat st;
+    fstat(fd, &st);
+    size = static_cast<size_t>(st.st_size);
+    void* p = size > 0 ? mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    ::close(fd); // the mapping keeps the file alive
+    data = p == MAP_FAILED ? nullptr : static_cast<const char*>(p);
+#endif
+
+    TrajectoryHeader header;
+    if (!data || size < sizeof(header)) {
+        error = "not a trajectory file: " + path;
+        close();
+        return false;
+    }
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, TRAJECTORY_MAGIC, sizeof(header.magic)) != 0 || header.version != TRAJECTORY_VERSION) {
+        error = "not a trajectory file (or unsupported version): " + path;
+        close();
+        return false;
+    }
+    flags = header.flags;
+
+    // The index is used only if it, and every frame it points at, lies inside the file
+    bool indexed = header.indexOffset >= sizeof(header) && header.indexOffset <= size
+        && header.frameCount <= (size - header.indexOffset) / sizeof(uint64_t);
+    if (indexed) {
+        offsets.resize(header.frameCount);
+        std::memcpy(offsets.data(), data + header.indexOffset, header.frameCount * sizeof(uint64_t));
+        for (uint64_t at : offsets) {
+            if (!frameFits(at, header.indexOffset)) {
+                indexed = false;
+                break;
+            }
+        }
+        if (!indexed) offsets.clear();
+    }
+    if (!indexed) {
+        // No index (the writer did not finish): walk the frames
+        uint64_t at = sizeof(header);
+        while (frameFits(at, size)) {
+            TrajectoryFrameHeader fh;
+            std::memcpy(&fh, data + at, sizeof(fh));
+            offsets.push_back(at);
+            at += frameBytes(fh.bodyCount, isFloat32());
+        }
+    }
+    return true;
+}
+
+bool TrajectoryReader::frameFits(uint64_t at, uint64_t end) const {
+    if (at < sizeof(TrajectoryHeader) || at > end || end - at < sizeof(TrajectoryFrameHeader)) return false;
+    TrajectoryFrameHeader fh;
+    std::memcpy(&fh, data + at, sizeof(fh));
+    // Compare body counts, not byte counts, so a corrupt count cannot overflow
+    const uint64_t elem = isFloat32() ? 4 : 8;
+    return fh.bodyCount <= (end - at - sizeof(fh)) / (TRAJECTORY_ARRAYS * elem);
+}
+
+void TrajectoryReader::close() {
+#ifdef _WIN32
+    if (data) UnmapViewOfFile(data);
+    if (mappingHandle) CloseHandle(mappingHandle);
+    if (fileHandle) CloseHandle(fileHandle);
+    mappingHandle = nullptr;
+    fileHandle = nullptr;
+#else
+    if (data) munmap(const_cast<char*>(data), size);
+#endif
+    data = nullptr;
+    size = 0;
+    offsets.clear();
+}
+
+TrajectoryFrameHeader TrajectoryReader::frameHeader(size_t k) const {
+    TrajectoryFrameHeader fh;
+    std::memcpy(&fh, data + offsets[k], sizeof(fh));
+    return fh;
+}
+
+LD TrajectoryReader::value(size_t k, int array, size_t body) const {
+    const uint64_t n = frameHeader(k).bodyCount;
+    const size_t elem = isFloat32() ? 4 : 8;
+    const char* p = data + offsets[k] + sizeof(TrajectoryFrameHeader) + (array * n + body) * elem;
+    if (isFloat32()) {
+        float f;
+        std::memcpy(&f, p, sizeof(f));
+        return f;
+    }
+    double d;
+    std::memcpy(&d, p, sizeof(d));
+    return d;
+}
+
+void TrajectoryReader::readFrame(size_t k, std::vector<Body>& bodies) const {
+    const size_t n = static_cast<size_t>(frameHeader(k).bodyCount);
+    bodies.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+        Body& b = bodies[i];
+        b.mass = value(k, 0, i);
+        b.position = { value(k, 1, i), value(k, 2, i) };
+        b.velocity = { value(k, 3, i), value(k, 4, i) };
+        b.acceleration = { 0, 0 };
+    }
+}
\ No newline at end of file
@@ -0,0 +1,105 @@
+#pragma once
+#include "helpers.h"
+#include "body.h"
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+
+class Simulation;
+
+// Binary trajectory file (little endian):
+//
+//   header     TrajectoryHeader (64 bytes)
+//   frames     frame header + SoA arrays mass[n], x[n], y[n], vx[n], vy[n]
+//              as float64, or float32 with TRAJECTORY_FLOAT32
+//   index      uint64 file offset of every frame, written on close
+//
+// The header's indexOffset/frameCount are patched on close; a file without
+// an index (crashed writer) is still readable, the reader then scans the frames.
+struct TrajectoryHeader {
+    char magic[8];          // "NBODYTRJ"
+    uint32_t version;
+    uint32_t flags;
+    uint64_t frameCount;
+    uint64_t indexOffset;   // 0 = no index
+    uint8_t reserved[32];
+};
+static_assert(sizeof(TrajectoryHeader) == 64, "trajectory header must stay 64 bytes");
+
+struct TrajectoryFrameHeader {
+    uint64_t step;
+    double time;
+    uint64_t bodyCount;
+};
+static_assert(sizeof(TrajectoryFrameHeader) == 24, "frame header must stay 24 bytes");
+
+enum : uint32_t {
+    TRAJECTORY_FLOAT32 = 1u << 0
+};
+
+// Streams frames to disk from a background thread.
+// record() only serializes into the active buffer; full buffers are swapped
+// with the one the writer thread has finished, so the stepping thread
+// waits only if the disk cannot keep up at all.
+class TrajectoryWriter {
+public:
+    ~TrajectoryWriter();
+
+    bool open(const std::string& path, bool float32, std::string& error);
+    void record(const Simulation& sim);
+    void close(); // flushes, writes the index and patches the header
+    std::string lastError(); // empty while every write succeeded
+
+    size_t bufferBytes = 4 << 20;
+
+private:
+    FILE* file = nullptr;
+    std::string filePath;
+    std::string writeError; // first failed write; the file then gets no index
+    bool float32 = false;
+    uint64_t fileBytes = 0; // bytes already handed over, i.e. offset of the next frame
+    std::vector<uint64_t> index;
+
+    std::vector<char> active;  // filled by record()
+    std::vector<char> pending; // written by the thread
+    bool hasPending = false;
+    bool stopping = false;
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::thread thread;
+
+    void handOver();
+    void writerLoop();
+};
+
+// Random access over a memory-mapped trajectory file: frame k is one index lookup away.
+class TrajectoryReader {
+public:
+    ~TrajectoryReader();
+
+    bool open(const std::string& path, std::string& error);
+    void close();
+
+    size_t frameCount() const { return offsets.size(); }
+    bool isFloat32() const { return (flags & TRAJECTORY_FLOAT32) != 0; }
+
+    TrajectoryFrameHeader frameHeader(size_t k) const;
+    // Rebuilds the bodies of frame k (radius is not stored; accelerations are zero)
+    void readFrame(size_t k, std::vector<Body>& bodies) const;
+    LD value(size_t k, int array, size_t body) const; // array: 0 mass, 1 x, 2 y, 3 vx, 4 vy
+
+private:
+    const char* data = nullptr;
+    size_t size = 0;
+    uint32_t flags = 0;
+    std::vector<uint64_t> offsets;
+
+    bool frameFits(uint64_t at, uint64_t end) const; // a whole frame starts at 'at' and ends by 'end'
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#endif
+};
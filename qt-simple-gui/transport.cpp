@@ -0,0 +1,497 @@
+﻿#include "transport.h"
+#include <algorithm>
+#include <cstring>
+#include <thread>
+#ifndef _WIN32
+#include <cerrno>
+#include <dirent.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+// --- Mailbox ---
+
+void Mailbox::put(int from, int tag, std::vector<char> data) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        queues[{ from, tag }].push_back(std::move(data));
+    }
+    arrived.notify_all();
+}
+
+bool Mailbox::take(int from, int tag, std::vector<char>& data) {
+    std::unique_lock<std::mutex> lock(mutex);
+    auto& queue = queues[{ from, tag }];
+    arrived.wait(lock, [&] {
+        return !queue.empty() || closed || std::find(gone.begin(), gone.end(), from) != gone.end();
+    });
+    // Messages that arrived before the source went away are still delivered
+    if (queue.empty() || closed) return false;
+    data = std::move(queue.front());
+    queue.pop_front();
+    return true;
+}
+
+void Mailbox::disconnect(int from) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        gone.push_back(from);
+    }
+    arrived.notify_all();
+}
+
+void Mailbox::close() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        closed = true;
+    }
+    arrived.notify_all();
+}
+
+// --- Collectives ---
+
+bool Transport::allGather(int tag, const std::vector<char>& mine, std::vector<std::vector<char>>& all) {
+    const int n = size(), me = rank();
+    all.resize(n);
+    for (int r = 0; r < n; ++r) {
+        if (r != me && !send(r, tag, mine)) return false;
+    }
+    all[me] = mine;
+    for (int r = 0; r < n; ++r) {
+        if (r != me && !receive(r, tag, all[r])) return false;
+    }
+    return true;
+}
+
+bool Transport::allReduce(int tag, std::vector<double>& values, Reduce op) {
+    std::vector<char> mine(values.size() * sizeof(double));
+    if (!values.empty()) std::memcpy(mine.data(), values.data(), mine.size());
+    std::vector<std::vector<char>> all;
+    if (!allGather(tag, mine, all)) return false;
+
+    for (size_t r = 0; r < all.size(); ++r) {
+        if (all[r].size() != mine.size()) {
+            failure = "rank " + std::to_string(r) + " sent " + std::to_string(all[r].size() / sizeof(double))
+                + " values to a reduction of " + std::to_string(values.size());
+            return false;
+        }
+    }
+    for (size_t k = 0; k < values.size(); ++k) {
+        double v;
+        std::memcpy(&v, all[0].data() + k * sizeof(double), sizeof(double));
+        for (size_t r = 1; r < all.size(); ++r) {
+            double w;
+            std::memcpy(&w, all[r].data() + k * sizeof(double), sizeof(double));
+            if (op == Reduce::Sum) v += w;
+            else if (op == Reduce::Min) v = std::min(v, w);
+            else v = std::max(v, w);
+        }
+        values[k] = v;
+    }
+    return true;
+}
+
+// --- Local: threads and shared mailboxes ---
+
+namespace {
+
+struct LocalHub {
+    explicit LocalHub(int ranks) : boxes(ranks) {}
+    std::vector<Mailbox> boxes;
+    std::atomic<bool> aborted{ false };
+};
+
+class LocalTransport : public Transport {
+public:
+    LocalTransport(LocalHub& hub, int rank) : hub(hub), me(rank) {}
+
+    int rank() const override { return me; }
+    int size() const override { return static_cast<int>(hub.boxes.size()); }
+
+    bool send(int to, int tag, std::vector<char> data) override {
+        if (hub.aborted) {
+            failure = "run aborted by another rank";
+            return false;
+        }
+        sentBytes += data.size();
+        ++sentMessages;
+        hub.boxes[to].put(me, tag, std::move(data));
+        return true;
+    }
+
+    bool receive(int from, int tag, std::vector<char>& data) override {
+        if (hub.boxes[me].take(from, tag, data)) return true;
+        failure = "run aborted by another rank";
+        return false;
+    }
+
+    void abort() override {
+        hub.aborted = true;
+        for (auto& box : hub.boxes) box.close();
+    }
+
+    bool linkBroken() const { return hub.aborted; }
+
+private:
+    LocalHub& hub;
+    int me;
+};
+
+// Keeps the error of the rank that failed first on its own account;
+// ranks that only failed because the run was aborted come second
+struct RankFailures {
+    std::mutex mutex;
+    std::string first;
+    bool firstIsOwn = false;
+
+    void add(int rank, const std::string& message, bool own) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!first.empty() && (firstIsOwn || !own)) return;
+        first = "rank " + std::to_string(rank) + ": " + (message.empty() ? std::string("failed") : message);
+        firstIsOwn = own;
+    }
+};
+
+bool runLocal(int ranks, const std::function<bool(Transport&, std::string&)>& rankMain, std::string& error) {
+    LocalHub hub(ranks);
+    RankFailures failures;
+    auto runRank = [&](int r) {
+        LocalTransport transport(hub, r);
+        std::string message;
+        bool ok = rankMain(transport, message);
+        if (ok) return;
+        const bool own = !transport.linkBroken();
+        if (message.empty()) message = transport.error();
+        failures.add(r, message, own);
+        transport.abort();
+    };
+
+    std::vector<std::thread> threads;
+    for (int r = 1; r < ranks; ++r) threads.emplace_back(runRank, r);
+    runRank(0);
+    for (auto& t : threads) t.join();
+
+    if (failures.first.empty()) return true;
+    error = failures.first;
+    return false;
+}
+
+#ifndef _WIN32
+
+// --- Socket: forked processes, one stream socket per pair of ranks ---
+//
+// A message on the wire is a header (tag, payload size) and the payload.
+// One reader thread per peer moves incoming messages into the mailbox, so a peer's
+// writes never block on this rank being busy; one writer thread sends the queued messages.
+
+struct WireHeader {
+    int32_t tag;
+    uint32_t reserved;
+    uint64_t size;
+};
+
+// Sockets are written with send(), so a peer that is gone does not raise SIGPIPE
+bool writeAll(int fd, const char* p, size_t n, bool socket = true) {
+    while (n > 0) {
+#ifdef MSG_NOSIGNAL
+        ssize_t k = socket ? ::send(fd, p, n, MSG_NOSIGNAL) : ::write(fd, p, n);
+#else
+        ssize_t k = ::write(fd, p, n);
+        (void)socket;
+#endif
+        if (k < 0 && errno == EINTR) continue;
+        if (k <= 0) return false;
+        p += k;
+        n -= static_cast<size_t>(k);
+    }
+    return true;
+}
+
+bool readAll(int fd, char* p, size_t n) {
+    while (n > 0) {
+        ssize_t k = ::read(fd, p, n);
+        if (k < 0 && errno == EINTR) continue;
+        if (k <= 0) return false;
+        p += k;
+        n -= static_cast<size_t>(k);
+    }
+    return true;
+}
+
+class SocketTransport : public Transport {
+public:
+    // peers[r] = socket connected to rank r, -1 for this rank
+    SocketTransport(int rank, std::vector<int> peers) : me(rank), fds(std::move(peers)) {
+        for (int r = 0; r < static_cast<int>(fds.size()); ++r) {
+            if (fds[r] >= 0) readers.emplace_back(&SocketTransport::readLoop, this, r);
+        }
+        writer = std::thread(&SocketTransport::writeLoop, this);
+    }
+
+    // Delivers everything still queued, then waits until every peer has hung up
+    ~SocketTransport() override {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        writer.join();
+        for (int fd : fds) {
+            if (fd >= 0) ::shutdown(fd, SHUT_WR);
+        }
+        for (auto& t : readers) t.join();
+        for (int fd : fds) {
+            if (fd >= 0) ::close(fd);
+        }
+    }
+
+    int rank() const override { return me; }
+    int size() const override { return static_cast<int>(fds.size()); }
+
+    bool send(int to, int tag, std::vector<char> data) override {
+        if (broken) {
+            failure = "lost the connection to another rank";
+            return false;
+        }
+        sentBytes += data.size();
+        ++sentMessages;
+        if (to == me) {
+            inbox.put(me, tag, std::move(data));
+            return true;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            queue.push_back({ to, tag, std::move(data) });
+        }
+        wake.notify_all();
+        return true;
+    }
+
+    bool receive(int from, int tag, std::vector<char>& data) override {
+        if (inbox.take(from, tag, data)) return true;
+        broken = true;
+        failure = "lost the connection to rank " + std::to_string(from);
+        return false;
+    }
+
+    void abort() override {
+        broken = true;
+        inbox.close();
+        for (int fd : fds) {
+            if (fd >= 0) ::shutdown(fd, SHUT_RDWR);
+        }
+    }
+
+    bool linkBroken() const { return broken; }
+
+private:
+    struct Outgoing {
+        int to, tag;
+        std::vector<char> data;
+    };
+
+    int me;
+    std::vector<int> fds;
+    Mailbox inbox;
+    std::vector<std::thread> readers;
+    std::thread writer;
+    std::atomic<bool> broken{ false };
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<Outgoing> queue;
+    bool stopping = false;
+
+    void readLoop(int from) {
+        while (true) {
+            WireHeader h;
+            if (!readAll(fds[from], reinterpret_cast<char*>(&h), sizeof(h))) break;
+            std::vector<char> data(h.size);
+            if (!readAll(fds[from], data.data(), data.size())) break;
+            inbox.put(from, h.tag, std::move(data));
+        }
+        inbox.disconnect(from);
+    }
+
+    void writeLoop() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            wake.wait(lock, [&] { return stopping || !queue.empty(); });
+            if (queue.empty()) return; // stopping with nothing left
+            Outgoing m = std::move(queue.front());
+            queue.pop_front();
+            lock.unlock();
+            WireHeader h = { m.tag, 0, m.data.size() };
+            if (!broken && !(writeAll(fds[m.to], reinterpret_cast<const char*>(&h), sizeof(h))
+                && writeAll(fds[m.to], m.data.data(), m.data.size()))) {
+                broken = true; // the peer is gone; its reader reports it to receive()
+            }
+            lock.lock();
+        }
+    }
+};
+
+// Threads of this process, or 0 where the platform does not tell
+static int processThreads() {
+#ifdef __linux__
+    DIR* dir = ::opendir("/proc/self/task");
+    if (!dir) return 0;
+    int count = 0;
+    while (const dirent* entry = ::readdir(dir)) {
+        if (entry->d_name[0] != '.') ++count;
+    }
+    ::closedir(dir);
+    return count;
+#else
+    return 0;
+#endif
+}
+
+bool runSockets(int ranks, const std::function<bool(Transport&, std::string&)>& rankMain, std::string& error) {
+    // A forked child gets only the calling thread; locks the others hold would never be released
+    const int running = processThreads();
+    if (ranks > 1 && running > 1) {
+        error = "socket ranks must be forked before the process starts threads (" + std::to_string(running) + " running)";
+        return false;
+    }
+
+    // pair[i][j] is rank i's end of the socket to rank j
+    std::vector<std::vector<int>> pair(ranks, std::vector<int>(ranks, -1));
+    auto closeAll = [&](int keep) {
+        for (int i = 0; i < ranks; ++i) {
+            if (i == keep) continue;
+            for (int& fd : pair[i]) {
+                if (fd >= 0) ::close(fd);
+                fd = -1;
+            }
+        }
+    };
+    for (int i = 0; i < ranks; ++i) {
+        for (int j = i + 1; j < ranks; ++j) {
+            int sv[2];
+            if (::socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0) {
+                error = std::string("socketpair: ") + std::strerror(errno);
+                closeAll(-1);
+                return false;
+            }
+            pair[i][j] = sv[0];
+            pair[j][i] = sv[1];
+#ifdef SO_NOSIGPIPE
+            int on = 1;
+            ::setsockopt(sv[0], SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+            ::setsockopt(sv[1], SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+        }
+    }
+
+    // Each child reports its error message through a pipe
+    std::vector<pid_t> children(ranks, -1);
+    std::vector<int> messages(ranks, -1);
+    for (int r = 1; r < ranks; ++r) {
+        int pipeFds[2];
+        if (::pipe(pipeFds) != 0) {
+            error = std::string("pipe: ") + std::strerror(errno);
+            break;
+        }
+        pid_t pid = ::fork();
+        if (pid == 0) {
+            ::close(pipeFds[0]);
+            for (int k = 1; k < r; ++k) ::close(messages[k]);
+            closeAll(r);
+            bool ok;
+            bool own;
+            std::string message;
+            {
+                SocketTransport transport(r, pair[r]);
+                ok = rankMain(transport, message);
+                own = !transport.linkBroken();
+                if (!ok) {
+                    if (message.empty()) message = transport.error();
+                    transport.abort();
+                }
+            }
+            if (!ok) {
+                message.insert(0, own ? "+" : "-");
+                writeAll(pipeFds[1], message.data(), message.size(), false);
+            }
+            ::_exit(ok ? 0 : 1);
+        }
+        ::close(pipeFds[1]);
+        if (pid < 0) {
+            ::close(pipeFds[0]);
+            error = std::string("fork: ") + std::strerror(errno);
+            break;
+        }
+        children[r] = pid;
+        messages[r] = pipeFds[0];
+    }
+
+    RankFailures failures;
+    const bool launched = error.empty();
+    closeAll(0);
+    if (launched) {
+        SocketTransport transport(0, pair[0]);
+        std::string message;
+        if (!rankMain(transport, message)) {
+            failures.add(0, message.empty() ? transport.error() : message, !transport.linkBroken());
+            transport.abort();
+        }
+    }
+    else {
+        // Not every rank could start: the ones that did lose rank 0 and give up
+        for (int fd : pair[0]) {
+            if (fd >= 0) ::close(fd);
+        }
+    }
+
+    for (int r = 1; r < ranks; ++r) {
+        if (children[r] < 0) continue;
+        std::string text;
+        char buffer[256];
+        ssize_t k;
+        while ((k = ::read(messages[r], buffer, sizeof(buffer))) > 0 || (k < 0 && errno == EINTR)) {
+            if (k > 0) text.append(buffer, static_cast<size_t>(k));
+        }
+        ::close(messages[r]);
+        int status = 0;
+        while (::waitpid(children[r], &status, 0) < 0 && errno == EINTR) {}
+        if (WIFEXITED(status) && WEXITSTATUS(status) == 0) continue;
+        if (!text.empty()) failures.add(r, text.substr(1), text[0] == '+');
+        else failures.add(r, WIFSIGNALED(status) ? "killed by signal " + std::to_string(WTERMSIG(status)) : std::string(), true);
+    }
+
+    if (!launched) return false;
+    if (failures.first.empty()) return true;
+    error = failures.first;
+    return false;
+}
+
+#endif
+
+}
+
+bool runRanks(TransportType type, int ranks, const std::function<bool(Transport&, std::string&)>& rankMain, std::string& error) {
+    if (ranks < 1) {
+        error = "at least one rank is needed";
+        return false;
+    }
+    if (type == TransportType::Local) return runLocal(ranks, rankMain, error);
+#ifdef _WIN32
+    error = "the socket transport needs a POSIX system, use the local one";
+    return false;
+#else
+    return runSockets(ranks, rankMain, error);
+#endif
+}
+
+bool parseTransport(const std::string& s, TransportType& out) {
+    if (s == "local") out = TransportType::Local;
+    else if (s == "socket") out = TransportType::Socket;
+    else return false;
+    return true;
+}
+
+const char* transportName(TransportType type) {
+    return type == TransportType::Socket ? "Unix sockets" : "shared memory";
+}
\ No newline at end of file
@@ -0,0 +1,82 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+enum class TransportType {
+    Local, // ranks are threads of one process, messages are handed over in shared memory
+    Socket // ranks are forked processes connected by Unix domain sockets (POSIX only)
+};
+
+// Incoming messages of one rank, queued per (source rank, tag)
+class Mailbox {
+public:
+    void put(int from, int tag, std::vector<char> data);
+    // Waits for the next message from 'from' with 'tag'; false once that source is gone (or after close())
+    bool take(int from, int tag, std::vector<char>& data);
+    void disconnect(int from); // no more messages will come from this source
+    void close();              // wakes every waiting take() with false
+
+private:
+    std::mutex mutex;
+    std::condition_variable arrived;
+    std::map<std::pair<int, int>, std::deque<std::vector<char>>> queues;
+    std::vector<int> gone;
+    bool closed = false;
+};
+
+// Message passing between the ranks of a decomposed run (see domain.h).
+//
+// A message is a byte buffer with a tag. receive() waits for the next message from
+// one source with one tag, so messages with the same source and tag arrive in order;
+// send() never waits for the receiver, which lets a rank post its exports and go on computing.
+// Collectives are built from send/receive: every rank has to call them in the same order.
+class Transport {
+public:
+    virtual ~Transport() = default;
+
+    virtual int rank() const = 0;
+    virtual int size() const = 0;
+
+    // Both return false with error() set once the link is broken (a rank failed or exited)
+    virtual bool send(int to, int tag, std::vector<char> data) = 0;
+    virtual bool receive(int from, int tag, std::vector<char>& data) = 0;
+
+    // Gives up on the run: every rank's pending and later receives fail
+    virtual void abort() = 0;
+
+    // all[r] = the buffer rank r passed in
+    bool allGather(int tag, const std::vector<char>& mine, std::vector<std::vector<char>>& all);
+
+    // Element-wise over all ranks, reduced in rank order so that every rank gets the same bits
+    enum class Reduce { Sum, Min, Max };
+    bool allReduce(int tag, std::vector<double>& values, Reduce op = Reduce::Sum);
+
+    const std::string& error() const { return failure; }
+    uint64_t bytesSent() const { return sentBytes; }
+    uint64_t messagesSent() const { return sentMessages; }
+
+protected:
+    std::string failure;
+    std::atomic<uint64_t> sentBytes{ 0 };
+    std::atomic<uint64_t> sentMessages{ 0 };
+};
+
+// Runs rankMain once per rank on 'ranks' connected ranks and waits for all of them.
+// Local ranks are threads of this process. Socket ranks are forked processes, rank 0 being
+// the calling one, so only what rank 0 leaves behind is visible afterwards; fork before the
+// process has started threads of its own (checked on Linux, where the run fails otherwise).
+// A rank that returns false aborts the run.
+// Returns false with 'error' set (the first failing rank's message) if any rank failed.
+bool runRanks(TransportType type, int ranks, const std::function<bool(Transport&, std::string&)>& rankMain, std::string& error);
+
+bool parseTransport(const std::string& s, TransportType& out);
+const char* transportName(TransportType type);
\ No newline at end of file
@@ -0,0 +1,34 @@
+#pragma once
+#include <atomic>
+
+// Lock-free single-producer/single-consumer handoff of the latest value.
+// The writer fills writeSlot() and publish()es it; the reader calls update() and
+// then reads front(), which stays untouched by the writer until the next update().
+// Values the reader did not get to are simply overwritten.
+template <typename T>
+class TripleBuffer {
+public:
+    T& writeSlot() { return slots[back]; }
+
+    void publish() {
+        back = middle.exchange(back | FRESH, std::memory_order_acq_rel) & INDEX;
+    }
+
+    // Returns true if a newer value became the front one
+    bool update() {
+        if ((middle.load(std::memory_order_acquire) & FRESH) == 0) return false;
+        frontIndex = middle.exchange(frontIndex, std::memory_order_acq_rel) & INDEX;
+        return true;
+    }
+
+    const T& front() const { return slots[frontIndex]; }
+
+private:
+    static constexpr int INDEX = 3;
+    static constexpr int FRESH = 4;
+
+    T slots[3];
+    int back = 0;                 // writer only
+    std::atomic<int> middle{ 1 }; // shared: slot index + FRESH flag
+    int frontIndex = 2;           // reader only
+};
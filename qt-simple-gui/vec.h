@@ -0,0 +1,71 @@
+#pragma once
+#include "helpers.h"
+
+// Fixed-size vector of the physics core, D = 2 or 3 components of type T.
+// Everything is inline and branch-free, so a loop over Vec<D, T> compiles to
+// the same code as hand-written x/y(/z) arithmetic.
+//
+// The 3D vector carries a fourth lane that is always zero and is aligned to its
+// full size: Vec<3, float> fills one 128-bit register and Vec<3, double> one
+// 256-bit register, and the operators touch all four lanes so the compiler can
+// use a single vector instruction for each of them. Over-aligned values are
+// passed by reference (MSVC cannot pass them by value on 32-bit targets).
+template <int D, typename T>
+struct Vec;
+
+template <typename T>
+struct Vec<2, T> {
+    static constexpr int LANES = 2;
+
+    T x = 0, y = 0;
+
+    Vec operator+(Vec o) const { return { x + o.x, y + o.y }; }
+    Vec operator-(Vec o) const { return { x - o.x, y - o.y }; }
+    Vec operator-() const { return { -x, -y }; }
+    Vec operator*(T s) const { return { x * s, y * s }; }
+    Vec& operator+=(Vec o) { x += o.x; y += o.y; return *this; }
+    Vec& operator-=(Vec o) { x -= o.x; y -= o.y; return *this; }
+
+    T dot(Vec o) const { return x * o.x + y * o.y; }
+    T norm() const { return std::sqrt(x * x + y * y); }
+};
+
+template <typename T>
+struct alignas(4 * sizeof(T)) Vec<3, T> {
+    static constexpr int LANES = 4;
+
+    T x = 0, y = 0, z = 0;
+    T w = 0; // padding lane, stays zero
+
+    Vec operator+(const Vec& o) const { return { x + o.x, y + o.y, z + o.z, w + o.w }; }
+    Vec operator-(const Vec& o) const { return { x - o.x, y - o.y, z - o.z, w - o.w }; }
+    Vec operator-() const { return { -x, -y, -z, -w }; }
+    Vec operator*(T s) const { return { x * s, y * s, z * s, w * s }; }
+    Vec& operator+=(const Vec& o) { x += o.x; y += o.y; z += o.z; w += o.w; return *this; }
+    Vec& operator-=(const Vec& o) { x -= o.x; y -= o.y; z -= o.z; w -= o.w; return *this; }
+
+    T dot(const Vec& o) const { return x * o.x + y * o.y + z * o.z; }
+    T norm() const { return std::sqrt(x * x + y * y + z * z); }
+    Vec cross(const Vec& o) const { return { y * o.z - z * o.y, z * o.x - x * o.z, x * o.y - y * o.x }; }
+};
+
+// "(x, y)" / "(x, y, z)" in scientific notation; the GUI formats with MainWindow::formatVec2 instead
+template <typename T>
+std::ostream& operator<<(std::ostream& os, const Vec<2, T>& v) {
+    std::ios::fmtflags flags = os.flags();
+    std::streamsize precision = os.precision();
+    os << std::scientific << std::setprecision(6) << "(" << v.x << ", " << v.y << ")";
+    os.flags(flags);
+    os.precision(precision);
+    return os;
+}
+
+template <typename T>
+std::ostream& operator<<(std::ostream& os, const Vec<3, T>& v) {
+    std::ios::fmtflags flags = os.flags();
+    std::streamsize precision = os.precision();
+    os << std::scientific << std::setprecision(6) << "(" << v.x << ", " << v.y << ", " << v.z << ")";
+    os.flags(flags);
+    os.precision(precision);
+    return os;
+}
\ No newline at end of file